@@ -0,0 +1,263 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "dyn_array.h"
+
+/*
+	dyn_array benchmark notes!
+
+	Every benchmark takes {array length, object size in bytes}. 16 bytes is a ProcessControlBlock_t,
+	  64 and 256 stand in for bigger payloads. Objects are keyed by their first 8 bytes.
+
+	The single object operations keep the array at the same length by pairing each one with an O(1)
+	  operation at the back (push_front with pop_back, extract_front with push_back, etc),
+	  so every iteration sees the same array and the time is dominated by the operation named.
+
+	Allocation and memmove profiles come from dyn_array's stats counters and are reported per iteration:
+	  reallocs, bytes_copied and bytes_moved.
+
+	Output is JSON unless --benchmark_format says otherwise, so results can be collected over time.
+*/
+
+static uint64_t next_random(uint64_t& state)
+{
+	// xorshift64*, plenty for generating keys
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 2685821657736338717ull;
+}
+
+static int compare_key(const void* a, const void* b)
+{
+	uint64_t key_a, key_b;
+	memcpy(&key_a, a, sizeof(key_a));
+	memcpy(&key_b, b, sizeof(key_b));
+	return (key_a > key_b) - (key_a < key_b);
+}
+
+// A zeroed object of the benchmark's size with the given key
+static std::vector<uint8_t> make_object(const benchmark::State& state, const uint64_t key)
+{
+	std::vector<uint8_t> object((size_t)state.range(1), 0);
+	memcpy(object.data(), &key, sizeof(key));
+	return object;
+}
+
+// An array of the benchmark's length and object size with random keys
+static dyn_array_t* make_array(const benchmark::State& state, const bool sorted)
+{
+	const size_t length = (size_t)state.range(0);
+	const size_t object_size = (size_t)state.range(1);
+	dyn_array_t* array = dyn_array_create(length, object_size, NULL);
+	uint64_t random_state = 0x9E3779B97F4A7C15ull;
+	for (size_t i = 0; i < length; i++)
+	{
+		dyn_array_push_back(array, make_object(state, next_random(random_state)).data());
+	}
+	if (sorted) { dyn_array_sort(array, compare_key); }
+	return array;
+}
+
+// Turns the array's stats into per iteration counters, along with bytes processed
+static void report(benchmark::State& state, const dyn_array_t* array, const size_t objects_per_iteration)
+{
+	dyn_array_stats_t stats;
+	if (dyn_array_get_stats(array, &stats))
+	{
+		state.counters["reallocs"] = benchmark::Counter((double)stats.reallocs, benchmark::Counter::kAvgIterations);
+		state.counters["bytes_copied"] = benchmark::Counter((double)stats.bytes_copied, benchmark::Counter::kAvgIterations);
+		state.counters["bytes_moved"] = benchmark::Counter((double)stats.bytes_moved, benchmark::Counter::kAvgIterations);
+	}
+	state.SetBytesProcessed((int64_t)(state.iterations() * objects_per_iteration * state.range(1)));
+}
+
+// Growth from zero capacity, a whole array per iteration
+static void BM_push_back_from_empty(benchmark::State& state)
+{
+	const size_t length = (size_t)state.range(0);
+	const std::vector<uint8_t> object = make_object(state, 1);
+	dyn_array_stats_t total = { 0, 0, 0, 0 };
+	for (auto _ : state)
+	{
+		dyn_array_t* array = dyn_array_create(0, (size_t)state.range(1), NULL);
+		dyn_array_enable_stats(array);
+		for (size_t i = 0; i < length; i++) { dyn_array_push_back(array, object.data()); }
+		benchmark::DoNotOptimize(dyn_array_export(array));
+
+		dyn_array_stats_t stats;
+		dyn_array_get_stats(array, &stats);
+		total.reallocs += stats.reallocs;
+		total.bytes_copied += stats.bytes_copied;
+		total.bytes_moved += stats.bytes_moved;
+		dyn_array_destroy(array);
+	}
+	state.counters["reallocs"] = benchmark::Counter((double)total.reallocs, benchmark::Counter::kAvgIterations);
+	state.counters["bytes_copied"] = benchmark::Counter((double)total.bytes_copied, benchmark::Counter::kAvgIterations);
+	state.counters["bytes_moved"] = benchmark::Counter((double)total.bytes_moved, benchmark::Counter::kAvgIterations);
+	state.SetBytesProcessed((int64_t)(state.iterations() * length * state.range(1)));
+}
+
+static void BM_push_back(benchmark::State& state)
+{
+	dyn_array_t* array = make_array(state, false);
+	const std::vector<uint8_t> object = make_object(state, 1);
+	dyn_array_enable_stats(array);
+	for (auto _ : state)
+	{
+		dyn_array_push_back(array, object.data());
+		dyn_array_pop_back(array);
+	}
+	report(state, array, 1);
+	dyn_array_destroy(array);
+}
+
+static void BM_push_front(benchmark::State& state)
+{
+	dyn_array_t* array = make_array(state, false);
+	const std::vector<uint8_t> object = make_object(state, 1);
+	dyn_array_enable_stats(array);
+	for (auto _ : state)
+	{
+		dyn_array_push_front(array, object.data());
+		dyn_array_pop_back(array);
+	}
+	report(state, array, 1);
+	dyn_array_destroy(array);
+}
+
+static void BM_insert_middle(benchmark::State& state)
+{
+	dyn_array_t* array = make_array(state, false);
+	const std::vector<uint8_t> object = make_object(state, 1);
+	dyn_array_enable_stats(array);
+	for (auto _ : state)
+	{
+		dyn_array_insert(array, dyn_array_size(array) / 2, object.data());
+		dyn_array_pop_back(array);
+	}
+	report(state, array, 1);
+	dyn_array_destroy(array);
+}
+
+// Extracts at a fraction of the way into the array (0 front, 1 middle, 2 back) and pushes it back on the end
+template <int Where>
+static void BM_extract(benchmark::State& state)
+{
+	dyn_array_t* array = make_array(state, false);
+	std::vector<uint8_t> object = make_object(state, 0);
+	dyn_array_enable_stats(array);
+	for (auto _ : state)
+	{
+		const size_t size = dyn_array_size(array);
+		dyn_array_extract(array, Where == 0 ? 0 : Where == 1 ? size / 2 : size - 1, object.data());
+		dyn_array_push_back(array, object.data());
+	}
+	report(state, array, 1);
+	dyn_array_destroy(array);
+}
+
+static void BM_insert_sorted(benchmark::State& state)
+{
+	dyn_array_t* array = make_array(state, true);
+	std::vector<uint8_t> object = make_object(state, 0);
+	uint64_t random_state = 0xD1B54A32D192ED03ull;
+	dyn_array_enable_stats(array);
+	for (auto _ : state)
+	{
+		const uint64_t key = next_random(random_state);
+		memcpy(object.data(), &key, sizeof(key));
+		dyn_array_insert_sorted(array, object.data(), compare_key);
+		// Dropping the biggest key keeps it sorted
+		dyn_array_pop_back(array);
+	}
+	report(state, array, 1);
+	dyn_array_destroy(array);
+}
+
+static void BM_sort(benchmark::State& state)
+{
+	dyn_array_t* unsorted = make_array(state, false);
+	for (auto _ : state)
+	{
+		// Every iteration sorts the same shuffled array, the copy is made off the clock
+		state.PauseTiming();
+		dyn_array_t* array = dyn_array_import(dyn_array_export(unsorted), dyn_array_size(unsorted), (size_t)state.range(1), NULL);
+		state.ResumeTiming();
+		dyn_array_sort(array, compare_key);
+		benchmark::DoNotOptimize(dyn_array_export(array));
+		state.PauseTiming();
+		dyn_array_destroy(array);
+		state.ResumeTiming();
+	}
+	state.SetBytesProcessed((int64_t)(state.iterations() * state.range(0) * state.range(1)));
+	dyn_array_destroy(unsorted);
+}
+
+static void sum_key(void* const object, void* total)
+{
+	uint64_t key;
+	memcpy(&key, object, sizeof(key));
+	*(uint64_t*)total += key;
+}
+
+static void BM_for_each(benchmark::State& state)
+{
+	dyn_array_t* array = make_array(state, false);
+	for (auto _ : state)
+	{
+		uint64_t total = 0;
+		dyn_array_for_each(array, sum_key, &total);
+		benchmark::DoNotOptimize(total);
+	}
+	state.SetBytesProcessed((int64_t)(state.iterations() * state.range(0) * state.range(1)));
+	dyn_array_destroy(array);
+}
+
+// Lengths 2^10, 2^14 and 2^18 for each object size
+static void sizes(benchmark::internal::Benchmark* benchmark)
+{
+	benchmark->ArgNames({ "length", "object_size" });
+	for (int64_t object_size : { 16, 64, 256 })
+	{
+		for (int64_t length = 1 << 10; length <= 1 << 18; length <<= 4)
+		{
+			benchmark->Args({ length, object_size });
+		}
+	}
+}
+
+BENCHMARK(BM_push_back_from_empty)->Apply(sizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_push_back)->Apply(sizes);
+BENCHMARK(BM_push_front)->Apply(sizes);
+BENCHMARK(BM_insert_middle)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_extract, 0)->Name("BM_extract_front")->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_extract, 1)->Name("BM_extract_middle")->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_extract, 2)->Name("BM_extract_back")->Apply(sizes);
+BENCHMARK(BM_insert_sorted)->Apply(sizes);
+BENCHMARK(BM_sort)->Apply(sizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_for_each)->Apply(sizes)->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv)
+{
+	// JSON unless asked for something else
+	std::vector<char*> args(argv, argv + argc);
+	static char json_format[] = "--benchmark_format=json";
+	bool format_given = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]).compare(0, 18, "--benchmark_format") == 0) { format_given = true; }
+	}
+	if (!format_given) { args.insert(args.begin() + 1, json_format); }
+
+	int arg_count = (int)args.size();
+	benchmark::Initialize(&arg_count, args.data());
+	if (benchmark::ReportUnrecognizedArguments(arg_count, args.data())) { return 1; }
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,413 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <pthread.h>
+
+#include "dyn_array.h"
+#include "pcb_channel.h"
+#include "pcb_columns.h"
+#include "processing_scheduling.h"
+
+/*
+	Scheduler benchmark notes!
+
+	Every benchmark takes {pcb count, arrival density, burst distribution} (and a quantum for round robin).
+
+	Arrival density is how fast processes show up compared to how fast the CPU gets through them:
+	  BACKLOG - everything arrives in the first tenth of the run, the ready queue gets huge
+	  BALANCED - arrivals keep pace with the CPU, the ready queue stays small
+	  SPARSE - arrivals are twice as far apart as the bursts, the CPU idles a lot
+
+	Burst distributions:
+	  UNIFORM - bursts spread evenly over 1-100
+	  HEAVY_TAIL - mostly short bursts (1-10) with the odd long one (100-1000)
+
+	Workloads are generated from a fixed seed, so runs are comparable.
+	Counters: PCBs/s is throughput, time/decision is time per dispatch (a process getting the CPU).
+
+	The parallel benchmarks run schedule_parallel on the SPARSE workloads (the ones with idle gaps to split at),
+	  on every CPU. They use wall clock time, compare them with the single threaded runs above.
+
+	The refresh benchmarks time one refresh of a live trace with {history, new pcbs}: a simulation handle
+	  appending the new PCBs and advancing, against rerunning shortest_job_first over everything.
+
+	The argmin benchmarks scan {pcb count} PCBs for the shortest burst that hasn't started (about a
+	  quarter have), once over the ProcessControlBlock_t array and once per pcb_columns kernel.
+*/
+
+enum ArrivalDensity { BACKLOG, BALANCED, SPARSE };
+enum BurstDistribution { UNIFORM, HEAVY_TAIL };
+
+struct Workload
+{
+	int64_t count;
+	int64_t density;
+	int64_t distribution;
+	dyn_array_t* pcbs;
+};
+
+static uint32_t next_random(uint64_t& state)
+{
+	// xorshift64*, plenty for generating traces
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return (uint32_t)((state * 2685821657736338717ull) >> 32);
+}
+
+// Builds (or reuses) the workload for the benchmark's arguments
+// Benchmarks run in registration order, so keeping only the last one around saves memory with big traces
+static const dyn_array_t* get_workload(const benchmark::State& state)
+{
+	static Workload cached = { 0, 0, 0, NULL };
+	const int64_t count = state.range(0);
+	const int64_t density = state.range(1);
+	const int64_t distribution = state.range(2);
+	if (cached.pcbs != NULL && cached.count == count && cached.density == density && cached.distribution == distribution)
+	{
+		return cached.pcbs;
+	}
+	dyn_array_destroy(cached.pcbs);
+
+	dyn_array_t* pcbs = dyn_array_create(count, sizeof(ProcessControlBlock_t), NULL);
+	uint64_t random_state = 0x9E3779B97F4A7C15ull;
+	// Mean burst is ~50 for UNIFORM and ~60 for HEAVY_TAIL, pick the arrival spread from that
+	const uint64_t mean_burst = distribution == UNIFORM ? 50 : 60;
+	const uint64_t arrival_span = density == BACKLOG ? count * mean_burst / 10 : density == BALANCED ? count * mean_burst : count * mean_burst * 2;
+	for (int64_t i = 0; i < count; i++)
+	{
+		ProcessControlBlock_t pcb;
+		if (distribution == UNIFORM) { pcb.remaining_burst_time = 1 + next_random(random_state) % 100; }
+		else if (next_random(random_state) % 10) { pcb.remaining_burst_time = 1 + next_random(random_state) % 10; }
+		else { pcb.remaining_burst_time = 100 + next_random(random_state) % 901; }
+		pcb.priority = next_random(random_state) % 16;
+		// Arrivals go up in order (like a real trace) with some jitter between them
+		pcb.arrival = (uint32_t)(arrival_span * i / count + next_random(random_state) % (2 * mean_burst));
+		pcb.started = false;
+		dyn_array_push_back(pcbs, &pcb);
+	}
+	cached = { count, density, distribution, pcbs };
+	return pcbs;
+}
+
+static void set_counters(benchmark::State& state, const int64_t decisions)
+{
+	state.counters["PCBs/s"] = benchmark::Counter((double)state.range(0), benchmark::Counter::kIsIterationInvariantRate);
+	// An inverted rate comes out as seconds per decision, printed with an SI prefix (ns, us)
+	state.counters["time/decision"] = benchmark::Counter((double)decisions,
+		benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+template <bool (*Scheduler)(dyn_array_t*, ScheduleResult_t*)>
+static void BM_nonpreemptive(benchmark::State& state)
+{
+	// These don't touch their input, the workload is shared by every iteration
+	dyn_array_t* pcbs = const_cast<dyn_array_t*>(get_workload(state));
+	ScheduleResult_t result;
+	for (auto _ : state)
+	{
+		if (!Scheduler(pcbs, &result)) { state.SkipWithError("scheduler failed"); break; }
+		benchmark::DoNotOptimize(result);
+	}
+	// Each process gets the CPU exactly once
+	set_counters(state, state.range(0));
+}
+
+static void BM_shortest_remaining_time_first(benchmark::State& state)
+{
+	dyn_array_t* pcbs = const_cast<dyn_array_t*>(get_workload(state));
+	ScheduleResult_t result;
+
+	// Preemptions depend on the run, so count the dispatches of one run (off the clock) if the library can
+	ScheduleStats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	const bool counted = schedule_stats_attach(&stats) && shortest_remaining_time_first(pcbs, &result);
+	schedule_stats_attach(NULL);
+
+	for (auto _ : state)
+	{
+		if (!shortest_remaining_time_first(pcbs, &result)) { state.SkipWithError("scheduler failed"); break; }
+		benchmark::DoNotOptimize(result);
+	}
+	if (counted) { set_counters(state, (int64_t)stats.selections); }
+	else { state.counters["PCBs/s"] = benchmark::Counter((double)state.range(0), benchmark::Counter::kIsIterationInvariantRate); }
+}
+
+static void BM_round_robin(benchmark::State& state)
+{
+	const dyn_array_t* pcbs = get_workload(state);
+	const size_t quantum = (size_t)state.range(3);
+	ScheduleResult_t result;
+
+	// Every slice is one dispatch, a process needs ceil(burst / quantum) of them
+	int64_t decisions = 0;
+	for (size_t i = 0; i < dyn_array_size(pcbs); i++)
+	{
+		decisions += (((const ProcessControlBlock_t*)dyn_array_export(pcbs))[i].remaining_burst_time + quantum - 1) / quantum;
+	}
+
+	for (auto _ : state)
+	{
+		if (!round_robin(const_cast<dyn_array_t*>(pcbs), &result, quantum)) { state.SkipWithError("scheduler failed"); break; }
+		benchmark::DoNotOptimize(result);
+	}
+	set_counters(state, decisions);
+}
+
+template <bool (*Scheduler)(dyn_array_t*, ScheduleResult_t*)>
+static void BM_parallel(benchmark::State& state)
+{
+	dyn_array_t* pcbs = const_cast<dyn_array_t*>(get_workload(state));
+	ScheduleResult_t result;
+	for (auto _ : state)
+	{
+		if (!schedule_parallel(pcbs, Scheduler, &result)) { state.SkipWithError("scheduler failed"); break; }
+		benchmark::DoNotOptimize(result);
+	}
+	set_counters(state, state.range(0));
+}
+
+static void BM_round_robin_parallel(benchmark::State& state)
+{
+	dyn_array_t* pcbs = const_cast<dyn_array_t*>(get_workload(state));
+	ScheduleResult_t result;
+	for (auto _ : state)
+	{
+		if (!round_robin_parallel(pcbs, (size_t)state.range(3), &result)) { state.SkipWithError("scheduler failed"); break; }
+		benchmark::DoNotOptimize(result);
+	}
+	state.counters["PCBs/s"] = benchmark::Counter((double)state.range(0), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Adds count PCBs in arrival order carrying on from arrival, keeping the CPU about 90% busy
+static void append_balanced(dyn_array_t* pcbs, const int64_t count, uint64_t& random_state, uint32_t& arrival)
+{
+	for (int64_t i = 0; i < count; i++)
+	{
+		ProcessControlBlock_t pcb;
+		pcb.remaining_burst_time = 1 + next_random(random_state) % 100;
+		pcb.priority = next_random(random_state) % 16;
+		arrival += next_random(random_state) % 110;
+		pcb.arrival = arrival;
+		pcb.started = false;
+		dyn_array_push_back(pcbs, &pcb);
+	}
+}
+
+static void BM_refresh_simulation(benchmark::State& state)
+{
+	uint64_t random_state = 0x9E3779B97F4A7C15ull;
+	uint32_t arrival = 0;
+	dyn_array_t* history = dyn_array_create(state.range(0), sizeof(ProcessControlBlock_t), NULL);
+	append_balanced(history, state.range(0), random_state, arrival);
+	ScheduleSimulation_t* simulation = schedule_simulation_create(shortest_job_first);
+	schedule_simulation_append(simulation, history);
+	dyn_array_t* batch = dyn_array_create(state.range(1), sizeof(ProcessControlBlock_t), NULL);
+	ScheduleResult_t result;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		dyn_array_clear(batch);
+		append_balanced(batch, state.range(1), random_state, arrival);
+		state.ResumeTiming();
+		if (!schedule_simulation_append(simulation, batch) || !schedule_simulation_advance(simulation, &result))
+		{
+			state.SkipWithError("simulation failed");
+			break;
+		}
+		benchmark::DoNotOptimize(result);
+	}
+	schedule_simulation_destroy(simulation);
+	dyn_array_destroy(batch);
+	dyn_array_destroy(history);
+}
+
+static void BM_refresh_rerun(benchmark::State& state)
+{
+	uint64_t random_state = 0x9E3779B97F4A7C15ull;
+	uint32_t arrival = 0;
+	dyn_array_t* history = dyn_array_create(state.range(0) + state.range(1), sizeof(ProcessControlBlock_t), NULL);
+	append_balanced(history, state.range(0) + state.range(1), random_state, arrival);
+	ScheduleResult_t result;
+	for (auto _ : state)
+	{
+		if (!shortest_job_first(history, &result)) { state.SkipWithError("scheduler failed"); break; }
+		benchmark::DoNotOptimize(result);
+	}
+	dyn_array_destroy(history);
+}
+
+// The PCBs for the argmin benchmarks, a quarter of them started
+static dyn_array_t* create_scan_pcbs(const int64_t count)
+{
+	dyn_array_t* pcbs = dyn_array_create(count, sizeof(ProcessControlBlock_t), NULL);
+	uint64_t random_state = 0x9E3779B97F4A7C15ull;
+	for (int64_t i = 0; i < count; i++)
+	{
+		ProcessControlBlock_t pcb;
+		pcb.remaining_burst_time = 1 + next_random(random_state) % 100000;
+		pcb.priority = next_random(random_state) % 16;
+		pcb.arrival = (uint32_t)i;
+		pcb.started = next_random(random_state) % 4 == 0;
+		dyn_array_push_back(pcbs, &pcb);
+	}
+	return pcbs;
+}
+
+static void BM_argmin_pcbs(benchmark::State& state)
+{
+	dyn_array_t* pcbs = create_scan_pcbs(state.range(0));
+	const ProcessControlBlock_t* blocks = (const ProcessControlBlock_t*)dyn_array_export(pcbs);
+	const size_t count = dyn_array_size(pcbs);
+	for (auto _ : state)
+	{
+		size_t best = count;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!blocks[i].started && (best == count || blocks[i].remaining_burst_time < blocks[best].remaining_burst_time)) { best = i; }
+		}
+		benchmark::DoNotOptimize(best);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	dyn_array_destroy(pcbs);
+}
+
+template <pcb_kernel_t Kernel>
+static void BM_argmin_columns(benchmark::State& state)
+{
+	if (!pcb_columns_use_kernel(Kernel)) { state.SkipWithError("kernel not supported on this CPU"); return; }
+	dyn_array_t* pcbs = create_scan_pcbs(state.range(0));
+	pcb_columns_t* columns = pcb_columns_import(pcbs);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(pcb_columns_argmin(columns, PCB_COLUMN_BURST, 0, pcb_columns_size(columns)));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	pcb_columns_use_kernel(PCB_KERNEL_AUTO);
+	pcb_columns_destroy(columns);
+	dyn_array_destroy(pcbs);
+}
+
+struct ChannelBenchProducer
+{
+	pcb_channel_t* channel;
+	int64_t count;
+	int64_t batch;
+};
+
+static void* channel_bench_produce(void* arg)
+{
+	ChannelBenchProducer* producer = (ChannelBenchProducer*)arg;
+	for (int64_t sent = 0; sent < producer->count;)
+	{
+		ProcessControlBlock_t* slots = NULL;
+		const size_t reserved = pcb_channel_reserve(producer->channel, &slots, (size_t)std::min(producer->batch, producer->count - sent));
+		for (size_t i = 0; i < reserved; i++) { slots[i] = ProcessControlBlock_t{ 1, 0, (uint32_t)(sent + i), false }; }
+		pcb_channel_publish(producer->channel, reserved);
+		sent += (int64_t)reserved;
+	}
+	pcb_channel_close(producer->channel);
+	return NULL;
+}
+
+static void BM_channel_handoff(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		pcb_channel_t* channel = pcb_channel_create(0);
+		ChannelBenchProducer producer = { channel, state.range(0), state.range(1) };
+		pthread_t thread;
+		if (channel == NULL || pthread_create(&thread, NULL, channel_bench_produce, &producer) != 0)
+		{
+			pcb_channel_destroy(channel);
+			state.SkipWithError("no channel");
+			break;
+		}
+		uint64_t arrivals = 0;
+		const ProcessControlBlock_t* pcbs = NULL;
+		for (size_t count; (count = pcb_channel_peek(channel, &pcbs)) > 0;)
+		{
+			for (size_t i = 0; i < count; i++) { arrivals += pcbs[i].arrival; }
+			pcb_channel_release(channel, count);
+		}
+		pthread_join(thread, NULL);
+		pcb_channel_destroy(channel);
+		benchmark::DoNotOptimize(arrivals);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Full size sweep on the typical workload, every density/distribution mix at 1e5
+static void workload_args(benchmark::internal::Benchmark* benchmark, const int64_t max_count, const int64_t quantum)
+{
+	std::vector<int64_t> extra;
+	if (quantum) { extra.push_back(quantum); }
+	for (int64_t count = 1000; count <= max_count; count *= 10)
+	{
+		std::vector<int64_t> args = { count, BALANCED, UNIFORM };
+		args.insert(args.end(), extra.begin(), extra.end());
+		benchmark->Args(args);
+	}
+	for (int64_t density = BACKLOG; density <= SPARSE; density++)
+	{
+		for (int64_t distribution = UNIFORM; distribution <= HEAVY_TAIL; distribution++)
+		{
+			if (density == BALANCED && distribution == UNIFORM) { continue; }
+			std::vector<int64_t> args = { 100000, density, distribution };
+			args.insert(args.end(), extra.begin(), extra.end());
+			benchmark->Args(args);
+		}
+	}
+}
+
+static void nonpreemptive_args(benchmark::internal::Benchmark* benchmark)
+{
+	benchmark->ArgNames({ "pcbs", "density", "bursts" });
+	workload_args(benchmark, 10000000, 0);
+}
+
+// Only the SPARSE workloads have idle gaps for the parallel runs to split at
+static void parallel_args(benchmark::internal::Benchmark* benchmark)
+{
+	benchmark->ArgNames({ "pcbs", "density", "bursts", "quantum" });
+	for (int64_t count = 100000; count <= 10000000; count *= 10)
+	{
+		for (int64_t distribution = UNIFORM; distribution <= HEAVY_TAIL; distribution++)
+		{
+			benchmark->Args({ count, SPARSE, distribution, 4 });
+		}
+	}
+}
+
+static void round_robin_args(benchmark::internal::Benchmark* benchmark)
+{
+	benchmark->ArgNames({ "pcbs", "density", "bursts", "quantum" });
+	for (int64_t quantum : { 1, 4, 32 })
+	{
+		workload_args(benchmark, 10000000, quantum);
+	}
+}
+
+BENCHMARK_TEMPLATE(BM_nonpreemptive, first_come_first_serve)->Apply(nonpreemptive_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_nonpreemptive, shortest_job_first)->Apply(nonpreemptive_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_nonpreemptive, priority)->Apply(nonpreemptive_args)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_shortest_remaining_time_first)->Apply(nonpreemptive_args)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_round_robin)->Apply(round_robin_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_parallel, first_come_first_serve)->Apply(parallel_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_parallel, shortest_job_first)->Apply(parallel_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_parallel, priority)->Apply(parallel_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_parallel, shortest_remaining_time_first)->Apply(parallel_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_round_robin_parallel)->Apply(parallel_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_refresh_simulation)->ArgNames({ "history", "pcbs" })->Args({ 100000, 100 })->Args({ 1000000, 100 })->Args({ 1000000, 10000 })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_refresh_rerun)->ArgNames({ "history", "pcbs" })->Args({ 100000, 100 })->Args({ 1000000, 100 })->Args({ 1000000, 10000 })->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_channel_handoff)->ArgNames({ "pcbs", "batch" })->Args({ 10000000, 64 })->Args({ 10000000, 4096 })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_argmin_pcbs)->ArgName("pcbs")->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_argmin_columns, PCB_KERNEL_SCALAR)->ArgName("pcbs")->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_argmin_columns, PCB_KERNEL_SSE41)->ArgName("pcbs")->Range(64, 1 << 20);
+BENCHMARK_TEMPLATE(BM_argmin_columns, PCB_KERNEL_AVX2)->ArgName("pcbs")->Range(64, 1 << 20);
+
+BENCHMARK_MAIN();
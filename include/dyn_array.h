@@ -44,6 +44,37 @@ typedef struct dyn_array dyn_array_t;
 ///
 dyn_array_t *dyn_array_create(const size_t capacity, const size_t data_type_size, void (*destruct_func)(void *));
 
+/*
+	Large array notes!
+
+	Arrays made with dyn_array_create_mapped keep their objects in an anonymous memory mapping
+	  instead of the heap. Meant for arrays that get into the hundreds of MB and beyond.
+
+	Growing moves the mapping (mremap) instead of copying the payload, so there is never
+	  a second copy of the array alive and growth costs the same at any size.
+
+	Pages are only backed by memory once they are touched, so a generous capacity is cheap.
+
+	With DYN_MAP_HUGEPAGES the mapping is also advised to use transparent huge pages,
+	  which cuts TLB misses when scanning through a huge array.
+
+	Everything else works exactly the same as a regular dynamic array.
+*/
+
+// Flags for dyn_array_create_mapped
+#define DYN_MAP_HUGEPAGES 0x01
+
+///
+/// Creates a new dynamic array in large array mode (see notes above)
+/// \param capacity Minimum capacity request, rounded up to whole pages
+/// \param data_type_size Size of the object type to be stored in bytes
+/// \param destruct_func Optional destructor to be applied on destruct operations (NULL to disable)
+/// \param map_flags DYN_MAP_HUGEPAGES or 0
+/// \return new dynamic array pointer, NULL on error
+///
+dyn_array_t *dyn_array_create_mapped(const size_t capacity, const size_t data_type_size,
+									 void (*destruct_func)(void *), const unsigned int map_flags);
+
 ///
 /// Creates a new dynamic array from a given array
 /// (Given pointer can be freed after import, we copy the data)
@@ -56,6 +87,34 @@ dyn_array_t *dyn_array_create(const size_t capacity, const size_t data_type_size
 dyn_array_t *dyn_array_import(const void *const data, const size_t count, const size_t data_type_size,
 							  void (*destruct_func)(void *));
 
+/*
+	Clone notes!
+
+	dyn_array_clone is O(1): the clone shares its source's payload until one of them is changed.
+	The first change through this library (insert, remove, sort, for_each, etc)
+	  gives that array its own copy, the other one is left as it was.
+
+	Pointers from dyn_array_at/front/back/export on a shared array are read only!
+	Call dyn_array_detach first if you want to write through them.
+
+	Arrays with a destructor can't be cloned (the objects would be destructed twice).
+*/
+
+///
+/// Creates a copy-on-write clone of a dynamic array (see notes above)
+/// Compacts the source first if it has tombstones. The clone does not inherit tombstone mode
+/// \param dyn_array the dynamic array to clone
+/// \return new dynamic array pointer, NULL on error (or if the array has a destructor)
+///
+dyn_array_t *dyn_array_clone(dyn_array_t *const dyn_array);
+
+///
+/// Makes sure the array has its own payload, copying it if it's shared with a clone
+/// \param dyn_array the dynamic array
+/// \return bool representing success of the operation
+///
+bool dyn_array_detach(dyn_array_t *const dyn_array);
+
 ///
 /// Returns an internal pointer to the data array for export
 /// Since this pointer is internal, it may be invalidated by insertions that trigger reallocation
@@ -184,6 +243,64 @@ bool dyn_array_erase(dyn_array_t *const dyn_array, const size_t index);
 ///
 bool dyn_array_extract(dyn_array_t *const dyn_array, const size_t index, void *const object);
 
+///
+/// Removes and optionally destructs the object at the given index by moving the last object into its place
+/// Does NOT preserve the order of the array, but never shifts more than one object
+/// \param dyn_array the dynamic array
+/// \param index index of the object to be erased
+/// \return bool representing success of the operation
+///
+bool dyn_array_erase_swap(dyn_array_t *const dyn_array, const size_t index);
+
+///
+/// Removes the object at the given index and places it at the desired location, then moves the last
+/// object into its place. Does NOT preserve the order of the array, but never shifts more than one object
+/// Does not destruct the object since it is returned to the user
+/// \param dyn_array the dynamic array
+/// \param index the index of the object to extract
+/// \param object destination for extracted object
+/// \return bool representing success of the operation
+///
+bool dyn_array_extract_swap(dyn_array_t *const dyn_array, const size_t index, void *const object);
+
+
+/*
+	Tombstone notes!
+
+	Tombstone mode is opt-in and makes dyn_array_erase and dyn_array_extract O(1) while
+	  preserving the order of the remaining objects.
+
+	Instead of shifting the rest of the array down, the removed slot is marked dead.
+	Dead slots are compacted away (in order) once they make up compact_percent of the array,
+	  or before any operation that needs contiguous indices (insert, front operations, sort, etc).
+	Pushing to the back and removing the last object never compacts.
+
+	While dead slots exist, dyn_array_size counts them, so existing index loops keep working,
+	  but dyn_array_at returns NULL for a dead slot and dyn_array_for_each skips them.
+	The last slot is always alive, so the back functions and dyn_array_empty behave as usual.
+*/
+
+///
+/// Turns on tombstone mode (see notes above)
+/// \param dyn_array the dynamic array
+/// \param compact_percent percentage (1-100) of dead slots that triggers a compaction
+/// \return bool representing success of the operation
+///
+bool dyn_array_enable_tombstones(dyn_array_t *const dyn_array, const size_t compact_percent);
+
+///
+/// Compacts any dead slots and turns off tombstone mode
+/// \param dyn_array the dynamic array
+///
+void dyn_array_disable_tombstones(dyn_array_t *const dyn_array);
+
+///
+/// Removes all dead slots now, keeping the order of the remaining objects
+/// Does nothing if tombstone mode is off or nothing has been removed
+/// \param dyn_array the dynamic array
+///
+void dyn_array_compact(dyn_array_t *const dyn_array);
+
 
 ///
 /// Removes and optionally destructs all array elements
@@ -219,6 +336,101 @@ size_t dyn_array_capacity(const dyn_array_t *const dyn_array);
 ///
 size_t dyn_array_data_size(const dyn_array_t *const dyn_array);
 
+
+/*
+	Growth policy notes!
+
+	When an array runs out of room its capacity is multiplied by the growth factor
+	  (repeatedly, until everything fits), and never goes below the minimum capacity.
+	The default is doubling from 16, which is what every array starts with.
+
+	A smaller factor (1.5, say) wastes less memory on big arrays at the cost of more reallocations.
+
+	For anything fancier, set a grow callback. It gets the current capacity and the capacity
+	  that's needed and returns the new capacity (at least the needed one). The factor and
+	  minimum capacity are ignored while it's set.
+
+	dyn_array_reserve and dyn_array_shrink_to_fit set the capacity directly, no policy involved.
+*/
+
+#define DYN_DEFAULT_GROWTH_FACTOR 2.0
+#define DYN_DEFAULT_MIN_CAPACITY 16
+
+typedef struct
+{
+	double growth_factor;	// Must be greater than 1
+	size_t min_capacity;
+	size_t (*grow)(const size_t capacity, const size_t needed, void *arg);	// NULL to use the two above
+	void *grow_arg;			// Passed to grow (as parameter 3)
+} dyn_growth_policy_t;
+
+///
+/// Sets how the array grows when it runs out of capacity (see notes above)
+/// \param dyn_array the dynamic array
+/// \param policy the policy to copy, NULL to go back to the default
+/// \return bool representing success of the operation (fails on a factor <= 1 without a callback)
+///
+bool dyn_array_set_growth_policy(dyn_array_t *const dyn_array, const dyn_growth_policy_t *const policy);
+
+///
+/// Makes sure at least capacity objects fit without another reallocation
+/// \param dyn_array the dynamic array
+/// \param capacity the requested capacity
+/// \return bool representing success of the operation
+///
+bool dyn_array_reserve(dyn_array_t *const dyn_array, const size_t capacity);
+
+///
+/// Gives back unused capacity so the array only holds what it needs (compacts tombstones first)
+/// shrink_to_fit is more of a request, the array may keep a little extra (a page for large arrays)
+/// \param dyn_array the dynamic array
+/// \return bool representing success of the operation
+///
+bool dyn_array_shrink_to_fit(dyn_array_t *const dyn_array);
+
+/*
+	Stats notes!
+
+	Arrays can keep count of their memory traffic, handy when tuning the growth policy.
+	Counting is off by default and costs a branch per operation when it's off.
+
+	reallocs counts every time the storage was moved to a new size (grow, reserve, shrink)
+	  or copied away from a clone.
+	bytes_copied counts bytes copied into and out of the array (inserts, extracts,
+	  and the payload copy when a shared array gets its own).
+	bytes_moved counts bytes shifted around inside the array to open or close gaps.
+	peak_capacity is the highest capacity seen since counting started.
+*/
+
+typedef struct
+{
+	size_t reallocs;
+	size_t bytes_copied;
+	size_t bytes_moved;
+	size_t peak_capacity;
+} dyn_array_stats_t;
+
+///
+/// Starts (or restarts, from zero) counting the array's memory traffic
+/// \param dyn_array the dynamic array
+/// \return bool representing success of the operation
+///
+bool dyn_array_enable_stats(dyn_array_t *const dyn_array);
+
+///
+/// Stops counting and throws the counters away
+/// \param dyn_array the dynamic array
+///
+void dyn_array_disable_stats(dyn_array_t *const dyn_array);
+
+///
+/// Copies out the counters
+/// \param dyn_array the dynamic array
+/// \param stats destination for the counters
+/// \return bool representing success of the operation (false if counting is off)
+///
+bool dyn_array_get_stats(const dyn_array_t *const dyn_array, dyn_array_stats_t *const stats);
+
 ///
 /// Sorts the array according to the given comparator function
 /// compare(x,y) < 0 iff x < y
@@ -255,6 +467,181 @@ bool dyn_array_insert_sorted(dyn_array_t *const dyn_array, const void *const obj
 ///
 bool dyn_array_for_each(dyn_array_t *const dyn_array, void (*const func)(void *const, void *), void *arg);
 
+
+/*
+	Parallel notes!
+
+	The parallel functions run on the library's thread pool (see thread_pool.h),
+	  use thread_pool_set_thread_count to pick how many threads they get.
+
+	The array is cut into fixed size chunks, so how the work is split never depends on
+	  the thread count, and results are the same no matter how many threads ran them.
+
+	Don't modify the array from inside the callbacks.
+*/
+
+///
+/// Applies the given function to every object in the array, spreading chunks of the array across threads
+/// With state_size 0, func gets arg directly and has to be safe to run concurrently with itself
+/// Otherwise every chunk gets its own zeroed state_size bytes (passed as parameter 2 instead of arg),
+///  and once all chunks are done reduce(arg, state) is called on each chunk's state in array order
+/// \param dyn_array the dynamic array
+/// \param func the function to apply
+/// \param arg argument that will be passed to the function, or the reduce destination
+/// \param state_size size of the per chunk state in bytes (0 to share arg)
+/// \param reduce merges a chunk's state into arg (required if state_size isn't 0)
+/// \return bool representing success of operation
+///
+bool dyn_array_parallel_for_each(dyn_array_t *const dyn_array, void (*const func)(void *const, void *), void *arg,
+								 const size_t state_size, void (*const reduce)(void *, const void *));
+
+///
+/// Sorts the array according to the given comparator function, like dyn_array_sort, but across threads
+/// Chunks are sorted in parallel and then merged, so for a comparator that totally orders the objects
+///  the result is identical to dyn_array_sort. Sort is not guaranteed to be stable
+/// \param dyn_array the dynamic array
+/// \param compare the comparison function, must be safe to run concurrently with itself
+/// \return bool representing success of the operation
+///
+bool dyn_array_parallel_sort(dyn_array_t *const dyn_array, int (*const compare)(const void *, const void *));
+
+
+/*
+	Heap notes!
+
+	The heap functions keep the array as a binary min-heap: the object at the front is the one
+	  that compares lowest, so to get the highest first just flip your comparator.
+
+	Use the same comparator for every call on the same heap.
+	Pushing and popping are O(log n), dyn_array_make_heap is O(n).
+
+	Heaps don't mix with tombstone mode, those calls fail if it's on.
+*/
+
+///
+/// Rearranges the array into a heap
+/// \param dyn_array the dynamic array
+/// \param compare the comparison function
+/// \return bool representing success of the operation
+///
+bool dyn_array_make_heap(dyn_array_t *const dyn_array, int (*const compare)(const void *, const void *));
+
+///
+/// Copies the given object into the heap, increasing container size by one
+/// \param dyn_array the dynamic array (already a heap)
+/// \param object the object to insert
+/// \param compare the comparison function
+/// \return bool representing success of the operation
+///
+bool dyn_array_heap_push(dyn_array_t *const dyn_array, const void *const object,
+						 int (*const compare)(const void *, const void *));
+
+///
+/// Removes the lowest object from the heap and places it in the desired location, decreasing container size by one
+/// Does not destruct since it was returned to the user
+/// \param dyn_array the dynamic array (already a heap)
+/// \param object destination for extracted object
+/// \param compare the comparison function
+/// \return bool representing success of the operation
+///
+bool dyn_array_heap_pop(dyn_array_t *const dyn_array, void *const object,
+						int (*const compare)(const void *, const void *));
+
+///
+/// Returns a pointer to the lowest object in the heap (don't change it in a way that changes its order!)
+/// \param dyn_array the dynamic array (already a heap)
+/// \return pointer to the lowest object, NULL on error/empty heap
+///
+void *dyn_array_heap_top(const dyn_array_t *const dyn_array);
+
+
+/*
+	Indexed heap notes!
+
+	An indexed heap is a heap that hands out a handle for every object pushed,
+	  so the object can be changed (decrease/increase key) or removed later without searching for it.
+
+	Handles stay valid until the object is popped or removed, after that they get reused.
+	Objects are stored by value, the heap owns its copies.
+*/
+
+typedef struct dyn_indexed_heap dyn_indexed_heap_t;
+
+///
+/// Creates a new indexed heap
+/// \param capacity Minimum capacity request (0 is fine if you have no opinion)
+/// \param data_type_size Size of the object type to be stored in bytes
+/// \param compare the comparison function, the lowest object comes out first
+/// \return new indexed heap pointer, NULL on error
+///
+dyn_indexed_heap_t *dyn_indexed_heap_create(const size_t capacity, const size_t data_type_size,
+											int (*const compare)(const void *, const void *));
+
+///
+/// Indexed heap destructor
+/// \param heap the indexed heap to destruct
+///
+void dyn_indexed_heap_destroy(dyn_indexed_heap_t *const heap);
+
+///
+/// Copies the given object into the heap
+/// \param heap the indexed heap
+/// \param object the object to insert
+/// \param handle destination for the object's handle (NULL if you don't need it)
+/// \return bool representing success of the operation
+///
+bool dyn_indexed_heap_push(dyn_indexed_heap_t *const heap, const void *const object, size_t *const handle);
+
+///
+/// Returns a pointer to the lowest object in the heap (use dyn_indexed_heap_update to change it)
+/// \param heap the indexed heap
+/// \param handle destination for the object's handle (NULL if you don't need it)
+/// \return pointer to the lowest object, NULL on error/empty heap
+///
+const void *dyn_indexed_heap_top(const dyn_indexed_heap_t *const heap, size_t *const handle);
+
+///
+/// Removes the lowest object from the heap and places it in the desired location
+/// \param heap the indexed heap
+/// \param object destination for extracted object
+/// \param handle destination for the object's (now released) handle (NULL if you don't need it)
+/// \return bool representing success of the operation
+///
+bool dyn_indexed_heap_pop(dyn_indexed_heap_t *const heap, void *const object, size_t *const handle);
+
+///
+/// Returns a pointer to the object with the given handle (use dyn_indexed_heap_update to change it)
+/// \param heap the indexed heap
+/// \param handle the object's handle
+/// \return pointer to the object, NULL on error/released handle
+///
+const void *dyn_indexed_heap_get(const dyn_indexed_heap_t *const heap, const size_t handle);
+
+///
+/// Replaces the object with the given handle and moves it to its new place (decrease or increase key)
+/// \param heap the indexed heap
+/// \param handle the object's handle
+/// \param object the new value of the object
+/// \return bool representing success of the operation
+///
+bool dyn_indexed_heap_update(dyn_indexed_heap_t *const heap, const size_t handle, const void *const object);
+
+///
+/// Removes the object with the given handle from the heap and places it in the desired location
+/// \param heap the indexed heap
+/// \param handle the object's handle
+/// \param object destination for extracted object (NULL to just drop it)
+/// \return bool representing success of the operation
+///
+bool dyn_indexed_heap_remove(dyn_indexed_heap_t *const heap, const size_t handle, void *const object);
+
+///
+/// Returns the number of objects in the heap
+/// \param heap the indexed heap
+/// \return the number of objects, 0 on error
+///
+size_t dyn_indexed_heap_size(const dyn_indexed_heap_t *const heap);
+
 #ifdef __cplusplus
   }
 #endif
@@ -0,0 +1,282 @@
+#ifndef DYN_ARRAY_HPP
+#define DYN_ARRAY_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "dyn_array.h"
+
+/*
+	Typed dyn_array notes!
+
+	hw2::dyn_array<T> is a header-only, typed cousin of dyn_array_t for C++ code.
+
+	The element size is a compile time constant and every accessor is inline, so loops
+	  over it are plain pointer loops the compiler can unroll and vectorize
+	  (no out-of-line dyn_array_at, no function pointer per element).
+
+	Storage is contiguous, iterators are raw pointers, and growth moves elements
+	  (std::move_if_noexcept) rather than copying them byte by byte.
+
+	It talks to the C library through from_c/to_c, which copy to/from a dyn_array_t.
+	Those need a trivially copyable T since the C side moves everything with memcpy.
+
+	Allocation failures throw std::bad_alloc like the rest of C++, and at() throws
+	  std::out_of_range. operator[] does no checking.
+*/
+
+namespace hw2
+{
+	template <typename T>
+	class dyn_array
+	{
+	public:
+		typedef T value_type;
+		typedef T *iterator;
+		typedef const T *const_iterator;
+		typedef std::size_t size_type;
+
+		// Size of one stored object in bytes, the C version has to look this up at runtime
+		static constexpr size_type data_size = sizeof(T);
+
+		// Same starting capacity as dyn_array_create
+		static constexpr size_type min_capacity = DYN_DEFAULT_MIN_CAPACITY;
+
+		dyn_array() noexcept : array_(nullptr), size_(0), capacity_(0) {}
+
+		explicit dyn_array(const size_type capacity) : dyn_array() { reserve(capacity); }
+
+		dyn_array(const T *const data, const size_type count) : dyn_array(count)
+		{
+			// size_ counts each object as it is built, so if a copy throws the destructor cleans up the ones before it
+			for (; size_ < count; ++size_)
+			{
+				new (array_ + size_) T(data[size_]);
+			}
+		}
+
+		dyn_array(const dyn_array &other) : dyn_array(other.array_, other.size_) {}
+
+		dyn_array(dyn_array &&other) noexcept : array_(other.array_), size_(other.size_), capacity_(other.capacity_)
+		{
+			other.array_	= nullptr;
+			other.size_		= 0;
+			other.capacity_ = 0;
+		}
+
+		dyn_array &operator=(dyn_array other) noexcept
+		{
+			swap(other);
+			return *this;
+		}
+
+		~dyn_array()
+		{
+			clear();
+			::operator delete(array_);
+		}
+
+		///
+		/// Copies the contents of a C dynamic array (which must hold T sized objects)
+		/// \param c_array the dynamic array to copy, NULL gives an empty array
+		/// \return the typed copy
+		///
+		static dyn_array from_c(const dyn_array_t *const c_array)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "C dyn_arrays can only hold trivially copyable types");
+			if (c_array && dyn_array_data_size(c_array) != data_size)
+			{
+				throw std::invalid_argument("dyn_array element size mismatch");
+			}
+			const size_type count = dyn_array_size(c_array);
+			dyn_array copy(count);
+			if (count)
+			{
+				std::memcpy(static_cast<void *>(copy.array_), dyn_array_export(c_array), count * data_size);
+			}
+			copy.size_ = count;
+			return copy;
+		}
+
+		///
+		/// Copies the contents into a new C dynamic array, for handing to the C library
+		/// \param destruct_func Optional destructor for the C array (NULL to disable)
+		/// \return new dynamic array pointer (caller destroys it), NULL on error
+		///
+		dyn_array_t *to_c(void (*destruct_func)(void *) = nullptr) const
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "C dyn_arrays can only hold trivially copyable types");
+			if (size_ == 0)
+			{
+				return dyn_array_create(0, data_size, destruct_func);
+			}
+			return dyn_array_import(array_, size_, data_size, destruct_func);
+		}
+
+		T *data() noexcept { return array_; }
+		const T *data() const noexcept { return array_; }
+
+		size_type size() const noexcept { return size_; }
+		size_type capacity() const noexcept { return capacity_; }
+		bool empty() const noexcept { return size_ == 0; }
+
+		T &operator[](const size_type index) noexcept { return array_[index]; }
+		const T &operator[](const size_type index) const noexcept { return array_[index]; }
+
+		T &at(const size_type index)
+		{
+			if (index >= size_) { throw std::out_of_range("dyn_array index out of range"); }
+			return array_[index];
+		}
+
+		const T &at(const size_type index) const
+		{
+			if (index >= size_) { throw std::out_of_range("dyn_array index out of range"); }
+			return array_[index];
+		}
+
+		T &front() noexcept { return array_[0]; }
+		const T &front() const noexcept { return array_[0]; }
+		T &back() noexcept { return array_[size_ - 1]; }
+		const T &back() const noexcept { return array_[size_ - 1]; }
+
+		iterator begin() noexcept { return array_; }
+		iterator end() noexcept { return array_ + size_; }
+		const_iterator begin() const noexcept { return array_; }
+		const_iterator end() const noexcept { return array_ + size_; }
+		const_iterator cbegin() const noexcept { return array_; }
+		const_iterator cend() const noexcept { return array_ + size_; }
+
+		void push_back(const T &object) { emplace_back(object); }
+		void push_back(T &&object) { emplace_back(std::move(object)); }
+
+		template <typename... Args>
+		T &emplace_back(Args &&... args)
+		{
+			if (size_ == capacity_)
+			{
+				// args may point into our own storage, so build the new object before moving house
+				T object(std::forward<Args>(args)...);
+				grow(size_ + 1);
+				new (array_ + size_) T(std::move(object));
+			}
+			else
+			{
+				new (array_ + size_) T(std::forward<Args>(args)...);
+			}
+			return array_[size_++];
+		}
+
+		void pop_back() noexcept
+		{
+			array_[--size_].~T();
+		}
+
+		///
+		/// Removes the object at index by moving the last object into its place (order is not kept)
+		/// \param index the index of the object to remove
+		///
+		void erase_swap(const size_type index) noexcept
+		{
+			if (index != size_ - 1)
+			{
+				array_[index] = std::move(array_[size_ - 1]);
+			}
+			pop_back();
+		}
+
+		///
+		/// Makes sure at least capacity objects fit without another allocation
+		/// \param capacity the requested capacity
+		///
+		void reserve(const size_type capacity)
+		{
+			if (capacity > capacity_)
+			{
+				grow(capacity);
+			}
+		}
+
+		void clear() noexcept
+		{
+			while (size_)
+			{
+				pop_back();
+			}
+		}
+
+		void swap(dyn_array &other) noexcept
+		{
+			std::swap(array_, other.array_);
+			std::swap(size_, other.size_);
+			std::swap(capacity_, other.capacity_);
+		}
+
+	private:
+		// Same doubling as dyn_request_size_increase
+		void grow(const size_type needed)
+		{
+			size_type new_capacity = capacity_ ? capacity_ << 1 : min_capacity;
+			while (new_capacity < needed)
+			{
+				new_capacity <<= 1;
+			}
+
+			T *const new_array = static_cast<T *>(::operator new(new_capacity * data_size));
+			relocate(new_array, std::is_trivially_copyable<T>());
+			::operator delete(array_);
+			array_	  = new_array;
+			capacity_ = new_capacity;
+		}
+
+		// Trivial types go in one memcpy, everything else is moved (or copied if moving could throw)
+		void relocate(T *const new_array, std::true_type) noexcept
+		{
+			if (size_)
+			{
+				std::memcpy(static_cast<void *>(new_array), array_, size_ * data_size);
+			}
+		}
+
+		void relocate(T *const new_array, std::false_type)
+		{
+			size_type moved = 0;
+			try
+			{
+				for (; moved < size_; ++moved)
+				{
+					new (new_array + moved) T(std::move_if_noexcept(array_[moved]));
+				}
+			}
+			catch (...)
+			{
+				while (moved)
+				{
+					new_array[--moved].~T();
+				}
+				::operator delete(new_array);
+				throw;
+			}
+			for (size_type idx = 0; idx < size_; ++idx)
+			{
+				array_[idx].~T();
+			}
+		}
+
+		T *array_;
+		size_type size_;
+		size_type capacity_;
+	};
+
+	template <typename T>
+	constexpr typename dyn_array<T>::size_type dyn_array<T>::data_size;
+
+	template <typename T>
+	constexpr typename dyn_array<T>::size_type dyn_array<T>::min_capacity;
+}
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef PCB_CHANNEL_H
+#define PCB_CHANNEL_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "processing_scheduling.h"
+
+/*
+	PCB channel notes!
+
+	A bounded ring of PCBs between exactly one producer thread and one consumer thread, so a loader
+	  can decode a trace while a scheduler is still working through what came before.
+
+	It is lock free: the producer only writes the tail and the consumer only writes the head, each on its
+	  own cache line together with that side's cached copy of the other index, so a side only reads the
+	  other's line when its cached copy says the ring is full (or empty). PCBs move in batches: the
+	  producer reserves a run of free slots, fills them in place and publishes them with one store, the
+	  consumer peeks at a run of published slots and releases them with one store. The per-PCB cost is
+	  the copy into the slot and nothing else.
+
+	A side that can't go on (ring full, or empty) looks again a few times, then sleeps on a futex until
+	  the other side publishes or releases. Both sides only make the wake-up system call when the other
+	  is actually asleep.
+
+	Ending:
+	  pcb_channel_close - the producer is done, the consumer still gets everything already published
+	  pcb_channel_abort - either side gives up, the other side's next call returns 0 (or false)
+
+	Only pcb_channel_close, pcb_channel_abort and pcb_channel_aborted may be called from either thread,
+	  the rest belong to the side they are named for.
+*/
+
+typedef struct pcb_channel pcb_channel_t;
+
+// PCBs a channel holds when created with capacity 0 (1 MiB of slots)
+#define PCB_CHANNEL_DEFAULT_CAPACITY ((size_t) 1 << 16)
+
+///
+/// Creates an empty channel
+/// \param capacity how many PCBs it can hold, rounded up to a power of two (at least 64), 0 for PCB_CHANNEL_DEFAULT_CAPACITY
+/// \return the channel, NULL on error
+///
+pcb_channel_t *pcb_channel_create(const size_t capacity);
+
+///
+/// Frees a channel, once neither thread uses it anymore
+/// \param channel the channel (NULL is fine)
+///
+void pcb_channel_destroy(pcb_channel_t *const channel);
+
+///
+/// Producer: waits for free slots and returns a run of them to fill in place
+/// \param channel the channel
+/// \param slots where the first slot goes
+/// \param wanted the most slots wanted
+/// \return how many slots can be filled (between 1 and wanted, fewer where the ring wraps), 0 if the channel was closed or aborted
+///
+size_t pcb_channel_reserve(pcb_channel_t *const channel, ProcessControlBlock_t **const slots, const size_t wanted);
+
+///
+/// Producer: hands the first count reserved slots to the consumer
+/// \param channel the channel
+/// \param count how many, no more than the last pcb_channel_reserve returned
+///
+void pcb_channel_publish(pcb_channel_t *const channel, const size_t count);
+
+///
+/// Producer: copies PCBs in, waiting for room as needed
+/// \param channel the channel
+/// \param pcbs the PCBs
+/// \param count how many
+/// \return bool representing success of the operation (false if the channel was closed or aborted first)
+///
+bool pcb_channel_send(pcb_channel_t *const channel, const ProcessControlBlock_t *const pcbs, size_t count);
+
+///
+/// Consumer: waits for published PCBs and returns a run of them to read in place
+/// \param channel the channel
+/// \param pcbs where the first PCB goes
+/// \return how many can be read (fewer than published where the ring wraps), 0 once the channel is closed and empty or aborted
+///
+size_t pcb_channel_peek(pcb_channel_t *const channel, const ProcessControlBlock_t **const pcbs);
+
+///
+/// Consumer: hands the first count peeked slots back to the producer
+/// \param channel the channel
+/// \param count how many, no more than the last pcb_channel_peek returned
+///
+void pcb_channel_release(pcb_channel_t *const channel, const size_t count);
+
+///
+/// Consumer: copies out up to max PCBs, waiting for at least one
+/// \param channel the channel
+/// \param pcbs where they go
+/// \param max the most to copy
+/// \return how many were copied, 0 once the channel is closed and empty or aborted
+///
+size_t pcb_channel_receive(pcb_channel_t *const channel, ProcessControlBlock_t *const pcbs, const size_t max);
+
+///
+/// Producer: marks the end of the stream, the consumer still reads what was published before it
+/// \param channel the channel
+///
+void pcb_channel_close(pcb_channel_t *const channel);
+
+///
+/// Either side: stops the channel, whatever is left in it is dropped
+/// \param channel the channel
+///
+void pcb_channel_abort(pcb_channel_t *const channel);
+
+///
+/// Returns whether a channel was aborted
+/// \param channel the channel
+/// \return true if it was
+///
+bool pcb_channel_aborted(const pcb_channel_t *const channel);
+
+///
+/// Producer: reads a PCB file (the format load_process_control_blocks reads) into a channel, then closes it
+/// \param input_file the PCB file
+/// \param channel the channel, aborted if the file can't be read
+/// \return bool representing success of the operation (false if the consumer aborted)
+///
+bool pcb_channel_load_file(const char *const input_file, pcb_channel_t *const channel);
+
+///
+/// Appends a PCB file to a simulation handle (see schedule_simulation_append) with a loader thread decoding
+///   the file into a channel while this thread appends and simulates what has arrived so far
+/// \param input_file the PCB file, in arrival order
+/// \param simulation the handle, nothing appended to it can arrive after the file's first arrival
+/// \return bool representing success of the operation (false if the file is out of order or can't be read,
+///  in which case whatever came before the bad batch has been appended)
+///
+bool pcb_channel_simulate_file(const char *const input_file, ScheduleSimulation_t *const simulation);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,171 @@
+#ifndef PCB_COLUMNS_H
+#define PCB_COLUMNS_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dyn_array.h"
+#include "processing_scheduling.h"
+
+/*
+	PCB column notes!
+
+	pcb_columns_t keeps PCBs as a structure of arrays: one uint32_t column each for burst, priority
+	  and arrival, plus a bitset for started. A scan that only reads one field reads 4 bytes per PCB
+	  instead of a whole 16 byte ProcessControlBlock_t.
+
+	Columns are 32 byte aligned and padded to a multiple of 8 entries, so the vector kernels never
+	  have to handle a partial load at the end.
+
+	pcb_columns_argmin finds the lowest value of a column among the PCBs in a range that have not
+	  started. It uses AVX2 or SSE4.1 when the CPU has them (checked once at runtime) and a plain
+	  loop otherwise. Every kernel gives the same answer: ties go to the lowest index.
+
+	The schedulers in process_scheduling_core.cpp don't use these. Popping a heap is O(log n) per
+	  decision and a scan is O(n) even 8 lanes at a time, and scanning the arrived window was slower
+	  than the heap even when the window stayed under a hundred PCBs.
+*/
+
+// The fields are here so the started bits can be tested and set inline in a scheduler's loop
+// Use the functions below rather than changing them directly
+typedef struct pcb_columns
+{
+	uint32_t *values[3];	// Indexed by pcb_column_t, capacity entries each (padding is UINT32_MAX)
+	uint64_t *started;		// One bit per PCB
+	size_t size;
+	size_t capacity;		// A multiple of 8
+}
+pcb_columns_t;
+
+// The columns of a pcb_columns_t
+typedef enum
+{
+	PCB_COLUMN_BURST,
+	PCB_COLUMN_PRIORITY,
+	PCB_COLUMN_ARRIVAL
+}
+pcb_column_t;
+
+// The argmin kernels, see pcb_columns_use_kernel
+typedef enum
+{
+	PCB_KERNEL_AUTO,	// The best one the CPU supports
+	PCB_KERNEL_SCALAR,
+	PCB_KERNEL_SSE41,
+	PCB_KERNEL_AVX2
+}
+pcb_kernel_t;
+
+///
+/// Creates an empty set of columns with room for capacity PCBs
+/// \param capacity the number of PCBs it can hold (it never grows)
+/// \return new columns pointer, NULL on error
+///
+pcb_columns_t *pcb_columns_create(const size_t capacity);
+
+///
+/// Creates columns holding a copy of every PCB in a ready queue, in the same order
+/// \param ready_queue a dyn_array of type ProcessControlBlock_t
+/// \return new columns pointer, NULL on error
+///
+pcb_columns_t *pcb_columns_import(const dyn_array_t *const ready_queue);
+
+///
+/// Columns destructor
+/// \param columns the columns to destruct (NULL is fine)
+///
+void pcb_columns_destroy(pcb_columns_t *const columns);
+
+///
+/// Adds a PCB to the end
+/// \param columns the columns
+/// \param pcb the PCB to add
+/// \return bool representing success of the operation (false when full)
+///
+bool pcb_columns_push_back(pcb_columns_t *const columns, const ProcessControlBlock_t *const pcb);
+
+///
+/// Copies a PCB back out
+/// \param columns the columns
+/// \param index the PCB's index
+/// \param pcb where the PCB goes
+/// \return bool representing success of the operation
+///
+bool pcb_columns_get(const pcb_columns_t *const columns, const size_t index, ProcessControlBlock_t *const pcb);
+
+///
+/// Returns the number of PCBs held
+/// \param columns the columns
+/// \return the number of PCBs, 0 on error
+///
+size_t pcb_columns_size(const pcb_columns_t *const columns);
+
+///
+/// Returns one of the columns, for reading or changing values in place
+/// \param columns the columns
+/// \param column which column
+/// \return pointer to pcb_columns_size values, NULL on error
+///
+uint32_t *pcb_columns_column(pcb_columns_t *const columns, const pcb_column_t column);
+
+///
+/// Marks a PCB as started (or not)
+/// \param columns the columns
+/// \param index the PCB's index
+/// \param started the new value
+/// \return bool representing success of the operation
+///
+static inline bool pcb_columns_set_started(pcb_columns_t *const columns, const size_t index, const bool started)
+{
+	if (!columns || index >= columns->size)
+	{
+		return false;
+	}
+	const uint64_t bit = (uint64_t) 1 << (index & 63);
+	columns->started[index >> 6] = started ? columns->started[index >> 6] | bit : columns->started[index >> 6] & ~bit;
+	return true;
+}
+
+///
+/// Returns whether a PCB has started
+/// \param columns the columns
+/// \param index the PCB's index
+/// \return true if it has started, false if not (or on error)
+///
+static inline bool pcb_columns_started(const pcb_columns_t *const columns, const size_t index)
+{
+	return columns && index < columns->size && ((columns->started[index >> 6] >> (index & 63)) & 1);
+}
+
+///
+/// Marks every PCB as not started
+/// \param columns the columns
+///
+void pcb_columns_clear_started(pcb_columns_t *const columns);
+
+///
+/// Finds the PCB with the lowest value in a column among the ones in [begin, end) that have not started
+/// \param columns the columns
+/// \param column the column to compare
+/// \param begin the first index to look at
+/// \param end one past the last index to look at (no more than pcb_columns_size)
+/// \return the index of the lowest value (lowest index on ties), end if every PCB in range has started (or on error)
+///
+size_t pcb_columns_argmin(const pcb_columns_t *const columns, const pcb_column_t column, const size_t begin, const size_t end);
+
+///
+/// Picks the kernel pcb_columns_argmin uses on every thread, mostly for testing and benchmarking
+/// \param kernel the kernel, PCB_KERNEL_AUTO for the best the CPU supports
+/// \return true if the kernel is available, false if not (and nothing changes)
+///
+bool pcb_columns_use_kernel(const pcb_kernel_t kernel);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,89 @@
+#ifndef PCB_SORT_H
+#define PCB_SORT_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "processing_scheduling.h"
+
+/*
+	PCB sort notes!
+
+	Sorts a PCB file (the format load_process_control_blocks reads) by arrival without ever holding
+	  the whole thing in memory, so traces bigger than RAM can go through the simulation handles,
+	  which need arrival order.
+
+	It is an external merge sort:
+	  1. The file is read a chunk at a time, about half the memory budget per chunk, and each chunk is
+	     radix sorted on arrival (11 bits a pass, passes where every key has the same digit are skipped).
+	  2. Sorted chunks are spilled back to back into one temp file, which is unlinked as soon as it is
+	     created so nothing is left behind if the sort dies.
+	  3. The runs are merged with a loser tree, k runs at a time (k is as many as the budget gives each a
+	     64 KiB read buffer). More runs than that take extra passes through a second temp file. A file that
+	     fits in one chunk is never spilled.
+
+	Both the radix sort and the merge are stable, so processes with the same arrival stay in file order.
+	  FCFS and SRTF give the same result on the sorted file as on the original; SJF and priority break
+	  ties between processes with different arrivals by file position, which sorting changes.
+
+	Every byte gets read and written once per pass and the reads and writes are sequential (the merge
+	  reads each run a block at a time), so a sort with one merge pass costs about two reads and two writes
+	  of the file. A 100 GB trace with a 16 GB budget is 13 runs and one merge pass. The file format's
+	  uint32_t count caps a trace at 2^32 - 1 processes (about 48 GB) either way.
+*/
+
+// How a sort may use resources
+typedef struct
+{
+	size_t memory_bytes;	// Roughly the most memory the sort uses, 0 for PCB_SORT_DEFAULT_MEMORY (at least PCB_SORT_MIN_MEMORY)
+	const char *temp_dir;	// Where runs are spilled, NULL for $TMPDIR (or /tmp)
+}
+pcb_sort_options_t;
+
+#define PCB_SORT_DEFAULT_MEMORY ((size_t) 1 << 30)
+#define PCB_SORT_MIN_MEMORY ((size_t) 256 << 10)
+
+// Called with the sorted PCBs a batch at a time, in order
+// \param arg the argument given to pcb_sort_stream
+// \param pcbs the next batch
+// \param count how many (never 0)
+// \return true to carry on, false to stop the sort (which then fails)
+typedef bool (*pcb_sort_consumer_t)(void *arg, const ProcessControlBlock_t *pcbs, size_t count);
+
+///
+/// Sorts a PCB file by arrival into another PCB file
+/// \param input_file the PCB file to sort
+/// \param output_file where the sorted file goes (it can't be input_file)
+/// \param options resources it may use, NULL for the defaults
+/// \return bool representing success of the operation
+///
+bool pcb_sort_file(const char *const input_file, const char *const output_file, const pcb_sort_options_t *const options);
+
+///
+/// Sorts a PCB file by arrival and hands the PCBs to a consumer in order instead of writing them out
+/// \param input_file the PCB file to sort
+/// \param options resources it may use, NULL for the defaults
+/// \param consumer called with each batch
+/// \param arg passed to consumer as is
+/// \return bool representing success of the operation (false if the consumer stopped it)
+///
+bool pcb_sort_stream(const char *const input_file, const pcb_sort_options_t *const options, const pcb_sort_consumer_t consumer, void *const arg);
+
+///
+/// Sorts a PCB file by arrival straight into a simulation handle, see schedule_simulation_append
+/// \param input_file the PCB file to sort
+/// \param options resources it may use, NULL for the defaults
+/// \param simulation the handle, nothing appended to it can arrive after the file's first arrival
+/// \return bool representing success of the operation
+///
+bool pcb_sort_simulation(const char *const input_file, const pcb_sort_options_t *const options, ScheduleSimulation_t *const simulation);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,118 @@
+#ifndef PROCESS_SCHEDULING_CORE_H
+#define PROCESS_SCHEDULING_CORE_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "processing_scheduling.h"
+
+/*
+	Scheduler core notes!
+
+	Internal to the process_scheduling library, nothing outside it should include this.
+
+	Every scheduler's loop lives in process_scheduling_core.cpp: the heap based ones as C++ templates
+	  over their ordering (so every policy gets its own fully inlined loop) and round robin over a ring.
+	  The loops are resumable, and the simulation handles run the same ones. They keep the C ABI
+	  declared in processing_scheduling.h.
+
+	Everything a caller can attach (stats, completion observer, per process times, trace) is
+	  thread local on the C side. A run takes one snapshot of it with schedule_hooks_current.
+*/
+
+// What is attached on the calling thread
+typedef struct
+{
+	ScheduleStats_t *stats;							// NULL unless counting (always NULL without SCHEDULE_STATS)
+	schedule_completion_function_t completion_observer;
+	void *completion_arg;
+	const ScheduleTimes_t *times;
+	ScheduleTrace_t *trace;
+}
+ScheduleHooks_t;
+
+///
+/// Reads what is attached on the calling thread
+/// \param hooks where it goes
+///
+void schedule_hooks_current(ScheduleHooks_t *hooks);
+
+///
+/// Adds an event to a trace, writing out the buffer when it fills up
+/// \param trace the trace
+/// \param time when it happened
+/// \param pid the process's position in the ready queue (the process count for BEGIN)
+/// \param event what happened
+///
+void schedule_trace_record(ScheduleTrace_t *trace, uint64_t time, size_t pid, ScheduleTraceEventType_t event);
+
+// A file written through a buffer (the trace writes its events through one too)
+typedef struct ScheduleWriter ScheduleWriter_t;
+
+// A file read through a buffer
+typedef struct ScheduleReader ScheduleReader_t;
+
+///
+/// Opens a file for buffered writing, replacing whatever was there
+/// \param path the file to write
+/// \param block_size bytes buffered between writes, 0 for 1 MiB
+/// \return the writer, NULL on error
+///
+ScheduleWriter_t *schedule_writer_open(const char *path, size_t block_size);
+
+///
+/// Adds bytes to a writer, writing out the buffer whenever it fills up
+/// \param writer the writer
+/// \param data the bytes
+/// \param size how many
+/// \return false once any write has failed (everything after that is dropped)
+///
+bool schedule_writer_write(ScheduleWriter_t *writer, const void *data, size_t size);
+
+///
+/// Writes out what is left, closes the file and frees the writer
+/// \param writer the writer
+/// \return true if every byte made it to the file
+///
+bool schedule_writer_close(ScheduleWriter_t *writer);
+
+///
+/// Opens a file for buffered reading
+/// \param path the file to read
+/// \param block_size bytes read at a time, 0 for 1 MiB
+/// \return the reader, NULL on error
+///
+ScheduleReader_t *schedule_reader_open(const char *path, size_t block_size);
+
+///
+/// Reads the next bytes of a file
+/// \param reader the reader
+/// \param data where they go
+/// \param size how many
+/// \return false if the file ended (or a read failed) first
+///
+bool schedule_reader_read(ScheduleReader_t *reader, void *data, size_t size);
+
+///
+/// Closes the file and frees the reader
+/// \param reader the reader (NULL is fine)
+///
+void schedule_reader_close(ScheduleReader_t *reader);
+
+///
+/// Makes every decision a simulation handle can make before its latest arrival, without working out a result
+/// (schedule_simulation_advance does this first, so a loader that settles as it appends leaves it less to do)
+/// \param simulation the handle
+/// \return false for an error
+///
+bool schedule_simulation_settle(ScheduleSimulation_t *simulation);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
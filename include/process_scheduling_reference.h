@@ -0,0 +1,75 @@
+#ifndef PROCESS_SCHEDULING_REFERENCE_H
+#define PROCESS_SCHEDULING_REFERENCE_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dyn_array.h"
+#include "processing_scheduling.h"
+
+/*
+	Reference scheduler notes!
+
+	These are the original schedulers, kept as an oracle for testing the fast ones against.
+	  They tick the simulated clock one time unit at a time and rescan the whole queue for every
+	  decision, so they are slow (quadratic or worse) but simple enough to trust by reading them.
+
+	Every reference scheduler must give exactly the same ScheduleResult_t as its fast counterpart
+	  in processing_scheduling.h for any input, ties and idle gaps included.
+
+	The one change from the original code is zero burst processes: SRTF and round robin used to
+	  decrement them past zero (and run for ~4 billion ticks). Here they finish as soon as they get
+	  the CPU without using any time, which is what the fast schedulers do.
+
+	Unlike the originals these work on a copy, the incoming ready queue is left untouched.
+*/
+
+///
+/// Reference First Come First Served, see first_come_first_serve
+/// \param ready_queue a dyn_array of type ProcessControlBlock_t
+/// \param result where the stats go
+/// \return true on success, false on bad input or allocation failure
+///
+bool reference_first_come_first_serve(const dyn_array_t *ready_queue, ScheduleResult_t *result);
+
+///
+/// Reference Shortest Job First, see shortest_job_first
+/// \param ready_queue a dyn_array of type ProcessControlBlock_t
+/// \param result where the stats go
+/// \return true on success, false on bad input or allocation failure
+///
+bool reference_shortest_job_first(const dyn_array_t *ready_queue, ScheduleResult_t *result);
+
+///
+/// Reference non-preemptive Priority, see priority
+/// \param ready_queue a dyn_array of type ProcessControlBlock_t
+/// \param result where the stats go
+/// \return true on success, false on bad input or allocation failure
+///
+bool reference_priority(const dyn_array_t *ready_queue, ScheduleResult_t *result);
+
+///
+/// Reference Round Robin, see round_robin
+/// \param ready_queue a dyn_array of type ProcessControlBlock_t
+/// \param result where the stats go
+/// \param quantum the time slice
+/// \return true on success, false on bad input or allocation failure
+///
+bool reference_round_robin(const dyn_array_t *ready_queue, ScheduleResult_t *result, size_t quantum);
+
+///
+/// Reference Shortest Remaining Time First, see shortest_remaining_time_first
+/// \param ready_queue a dyn_array of type ProcessControlBlock_t
+/// \param result where the stats go
+/// \return true on success, false on bad input or allocation failure
+///
+bool reference_shortest_remaining_time_first(const dyn_array_t *ready_queue, ScheduleResult_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -5,6 +5,7 @@
 	extern "C" {
 #endif
 
+#include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -27,6 +28,304 @@
 	} 
 	ScheduleResult_t;
 
+	// What a scheduler did to get its result, for working out why a run was slow
+	// Only filled in while attached with schedule_stats_attach
+	typedef struct
+	{
+		unsigned long selections;		// Times a process was picked to get the CPU
+		unsigned long comparisons;		// Comparisons made while ordering processes
+		unsigned long context_switches;	// Times the CPU went from one process to a different one
+		unsigned long idle_jumps;		// Times the clock skipped ahead because nothing had arrived
+		unsigned long ticks;			// Times the simulated clock was advanced (per time unit or per event)
+		size_t bytes_moved;				// Bytes dyn_array shifted around inside the queues
+		size_t bytes_copied;			// Bytes dyn_array copied into and out of the queues
+	}
+	ScheduleStats_t;
+
+	// Adds the counts of every scheduler run on this thread to stats, until detached
+	// Counting is compiled out unless the library is built with SCHEDULE_STATS
+	// \param stats where to count (counts are added, so zero it first), NULL to detach
+	// \return true if counting is compiled in, else false (and nothing gets counted)
+	bool schedule_stats_attach(ScheduleStats_t *stats);
+
+	// Called by a scheduler each time one of its processes finishes
+	// \param arg the argument given to schedule_completion_attach
+	// \param process the process as it arrived (remaining_burst_time is its whole burst)
+	// \param waiting_time how long it spent ready but not running
+	// \param turnaround_time how long from arrival to finishing
+	typedef void (*schedule_completion_function_t)(void *arg, const ProcessControlBlock_t *process,
+		unsigned long waiting_time, unsigned long turnaround_time);
+
+	// Calls observer for every process that finishes in every scheduler run on this thread, until detached
+	// \param observer the function to call, NULL to detach
+	// \param arg passed to observer as is
+	void schedule_completion_attach(schedule_completion_function_t observer, void *arg);
+
+	// Reads back what is attached on this thread, so it can be put back after attaching something else
+	// \param observer where the attached function goes (NULL if nothing is attached)
+	// \param arg where its argument goes
+	void schedule_completion_attached(schedule_completion_function_t *observer, void **arg);
+
+	// The tail of a per process time, over every process of a run
+	typedef struct
+	{
+		unsigned long p50;
+		unsigned long p90;
+		unsigned long p99;
+		unsigned long p999;
+		unsigned long max;
+	}
+	ScheduleLatency_t;
+
+	// A ScheduleResult_t along with the tails of waiting and turnaround time
+	typedef struct
+	{
+		ScheduleResult_t result;
+		ScheduleLatency_t waiting;
+		ScheduleLatency_t turnaround;
+		bool exact;						// False if the percentiles came from the histogram (max is always exact)
+	}
+	ScheduleResultExtended_t;
+
+	// How the percentiles of an extended result are worked out
+	typedef enum
+	{
+		SCHEDULE_LATENCY_AUTO,			// Exact up to SCHEDULE_EXACT_LATENCY_LIMIT processes, the histogram past that
+		SCHEDULE_LATENCY_EXACT,			// Keeps every time, 16 bytes per process
+		SCHEDULE_LATENCY_HISTOGRAM		// Fixed memory (~60KB), percentiles are high by at most 1/64 (1.6%)
+	}
+	ScheduleLatencyMode_t;
+
+	#define SCHEDULE_EXACT_LATENCY_LIMIT 65536
+
+	// Runs a scheduler and works out the tails of its waiting and turnaround times as processes finish
+	// Anything already attached with schedule_completion_attach still gets called
+	// \param ready_queue a dyn_array of type ProcessControlBlock_t, passed to scheduler
+	// \param scheduler one of first_come_first_serve, shortest_job_first, priority or shortest_remaining_time_first
+	// \param mode how to work out the percentiles
+	// \param result where the results go
+	// \return true if the scheduler ran successfully else false for an error
+	bool schedule_extended(dyn_array_t *ready_queue, bool (*scheduler)(dyn_array_t *, ScheduleResult_t *),
+		ScheduleLatencyMode_t mode, ScheduleResultExtended_t *result);
+
+	// schedule_extended for round robin
+	// \param ready_queue a dyn_array of type ProcessControlBlock_t
+	// \param quantum the quantum
+	// \param mode how to work out the percentiles
+	// \param result where the results go
+	// \return true if round robin ran successfully else false for an error
+	bool round_robin_extended(dyn_array_t *ready_queue, size_t quantum, ScheduleLatencyMode_t mode, ScheduleResultExtended_t *result);
+
+	/*
+		Parallel schedule notes!
+
+		Every scheduler here keeps the CPU busy while anything is waiting, so once the CPU goes idle with
+		  nothing waiting, nothing before that point can change what happens after it. The stretches in
+		  between (busy periods) can be simulated on their own and their totals added up.
+
+		Busy periods only depend on arrivals and bursts, not on the policy, so one pass in admission order
+		  finds them: by arrival for the heap based schedulers, in queue order for round robin (where a
+		  process that hasn't arrived holds up the ones behind it). Busy periods are grouped into a few
+		  segments per pool thread and the segments run on the thread pool (see thread_pool.h).
+
+		Each segment keeps its processes in ready queue order, so ties break the same way and the result
+		  is exactly what the scheduler gives on its own. A trace that never goes idle is one segment.
+
+		Nothing attached on the calling thread (stats, completion observer, times, trace) sees a parallel run.
+	*/
+
+	// Runs a scheduler over the busy periods of the ready queue in parallel
+	// \param ready_queue a dyn_array of type ProcessControlBlock_t, left untouched
+	// \param scheduler one of first_come_first_serve, shortest_job_first, priority or shortest_remaining_time_first
+	// \param result where the results go, the same as scheduler would give
+	// \return true if every segment ran successfully else false for an error
+	bool schedule_parallel(dyn_array_t *ready_queue, bool (*scheduler)(dyn_array_t *, ScheduleResult_t *), ScheduleResult_t *result);
+
+	// schedule_parallel for round robin
+	// \param ready_queue a dyn_array of type ProcessControlBlock_t, left untouched
+	// \param quantum the quantum
+	// \param result where the results go, the same as round_robin would give
+	// \return true if every segment ran successfully else false for an error
+	bool round_robin_parallel(dyn_array_t *ready_queue, size_t quantum, ScheduleResult_t *result);
+
+	/*
+		Simulation handle notes!
+
+		A simulation handle keeps a scheduler's state (clock, ready queue, running totals) between calls, so a
+		  trace that keeps growing doesn't have to be rerun from time zero every time something is added.
+
+		Processes have to be appended in arrival order: none can arrive before the last one appended. That
+		  makes every decision before the latest arrival final, and advancing only makes those. The result is
+		  what the scheduler would give for everything appended so far, worked out by finishing off a copy,
+		  so an advance costs O(new processes) plus O(processes still waiting), never O(history).
+
+		A handle remembers nothing about processes once they finish. Nothing attached (stats, completion
+		  observer, times, trace) sees a handle's runs. A handle is not thread safe, but clones are independent.
+	*/
+	typedef struct ScheduleSimulation ScheduleSimulation_t;
+
+	// Creates an empty simulation handle
+	// \param scheduler one of first_come_first_serve, shortest_job_first, priority or shortest_remaining_time_first
+	// \return the handle, NULL for an error (or a scheduler it doesn't know)
+	ScheduleSimulation_t *schedule_simulation_create(bool (*scheduler)(dyn_array_t *, ScheduleResult_t *));
+
+	// schedule_simulation_create for round robin
+	// \param quantum the quantum
+	// \return the handle, NULL for an error
+	ScheduleSimulation_t *round_robin_simulation_create(size_t quantum);
+
+	// Copies a handle as it stands, so what comes next can be tried more than one way
+	// \param simulation the handle to copy
+	// \return the copy, NULL for an error
+	ScheduleSimulation_t *schedule_simulation_clone(const ScheduleSimulation_t *simulation);
+
+	// Destroys a handle
+	// \param simulation the handle (NULL is fine)
+	void schedule_simulation_destroy(ScheduleSimulation_t *simulation);
+
+	// Adds processes to the end of a simulation, their queue positions follow on from the ones already appended
+	// \param simulation the handle
+	// \param pcbs a dyn_array of type ProcessControlBlock_t in arrival order, none before the last arrival appended
+	// \return true if they were appended else false for an error (an out of order batch appends nothing, and
+	//  nothing can be appended once schedule_simulation_finish has been called)
+	bool schedule_simulation_append(ScheduleSimulation_t *simulation, const dyn_array_t *pcbs);
+
+	// Runs a simulation up to the latest arrival appended and works out the result so far
+	// \param simulation the handle
+	// \param result where the results go, the same as the scheduler would give for everything appended
+	// \return true if it ran successfully else false for an error (or nothing appended yet)
+	bool schedule_simulation_advance(ScheduleSimulation_t *simulation, ScheduleResult_t *result);
+
+	// Returns how many processes have been appended to a simulation
+	// \param simulation the handle
+	// \return the process count, 0 for an error
+	size_t schedule_simulation_size(const ScheduleSimulation_t *simulation);
+
+	/*
+		Simulation checkpoint notes!
+
+		A checkpoint is everything a handle holds (clock, totals, pending processes, ready structure), written
+		  to a file. A long run that gets interrupted can restore the last one instead of starting from zero,
+		  and any number of what-if continuations can be restored from one warm prefix without re-simulating it.
+
+		A checkpoint file is in native byte order like the PCB files:
+		  header - "PCBSIMCK", uint32_t version (1), uint32_t policy (0 FCFS, 1 SJF, 2 priority, 3 round robin, 4 SRTF)
+		  handle - uint64_t processes appended, uint32_t latest arrival, uint32_t closed (1 once finishing has started)
+		  quantum - round robin only: uint64_t quantum
+		  progress - uint64_t clock, total waiting, total turnaround, processes finished, cpu busy
+		  policy - SRTF: uint64_t last to run, holding. Round robin: the process that had the last slice, uint64_t sliced, holding
+		  pending - uint64_t count, then that many processes in the order they get admitted
+		  ready - uint64_t count, then that many processes (heap order, or front to back for round robin)
+		  process - uint32_t remaining burst, priority, arrival, burst it arrived with, started, then uint64_t queue position
+
+		A checkpoint is written to path.tmp through a buffered writer and renamed over path once it is
+		  complete, so an interrupted write leaves the previous checkpoint alone.
+
+		schedule_simulation_finish runs a handle to the end in batches of decisions and can checkpoint between
+		  batches, every so often or whenever a flag gets set (a signal handler can set it). A finish that is
+		  interrupted picks up by restoring the checkpoint and calling finish again.
+	*/
+
+	// When schedule_simulation_finish writes checkpoints
+	typedef struct
+	{
+		const char *path;					// Where they go, each one replaces the last
+		unsigned long interval_seconds;		// Wall clock time between them, 0 for none
+		volatile sig_atomic_t *request;		// Set it to non zero for one as soon as possible (finish clears it), NULL for none
+	}
+	ScheduleCheckpoints_t;
+
+	// Writes everything a handle holds to a checkpoint file
+	// \param simulation the handle
+	// \param path the file, replaced once the checkpoint is complete
+	// \return true if the whole checkpoint was written else false for an error
+	bool schedule_simulation_checkpoint(const ScheduleSimulation_t *simulation, const char *path);
+
+	// Makes a handle out of a checkpoint, it carries on exactly where the checkpointed one was
+	// \param path the checkpoint file
+	// \return the handle, NULL for an error (or a file that isn't a whole checkpoint)
+	ScheduleSimulation_t *schedule_simulation_restore(const char *path);
+
+	// Runs everything appended to a simulation to the end, nothing more can be appended after this
+	// \param simulation the handle
+	// \param checkpoints when to checkpoint along the way, NULL for never
+	// \param result where the results go, the same as the scheduler would give for everything appended
+	// \return true if it ran successfully else false for an error (a checkpoint that couldn't be written stops
+	//  the run where it got to, finishing the handle again carries on)
+	bool schedule_simulation_finish(ScheduleSimulation_t *simulation, const ScheduleCheckpoints_t *checkpoints, ScheduleResult_t *result);
+
+	// Caller owned arrays the schedulers fill in with each process's times, indexed by position in the ready queue
+	// Every array needs room for one entry per process, any of them can be NULL to skip it
+	typedef struct
+	{
+		unsigned long *start;			// When it first got the CPU
+		unsigned long *completion;		// When it finished
+		unsigned long *waiting;			// How long it spent ready but not running
+		unsigned long *response;		// How long from arrival until it first got the CPU
+	}
+	ScheduleTimes_t;
+
+	// Fills in times for every scheduler run on this thread, until detached
+	// Each run overwrites the entries of its processes, times has to stay valid while attached
+	// \param times the arrays to fill in, NULL to detach
+	void schedule_times_attach(const ScheduleTimes_t *times);
+
+	/*
+		Schedule trace notes!
+
+		A trace file is a 16 byte header followed by 16 byte events, in native byte order like the PCB files:
+		  header - "PCBTRACE", uint32_t version (1), uint32_t event size (16)
+		  event - uint64_t time, uint32_t pid, uint32_t event (ScheduleTraceEventType_t)
+
+		pid is the process's position in the ready queue. Every run starts with a BEGIN event whose pid
+		  is the number of processes in the run, so one file can hold several runs back to back.
+
+		A process gets DISPATCH when it takes the CPU and PREEMPT when it has to give it up with work left,
+		  so it holds the CPU from a DISPATCH until its next PREEMPT or COMPLETE. A process that keeps
+		  the CPU at the end of a slice (nothing else was waiting) carries on without new events.
+
+		Events are buffered and written out a block at a time, tracing costs one branch per event when
+		  nothing is attached. A trace is not thread safe, attach it to one thread at a time.
+	*/
+	typedef enum
+	{
+		SCHEDULE_TRACE_BEGIN,
+		SCHEDULE_TRACE_DISPATCH,
+		SCHEDULE_TRACE_PREEMPT,
+		SCHEDULE_TRACE_COMPLETE
+	}
+	ScheduleTraceEventType_t;
+
+	typedef struct
+	{
+		uint64_t time;
+		uint32_t pid;
+		uint32_t event;
+	}
+	ScheduleTraceEvent_t;
+
+	typedef struct ScheduleTrace ScheduleTrace_t;
+
+	// Creates (or truncates) a trace file
+	// \param path where the trace goes
+	// \param block_size bytes buffered between writes, 0 for the default (1MB)
+	// \return the open trace, NULL for an error
+	ScheduleTrace_t *schedule_trace_open(const char *path, size_t block_size);
+
+	// Writes out whatever is buffered and closes the trace
+	// \param trace the trace, detach it from every thread first
+	// \return true if every event made it to the file else false for an error
+	bool schedule_trace_close(ScheduleTrace_t *trace);
+
+	// Records the events of every scheduler run on this thread to trace, until detached
+	// \param trace the trace to write to, NULL to detach
+	void schedule_trace_attach(ScheduleTrace_t *trace);
+
+	// Reads back a trace file
+	// \param input_file the trace file
+	// \return a dyn_array of ScheduleTraceEvent_t, NULL for an error (or a file that is not a trace)
+	dyn_array_t *load_schedule_trace(const char *input_file);
+
 	// Reads the PCB values from the binary file into ProcessControlBlock_t
 	// for N number of PCB entries stored in the file
 	// \param input_file the file containing the PCB burst times
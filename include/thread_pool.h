@@ -0,0 +1,140 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+	Thread pool notes!
+
+	The library keeps one work-stealing pool of worker threads, started the first time it is
+	  needed and reused by every parallel operation afterwards.
+
+	The calling thread works too, so a pool of N threads runs N - 1 workers.
+
+	Every worker owns a Chase-Lev deque: it pushes and pops its own tasks at the bottom (newest
+	  first, while they are still in cache) and idle threads steal from the top of a random
+	  victim (oldest first, which are the biggest pieces). Threads outside the pool hand their
+	  tasks over through one shared queue. Workers with nothing to steal sleep until a task shows up.
+
+	Parallel loops are split in halves: the thread running a range pushes the top half as a new
+	  task and keeps the bottom half, down to single chunks. So a thread that falls behind gets
+	  relieved by thieves, and the split happens where the work is.
+
+	Waiting never just blocks while there are tasks around: a thread waiting on a loop or task
+	  group runs queued tasks (its own first), so parallel calls from inside parallel calls,
+	  and from several threads at once, all run in parallel on the same workers.
+
+	Chunking: thread_pool_parallel_for runs one index per chunk, which suits a handful of big
+	  items. For many small items use thread_pool_parallel_for_chunked with a grain (indices per
+	  chunk), or 0 to let the pool pick one: about 8 chunks per thread, or a fixed 256 chunks
+	  whatever the thread count if deterministic mode is on.
+
+	Deterministic mode: thread_pool_parallel_reduce combines its per-chunk partials in chunk order,
+	  so as long as the chunks are the same the result is bit for bit the same however the chunks were
+	  scheduled. An explicit grain always gives the same chunks; deterministic mode makes the automatic
+	  grain depend only on the count too, so floating point reductions come out the same on any number
+	  of threads.
+*/
+
+// A set of tasks that can be waited on together
+typedef struct thread_pool_task_group thread_pool_task_group_t;
+
+///
+/// Calls func(arg, index) once for every index in [0, count), spread across the pool
+/// Returns once every call has finished
+/// \param count number of indices to run
+/// \param func the function to apply, must be safe to run concurrently with itself
+/// \param arg argument that will be passed to the function (as parameter 1)
+/// \return bool representing success of the operation (really just pointer checks)
+///
+bool thread_pool_parallel_for(const size_t count, void (*const func)(void *, size_t), void *arg);
+
+///
+/// Calls func(arg, begin, end) once for every chunk [begin, end) of [0, count), spread across the pool
+/// Returns once every call has finished
+/// \param count number of indices to run
+/// \param grain indices per chunk (the last chunk may be short), 0 to let the pool pick
+/// \param func the function to apply, must be safe to run concurrently with itself
+/// \param arg argument that will be passed to the function (as parameter 1)
+/// \return bool representing success of the operation (really just pointer checks)
+///
+bool thread_pool_parallel_for_chunked(const size_t count, const size_t grain, void (*const func)(void *, size_t, size_t), void *arg);
+
+///
+/// Calls map(arg, begin, end, partial) for every chunk [begin, end) of [0, count) in parallel, each with its own
+///   zeroed partial, then combine(arg, partial) with every partial on the calling thread, in chunk order
+/// \param count number of indices to run
+/// \param grain indices per chunk (the last chunk may be short), 0 to let the pool pick
+/// \param partial_size bytes in each partial
+/// \param map the function to apply to each chunk, must be safe to run concurrently with itself
+/// \param combine folds a partial into the result (which arg can point to)
+/// \param arg argument that will be passed to both functions (as parameter 1)
+/// \return bool representing success of the operation (false if the partials can't be allocated)
+///
+bool thread_pool_parallel_reduce(const size_t count, const size_t grain, const size_t partial_size,
+								 void (*const map)(void *, size_t, size_t, void *), void (*const combine)(void *, const void *), void *arg);
+
+///
+/// Creates an empty task group
+/// Until it is destroyed the group counts as a running parallel operation (thread_pool_set_thread_count waits for it)
+/// \return the new group, NULL on failure
+///
+thread_pool_task_group_t* thread_pool_task_group_create(void);
+
+///
+/// Queues func(arg) on the pool as part of a group, tasks of the group may add more tasks to it
+/// \param group the group the task belongs to
+/// \param func the task, must be safe to run concurrently with the group's other tasks
+/// \param arg argument that will be passed to the function
+/// \return bool representing success of the operation (really just pointer checks)
+///
+bool thread_pool_task_group_run(thread_pool_task_group_t *const group, void (*const func)(void *), void *arg);
+
+///
+/// Returns once every task of a group (including tasks they added) has finished, running queued tasks meanwhile
+/// The group can be reused afterwards
+/// \param group the group to wait for
+///
+void thread_pool_task_group_wait(thread_pool_task_group_t *const group);
+
+///
+/// Waits for a group and frees it, call it on the thread that created the group
+/// \param group the group to destroy
+///
+void thread_pool_task_group_destroy(thread_pool_task_group_t *const group);
+
+///
+/// Turns deterministic mode on or off (see the notes above), it is off to begin with
+/// \param enabled true to make automatic grains depend only on the count
+///
+void thread_pool_set_deterministic(const bool enabled);
+
+///
+/// Returns whether deterministic mode is on
+/// \return true if it is
+///
+bool thread_pool_deterministic(void);
+
+///
+/// Sets how many threads (including the caller) parallel operations use
+/// Waits for any running parallel operation first
+/// \param thread_count number of threads, 0 for one per online CPU
+///
+void thread_pool_set_thread_count(const size_t thread_count);
+
+///
+/// Returns how many threads (including the caller) parallel operations use
+/// \return the thread count, at least 1
+///
+size_t thread_pool_thread_count(void);
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif
@@ -1,27 +1,1336 @@
 #define _GNU_SOURCE
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "dyn_array.h"
+#include "pcb_sort.h"
 #include "processing_scheduling.h"
+#include "thread_pool.h"
 
 #define FCFS "FCFS"
 #define P "P"
 #define RR "RR"
 #define SJF "SJF"
 #define SRT "SRT"
+#define ALL "ALL"
 
+// How the results get printed
+typedef enum
+{
+	FORMAT_TEXT,		// Human readable lines, the default
+	FORMAT_JSON,		// One object, for collecting results over time
+	FORMAT_CSV,			// A header and one row per algorithm
+	FORMAT_MARKDOWN		// The scheduling analysis table in README.md
+}
+OutputFormat_t;
+
+// One algorithm run over the loaded schedule
+typedef struct
+{
+	const char* algorithm;		// Name given on the command line (FCFS, SJF, ...)
+	const char* function;		// The scheduling function that ran, as README.md names it
+	ScheduleResult_t result;
+	ScheduleResultExtended_t extended;	// result again, with the tails of waiting and turnaround time (if they were collected)
+	ScheduleStats_t stats;
+	double simulate_seconds;	// The scheduling function itself, copying and ordering its ready queue included
+	double latency_seconds;		// The second run that collected the latency tails, kept out of simulate_seconds
+}
+AnalysisRun_t;
+
+// README.md order, what ALL runs
+static const char* const ALL_ALGORITHMS[] = { FCFS, SJF, P, RR, SRT };
+#define ALL_ALGORITHM_COUNT (sizeof(ALL_ALGORITHMS) / sizeof(ALL_ALGORITHMS[0]))
+
+// Reads the monotonic clock, so phase timings can't be thrown off by the wall clock changing
+// \return: The current time in seconds
+static double monotonic_seconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Reads the peak resident set size of the process so far.
+// \return: The peak RSS in kilobytes, 0 if it can't be read
+static long peak_rss_kilobytes(void)
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+	return usage.ru_maxrss;
+}
+
+// Parses the value of --format.
+// \param: name - the format name given on the command line
+// \param: format - where the parsed format is stored
+// \return: True if the name is a known format, false otherwise
+static bool parse_format(const char* name, OutputFormat_t* format)
+{
+	if (strcmp(name, "text") == 0) { *format = FORMAT_TEXT; }
+	else if (strcmp(name, "json") == 0) { *format = FORMAT_JSON; }
+	else if (strcmp(name, "csv") == 0) { *format = FORMAT_CSV; }
+	else if (strcmp(name, "markdown") == 0) { *format = FORMAT_MARKDOWN; }
+	else { return false; }
+	return true;
+}
+
+// Runs one scheduling algorithm over the schedule and times it.
+// The latency tails come from a second, separately timed run, so simulate_seconds stays the plain scheduler call.
+// \param: algorithm_name - FCFS, SJF, P, RR or SRT
+// \param: schedule - the loaded PCBs (left untouched by the schedulers)
+// \param: quantum - the round robin quantum, 0 if none was given
+// \param: count_stats - true to fill in the run's stats
+// \param: trace - where to record the timed run's events, NULL for none (the latency run is never traced)
+// \param: collect_latency - true to fill in the run's latency tails (run->extended)
+// \param: run - where the results and timings go
+// \return: True if the algorithm ran successfully, false for an unknown name, a missing quantum or an error
+static bool run_algorithm(const char* algorithm_name, dyn_array_t* schedule, const size_t quantum, const bool count_stats,
+	ScheduleTrace_t* trace, const bool collect_latency, AnalysisRun_t* run)
+{
+	memset(run, 0, sizeof(*run));
+	run->algorithm = algorithm_name;
+
+	// Find the correct scheduling algorithm for the name
+	static const int MAX_ALGORITHM_NAME_LENGTH = 5;
+	bool (*scheduler)(dyn_array_t*, ScheduleResult_t*) = NULL;
+	bool is_round_robin = false;
+	switch (strnlen(algorithm_name, MAX_ALGORITHM_NAME_LENGTH))
+	{
+		case 1:
+			if (strncmp(algorithm_name, P, 1) == 0) { run->function = "priority"; scheduler = priority; }
+			break;
+
+		case 2:
+			if (strncmp(algorithm_name, RR, 2) == 0) { run->function = "round_robin"; is_round_robin = quantum > 0; }
+			break;
+
+		case 3:
+			if (strncmp(algorithm_name, SJF, 3) == 0) { run->function = "shortest_job_first"; scheduler = shortest_job_first; }
+			else if (strncmp(algorithm_name, SRT, 3) == 0) { run->function = "shortest_remaining_time_first"; scheduler = shortest_remaining_time_first; }
+			break;
+
+		case 4:
+			if (strncmp(algorithm_name, FCFS, 4) == 0) { run->function = "first_come_first_serve"; scheduler = first_come_first_serve; }
+			break;
+	}
+	if (scheduler == NULL && !is_round_robin) { return false; }
+
+	if (count_stats) { schedule_stats_attach(&run->stats); }
+	if (trace != NULL) { schedule_trace_attach(trace); }
+	double simulate_start = monotonic_seconds();
+	bool success = is_round_robin ? round_robin(schedule, &run->result, quantum) : scheduler(schedule, &run->result);
+	run->simulate_seconds = monotonic_seconds() - simulate_start;
+	schedule_trace_attach(NULL);
+	schedule_stats_attach(NULL);
+
+	if (success && collect_latency)
+	{
+		double latency_start = monotonic_seconds();
+		success = is_round_robin ? round_robin_extended(schedule, quantum, SCHEDULE_LATENCY_AUTO, &run->extended)
+			: schedule_extended(schedule, scheduler, SCHEDULE_LATENCY_AUTO, &run->extended);
+		run->latency_seconds = monotonic_seconds() - latency_start;
+	}
+	return success;
+}
+
+// Simulated PCBs per second of wall time
+static double pcbs_per_second(const size_t pcb_count, const double seconds)
+{
+	return seconds > 0 ? pcb_count / seconds : 0;
+}
+
+// Prints a string as a JSON string literal
+static void print_json_string(const char* string)
+{
+	putchar('"');
+	for (const unsigned char* c = (const unsigned char*)string; *c != '\0'; c++)
+	{
+		if (*c == '"' || *c == '\\') { printf("\\%c", *c); }
+		else if (*c < 0x20) { printf("\\u%04x", *c); }
+		else { putchar(*c); }
+	}
+	putchar('"');
+}
+
+// The stats object of a run or summary, as JSON
+static void print_json_stats(const ScheduleStats_t* stats)
+{
+	printf("{ \"selections\": %lu, \"comparisons\": %lu, \"context_switches\": %lu, \"idle_jumps\": %lu, "
+		"\"ticks\": %lu, \"bytes_moved\": %zu, \"bytes_copied\": %zu }",
+		stats->selections, stats->comparisons, stats->context_switches, stats->idle_jumps,
+		stats->ticks, stats->bytes_moved, stats->bytes_copied);
+}
+
+// One line of percentiles for the text format
+static void print_text_latency(const char* name, const ScheduleLatency_t* latency)
+{
+	printf("%s p50/p90/p99/p99.9/max:%s %lu %lu %lu %lu %lu\n", name, strlen(name) < 8 ? "\t" : "",
+		latency->p50, latency->p90, latency->p99, latency->p999, latency->max);
+}
+
+// The percentiles of a run as a JSON object
+static void print_json_latency(const ScheduleLatency_t* latency)
+{
+	printf("{ \"p50\": %lu, \"p90\": %lu, \"p99\": %lu, \"p999\": %lu, \"max\": %lu }",
+		latency->p50, latency->p90, latency->p99, latency->p999, latency->max);
+}
+
+static void print_text(const AnalysisRun_t* runs, const size_t run_count, const size_t pcb_count, const double load_seconds, const bool print_stats)
+{
+	for (size_t i = 0; i < run_count; i++)
+	{
+		const AnalysisRun_t* run = &runs[i];
+		if (run_count > 1) { printf("%s\n", run->function); }
+		printf("Average Waiting Time:\t %f\n", run->result.average_waiting_time);
+		printf("Average Turnaround Time: %f\n", run->result.average_turnaround_time);
+		printf("Total Run Time:\t\t %ld\n", run->result.total_run_time);
+		print_text_latency("Waiting", &run->extended.waiting);
+		print_text_latency("Turnaround", &run->extended.turnaround);
+		printf("Simulate Time:\t\t %f s\n", run->simulate_seconds);
+		printf("PCBs/sec:\t\t %.0f\n", pcbs_per_second(pcb_count, run->simulate_seconds));
+		printf("Latency Time:\t\t %f s\n", run->latency_seconds);
+		if (print_stats)
+		{
+			printf("Selections:\t\t %lu\n", run->stats.selections);
+			printf("Comparisons:\t\t %lu\n", run->stats.comparisons);
+			printf("Context Switches:\t %lu\n", run->stats.context_switches);
+			printf("Idle Jumps:\t\t %lu\n", run->stats.idle_jumps);
+			printf("Clock Ticks:\t\t %lu\n", run->stats.ticks);
+			printf("Bytes Moved:\t\t %zu\n", run->stats.bytes_moved);
+			printf("Bytes Copied:\t\t %zu\n", run->stats.bytes_copied);
+		}
+	}
+	printf("Load Time:\t\t %f s\n", load_seconds);
+	printf("Peak RSS:\t\t %ld KB\n", peak_rss_kilobytes());
+}
+
+static void print_json(const AnalysisRun_t* runs, const size_t run_count, const char* filename, const size_t pcb_count,
+	const double load_seconds, const bool print_stats)
+{
+	printf("{\n  \"file\": ");
+	print_json_string(filename);
+	printf(",\n  \"pcbs\": %zu,\n  \"load_seconds\": %.9f,\n  \"peak_rss_kb\": %ld,\n  \"runs\": [", pcb_count, load_seconds, peak_rss_kilobytes());
+	for (size_t i = 0; i < run_count; i++)
+	{
+		const AnalysisRun_t* run = &runs[i];
+		printf("%s\n    {\n", i > 0 ? "," : "");
+		printf("      \"algorithm\": \"%s\",\n", run->algorithm);
+		printf("      \"function\": \"%s\",\n", run->function);
+		printf("      \"average_waiting_time\": %f,\n", run->result.average_waiting_time);
+		printf("      \"average_turnaround_time\": %f,\n", run->result.average_turnaround_time);
+		printf("      \"total_run_time\": %lu,\n", run->result.total_run_time);
+		printf("      \"waiting_time\": ");
+		print_json_latency(&run->extended.waiting);
+		printf(",\n      \"turnaround_time\": ");
+		print_json_latency(&run->extended.turnaround);
+		printf(",\n      \"exact_percentiles\": %s,\n", run->extended.exact ? "true" : "false");
+		printf("      \"simulate_seconds\": %.9f,\n", run->simulate_seconds);
+		printf("      \"pcbs_per_second\": %.0f,\n", pcbs_per_second(pcb_count, run->simulate_seconds));
+		printf("      \"latency_seconds\": %.9f", run->latency_seconds);
+		if (print_stats)
+		{
+			printf(",\n      \"stats\": ");
+			print_json_stats(&run->stats);
+		}
+		printf("\n    }");
+	}
+	printf("\n  ]\n}\n");
+}
+
+static void print_csv(const AnalysisRun_t* runs, const size_t run_count, const size_t pcb_count, const double load_seconds, const bool print_stats)
+{
+	printf("algorithm,average_waiting_time,average_turnaround_time,total_run_time,pcbs,load_seconds,simulate_seconds,pcbs_per_second,peak_rss_kb,latency_seconds,"
+		"waiting_p50,waiting_p90,waiting_p99,waiting_p999,waiting_max,turnaround_p50,turnaround_p90,turnaround_p99,turnaround_p999,turnaround_max");
+	if (print_stats) { printf(",selections,comparisons,context_switches,idle_jumps,ticks,bytes_moved,bytes_copied"); }
+	printf("\n");
+
+	long peak_rss = peak_rss_kilobytes();
+	for (size_t i = 0; i < run_count; i++)
+	{
+		const AnalysisRun_t* run = &runs[i];
+		printf("%s,%f,%f,%lu,%zu,%.9f,%.9f,%.0f,%ld,%.9f", run->algorithm, run->result.average_waiting_time, run->result.average_turnaround_time,
+			run->result.total_run_time, pcb_count, load_seconds, run->simulate_seconds,
+			pcbs_per_second(pcb_count, run->simulate_seconds), peak_rss, run->latency_seconds);
+		const ScheduleLatency_t* latencies[] = { &run->extended.waiting, &run->extended.turnaround };
+		for (size_t l = 0; l < 2; l++)
+		{
+			printf(",%lu,%lu,%lu,%lu,%lu", latencies[l]->p50, latencies[l]->p90, latencies[l]->p99, latencies[l]->p999, latencies[l]->max);
+		}
+		if (print_stats)
+		{
+			printf(",%lu,%lu,%lu,%lu,%lu,%zu,%zu", run->stats.selections, run->stats.comparisons, run->stats.context_switches,
+				run->stats.idle_jumps, run->stats.ticks, run->stats.bytes_moved, run->stats.bytes_copied);
+		}
+		printf("\n");
+	}
+}
+
+// Only the results, so the table in README.md can be pasted straight from `analysis pcb.bin ALL 4 --format markdown`
+static void print_markdown(const AnalysisRun_t* runs, const size_t run_count)
+{
+	printf("| Scheduling Algorithm | Average Waiting Time | Average Turnaround Time | Total Run Time |\n");
+	printf("|-----|-----|-----|-----|\n");
+	for (size_t i = 0; i < run_count; i++)
+	{
+		printf("| `%s` | `%f` | `%f` | `%lu` |\n", runs[i].function, runs[i].result.average_waiting_time,
+			runs[i].result.average_turnaround_time, runs[i].result.total_run_time);
+	}
+}
+
+/*
+	Batch mode notes!
+
+	analysis --batch <directory|glob> <algorithms> [quantum] runs every file in a directory (or every file
+	  a glob matches) through a comma separated list of algorithms (or ALL) in one process.
+
+	Files are spread over the thread pool one at a time, so a few big files don't hold up the small ones.
+	  Each file is loaded, run through every algorithm and dropped before the worker takes the next.
+
+	The report has a result per file and algorithm, then a summary per algorithm over every file.
+	  Summary averages are weighted by PCB count, as if all the files were one trace.
+	  Files that fail to load or schedule are reported and make the exit status a failure.
+*/
+
+// One file of a batch
+typedef struct
+{
+	const char* path;
+	size_t pcb_count;
+	double load_seconds;
+	bool success;								// Loaded and every algorithm ran
+	AnalysisRun_t runs[ALL_ALGORITHM_COUNT];	// One per batch algorithm, in the same order
+}
+AnalysisFile_t;
+
+// Everything the batch workers share
+typedef struct
+{
+	AnalysisFile_t* files;
+	const char* const* algorithms;
+	size_t algorithm_count;
+	size_t quantum;
+	bool count_stats;
+}
+AnalysisBatch_t;
+
+// One algorithm summed over every file of a batch
+typedef struct
+{
+	const char* algorithm;
+	const char* function;
+	size_t files;
+	size_t pcbs;
+	double total_waiting;		// Averages times PCB counts, so the sums weight each file by its size
+	double total_turnaround;
+	unsigned long total_run_time;
+	double simulate_seconds;
+	ScheduleStats_t stats;
+}
+AnalysisSummary_t;
+
+// dyn_array destructor for the owned path strings of a batch
+static void free_path(void* path)
+{
+	free(*(char**)path);
+}
+
+static int compare_paths(const void* a, const void* b)
+{
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Adds a copy of the path to the batch's path list.
+// \param: paths - a dyn_array of char*
+// \param: path - the path to copy in
+// \return: True if it was added, false on allocation failure
+static bool add_path(dyn_array_t* paths, const char* path)
+{
+	char* copy = strdup(path);
+	if (copy == NULL) { return false; }
+	if (!dyn_array_push_back(paths, &copy)) { free(copy); return false; }
+	return true;
+}
+
+// Lists the files of a batch: every regular file in the directory if source is one, else every match of the glob.
+// \param: source - a directory or a glob pattern
+// \return: A sorted dyn_array of char* paths (freed with it), NULL on error
+static dyn_array_t* list_batch_files(const char* source)
+{
+	dyn_array_t* paths = dyn_array_create(0, sizeof(char*), free_path);
+	if (paths == NULL) { return NULL; }
+
+	bool success = true;
+	struct stat info;
+	if (stat(source, &info) == 0 && S_ISDIR(info.st_mode))
+	{
+		DIR* directory = opendir(source);
+		if (directory == NULL) { dyn_array_destroy(paths); return NULL; }
+		for (struct dirent* entry = readdir(directory); entry != NULL && success; entry = readdir(directory))
+		{
+			char* path = NULL;
+			if (asprintf(&path, "%s/%s", source, entry->d_name) < 0) { success = false; break; }
+			if (stat(path, &info) == 0 && S_ISREG(info.st_mode)) { success = add_path(paths, path); }
+			free(path);
+		}
+		closedir(directory);
+	}
+	else
+	{
+		glob_t matches;
+		int status = glob(source, 0, NULL, &matches);
+		if (status == 0)
+		{
+			for (size_t i = 0; i < matches.gl_pathc && success; i++) { success = add_path(paths, matches.gl_pathv[i]); }
+		}
+		success = success && (status == 0 || status == GLOB_NOMATCH);
+		globfree(&matches);
+	}
+
+	if (!success || (dyn_array_size(paths) > 1 && !dyn_array_sort(paths, compare_paths))) { dyn_array_destroy(paths); return NULL; }
+	return paths;
+}
+
+// Splits a comma separated algorithm list (or ALL) into names.
+// \param: list - the list from the command line, modified in place
+// \param: quantum - the round robin quantum, 0 if none (ALL then leaves round robin out)
+// \param: algorithms - where the names go, room for ALL_ALGORITHM_COUNT
+// \return: How many names there are, 0 if the list is empty, too long, has an unknown name or RR without a quantum
+static size_t parse_algorithms(char* list, const size_t quantum, const char** algorithms)
+{
+	size_t count = 0;
+	if (strcmp(list, ALL) == 0)
+	{
+		for (size_t i = 0; i < ALL_ALGORITHM_COUNT; i++)
+		{
+			if (strcmp(ALL_ALGORITHMS[i], RR) != 0 || quantum > 0) { algorithms[count++] = ALL_ALGORITHMS[i]; }
+		}
+		return count;
+	}
+
+	char* save = NULL;
+	for (char* name = strtok_r(list, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save))
+	{
+		bool known = false;
+		for (size_t i = 0; i < ALL_ALGORITHM_COUNT; i++) { known = known || strcmp(ALL_ALGORITHMS[i], name) == 0; }
+		if (!known || count == ALL_ALGORITHM_COUNT || (strcmp(name, RR) == 0 && quantum == 0)) { return 0; }
+		algorithms[count++] = name;
+	}
+	return count;
+}
+
+// Thread pool job: loads one file of the batch and runs it through every algorithm
+static void analyze_batch_file(void* arg, size_t index)
+{
+	AnalysisBatch_t* batch = (AnalysisBatch_t*)arg;
+	AnalysisFile_t* file = &batch->files[index];
+
+	double load_start = monotonic_seconds();
+	dyn_array_t* schedule = load_process_control_blocks(file->path);
+	file->load_seconds = monotonic_seconds() - load_start;
+	if (schedule == NULL) { return; }
+	file->pcb_count = dyn_array_size(schedule);
+
+	file->success = true;
+	for (size_t i = 0; i < batch->algorithm_count && file->success; i++)
+	{
+		file->success = run_algorithm(batch->algorithms[i], schedule, batch->quantum, batch->count_stats, NULL, false, &file->runs[i]);
+	}
+	dyn_array_destroy(schedule);
+}
+
+// Sums every successful file's runs into one summary per algorithm
+static void summarize_batch(const AnalysisBatch_t* batch, const size_t file_count, AnalysisSummary_t* summaries)
+{
+	memset(summaries, 0, sizeof(AnalysisSummary_t) * batch->algorithm_count);
+	for (size_t a = 0; a < batch->algorithm_count; a++) { summaries[a].algorithm = batch->algorithms[a]; }
+	for (size_t f = 0; f < file_count; f++)
+	{
+		const AnalysisFile_t* file = &batch->files[f];
+		if (!file->success) { continue; }
+		for (size_t a = 0; a < batch->algorithm_count; a++)
+		{
+			const AnalysisRun_t* run = &file->runs[a];
+			AnalysisSummary_t* summary = &summaries[a];
+			summary->function = run->function;
+			summary->files++;
+			summary->pcbs += file->pcb_count;
+			summary->total_waiting += (double)run->result.average_waiting_time * file->pcb_count;
+			summary->total_turnaround += (double)run->result.average_turnaround_time * file->pcb_count;
+			summary->total_run_time += run->result.total_run_time;
+			summary->simulate_seconds += run->simulate_seconds;
+			summary->stats.selections += run->stats.selections;
+			summary->stats.comparisons += run->stats.comparisons;
+			summary->stats.context_switches += run->stats.context_switches;
+			summary->stats.idle_jumps += run->stats.idle_jumps;
+			summary->stats.ticks += run->stats.ticks;
+			summary->stats.bytes_moved += run->stats.bytes_moved;
+			summary->stats.bytes_copied += run->stats.bytes_copied;
+		}
+	}
+}
+
+// PCB weighted average of a summed column
+static double summary_average(const double total, const size_t pcbs)
+{
+	return pcbs > 0 ? total / pcbs : 0;
+}
+
+static void print_batch_text(const AnalysisBatch_t* batch, const size_t file_count, const AnalysisSummary_t* summaries,
+	const double wall_seconds, const bool print_stats)
+{
+	for (size_t f = 0; f < file_count; f++)
+	{
+		const AnalysisFile_t* file = &batch->files[f];
+		if (!file->success) { printf("%s: failed\n", file->path); continue; }
+		printf("%s: %zu PCBs, loaded in %f s\n", file->path, file->pcb_count, file->load_seconds);
+		for (size_t a = 0; a < batch->algorithm_count; a++)
+		{
+			const AnalysisRun_t* run = &file->runs[a];
+			printf("  %-4s waiting %f  turnaround %f  run time %lu  simulated in %f s\n", run->algorithm,
+				run->result.average_waiting_time, run->result.average_turnaround_time, run->result.total_run_time, run->simulate_seconds);
+		}
+	}
+
+	printf("Summary\n");
+	for (size_t a = 0; a < batch->algorithm_count; a++)
+	{
+		const AnalysisSummary_t* summary = &summaries[a];
+		printf("  %-4s %zu files, %zu PCBs, waiting %f  turnaround %f  run time %lu  PCBs/sec %.0f\n", summary->algorithm,
+			summary->files, summary->pcbs, summary_average(summary->total_waiting, summary->pcbs),
+			summary_average(summary->total_turnaround, summary->pcbs), summary->total_run_time,
+			pcbs_per_second(summary->pcbs, summary->simulate_seconds));
+		if (print_stats)
+		{
+			printf("       selections %lu  comparisons %lu  context switches %lu  idle jumps %lu  ticks %lu  bytes moved %zu  bytes copied %zu\n",
+				summary->stats.selections, summary->stats.comparisons, summary->stats.context_switches, summary->stats.idle_jumps,
+				summary->stats.ticks, summary->stats.bytes_moved, summary->stats.bytes_copied);
+		}
+	}
+	printf("Files:\t\t\t %zu\n", file_count);
+	printf("Wall Time:\t\t %f s\n", wall_seconds);
+	printf("Files/sec:\t\t %.0f\n", pcbs_per_second(file_count, wall_seconds));
+	printf("Threads:\t\t %zu\n", thread_pool_thread_count());
+	printf("Peak RSS:\t\t %ld KB\n", peak_rss_kilobytes());
+}
+
+static void print_batch_json(const AnalysisBatch_t* batch, const size_t file_count, const AnalysisSummary_t* summaries,
+	const double wall_seconds, const bool print_stats)
+{
+	printf("{\n  \"files\": [");
+	for (size_t f = 0; f < file_count; f++)
+	{
+		const AnalysisFile_t* file = &batch->files[f];
+		printf("%s\n    { \"file\": ", f > 0 ? "," : "");
+		print_json_string(file->path);
+		printf(", \"success\": %s, \"pcbs\": %zu, \"load_seconds\": %.9f, \"runs\": [", file->success ? "true" : "false",
+			file->pcb_count, file->load_seconds);
+		for (size_t a = 0; file->success && a < batch->algorithm_count; a++)
+		{
+			const AnalysisRun_t* run = &file->runs[a];
+			printf("%s\n      { \"algorithm\": \"%s\", \"average_waiting_time\": %f, \"average_turnaround_time\": %f, "
+				"\"total_run_time\": %lu, \"simulate_seconds\": %.9f", a > 0 ? "," : "", run->algorithm,
+				run->result.average_waiting_time, run->result.average_turnaround_time, run->result.total_run_time, run->simulate_seconds);
+			if (print_stats) { printf(", \"stats\": "); print_json_stats(&run->stats); }
+			printf(" }");
+		}
+		printf("%s] }", file->success ? "\n    " : "");
+	}
+
+	printf("\n  ],\n  \"summary\": [");
+	for (size_t a = 0; a < batch->algorithm_count; a++)
+	{
+		const AnalysisSummary_t* summary = &summaries[a];
+		printf("%s\n    { \"algorithm\": \"%s\", \"files\": %zu, \"pcbs\": %zu, \"average_waiting_time\": %f, "
+			"\"average_turnaround_time\": %f, \"total_run_time\": %lu, \"simulate_seconds\": %.9f, \"pcbs_per_second\": %.0f",
+			a > 0 ? "," : "", summary->algorithm, summary->files, summary->pcbs, summary_average(summary->total_waiting, summary->pcbs),
+			summary_average(summary->total_turnaround, summary->pcbs), summary->total_run_time, summary->simulate_seconds,
+			pcbs_per_second(summary->pcbs, summary->simulate_seconds));
+		if (print_stats) { printf(", \"stats\": "); print_json_stats(&summary->stats); }
+		printf(" }");
+	}
+	printf("\n  ],\n  \"file_count\": %zu,\n  \"wall_seconds\": %.9f,\n  \"threads\": %zu,\n  \"peak_rss_kb\": %ld\n}\n",
+		file_count, wall_seconds, thread_pool_thread_count(), peak_rss_kilobytes());
+}
+
+// Writes a field as CSV, quoted if it has to be
+static void print_csv_field(const char* field)
+{
+	if (strpbrk(field, ",\"\n") == NULL) { fputs(field, stdout); return; }
+	putchar('"');
+	for (const char* c = field; *c != '\0'; c++)
+	{
+		if (*c == '"') { putchar('"'); }
+		putchar(*c);
+	}
+	putchar('"');
+}
+
+// One row per file and algorithm, then one per algorithm with an empty file for the summary
+static void print_batch_csv(const AnalysisBatch_t* batch, const size_t file_count, const AnalysisSummary_t* summaries, const bool print_stats)
+{
+	printf("file,algorithm,success,pcbs,average_waiting_time,average_turnaround_time,total_run_time,load_seconds,simulate_seconds");
+	if (print_stats) { printf(",selections,comparisons,context_switches,idle_jumps,ticks,bytes_moved,bytes_copied"); }
+	printf("\n");
+
+	for (size_t f = 0; f < file_count; f++)
+	{
+		const AnalysisFile_t* file = &batch->files[f];
+		for (size_t a = 0; a < batch->algorithm_count; a++)
+		{
+			const AnalysisRun_t* run = &file->runs[a];
+			print_csv_field(file->path);
+			printf(",%s,%d,%zu,%f,%f,%lu,%.9f,%.9f", batch->algorithms[a], file->success, file->pcb_count, run->result.average_waiting_time,
+				run->result.average_turnaround_time, run->result.total_run_time, file->load_seconds, run->simulate_seconds);
+			if (print_stats)
+			{
+				printf(",%lu,%lu,%lu,%lu,%lu,%zu,%zu", run->stats.selections, run->stats.comparisons, run->stats.context_switches,
+					run->stats.idle_jumps, run->stats.ticks, run->stats.bytes_moved, run->stats.bytes_copied);
+			}
+			printf("\n");
+		}
+	}
+	for (size_t a = 0; a < batch->algorithm_count; a++)
+	{
+		const AnalysisSummary_t* summary = &summaries[a];
+		printf(",%s,%d,%zu,%f,%f,%lu,,%.9f", summary->algorithm, summary->files == file_count, summary->pcbs,
+			summary_average(summary->total_waiting, summary->pcbs), summary_average(summary->total_turnaround, summary->pcbs),
+			summary->total_run_time, summary->simulate_seconds);
+		if (print_stats)
+		{
+			printf(",%lu,%lu,%lu,%lu,%lu,%zu,%zu", summary->stats.selections, summary->stats.comparisons, summary->stats.context_switches,
+				summary->stats.idle_jumps, summary->stats.ticks, summary->stats.bytes_moved, summary->stats.bytes_copied);
+		}
+		printf("\n");
+	}
+}
+
+// The summary as a README style table
+static void print_batch_markdown(const AnalysisBatch_t* batch, const AnalysisSummary_t* summaries)
+{
+	printf("| Scheduling Algorithm | Average Waiting Time | Average Turnaround Time | Total Run Time |\n");
+	printf("|-----|-----|-----|-----|\n");
+	for (size_t a = 0; a < batch->algorithm_count; a++)
+	{
+		printf("| `%s` | `%f` | `%f` | `%lu` |\n", summaries[a].function ? summaries[a].function : summaries[a].algorithm,
+			summary_average(summaries[a].total_waiting, summaries[a].pcbs),
+			summary_average(summaries[a].total_turnaround, summaries[a].pcbs), summaries[a].total_run_time);
+	}
+}
+
+// Runs batch mode (see the notes above).
+// \param: source - a directory or glob
+// \param: algorithm_list - comma separated algorithm names, or ALL
+// \param: quantum - the round robin quantum, 0 if none was given
+// \param: format - how to print the report
+// \param: print_stats - true to count and report scheduler stats
+// \return: EXIT_SUCCESS if every file was analyzed, EXIT_FAILURE otherwise (or if there were no files)
+static int run_batch(const char* source, char* algorithm_list, const size_t quantum, const OutputFormat_t format, const bool print_stats)
+{
+	const char* algorithms[ALL_ALGORITHM_COUNT];
+	size_t algorithm_count = parse_algorithms(algorithm_list, quantum, algorithms);
+	if (algorithm_count == 0)
+	{
+		fprintf(stderr, "Algorithms are a comma separated list of FCFS, SJF, P, RR (needs a quantum) and SRT, or ALL\n");
+		return EXIT_FAILURE;
+	}
+
+	double wall_start = monotonic_seconds();
+	dyn_array_t* paths = list_batch_files(source);
+	if (paths == NULL) { fprintf(stderr, "Could not list %s\n", source); return EXIT_FAILURE; }
+	size_t file_count = dyn_array_size(paths);
+	// An empty batch is almost certainly a mistyped path, an all zero report would hide it
+	if (file_count == 0) { fprintf(stderr, "No PCB files in %s\n", source); dyn_array_destroy(paths); return EXIT_FAILURE; }
+
+	AnalysisFile_t* files = calloc(file_count, sizeof(AnalysisFile_t));
+	if (files == NULL) { dyn_array_destroy(paths); return EXIT_FAILURE; }
+	for (size_t f = 0; f < file_count; f++) { files[f].path = *(char**)dyn_array_at(paths, f); }
+
+	AnalysisBatch_t batch = { files, algorithms, algorithm_count, quantum, print_stats };
+	thread_pool_parallel_for(file_count, analyze_batch_file, &batch);
+
+	AnalysisSummary_t summaries[ALL_ALGORITHM_COUNT];
+	summarize_batch(&batch, file_count, summaries);
+	double wall_seconds = monotonic_seconds() - wall_start;
+
+	switch (format)
+	{
+		case FORMAT_TEXT: print_batch_text(&batch, file_count, summaries, wall_seconds, print_stats); break;
+		case FORMAT_JSON: print_batch_json(&batch, file_count, summaries, wall_seconds, print_stats); break;
+		case FORMAT_CSV: print_batch_csv(&batch, file_count, summaries, print_stats); break;
+		case FORMAT_MARKDOWN: print_batch_markdown(&batch, summaries); break;
+	}
+
+	bool success = true;
+	for (size_t f = 0; f < file_count; f++) { success = success && files[f].success; }
+	free(files);
+	dyn_array_destroy(paths);
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+	Server mode notes!
+
+	analysis --serve <socket path> listens on a Unix domain socket and answers queries until it gets
+	  SHUTDOWN, SIGINT or SIGTERM. Requests and replies are single lines:
+	    <algorithm> <quantum> <pcb file>	->	OK <average waiting> <average turnaround> <total run time>
+	    STATS							->	OK <hits> <misses> <cached files>
+	    SHUTDOWN						->	OK, then the server stops
+	  Anything that fails gets ERR <reason>. The quantum is ignored by everything but RR, the file goes last
+	  so it can have spaces in it. A connection can send as many requests as it likes.
+
+	Loaded files are cached by path and checked against the file's mtime, size and inode on every request,
+	  so a rewritten file is reloaded. The schedulers only depend on the PCBs, so each cached file keeps the
+	  results it has worked out too: a warm query is a stat and a table lookup.
+
+	The cache holds up to --cache-size files (1024 by default), the least recently used one goes first.
+
+	One thread polls the listening socket and every connection, reading whatever clients send. Once a
+	  connection has a complete request line it is handed to the thread pool, which answers every complete
+	  line it has and gives it back to the poller. So an idle client costs a buffer, not a thread, and
+	  --threads only limits how many requests are worked on at once. The poller takes part in the pool's
+	  thread count but just waits, so unless --threads says otherwise the server runs one thread per CPU
+	  plus the poller (with --threads 1 the poller answers requests itself).
+*/
+
+#define SERVER_DEFAULT_CACHE_SIZE 1024
+#define SERVER_CACHE_BUCKETS 1024
+// Round robin results kept per file, for the most recent distinct quanta
+#define SERVER_CACHED_QUANTA 8
+// Longest request line accepted (a path plus the algorithm and quantum)
+#define SERVER_MAX_REQUEST 4352
+
+// A loaded file and the results worked out for it so far
+typedef struct ServerCacheEntry
+{
+	char* path;
+	struct timespec mtime;				// What the file looked like when it was loaded
+	off_t size;
+	ino_t inode;
+	dyn_array_t* schedule;
+	size_t references;					// Requests using it, plus one while it's in the table
+	unsigned long last_used;
+	bool computed[ALL_ALGORITHM_COUNT];	// Results by ALL_ALGORITHMS index (round robin's are in rr_results)
+	ScheduleResult_t results[ALL_ALGORITHM_COUNT];
+	size_t rr_quanta[SERVER_CACHED_QUANTA];	// 0 for an empty slot
+	ScheduleResult_t rr_results[SERVER_CACHED_QUANTA];
+	size_t rr_next;						// Slot the next new quantum replaces
+	struct ServerCacheEntry* next;		// Bucket chain
+}
+ServerCacheEntry_t;
+
+// Everything the server threads share
+typedef struct
+{
+	int listen_fd;
+	int wake_fds[2];					// A pipe that wakes the poller when a connection comes back or the server stops
+	pthread_mutex_t cache_lock;			// Guards everything below
+	ServerCacheEntry_t* buckets[SERVER_CACHE_BUCKETS];
+	size_t cached;
+	size_t cache_capacity;
+	unsigned long clock;				// Bumped on every lookup, for least recently used
+	unsigned long hits;
+	unsigned long misses;
+}
+AnalysisServer_t;
+
+// One client, and what it has sent that hasn't been answered yet
+typedef struct
+{
+	AnalysisServer_t* server;
+	int fd;
+	atomic_bool busy;					// A pool thread is answering it, the poller leaves it alone until it's false
+	bool closing;						// The client went away or broke the protocol, set before busy is cleared
+	size_t buffered;
+	char buffer[SERVER_MAX_REQUEST];
+}
+ServerConnection_t;
+
+// Set by SHUTDOWN or a signal, the poller stops once it wakes up and sees it
+static atomic_bool server_stopping = false;
+static AnalysisServer_t* running_server = NULL;
+
+// Wakes the poller up, a full pipe already has a wake-up in it
+static void server_wake(AnalysisServer_t* server)
+{
+	const char byte = 0;
+	while (write(server->wake_fds[1], &byte, 1) == -1 && errno == EINTR) { }
+}
+
+// Tells the poller to stop.
+// Only makes async signal safe calls, so the signal handler can use it.
+static void server_stop(void)
+{
+	atomic_store(&server_stopping, true);
+	AnalysisServer_t* server = running_server;
+	if (server != NULL) { server_wake(server); }
+}
+
+static void server_signal_handler(int signal_number)
+{
+	(void)signal_number;
+	// The wake-up write can change errno under whatever the signal interrupted
+	int saved_errno = errno;
+	server_stop();
+	errno = saved_errno;
+}
+
+static unsigned long hash_path(const char* path)
+{
+	// FNV-1a
+	unsigned long hash = 14695981039346656037ul;
+	for (const unsigned char* c = (const unsigned char*)path; *c != '\0'; c++) { hash = (hash ^ *c) * 1099511628211ul; }
+	return hash;
+}
+
+// Drops a reference to an entry, freeing it with the last one. Must hold cache_lock.
+static void server_release_entry(ServerCacheEntry_t* entry)
+{
+	if (--entry->references > 0) { return; }
+	dyn_array_destroy(entry->schedule);
+	free(entry->path);
+	free(entry);
+}
+
+// Takes an entry out of the table. Must hold cache_lock.
+static void server_unlink_entry(AnalysisServer_t* server, ServerCacheEntry_t* entry)
+{
+	ServerCacheEntry_t** link = &server->buckets[hash_path(entry->path) % SERVER_CACHE_BUCKETS];
+	while (*link != entry) { link = &(*link)->next; }
+	*link = entry->next;
+	server->cached--;
+	server_release_entry(entry);
+}
+
+// Makes room for one more entry by dropping the least recently used one. Must hold cache_lock.
+static void server_evict(AnalysisServer_t* server)
+{
+	while (server->cached >= server->cache_capacity)
+	{
+		ServerCacheEntry_t* oldest = NULL;
+		for (size_t b = 0; b < SERVER_CACHE_BUCKETS; b++)
+		{
+			for (ServerCacheEntry_t* entry = server->buckets[b]; entry != NULL; entry = entry->next)
+			{
+				if (oldest == NULL || entry->last_used < oldest->last_used) { oldest = entry; }
+			}
+		}
+		server_unlink_entry(server, oldest);
+	}
+}
+
+// Finds the cached entry for a file as it is on disk now, loading it if it isn't cached or has changed.
+// \param: server - the server
+// \param: path - the PCB file
+// \return: The entry with a reference taken (give it back with server_release_entry), NULL if the file can't be loaded
+static ServerCacheEntry_t* server_acquire_entry(AnalysisServer_t* server, const char* path)
+{
+	struct stat info;
+	if (stat(path, &info) != 0) { return NULL; }
+	ServerCacheEntry_t** bucket = &server->buckets[hash_path(path) % SERVER_CACHE_BUCKETS];
+
+	pthread_mutex_lock(&server->cache_lock);
+	for (ServerCacheEntry_t* entry = *bucket; entry != NULL; entry = entry->next)
+	{
+		if (strcmp(entry->path, path) != 0) { continue; }
+		if (entry->mtime.tv_sec == info.st_mtim.tv_sec && entry->mtime.tv_nsec == info.st_mtim.tv_nsec
+			&& entry->size == info.st_size && entry->inode == info.st_ino)
+		{
+			entry->references++;
+			entry->last_used = ++server->clock;
+			server->hits++;
+			pthread_mutex_unlock(&server->cache_lock);
+			return entry;
+		}
+		// The file changed, anyone still using the old one keeps it until they're done
+		server_unlink_entry(server, entry);
+		break;
+	}
+	server->misses++;
+	pthread_mutex_unlock(&server->cache_lock);
+
+	// Load without holding the lock, two threads might both load a new file but only one copy gets kept
+	ServerCacheEntry_t* loaded = calloc(1, sizeof(ServerCacheEntry_t));
+	if (loaded == NULL) { return NULL; }
+	loaded->path = strdup(path);
+	loaded->schedule = load_process_control_blocks(path);
+	if (loaded->path == NULL || loaded->schedule == NULL)
+	{
+		dyn_array_destroy(loaded->schedule);
+		free(loaded->path);
+		free(loaded);
+		return NULL;
+	}
+	loaded->mtime = info.st_mtim;
+	loaded->size = info.st_size;
+	loaded->inode = info.st_ino;
+	loaded->references = 2;
+
+	pthread_mutex_lock(&server->cache_lock);
+	for (ServerCacheEntry_t* entry = *bucket; entry != NULL; entry = entry->next)
+	{
+		if (strcmp(entry->path, path) == 0) { server_unlink_entry(server, entry); break; }
+	}
+	server_evict(server);
+	loaded->last_used = ++server->clock;
+	loaded->next = *bucket;
+	*bucket = loaded;
+	server->cached++;
+	pthread_mutex_unlock(&server->cache_lock);
+	return loaded;
+}
+
+// Looks up a result the entry already has. Must hold cache_lock.
+// \return: True and the result if it has been worked out before, false otherwise
+static bool server_cached_result(const ServerCacheEntry_t* entry, const size_t algorithm, const size_t quantum, ScheduleResult_t* result)
+{
+	if (strcmp(ALL_ALGORITHMS[algorithm], RR) != 0)
+	{
+		*result = entry->results[algorithm];
+		return entry->computed[algorithm];
+	}
+	for (size_t i = 0; i < SERVER_CACHED_QUANTA; i++)
+	{
+		if (entry->rr_quanta[i] == quantum) { *result = entry->rr_results[i]; return true; }
+	}
+	return false;
+}
+
+// Keeps a result on the entry. Must hold cache_lock.
+static void server_cache_result(ServerCacheEntry_t* entry, const size_t algorithm, const size_t quantum, const ScheduleResult_t* result)
+{
+	if (strcmp(ALL_ALGORITHMS[algorithm], RR) != 0)
+	{
+		entry->results[algorithm] = *result;
+		entry->computed[algorithm] = true;
+		return;
+	}
+	entry->rr_quanta[entry->rr_next] = quantum;
+	entry->rr_results[entry->rr_next] = *result;
+	entry->rr_next = (entry->rr_next + 1) % SERVER_CACHED_QUANTA;
+}
+
+// Answers one request line.
+// \param: server - the server
+// \param: request - the line, without its newline (modified)
+// \param: reply - where the reply line goes
+// \param: reply_size - room in reply
+// \return: True if the server should stop once the reply is sent, false otherwise
+static bool server_handle_request(AnalysisServer_t* server, char* request, char* reply, const size_t reply_size)
+{
+	if (strcmp(request, "SHUTDOWN") == 0) { snprintf(reply, reply_size, "OK\n"); return true; }
+	if (strcmp(request, "STATS") == 0)
+	{
+		pthread_mutex_lock(&server->cache_lock);
+		snprintf(reply, reply_size, "OK %lu %lu %zu\n", server->hits, server->misses, server->cached);
+		pthread_mutex_unlock(&server->cache_lock);
+		return false;
+	}
+
+	// <algorithm> <quantum> <path>
+	char* save = NULL;
+	char* name = strtok_r(request, " ", &save);
+	char* quantum_text = strtok_r(NULL, " ", &save);
+	char* path = save;
+	size_t quantum = 0;
+	if (name == NULL || quantum_text == NULL || path == NULL || *path == '\0' || sscanf(quantum_text, "%zu", &quantum) != 1)
+	{
+		snprintf(reply, reply_size, "ERR expected <algorithm> <quantum> <pcb file>\n");
+		return false;
+	}
+	size_t algorithm = ALL_ALGORITHM_COUNT;
+	for (size_t i = 0; i < ALL_ALGORITHM_COUNT; i++)
+	{
+		if (strcmp(ALL_ALGORITHMS[i], name) == 0) { algorithm = i; }
+	}
+	if (algorithm == ALL_ALGORITHM_COUNT) { snprintf(reply, reply_size, "ERR unknown algorithm\n"); return false; }
+	if (strcmp(name, RR) == 0 && quantum == 0) { snprintf(reply, reply_size, "ERR RR needs a quantum\n"); return false; }
+
+	ServerCacheEntry_t* entry = server_acquire_entry(server, path);
+	if (entry == NULL) { snprintf(reply, reply_size, "ERR could not load %s\n", path); return false; }
+
+	pthread_mutex_lock(&server->cache_lock);
+	ScheduleResult_t result;
+	bool cached = server_cached_result(entry, algorithm, quantum, &result);
+	pthread_mutex_unlock(&server->cache_lock);
+
+	// The schedule is never modified, so it can be run without the lock
+	bool success = cached;
+	if (!cached)
+	{
+		AnalysisRun_t run;
+		success = run_algorithm(ALL_ALGORITHMS[algorithm], entry->schedule, quantum, false, NULL, false, &run);
+		result = run.result;
+	}
+
+	pthread_mutex_lock(&server->cache_lock);
+	if (success && !cached) { server_cache_result(entry, algorithm, quantum, &result); }
+	server_release_entry(entry);
+	pthread_mutex_unlock(&server->cache_lock);
+
+	if (success)
+	{
+		snprintf(reply, reply_size, "OK %.9g %.9g %lu\n", result.average_waiting_time, result.average_turnaround_time, result.total_run_time);
+	}
+	else { snprintf(reply, reply_size, "ERR %s failed\n", name); }
+	return false;
+}
+
+// Writes all of a reply, riding out interrupts and short writes.
+// \return: True if it was all written, false if the client went away
+static bool server_write(const int fd, const char* data, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = send(fd, data, length, MSG_NOSIGNAL);
+		if (written > 0) { data += written; length -= written; }
+		else if (written == -1 && errno == EINTR) { continue; }
+		else { return false; }
+	}
+	return true;
+}
+
+// Thread pool job: answers every complete line a connection has buffered, then hands it back to the poller
+static void server_answer_connection(void* arg)
+{
+	ServerConnection_t* connection = (ServerConnection_t*)arg;
+	char reply[SERVER_MAX_REQUEST + 64];
+	char* line = connection->buffer;
+	char* end;
+	while (!connection->closing && (end = memchr(line, '\n', connection->buffered - (line - connection->buffer))) != NULL)
+	{
+		*end = '\0';
+		if (end > line && end[-1] == '\r') { end[-1] = '\0'; }
+		bool stop = server_handle_request(connection->server, line, reply, sizeof(reply));
+		connection->closing = !server_write(connection->fd, reply, strlen(reply));
+		if (stop) { server_stop(); }
+		line = end + 1;
+	}
+	// Keep the partial line for next time
+	connection->buffered -= line - connection->buffer;
+	memmove(connection->buffer, line, connection->buffered);
+	if (!connection->closing && connection->buffered == sizeof(connection->buffer))
+	{
+		server_write(connection->fd, "ERR request too long\n", 21);
+		connection->closing = true;
+	}
+
+	atomic_store(&connection->busy, false);
+	server_wake(connection->server);
+}
+
+// Reads what a client sent, handing the connection to the pool once it has a complete line.
+// \param: connection - a connection the poller owns (not busy)
+// \param: group - the task group requests are answered in, NULL to answer them on this thread
+// \return: True if the connection is still open, false if the client went away
+static bool server_read_connection(ServerConnection_t* connection, thread_pool_task_group_t* group)
+{
+	ssize_t received;
+	do
+	{
+		received = recv(connection->fd, connection->buffer + connection->buffered, sizeof(connection->buffer) - connection->buffered, 0);
+	} while (received == -1 && errno == EINTR);
+	if (received <= 0) { return false; }
+
+	// Only the new bytes can hold the first newline, anything before was looked at already
+	const char* fresh = connection->buffer + connection->buffered;
+	connection->buffered += received;
+	if (memchr(fresh, '\n', received) == NULL && connection->buffered < sizeof(connection->buffer)) { return true; }
+
+	atomic_store(&connection->busy, true);
+	if (group == NULL) { server_answer_connection(connection); }
+	else { thread_pool_task_group_run(group, server_answer_connection, connection); }
+	return true;
+}
+
+static void server_close_connection(ServerConnection_t* connection)
+{
+	close(connection->fd);
+	free(connection);
+}
+
+// Accepts connections and reads requests until the server stops (see the notes above).
+// \param: server - the server, listening
+// \param: group - the task group requests are answered in, NULL to answer them on this thread
+// \return: EXIT_SUCCESS once stopped, EXIT_FAILURE if polling broke
+static int server_poll(AnalysisServer_t* server, thread_pool_task_group_t* group)
+{
+	// Connections and the poll set line up after the wake pipe and the listening socket
+	dyn_array_t* connections = dyn_array_create(0, sizeof(ServerConnection_t*), NULL);
+	struct pollfd* polled = NULL;
+	size_t polled_capacity = 0;
+	int status = connections == NULL ? EXIT_FAILURE : EXIT_SUCCESS;
+
+	while (status == EXIT_SUCCESS && !atomic_load(&server_stopping))
+	{
+		// Drop connections that were answered for the last time, poll the ones nobody is answering
+		size_t connection_count = dyn_array_size(connections);
+		for (size_t c = connection_count; c-- > 0;)
+		{
+			ServerConnection_t* connection = *(ServerConnection_t**)dyn_array_at(connections, c);
+			if (!atomic_load(&connection->busy) && connection->closing)
+			{
+				server_close_connection(connection);
+				dyn_array_erase_swap(connections, c);
+			}
+		}
+		connection_count = dyn_array_size(connections);
+		if (connection_count + 2 > polled_capacity)
+		{
+			struct pollfd* grown = realloc(polled, sizeof(struct pollfd) * (connection_count + 2) * 2);
+			if (grown == NULL) { status = EXIT_FAILURE; break; }
+			polled = grown;
+			polled_capacity = (connection_count + 2) * 2;
+		}
+		polled[0] = (struct pollfd) { server->wake_fds[0], POLLIN, 0 };
+		polled[1] = (struct pollfd) { server->listen_fd, POLLIN, 0 };
+		for (size_t c = 0; c < connection_count; c++)
+		{
+			ServerConnection_t* connection = *(ServerConnection_t**)dyn_array_at(connections, c);
+			// A negative fd is skipped by poll
+			polled[c + 2] = (struct pollfd) { atomic_load(&connection->busy) ? -1 : connection->fd, POLLIN, 0 };
+		}
+
+		if (poll(polled, connection_count + 2, -1) == -1)
+		{
+			if (errno != EINTR) { perror("poll"); status = EXIT_FAILURE; }
+			continue;
+		}
+		if (polled[0].revents != 0)
+		{
+			char drained[64];
+			while (read(server->wake_fds[0], drained, sizeof(drained)) > 0) { }
+		}
+
+		for (size_t c = 0; c < connection_count; c++)
+		{
+			if (polled[c + 2].revents == 0) { continue; }
+			ServerConnection_t* connection = *(ServerConnection_t**)dyn_array_at(connections, c);
+			if (!server_read_connection(connection, group)) { connection->closing = true; }
+		}
+
+		if (polled[1].revents != 0)
+		{
+			int fd = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+			if (fd == -1)
+			{
+				if (errno != EINTR && errno != ECONNABORTED && errno != EAGAIN) { perror("accept"); status = EXIT_FAILURE; }
+				continue;
+			}
+			ServerConnection_t* connection = malloc(sizeof(ServerConnection_t));
+			if (connection == NULL || !dyn_array_push_back(connections, &connection))
+			{
+				free(connection);
+				close(fd);
+				continue;
+			}
+			connection->server = server;
+			connection->fd = fd;
+			atomic_init(&connection->busy, false);
+			connection->closing = false;
+			connection->buffered = 0;
+		}
+	}
+
+	// Cut off clients still being answered (a reply blocked on a client that doesn't read fails), wait for them, then close everything
+	if (connections != NULL)
+	{
+		for (size_t c = 0; c < dyn_array_size(connections); c++)
+		{
+			shutdown((*(ServerConnection_t**)dyn_array_at(connections, c))->fd, SHUT_RDWR);
+		}
+		thread_pool_task_group_wait(group);
+		for (size_t c = 0; c < dyn_array_size(connections); c++) { server_close_connection(*(ServerConnection_t**)dyn_array_at(connections, c)); }
+		dyn_array_destroy(connections);
+	}
+	free(polled);
+	return status;
+}
+
+// Runs server mode (see the notes above).
+// \param: socket_path - where to listen, a stale socket left there is replaced
+// \param: cache_capacity - the most files to keep loaded
+// \return: EXIT_SUCCESS once stopped, EXIT_FAILURE if it couldn't start or polling broke
+static int run_server(const char* socket_path, const size_t cache_capacity)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(socket_path) >= sizeof(address.sun_path)) { fprintf(stderr, "Socket path is too long\n"); return EXIT_FAILURE; }
+	strcpy(address.sun_path, socket_path);
+
+	AnalysisServer_t* server = calloc(1, sizeof(AnalysisServer_t));
+	if (server == NULL) { return EXIT_FAILURE; }
+	server->cache_capacity = cache_capacity;
+	if (pipe2(server->wake_fds, O_CLOEXEC | O_NONBLOCK) != 0)
+	{
+		perror("pipe");
+		free(server);
+		return EXIT_FAILURE;
+	}
+	server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (server->listen_fd == -1)
+	{
+		perror("socket");
+		close(server->wake_fds[0]);
+		close(server->wake_fds[1]);
+		free(server);
+		return EXIT_FAILURE;
+	}
+	pthread_mutex_init(&server->cache_lock, NULL);
+
+	// Only a socket gets replaced, never a regular file that happens to have the name
+	struct stat info;
+	if (stat(socket_path, &info) == 0 && S_ISSOCK(info.st_mode)) { unlink(socket_path); }
+	if (bind(server->listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(server->listen_fd, SOMAXCONN) != 0)
+	{
+		perror(socket_path);
+		close(server->listen_fd);
+		close(server->wake_fds[0]);
+		close(server->wake_fds[1]);
+		pthread_mutex_destroy(&server->cache_lock);
+		free(server);
+		return EXIT_FAILURE;
+	}
+
+	running_server = server;
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = server_signal_handler;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	// With a single thread there are no workers to hand requests to
+	thread_pool_task_group_t* group = thread_pool_thread_count() > 1 ? thread_pool_task_group_create() : NULL;
+	int status = server_poll(server, group);
+	thread_pool_task_group_destroy(group);
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	running_server = NULL;
+	close(server->listen_fd);
+	unlink(socket_path);
+	for (size_t b = 0; b < SERVER_CACHE_BUCKETS; b++)
+	{
+		while (server->buckets[b] != NULL) { server_unlink_entry(server, server->buckets[b]); }
+	}
+	close(server->wake_fds[0]);
+	close(server->wake_fds[1]);
+	pthread_mutex_destroy(&server->cache_lock);
+	free(server);
+	return status;
+}
 
 // Add and comment your analysis code in this function.
 // THIS IS NOT FINISHED.
-int main(int argc, char **argv) 
+int main(int argc, char **argv)
 {
+	// Pull out the flags, wherever they are, so the rest are positional
+	bool print_stats = false;
+	bool batch = false;
+	bool serve = false;
+	bool sort = false;
+	bool threads_given = false;
+	pcb_sort_options_t sort_options = { 0, NULL };
+	size_t cache_capacity = SERVER_DEFAULT_CACHE_SIZE;
+	const char* trace_path = NULL;
+	OutputFormat_t format = FORMAT_TEXT;
+	int positional_count = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--stats") == 0) { print_stats = true; }
+		else if (strcmp(argv[i], "--batch") == 0) { batch = true; }
+		else if (strcmp(argv[i], "--serve") == 0) { serve = true; }
+		else if (strcmp(argv[i], "--sort") == 0) { sort = true; }
+		else if (strcmp(argv[i], "--memory") == 0)
+		{
+			size_t megabytes = 0;
+			if (i + 1 >= argc || sscanf(argv[++i], "%zu", &megabytes) != 1 || megabytes == 0)
+			{
+				fprintf(stderr, "--memory takes how many MiB the sort may use\n");
+				return EXIT_FAILURE;
+			}
+			sort_options.memory_bytes = megabytes << 20;
+		}
+		else if (strcmp(argv[i], "--cache-size") == 0)
+		{
+			if (i + 1 >= argc || sscanf(argv[++i], "%zu", &cache_capacity) != 1 || cache_capacity == 0)
+			{
+				fprintf(stderr, "--cache-size takes how many files to keep loaded\n");
+				return EXIT_FAILURE;
+			}
+		}
+		else if (strcmp(argv[i], "--threads") == 0)
+		{
+			size_t thread_count = 0;
+			if (i + 1 >= argc || sscanf(argv[++i], "%zu", &thread_count) != 1)
+			{
+				fprintf(stderr, "--threads takes a thread count (0 for one per CPU)\n");
+				return EXIT_FAILURE;
+			}
+			thread_pool_set_thread_count(thread_count);
+			threads_given = true;
+		}
+		else if (strcmp(argv[i], "--trace") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				fprintf(stderr, "--trace takes the file to write the schedule trace to\n");
+				return EXIT_FAILURE;
+			}
+			trace_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--format") == 0)
+		{
+			if (i + 1 >= argc || !parse_format(argv[++i], &format))
+			{
+				fprintf(stderr, "--format takes text, json, csv or markdown\n");
+				return EXIT_FAILURE;
+			}
+		}
+		else { argv[positional_count++] = argv[i]; }
+	}
+	argc = positional_count;
+
+	if (serve && argc == 2)
+	{
+		// One thread per CPU answers requests, plus the poller
+		if (!threads_given) { thread_pool_set_thread_count(thread_pool_thread_count() + 1); }
+		return run_server(argv[1], cache_capacity);
+	}
+
+	// Sort a trace by arrival without loading it, for traces bigger than memory
+	if (sort && argc == 3)
+	{
+		if (!pcb_sort_file(argv[1], argv[2], &sort_options))
+		{
+			fprintf(stderr, "Could not sort %s into %s\n", argv[1], argv[2]);
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
 	// Ensure the correct number of arguments are present
-	if (argc < 3) 
+	if (argc < 3 || serve || sort || (batch && trace_path != NULL))
 	{
-		printf("%s <pcb file> <schedule algorithm> [quantum]\n", argv[0]);
+		printf("%s <pcb file> <schedule algorithm|ALL> [quantum] [--stats] [--format text|json|csv|markdown] [--trace <file>]\n", argv[0]);
+		printf("%s --batch <directory|glob> <algorithm,...|ALL> [quantum] [--threads N] [--stats] [--format text|json|csv|markdown]\n", argv[0]);
+		printf("%s --serve <socket path> [--threads N] [--cache-size N]\n", argv[0]);
+		printf("%s --sort <pcb file> <sorted pcb file> [--memory MiB]\n", argv[0]);
 		return EXIT_FAILURE;
 	}
 
@@ -34,62 +1343,78 @@ int main(int argc, char **argv)
 	size_t quantum = 0;
 	if (argc > 3 && sscanf(argv[3], "%zu", &quantum) <= 0) { return EXIT_FAILURE; }
 
+	// Count what the schedulers do if asked to
+	ScheduleStats_t probe;
+	if (print_stats && !schedule_stats_attach(&probe))
+	{
+		fprintf(stderr, "Scheduler stats are not compiled in (build with SCHEDULE_STATS)\n");
+		print_stats = false;
+	}
+	schedule_stats_attach(NULL);
+
+	if (batch) { return run_batch(filename, algorithm_name, quantum, format, print_stats); }
+
 	// Extract schedule data from the provided file
+	double load_start = monotonic_seconds();
 	dyn_array_t* schedule = load_process_control_blocks(filename);
+	double load_seconds = monotonic_seconds() - load_start;
 	if (schedule == NULL) { return EXIT_FAILURE; }
+	size_t pcb_count = dyn_array_size(schedule);
 
-	// Allocate storage for the schedule algorithm result
-	ScheduleResult_t* result = malloc(sizeof(ScheduleResult_t));
-	if (result == NULL) { dyn_array_destroy(schedule); return EXIT_FAILURE; }
-
-	// Call the correct scheduling algorithm on the provided file schedule data
-	static const int MAX_ALGORITHM_NAME_LENGTH = 5;
-	bool success = false;
-	switch (strnlen(algorithm_name, MAX_ALGORITHM_NAME_LENGTH))
-	{	
-		case 1:
-			if (strncmp(algorithm_name, P, 1) == 0)
-			{
-				success = priority(schedule, result);
-			}
-        	break;
-		
-		case 2:
-			if (strncmp(algorithm_name, RR, 2) == 0)
-			{
-				if (quantum > 0) { success = round_robin(schedule, result, quantum); }
-			}
-        	break;
+	// Record every dispatch, preemption and completion if asked to (each run starts with a BEGIN event)
+	ScheduleTrace_t* trace = NULL;
+	if (trace_path != NULL)
+	{
+		trace = schedule_trace_open(trace_path, 0);
+		if (trace == NULL)
+		{
+			fprintf(stderr, "Could not create trace file %s\n", trace_path);
+			dyn_array_destroy(schedule);
+			return EXIT_FAILURE;
+		}
+	}
 
-		case 3:
-			if (strncmp(algorithm_name, SJF, 3) == 0)
-			{
-				success = shortest_job_first(schedule, result);
-			}
-			else if (strncmp(algorithm_name, SRT, 3) == 0)
-			{
-				success = shortest_remaining_time_first(schedule, result);
-			}
-			break;
+	// Markdown is the only format without the latency tails, so it can skip the second run
+	const bool collect_latency = format != FORMAT_MARKDOWN;
 
-		case 4:
-			if (strncmp(algorithm_name, FCFS, 4) == 0)
-			{
-				success = first_come_first_serve(schedule, result);
-			}
-			break;
+	// ALL runs every algorithm in README.md order (round robin only if there is a quantum)
+	AnalysisRun_t runs[ALL_ALGORITHM_COUNT];
+	size_t run_count = 0;
+	bool success = true;
+	if (strcmp(algorithm_name, ALL) == 0)
+	{
+		for (size_t i = 0; i < ALL_ALGORITHM_COUNT && success; i++)
+		{
+			if (strcmp(ALL_ALGORITHMS[i], RR) == 0 && quantum == 0) { continue; }
+			success = run_algorithm(ALL_ALGORITHMS[i], schedule, quantum, print_stats, trace, collect_latency, &runs[run_count++]);
+		}
+	}
+	else
+	{
+		success = run_algorithm(algorithm_name, schedule, quantum, print_stats, trace, collect_latency, &runs[run_count++]);
+	}
+	if (trace != NULL)
+	{
+		if (!schedule_trace_close(trace))
+		{
+			fprintf(stderr, "Could not write trace file %s\n", trace_path);
+			success = false;
+		}
 	}
 
 	// Display the scheduler algorithm's result statistics to the console
 	if (success)
 	{
-		printf("Average Waiting Time:\t %f\n", result->average_waiting_time);
-		printf("Average Turnaround Time: %f\n", result->average_turnaround_time);
-		printf("Total Run Time:\t\t %ld\n", result->total_run_time);
+		switch (format)
+		{
+			case FORMAT_TEXT: print_text(runs, run_count, pcb_count, load_seconds, print_stats); break;
+			case FORMAT_JSON: print_json(runs, run_count, filename, pcb_count, load_seconds, print_stats); break;
+			case FORMAT_CSV: print_csv(runs, run_count, pcb_count, load_seconds, print_stats); break;
+			case FORMAT_MARKDOWN: print_markdown(runs, run_count); break;
+		}
 	}
 
 	dyn_array_destroy(schedule);
-	free(result);
 
 	return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -1,4 +1,12 @@
+// mremap is a GNU extension
+#define _GNU_SOURCE
+
 #include "dyn_array.h"
+#include "thread_pool.h"
+
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 // Flag values
 // SHRUNK to indicate shrink_to_fit was called and size needs to be corrected
@@ -6,6 +14,13 @@
 // these are just ideas
 // typedef enum {NONE = 0x00, SHRUNK = 0x01, SORTED = 0x02, ALL = 0xFF} DYN_FLAGS;
 
+// Payload sharing between clones. Every array pointing at the same payload
+// points at the same dyn_share, whoever drops the count to 0 frees the payload
+typedef struct dyn_share 
+{
+	atomic_size_t owners;
+} dyn_share_t;
+
 struct dyn_array 
 {
 	// DYN_FLAGS flags;
@@ -14,6 +29,21 @@ struct dyn_array
 	const size_t data_size;
 	void *array;
 	void (*destructor)(void *);
+	// Tombstone mode, see the header. tombstones is NULL when the mode is off,
+	// otherwise one mark per slot of capacity
+	uint8_t *tombstones;
+	size_t dead_count;
+	size_t compact_percent;
+	// Large array mode, see the header. mapped_bytes is 0 when the storage came from malloc,
+	// otherwise it's the length of the anonymous mapping holding the array
+	size_t mapped_bytes;
+	bool hugepages;
+	// Copy on write, see dyn_array_clone. NULL when nobody else has seen the payload
+	dyn_share_t *share;
+	// How capacity grows, see the header
+	dyn_growth_policy_t growth;
+	// Memory traffic counters, NULL when counting is off
+	dyn_array_stats_t *stats;
 };
 
 // Supports 64bit+ size_t!
@@ -28,8 +58,27 @@ struct dyn_array
 	(((uint8_t *) (dyn_array_ptr)->array) + ((idx) * (dyn_array_ptr)->data_size))
 // Gets the size (in bytes) of n dyn_array elements
 #define DYN_SIZE_N_ELEMS(dyn_array_ptr, n) ((dyn_array_ptr)->data_size * (n))
+// Bumps a stats counter if the array is counting
+#define DYN_STAT(dyn_array_ptr, counter, amount)          \
+	do                                                    \
+	{                                                     \
+		if ((dyn_array_ptr)->stats)                       \
+		{                                                 \
+			(dyn_array_ptr)->stats->counter += (amount);  \
+		}                                                 \
+	} while (0)
+
+
+
+// Checks to see if the object can handle an increase in size (and optionally increases capacity)
+bool dyn_request_size_increase(dyn_array_t *const dyn_array, const size_t increment);
 
+// Picks the next capacity for the array's growth policy
+size_t dyn_growth_capacity(const dyn_array_t *const dyn_array, const size_t needed_size);
 
+// Moves the payload to storage for new_capacity objects, bigger or smaller (mapped arrays round up to the whole mapping)
+// The array must not be shared
+bool dyn_storage_resize(dyn_array_t *const dyn_array, const size_t new_capacity);
 
 // Modes of operation for dyn_shift
 typedef enum { MODE_INSERT = 0x01, MODE_EXTRACT = 0x02, MODE_ERASE = 0x06, TYPE_REMOVE = 0x02 } DYN_SHIFT_MODE;
@@ -43,6 +92,32 @@ bool dyn_shift_insert(dyn_array_t *const dyn_array, const size_t position, const
 bool dyn_shift_remove(dyn_array_t *const dyn_array, const size_t position, const size_t count,
 					  const DYN_SHIFT_MODE mode, void *const data_dst);
 
+// Tombstone helpers, marks a slot dead instead of shifting and squeezes dead slots out
+bool dyn_tombstone_remove(dyn_array_t *const dyn_array, const size_t position, const DYN_SHIFT_MODE mode,
+						  void *const data_dst);
+
+size_t dyn_tombstone_compact(dyn_array_t *const dyn_array, const size_t position);
+
+// Large array storage helpers. Sizes get rounded up to whole pages
+void *dyn_map_create(const size_t bytes, const bool hugepages, size_t *const mapped_bytes);
+
+void *dyn_map_resize(void *const array, const size_t old_bytes, const size_t bytes, const bool hugepages,
+					 size_t *const mapped_bytes);
+
+// Frees array storage from either malloc or dyn_map_create
+void dyn_storage_free(void *const array, const size_t mapped_bytes);
+
+// Gives the array its own copy of a shared payload. Anything that writes to the payload calls this first
+// Keep in mind tombstones are only ever marked on unshared arrays, so compacting never has to unshare
+bool dyn_cow_unshare(dyn_array_t *const dyn_array);
+
+// True if the payload can be written (it's ours, or we just made it ours)
+#define DYN_WRITABLE(dyn_array_ptr) (!(dyn_array_ptr)->share || dyn_cow_unshare(dyn_array_ptr))
+
+// Fills the hole with the last object instead of shifting
+bool dyn_swap_remove(dyn_array_t *const dyn_array, const size_t position, const DYN_SHIFT_MODE mode,
+					 void *const data_dst);
+
 
 
 
@@ -55,7 +130,7 @@ dyn_array_t *dyn_array_create(const size_t capacity, const size_t data_type_size
 		{
 			// would have inf loop if requested size was between DYN_MAX_CAPACITY
 			// and SIZE_MAX
-			size_t actual_capacity = 16;
+			size_t actual_capacity = DYN_DEFAULT_MIN_CAPACITY;
 			while (capacity > actual_capacity) 
 			{
 				actual_capacity <<= 1;
@@ -71,7 +146,8 @@ dyn_array_t *dyn_array_create(const size_t capacity, const size_t data_type_size
 			// I had an idea... and it compiles
 			// const members of a malloc'd struct are so annoying
 			memcpy(dyn_array, &((dyn_array_t){actual_capacity, 0, data_type_size,
-											  malloc(data_type_size * actual_capacity), destruct_func}),
+											  malloc(data_type_size * actual_capacity), destruct_func, NULL, 0, 0, 0, false, NULL,
+											  {DYN_DEFAULT_GROWTH_FACTOR, DYN_DEFAULT_MIN_CAPACITY, NULL, NULL}, NULL}),
 				   sizeof(dyn_array_t));
 
 			if (dyn_array->array) 
@@ -86,6 +162,31 @@ dyn_array_t *dyn_array_create(const size_t capacity, const size_t data_type_size
 	return NULL;
 }
 
+dyn_array_t *dyn_array_create_mapped(const size_t capacity, const size_t data_type_size,
+									 void (*destruct_func)(void *), const unsigned int map_flags) 
+{
+	dyn_array_t *dyn_array = dyn_array_create(0, data_type_size, destruct_func);
+	if (dyn_array) 
+	{
+		size_t mapped_bytes = 0;
+		const bool hugepages = map_flags & DYN_MAP_HUGEPAGES;
+		const size_t wanted = capacity > dyn_array->capacity ? capacity : dyn_array->capacity;
+		void *array = dyn_map_create(wanted * data_type_size, hugepages, &mapped_bytes);
+		if (array) 
+		{
+			// swap the little malloc'd array for the mapping, rounding capacity up to the whole mapping
+			free(dyn_array->array);
+			dyn_array->array		= array;
+			dyn_array->capacity		= mapped_bytes / data_type_size;
+			dyn_array->mapped_bytes = mapped_bytes;
+			dyn_array->hugepages	= hugepages;
+			return dyn_array;
+		}
+		dyn_array_destroy(dyn_array);
+	}
+	return NULL;
+}
+
 // Creates a dynamic array from a standard array
 dyn_array_t *dyn_array_import(const void *const data, const size_t count, const size_t data_type_size,
 							  void (*destruct_func)(void *)) 
@@ -119,8 +220,22 @@ const void *dyn_array_export(const dyn_array_t *const dyn_array)
 void dyn_array_destroy(dyn_array_t *dyn_array) 
 {
 	if (dyn_array) {
-		dyn_array_clear(dyn_array);
-		free(dyn_array->array);
+		if (dyn_array->share) 
+		{
+			// shared arrays never have destructors, so just let go of the payload
+			if (atomic_fetch_sub(&dyn_array->share->owners, 1) == 1) 
+			{
+				dyn_storage_free(dyn_array->array, dyn_array->mapped_bytes);
+				free(dyn_array->share);
+			}
+		} 
+		else 
+		{
+			dyn_array_clear(dyn_array);
+			dyn_storage_free(dyn_array->array, dyn_array->mapped_bytes);
+		}
+		free(dyn_array->tombstones);
+		free(dyn_array->stats);
 		free(dyn_array);
 	}
 }
@@ -128,6 +243,45 @@ void dyn_array_destroy(dyn_array_t *dyn_array)
 
 
 
+dyn_array_t *dyn_array_clone(dyn_array_t *const dyn_array) 
+{
+	// Shallow copies of objects that need destructing would get destructed twice
+	if (dyn_array && !dyn_array->destructor) 
+	{
+		// clones start without tombstones (and only unshared arrays have them, so this never copies)
+		dyn_array_compact(dyn_array);
+		if (!dyn_array->share) 
+		{
+			dyn_array->share = (dyn_share_t *) malloc(sizeof(dyn_share_t));
+			if (!dyn_array->share) 
+			{
+				return NULL;
+			}
+			atomic_init(&dyn_array->share->owners, 1);
+		}
+
+		dyn_array_t *clone = (dyn_array_t *) malloc(sizeof(dyn_array_t));
+		if (clone) 
+		{
+			memcpy(clone, &((dyn_array_t){dyn_array->capacity, dyn_array->size, dyn_array->data_size, dyn_array->array,
+										  NULL, NULL, 0, 0, dyn_array->mapped_bytes, dyn_array->hugepages,
+										  dyn_array->share, dyn_array->growth, NULL}),
+				   sizeof(dyn_array_t));
+			atomic_fetch_add(&dyn_array->share->owners, 1);
+		}
+		return clone;
+	}
+	return NULL;
+}
+
+bool dyn_array_detach(dyn_array_t *const dyn_array) 
+{
+	return dyn_array && DYN_WRITABLE(dyn_array);
+}
+
+
+
+
 void *dyn_array_front(const dyn_array_t *const dyn_array) 
 {
 	if (dyn_array && dyn_array->size) 
@@ -135,6 +289,16 @@ void *dyn_array_front(const dyn_array_t *const dyn_array)
 		// If array is null, well, this is ok, because it's null
 		// but if array is broken, well, we can't help that
 		// nor can we detect that, so I guess it's not an error
+		if (dyn_array->dead_count) 
+		{
+			// the last slot is always alive, so this stops
+			size_t idx = 0;
+			while (dyn_array->tombstones[idx]) 
+			{
+				++idx;
+			}
+			return DYN_ARRAY_POSITION(dyn_array, idx);
+		}
 		return dyn_array->array;
 	}
 	return NULL;
@@ -189,6 +353,10 @@ void *dyn_array_at(const dyn_array_t *const dyn_array, const size_t index)
 {
 	if (dyn_array && index < dyn_array->size) 
 	{
+		if (dyn_array->dead_count && dyn_array->tombstones[index]) 
+		{
+			return NULL;
+		}
 		return DYN_ARRAY_POSITION(dyn_array, index);
 	}
 	return NULL;
@@ -203,20 +371,77 @@ bool dyn_array_insert(dyn_array_t *const dyn_array, const size_t index, const vo
 
 bool dyn_array_erase(dyn_array_t *const dyn_array, const size_t index) 
 {
+	if (dyn_array && dyn_array->tombstones) 
+	{
+		return dyn_tombstone_remove(dyn_array, index, MODE_ERASE, NULL);
+	}
 	return dyn_shift_remove(dyn_array, index, 1, MODE_ERASE, NULL);
 }
 
 bool dyn_array_extract(dyn_array_t *const dyn_array, const size_t index, void *const object) 
 {
+	if (dyn_array && object && dyn_array->tombstones) 
+	{
+		return dyn_tombstone_remove(dyn_array, index, MODE_EXTRACT, object);
+	}
 	return dyn_array && object && dyn_array->size > index
 		   && dyn_shift_remove(dyn_array, index, 1, MODE_EXTRACT, object);
 }
 
+bool dyn_array_erase_swap(dyn_array_t *const dyn_array, const size_t index) 
+{
+	return dyn_swap_remove(dyn_array, index, MODE_ERASE, NULL);
+}
+
+bool dyn_array_extract_swap(dyn_array_t *const dyn_array, const size_t index, void *const object) 
+{
+	return object && dyn_swap_remove(dyn_array, index, MODE_EXTRACT, object);
+}
+
+bool dyn_array_enable_tombstones(dyn_array_t *const dyn_array, const size_t compact_percent) 
+{
+	if (dyn_array && compact_percent && compact_percent <= 100) 
+	{
+		if (!dyn_array->tombstones) 
+		{
+			dyn_array->tombstones = (uint8_t *) calloc(dyn_array->capacity, sizeof(uint8_t));
+			if (!dyn_array->tombstones) 
+			{
+				return false;
+			}
+		}
+		dyn_array->compact_percent = compact_percent;
+		return true;
+	}
+	return false;
+}
+
+void dyn_array_disable_tombstones(dyn_array_t *const dyn_array) 
+{
+	if (dyn_array && dyn_array->tombstones) 
+	{
+		dyn_tombstone_compact(dyn_array, 0);
+		free(dyn_array->tombstones);
+		dyn_array->tombstones	   = NULL;
+		dyn_array->compact_percent = 0;
+	}
+}
+
+void dyn_array_compact(dyn_array_t *const dyn_array) 
+{
+	if (dyn_array && dyn_array->dead_count) 
+	{
+		dyn_tombstone_compact(dyn_array, 0);
+	}
+}
+
 
 void dyn_array_clear(dyn_array_t *const dyn_array) 
 {
 	if (dyn_array && dyn_array->size) 
 	{
+		// compact first so the count below only covers live objects
+		dyn_array_compact(dyn_array);
 		dyn_shift_remove(dyn_array, 0, dyn_array->size, MODE_ERASE, NULL);
 	}
 }
@@ -253,14 +478,93 @@ size_t dyn_array_data_size(const dyn_array_t *const dyn_array)
 	return 0;  // hmmmmm...
 }
 
+bool dyn_array_set_growth_policy(dyn_array_t *const dyn_array, const dyn_growth_policy_t *const policy) 
+{
+	if (dyn_array) 
+	{
+		if (!policy) 
+		{
+			dyn_array->growth = (dyn_growth_policy_t){DYN_DEFAULT_GROWTH_FACTOR, DYN_DEFAULT_MIN_CAPACITY, NULL, NULL};
+			return true;
+		}
+		// a NaN factor fails this check too
+		if (policy->grow || policy->growth_factor > 1.0) 
+		{
+			dyn_array->growth = *policy;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool dyn_array_reserve(dyn_array_t *const dyn_array, const size_t capacity) 
+{
+	if (dyn_array && capacity <= DYN_MAX_CAPACITY) 
+	{
+		return capacity <= dyn_array->capacity || (DYN_WRITABLE(dyn_array) && dyn_storage_resize(dyn_array, capacity));
+	}
+	return false;
+}
+
+// No reallocation if it already fits. It either goes or it doesn't
+bool dyn_array_shrink_to_fit(dyn_array_t *const dyn_array) 
+{
+	if (dyn_array && DYN_WRITABLE(dyn_array)) 
+	{
+		dyn_array_compact(dyn_array);
+		// always keep room for one, a 0 byte allocation isn't guaranteed to be anything
+		const size_t wanted = dyn_array->size ? dyn_array->size : 1;
+		return wanted >= dyn_array->capacity || dyn_storage_resize(dyn_array, wanted);
+	}
+	return false;
+}
+
+bool dyn_array_enable_stats(dyn_array_t *const dyn_array) 
+{
+	if (dyn_array) 
+	{
+		if (!dyn_array->stats) 
+		{
+			dyn_array->stats = (dyn_array_stats_t *) malloc(sizeof(dyn_array_stats_t));
+			if (!dyn_array->stats) 
+			{
+				return false;
+			}
+		}
+		*dyn_array->stats = (dyn_array_stats_t){0, 0, 0, dyn_array->capacity};
+		return true;
+	}
+	return false;
+}
+
+void dyn_array_disable_stats(dyn_array_t *const dyn_array) 
+{
+	if (dyn_array) 
+	{
+		free(dyn_array->stats);
+		dyn_array->stats = NULL;
+	}
+}
+
+bool dyn_array_get_stats(const dyn_array_t *const dyn_array, dyn_array_stats_t *const stats) 
+{
+	if (dyn_array && dyn_array->stats && stats) 
+	{
+		*stats = *dyn_array->stats;
+		return true;
+	}
+	return false;
+}
+
 
 
 bool dyn_array_sort(dyn_array_t *const dyn_array, int (*const compare)(const void *, const void *)) 
 {
 	// hah, turns out there's a quicksort in cstdlib.
 	// and it works exactly like we want it to
-	if (dyn_array && dyn_array->size && compare) 
+	if (dyn_array && dyn_array->size && compare && DYN_WRITABLE(dyn_array)) 
 	{
+		dyn_array_compact(dyn_array);
 		qsort(dyn_array->array, dyn_array->size, dyn_array->data_size, compare);
 		return true;
 	}
@@ -273,6 +577,7 @@ bool dyn_array_insert_sorted(dyn_array_t *const dyn_array, const void *const obj
 {
 	if (dyn_array && compare && object) 
 	{
+		dyn_array_compact(dyn_array);
 		size_t ordered_position = 0;
 		if (dyn_array->size) 
 		{
@@ -290,7 +595,7 @@ bool dyn_array_insert_sorted(dyn_array_t *const dyn_array, const void *const obj
 
 bool dyn_array_for_each(dyn_array_t *const dyn_array, void (*const func)(void *const, void *), void *arg) 
 {
-	if (dyn_array && dyn_array->array && func) 
+	if (dyn_array && dyn_array->array && func && DYN_WRITABLE(dyn_array)) 
 	{
 		// So I just noticed we never check the data array ever
 		// Which is both unsafe and potentially undefined behavior
@@ -303,6 +608,10 @@ bool dyn_array_for_each(dyn_array_t *const dyn_array, void (*const func)(void *c
 		uint8_t *data_walker = (uint8_t *) dyn_array->array;
 		for (size_t idx = 0; idx < dyn_array->size; ++idx, data_walker += dyn_array->data_size) 
 		{
+			if (dyn_array->dead_count && dyn_array->tombstones[idx]) 
+			{
+				continue;
+			}
 			func((void *const) data_walker, arg);
 		}
 		return true;
@@ -311,18 +620,505 @@ bool dyn_array_for_each(dyn_array_t *const dyn_array, void (*const func)(void *c
 }
 
 
-/*
-	// No return value. It either goes or it doesn't. shrink_to_fit is more of a request
-	void dyn_array_shrink_to_fit(dyn_array_t *const dyn_array) {
-	if (dyn_array) {
-		void *new_address = realloc(dyn_array->data, DYN_ARRAY_SIZE_N_ELEMS(dyn_array, dyn_array->size));
-		if (new_address) {
-			dyn_array->data = new_address;
-			SET_FLAG(dyn_array,SHRUNK);
+// Objects per parallel chunk. Fixed so chunk boundaries (and so reduction order)
+// never depend on the thread count
+#ifndef DYN_PARALLEL_CHUNK
+#define DYN_PARALLEL_CHUNK ((size_t) 4096)
+#endif
+
+// Below this many objects a parallel sort isn't worth the threads, just qsort
+#ifndef DYN_PARALLEL_SORT_MIN
+#define DYN_PARALLEL_SORT_MIN ((size_t) 1 << 14)
+#endif
+
+typedef struct 
+{
+	dyn_array_t *dyn_array;
+	void (*func)(void *const, void *);
+	void *arg;
+	void (*reduce)(void *, const void *);
+} dyn_parallel_each_t;
+
+// Applies the function to the live objects in [begin, end), passing chunk_arg along
+static void dyn_parallel_each_range(const dyn_parallel_each_t *const job, size_t idx, const size_t end, void *const chunk_arg) 
+{
+	dyn_array_t *const dyn_array = job->dyn_array;
+	uint8_t *data_walker = DYN_ARRAY_POSITION(dyn_array, idx);
+	for (; idx < end; ++idx, data_walker += dyn_array->data_size) 
+	{
+		if (dyn_array->dead_count && dyn_array->tombstones[idx]) 
+		{
+			continue;
+		}
+		job->func((void *const) data_walker, chunk_arg);
+	}
+}
+
+static void dyn_parallel_each_chunk(void *job_ptr, size_t begin, size_t end) 
+{
+	const dyn_parallel_each_t *const job = (const dyn_parallel_each_t *) job_ptr;
+	dyn_parallel_each_range(job, begin, end, job->arg);
+}
+
+static void dyn_parallel_each_map(void *job_ptr, size_t begin, size_t end, void *state) 
+{
+	dyn_parallel_each_range((const dyn_parallel_each_t *) job_ptr, begin, end, state);
+}
+
+static void dyn_parallel_each_reduce(void *job_ptr, const void *state) 
+{
+	const dyn_parallel_each_t *const job = (const dyn_parallel_each_t *) job_ptr;
+	job->reduce(job->arg, state);
+}
+
+bool dyn_array_parallel_for_each(dyn_array_t *const dyn_array, void (*const func)(void *const, void *), void *arg,
+								 const size_t state_size, void (*const reduce)(void *, const void *)) 
+{
+	if (dyn_array && dyn_array->array && func && (!state_size || reduce) && DYN_WRITABLE(dyn_array)) 
+	{
+		dyn_parallel_each_t job = {dyn_array, func, arg, reduce};
+		if (!state_size) 
+		{
+			return thread_pool_parallel_for_chunked(dyn_array->size, DYN_PARALLEL_CHUNK, dyn_parallel_each_chunk, &job);
+		}
+		// fixed chunks reduced in array order, so it comes out the same every time
+		return thread_pool_parallel_reduce(dyn_array->size, DYN_PARALLEL_CHUNK, state_size, dyn_parallel_each_map,
+										   dyn_parallel_each_reduce, &job);
+	}
+	return false;
+}
+
+typedef struct 
+{
+	size_t data_size;
+	int (*compare)(const void *, const void *);
+	uint8_t *src;
+	uint8_t *dst;
+	// run r covers [bounds[r], bounds[r + 1])
+	size_t *bounds;
+	size_t run_count;
+} dyn_parallel_sort_t;
+
+static void dyn_parallel_sort_run(void *job_ptr, size_t run) 
+{
+	dyn_parallel_sort_t *const job = (dyn_parallel_sort_t *) job_ptr;
+	qsort(job->src + job->bounds[run] * job->data_size, job->bounds[run + 1] - job->bounds[run], job->data_size,
+		  job->compare);
+}
+
+// Merges runs 2 * pair and 2 * pair + 1 from src into dst (a lone last run just gets copied)
+// Ties take from the left run
+static void dyn_parallel_sort_merge(void *job_ptr, size_t pair) 
+{
+	dyn_parallel_sort_t *const job = (dyn_parallel_sort_t *) job_ptr;
+	const size_t data_size = job->data_size;
+	const size_t begin	 = job->bounds[2 * pair];
+	const size_t middle	= 2 * pair + 1 < job->run_count ? job->bounds[2 * pair + 1] : job->bounds[job->run_count];
+	const size_t end	   = 2 * pair + 1 < job->run_count ? job->bounds[2 * pair + 2] : middle;
+
+	const uint8_t *left		   = job->src + begin * data_size;
+	const uint8_t *right	   = job->src + middle * data_size;
+	const uint8_t *const l_end = right;
+	const uint8_t *const r_end = job->src + end * data_size;
+	uint8_t *out			   = job->dst + begin * data_size;
+	while (left < l_end && right < r_end) 
+	{
+		if (job->compare(right, left) < 0) 
+		{
+			memcpy(out, right, data_size);
+			right += data_size;
+		} 
+		else 
+		{
+			memcpy(out, left, data_size);
+			left += data_size;
+		}
+		out += data_size;
+	}
+	memcpy(out, left, l_end - left);
+	out += l_end - left;
+	memcpy(out, right, r_end - right);
+}
+
+bool dyn_array_parallel_sort(dyn_array_t *const dyn_array, int (*const compare)(const void *, const void *)) 
+{
+	if (dyn_array && dyn_array->size && compare && DYN_WRITABLE(dyn_array)) 
+	{
+		dyn_array_compact(dyn_array);
+		size_t run_count = thread_pool_thread_count();
+		uint8_t *const scratch = dyn_array->size >= DYN_PARALLEL_SORT_MIN && run_count > 1
+									 ? (uint8_t *) malloc(DYN_SIZE_N_ELEMS(dyn_array, dyn_array->size))
+									 : NULL;
+		size_t *const bounds = scratch ? (size_t *) malloc(sizeof(size_t) * (run_count + 1)) : NULL;
+		if (!bounds) 
+		{
+			// small, single threaded, or out of memory. The plain sort it is
+			free(scratch);
+			return dyn_array_sort(dyn_array, compare);
+		}
+
+		// sort one run per thread
+		for (size_t run = 0; run <= run_count; ++run) 
+		{
+			bounds[run] = dyn_array->size / run_count * run + (run * (dyn_array->size % run_count)) / run_count;
+		}
+		dyn_parallel_sort_t job = {dyn_array->data_size, compare, (uint8_t *) dyn_array->array, scratch, bounds,
+								   run_count};
+		thread_pool_parallel_for(run_count, dyn_parallel_sort_run, &job);
+
+		// then merge neighbouring runs until only one is left, bouncing between the array and scratch
+		while (job.run_count > 1) 
+		{
+			const size_t pairs = (job.run_count + 1) / 2;
+			thread_pool_parallel_for(pairs, dyn_parallel_sort_merge, &job);
+			for (size_t pair = 1; pair <= pairs; ++pair) 
+			{
+				bounds[pair] = 2 * pair < job.run_count ? bounds[2 * pair] : bounds[job.run_count];
+			}
+			job.run_count = pairs;
+			uint8_t *const swap = job.src;
+			job.src				= job.dst;
+			job.dst				= swap;
+		}
+		if (job.src != dyn_array->array) 
+		{
+			memcpy(dyn_array->array, job.src, DYN_SIZE_N_ELEMS(dyn_array, dyn_array->size));
+		}
+
+		free(bounds);
+		free(scratch);
+		return true;
+	}
+	return false;
+}
+
+
+// Heap helpers. Both work on a "hole": item gets written once, at the end, and everything it
+// passes gets moved one level instead of swapped. item must not live in [0, size) of the heap
+// (except for sift down starting at its own position, which is fine since that slot is the hole)
+static void dyn_heap_sift_up(dyn_array_t *const dyn_array, size_t position, const void *const item,
+							 int (*const compare)(const void *, const void *)) 
+{
+	while (position) 
+	{
+		const size_t parent = (position - 1) / 2;
+		if (compare(item, DYN_ARRAY_POSITION(dyn_array, parent)) >= 0) 
+		{
+			break;
+		}
+		memcpy(DYN_ARRAY_POSITION(dyn_array, position), DYN_ARRAY_POSITION(dyn_array, parent), dyn_array->data_size);
+		DYN_STAT(dyn_array, bytes_moved, dyn_array->data_size);
+		position = parent;
+	}
+	memcpy(DYN_ARRAY_POSITION(dyn_array, position), item, dyn_array->data_size);
+}
+
+static void dyn_heap_sift_down(dyn_array_t *const dyn_array, size_t position, const void *const item,
+							   int (*const compare)(const void *, const void *)) 
+{
+	const size_t size = dyn_array->size;
+	for (;;) 
+	{
+		size_t child = 2 * position + 1;
+		if (child >= size) 
+		{
+			break;
+		}
+		if (child + 1 < size
+			&& compare(DYN_ARRAY_POSITION(dyn_array, child + 1), DYN_ARRAY_POSITION(dyn_array, child)) < 0) 
+		{
+			++child;
+		}
+		if (compare(DYN_ARRAY_POSITION(dyn_array, child), item) >= 0) 
+		{
+			break;
+		}
+		memcpy(DYN_ARRAY_POSITION(dyn_array, position), DYN_ARRAY_POSITION(dyn_array, child), dyn_array->data_size);
+		DYN_STAT(dyn_array, bytes_moved, dyn_array->data_size);
+		position = child;
+	}
+	memcpy(DYN_ARRAY_POSITION(dyn_array, position), item, dyn_array->data_size);
+}
+
+bool dyn_array_make_heap(dyn_array_t *const dyn_array, int (*const compare)(const void *, const void *)) 
+{
+	if (dyn_array && compare && !dyn_array->tombstones && DYN_WRITABLE(dyn_array)) 
+	{
+		if (dyn_array->size > 1) 
+		{
+			// the hole would overwrite the object being sifted, so it needs to sit somewhere else
+			void *const item = malloc(dyn_array->data_size);
+			if (!item) 
+			{
+				return false;
+			}
+			for (size_t position = dyn_array->size / 2; position--;) 
+			{
+				memcpy(item, DYN_ARRAY_POSITION(dyn_array, position), dyn_array->data_size);
+				dyn_heap_sift_down(dyn_array, position, item, compare);
+			}
+			free(item);
+		}
+		return true;
+	}
+	return false;
+}
+
+bool dyn_array_heap_push(dyn_array_t *const dyn_array, const void *const object,
+						 int (*const compare)(const void *, const void *)) 
+{
+	if (dyn_array && object && compare && !dyn_array->tombstones && DYN_WRITABLE(dyn_array)
+		&& dyn_request_size_increase(dyn_array, 1)) 
+	{
+		dyn_heap_sift_up(dyn_array, dyn_array->size, object, compare);
+		++dyn_array->size;
+		DYN_STAT(dyn_array, bytes_copied, dyn_array->data_size);
+		return true;
+	}
+	return false;
+}
+
+bool dyn_array_heap_pop(dyn_array_t *const dyn_array, void *const object,
+						int (*const compare)(const void *, const void *)) 
+{
+	if (dyn_array && dyn_array->size && object && compare && !dyn_array->tombstones && DYN_WRITABLE(dyn_array)) 
+	{
+		memcpy(object, dyn_array->array, dyn_array->data_size);
+		DYN_STAT(dyn_array, bytes_copied, dyn_array->data_size);
+		// the old last object is outside the heap once size drops, so it can be sifted from where it is
+		--dyn_array->size;
+		if (dyn_array->size) 
+		{
+			dyn_heap_sift_down(dyn_array, 0, DYN_ARRAY_POSITION(dyn_array, dyn_array->size), compare);
 		}
+		return true;
 	}
+	return false;
+}
+
+void *dyn_array_heap_top(const dyn_array_t *const dyn_array) 
+{
+	return dyn_array_front(dyn_array);
+}
+
+
+// objects[handle] is where the object lives, heap holds handles in heap order
+// and positions[handle] is where that handle sits in heap (DYN_HEAP_RELEASED if it's free)
+struct dyn_indexed_heap 
+{
+	dyn_array_t *objects;
+	dyn_array_t *heap;
+	dyn_array_t *positions;
+	dyn_array_t *free_handles;
+	int (*compare)(const void *, const void *);
+};
+
+#define DYN_HEAP_RELEASED SIZE_MAX
+
+// Shortcuts into the indexed heap's arrays
+#define DYN_HEAP_HANDLE(heap_ptr, position) (((size_t *) (heap_ptr)->heap->array)[position])
+#define DYN_HEAP_POSITION(heap_ptr, handle) (((size_t *) (heap_ptr)->positions->array)[handle])
+#define DYN_HEAP_OBJECT(heap_ptr, handle) DYN_ARRAY_POSITION((heap_ptr)->objects, handle)
+
+static int dyn_indexed_heap_compare(const dyn_indexed_heap_t *const heap, const size_t a, const size_t b) 
+{
+	return heap->compare(DYN_HEAP_OBJECT(heap, a), DYN_HEAP_OBJECT(heap, b));
+}
+
+// Same hole trick as the plain heap, but moving handles and keeping positions up to date
+static void dyn_indexed_heap_place(dyn_indexed_heap_t *const heap, size_t position, const size_t handle) 
+{
+	const size_t size = heap->heap->size;
+	while (position) 
+	{
+		const size_t parent = (position - 1) / 2;
+		if (dyn_indexed_heap_compare(heap, handle, DYN_HEAP_HANDLE(heap, parent)) >= 0) 
+		{
+			break;
+		}
+		DYN_HEAP_HANDLE(heap, position)						   = DYN_HEAP_HANDLE(heap, parent);
+		DYN_HEAP_POSITION(heap, DYN_HEAP_HANDLE(heap, position)) = position;
+		position												   = parent;
 	}
-*/
+	for (;;) 
+	{
+		size_t child = 2 * position + 1;
+		if (child >= size) 
+		{
+			break;
+		}
+		if (child + 1 < size
+			&& dyn_indexed_heap_compare(heap, DYN_HEAP_HANDLE(heap, child + 1), DYN_HEAP_HANDLE(heap, child)) < 0) 
+		{
+			++child;
+		}
+		if (dyn_indexed_heap_compare(heap, DYN_HEAP_HANDLE(heap, child), handle) >= 0) 
+		{
+			break;
+		}
+		DYN_HEAP_HANDLE(heap, position)						   = DYN_HEAP_HANDLE(heap, child);
+		DYN_HEAP_POSITION(heap, DYN_HEAP_HANDLE(heap, position)) = position;
+		position												   = child;
+	}
+	DYN_HEAP_HANDLE(heap, position) = handle;
+	DYN_HEAP_POSITION(heap, handle) = position;
+}
+
+dyn_indexed_heap_t *dyn_indexed_heap_create(const size_t capacity, const size_t data_type_size,
+											int (*const compare)(const void *, const void *)) 
+{
+	if (compare) 
+	{
+		dyn_indexed_heap_t *heap = (dyn_indexed_heap_t *) malloc(sizeof(dyn_indexed_heap_t));
+		if (heap) 
+		{
+			heap->objects	   = dyn_array_create(capacity, data_type_size, NULL);
+			heap->heap		   = dyn_array_create(capacity, sizeof(size_t), NULL);
+			heap->positions	= dyn_array_create(capacity, sizeof(size_t), NULL);
+			heap->free_handles = dyn_array_create(0, sizeof(size_t), NULL);
+			heap->compare	  = compare;
+			if (heap->objects && heap->heap && heap->positions && heap->free_handles) 
+			{
+				return heap;
+			}
+			dyn_indexed_heap_destroy(heap);
+		}
+	}
+	return NULL;
+}
+
+void dyn_indexed_heap_destroy(dyn_indexed_heap_t *const heap) 
+{
+	if (heap) 
+	{
+		dyn_array_destroy(heap->objects);
+		dyn_array_destroy(heap->heap);
+		dyn_array_destroy(heap->positions);
+		dyn_array_destroy(heap->free_handles);
+		free(heap);
+	}
+}
+
+bool dyn_indexed_heap_push(dyn_indexed_heap_t *const heap, const void *const object, size_t *const handle) 
+{
+	// heap only ever grows by one slot, make sure it can before touching anything else
+	if (heap && object && dyn_request_size_increase(heap->heap, 1)) 
+	{
+		size_t new_handle;
+		// reuse a released handle if there is one, otherwise hand out a new one
+		if (heap->free_handles->size) 
+		{
+			new_handle = ((size_t *) heap->free_handles->array)[--heap->free_handles->size];
+			memcpy(DYN_HEAP_OBJECT(heap, new_handle), object, heap->objects->data_size);
+		} 
+		else 
+		{
+			const size_t released = DYN_HEAP_RELEASED;
+			new_handle			  = heap->objects->size;
+			if (!dyn_array_push_back(heap->positions, &released)) 
+			{
+				return false;
+			}
+			if (!dyn_array_push_back(heap->objects, object)) 
+			{
+				--heap->positions->size;
+				return false;
+			}
+		}
+		++heap->heap->size;
+		dyn_indexed_heap_place(heap, heap->heap->size - 1, new_handle);
+		if (handle) 
+		{
+			*handle = new_handle;
+		}
+		return true;
+	}
+	return false;
+}
+
+const void *dyn_indexed_heap_top(const dyn_indexed_heap_t *const heap, size_t *const handle) 
+{
+	if (heap && heap->heap->size) 
+	{
+		if (handle) 
+		{
+			*handle = DYN_HEAP_HANDLE(heap, 0);
+		}
+		return DYN_HEAP_OBJECT(heap, DYN_HEAP_HANDLE(heap, 0));
+	}
+	return NULL;
+}
+
+const void *dyn_indexed_heap_get(const dyn_indexed_heap_t *const heap, const size_t handle) 
+{
+	if (heap && handle < heap->positions->size && DYN_HEAP_POSITION(heap, handle) != DYN_HEAP_RELEASED) 
+	{
+		return DYN_HEAP_OBJECT(heap, handle);
+	}
+	return NULL;
+}
+
+bool dyn_indexed_heap_update(dyn_indexed_heap_t *const heap, const size_t handle, const void *const object) 
+{
+	if (object && dyn_indexed_heap_get(heap, handle)) 
+	{
+		memcpy(DYN_HEAP_OBJECT(heap, handle), object, heap->objects->data_size);
+		dyn_indexed_heap_place(heap, DYN_HEAP_POSITION(heap, handle), handle);
+		return true;
+	}
+	return false;
+}
+
+bool dyn_indexed_heap_remove(dyn_indexed_heap_t *const heap, const size_t handle, void *const object) 
+{
+	// the free list has to take the handle back, so make room first and nothing can fail after
+	if (dyn_indexed_heap_get(heap, handle) && dyn_request_size_increase(heap->free_handles, 1)) 
+	{
+		const size_t position = DYN_HEAP_POSITION(heap, handle);
+		if (object) 
+		{
+			memcpy(object, DYN_HEAP_OBJECT(heap, handle), heap->objects->data_size);
+		}
+		DYN_HEAP_POSITION(heap, handle)											= DYN_HEAP_RELEASED;
+		((size_t *) heap->free_handles->array)[heap->free_handles->size++] = handle;
+
+		// fill the hole with the last handle and let it find its place (it can go either way)
+		const size_t last = DYN_HEAP_HANDLE(heap, --heap->heap->size);
+		if (position != heap->heap->size) 
+		{
+			dyn_indexed_heap_place(heap, position, last);
+		}
+		return true;
+	}
+	return false;
+}
+
+bool dyn_indexed_heap_pop(dyn_indexed_heap_t *const heap, void *const object, size_t *const handle) 
+{
+	if (heap && heap->heap->size && object) 
+	{
+		const size_t top = DYN_HEAP_HANDLE(heap, 0);
+		if (dyn_indexed_heap_remove(heap, top, object)) 
+		{
+			if (handle) 
+			{
+				*handle = top;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t dyn_indexed_heap_size(const dyn_indexed_heap_t *const heap) 
+{
+	if (heap) 
+	{
+		return heap->heap->size;
+	}
+	return 0;
+}
+
 
 
 
@@ -334,9 +1130,6 @@ bool dyn_array_for_each(dyn_array_t *const dyn_array, void (*const func)(void *c
 //
 
 
-// Checks to see if the object can handle an increase in size (and optionally increases capacity)
-bool dyn_request_size_increase(dyn_array_t *const dyn_array, const size_t increment);
-
 #define MODE_IS_TYPE(mode, type) ((mode) & (type))
 
 // inserting between idx 1 and 2 (between B and C) means you're moving everything from 2 down to make room
@@ -355,14 +1148,21 @@ bool dyn_shift_insert(dyn_array_t *const dyn_array, const size_t position, const
 		// may or may not need to increase capacity.
 		// We'll ask the capacity function if we can do it.
 		// If we can, do it. If not... Too bad for the user.
-		if (position <= dyn_array->size && dyn_request_size_increase(dyn_array, count)) 
+		if (position <= dyn_array->size && DYN_WRITABLE(dyn_array) && dyn_request_size_increase(dyn_array, count)) 
 		{
+			// appending never disturbs a dead slot, anything else needs real indices
+			if (dyn_array->dead_count && position != dyn_array->size) 
+			{
+				return dyn_shift_insert(dyn_array, dyn_tombstone_compact(dyn_array, position), count, mode, data_src);
+			}
 			if (position != dyn_array->size) 
 			{  // wasn't a gap at the end, we need to move data
 				memmove(DYN_ARRAY_POSITION(dyn_array, position + count), DYN_ARRAY_POSITION(dyn_array, position),
 						DYN_SIZE_N_ELEMS(dyn_array, dyn_array->size - position));
+				DYN_STAT(dyn_array, bytes_moved, DYN_SIZE_N_ELEMS(dyn_array, dyn_array->size - position));
 			}
 			memcpy(DYN_ARRAY_POSITION(dyn_array, position), data_src, dyn_array->data_size * count);
+			DYN_STAT(dyn_array, bytes_copied, dyn_array->data_size * count);
 			dyn_array->size += count;
 			return true;
 		}
@@ -379,8 +1179,14 @@ bool dyn_shift_remove(dyn_array_t *const dyn_array, const size_t position, const
 					  const DYN_SHIFT_MODE mode, void *const data_dst) 
 {
 	if (dyn_array && count && dyn_array->size && MODE_IS_TYPE(mode, TYPE_REMOVE)  // mode = MODE_EXTRACT || MODE_ERASE
-		&& (position + count) <= dyn_array->size)   // verify size and range
+		&& (position + count) <= dyn_array->size   // verify size and range
+		&& DYN_WRITABLE(dyn_array))
 { 
+		// the last slot is always alive, so only popping it alone can skip getting real indices
+		if (dyn_array->dead_count && (count > 1 || position + count != dyn_array->size)) 
+		{
+			return dyn_shift_remove(dyn_array, dyn_tombstone_compact(dyn_array, position), count, mode, data_dst);
+		}
 
 		// shrinking in size
 		// nice and simple (?)
@@ -400,6 +1206,7 @@ bool dyn_shift_remove(dyn_array_t *const dyn_array, const size_t position, const
 			if (data_dst) 
 			{
 				memcpy(data_dst, DYN_ARRAY_POSITION(dyn_array, position), dyn_array->data_size * count);
+				DYN_STAT(dyn_array, bytes_copied, dyn_array->data_size * count);
 			} 
 			else 
 			{
@@ -414,9 +1221,15 @@ bool dyn_shift_remove(dyn_array_t *const dyn_array, const size_t position, const
 			// there's a actual gap, not just a hole to make at the end
 			memmove(DYN_ARRAY_POSITION(dyn_array, position), DYN_ARRAY_POSITION(dyn_array, position + count),
 					DYN_SIZE_N_ELEMS(dyn_array, dyn_array->size - (position + count)));
+			DYN_STAT(dyn_array, bytes_moved, DYN_SIZE_N_ELEMS(dyn_array, dyn_array->size - (position + count)));
 		}
-		// decrease the size and return
+		// decrease the size, along with any dead slots the popped one was hiding, and return
 		dyn_array->size -= count;
+		while (dyn_array->dead_count && dyn_array->tombstones[dyn_array->size - 1]) 
+		{
+			dyn_array->tombstones[--dyn_array->size] = 0;
+			--dyn_array->dead_count;
+		}
 		return true;
 	}
 	return false;
@@ -438,29 +1251,309 @@ bool dyn_request_size_increase(dyn_array_t *const dyn_array, const size_t increm
 		}
 		// have to reallocate, is that even possible?
 		size_t needed_size = dyn_array->size + increment;
+		if (needed_size <= DYN_MAX_CAPACITY) 
+		{
+			const size_t new_capacity = dyn_growth_capacity(dyn_array, needed_size);
+			// success! Wasn't that easy?
+			return new_capacity && dyn_storage_resize(dyn_array, new_capacity);
+		}
+	}
+	return false;
+}
 
-		// INSERT SHRINK_TO_FIT CORRECTION HERE
+// Works out the capacity to grow to from the array's growth policy, 0 if the policy came up short
+size_t dyn_growth_capacity(const dyn_array_t *const dyn_array, const size_t needed_size) 
+{
+	const dyn_growth_policy_t *const policy = &dyn_array->growth;
+	if (policy->grow) 
+	{
+		const size_t new_capacity = policy->grow(dyn_array->capacity, needed_size, policy->grow_arg);
+		return new_capacity >= needed_size && new_capacity <= DYN_MAX_CAPACITY ? new_capacity : 0;
+	}
+	size_t new_capacity = dyn_array->capacity > policy->min_capacity ? dyn_array->capacity : policy->min_capacity;
+	while (new_capacity < needed_size) 
+	{
+		const double next = (double) new_capacity * policy->growth_factor;
+		if (next >= (double) DYN_MAX_CAPACITY) 
+		{
+			return DYN_MAX_CAPACITY;
+		}
+		// small capacities with a small factor may not budge otherwise
+		new_capacity = (size_t) next > new_capacity ? (size_t) next : new_capacity + 1;
+	}
+	return new_capacity;
+}
 
-		if (needed_size <= DYN_MAX_CAPACITY) 
+bool dyn_storage_resize(dyn_array_t *const dyn_array, const size_t new_capacity) 
+{
+	// we can theoretically hold this, check if we can allocate that
+	size_t actual_capacity = new_capacity;
+	void *new_array		   = NULL;
+	if (dyn_array->mapped_bytes) 
+	{
+		// large arrays move their pages instead of copying, and the mapping may be
+		// bigger than asked for, so use all of it
+		size_t mapped_bytes = 0;
+		new_array = dyn_map_resize(dyn_array->array, dyn_array->mapped_bytes, DYN_SIZE_N_ELEMS(dyn_array, new_capacity),
+								   dyn_array->hugepages, &mapped_bytes);
+		if (new_array) 
 		{
-			size_t new_capacity = dyn_array->capacity << 1;
-			while (new_capacity < needed_size) 
+			dyn_array->mapped_bytes = mapped_bytes;
+			actual_capacity			= mapped_bytes / dyn_array->data_size;
+		}
+	} 
+	else 
+	{
+		new_array = realloc(dyn_array->array, DYN_SIZE_N_ELEMS(dyn_array, new_capacity));
+	}
+	if (!new_array) 
+	{
+		return false;
+	}
+	dyn_array->array = new_array;
+	DYN_STAT(dyn_array, reallocs, 1);
+
+	// tombstones have to cover the final capacity (not just the one asked for), or we're in trouble
+	// they follow the array, so if they can't they're either just a little too big (harmless)
+	// or the array keeps its old capacity and the extra storage goes unused
+	bool success = true;
+	if (dyn_array->tombstones && actual_capacity != dyn_array->capacity) 
+	{
+		uint8_t *new_tombstones = (uint8_t *) realloc(dyn_array->tombstones, actual_capacity);
+		if (new_tombstones) 
+		{
+			if (actual_capacity > dyn_array->capacity) 
 			{
-				new_capacity <<= 1;
+				memset(new_tombstones + dyn_array->capacity, 0, actual_capacity - dyn_array->capacity);
 			}
+			dyn_array->tombstones = new_tombstones;
+		} 
+		else if (actual_capacity > dyn_array->capacity) 
+		{
+			actual_capacity = dyn_array->capacity;
+			success			= false;
+		}
+	}
 
-			// we can theoretically hold this, check if we can allocate that
-			// if (!MULTIPLY_MAY_OVERFLOW(new_capacity, dyn_array->data_size)) {
-			// we won't overflow, so we can at least REQUEST this change
-			void *new_array = realloc(dyn_array->array, new_capacity * dyn_array->data_size);
-			if (new_array) 
+	dyn_array->capacity = actual_capacity;
+	if (dyn_array->stats && dyn_array->stats->peak_capacity < actual_capacity) 
+	{
+		dyn_array->stats->peak_capacity = actual_capacity;
+	}
+	return success;
+}
+
+
+// Unordered removal, the last object is moved into the hole
+// [A][X][B][C][D][E]
+//	   ^-----------/
+// [A][E][B][C][D][?]
+bool dyn_swap_remove(dyn_array_t *const dyn_array, const size_t position, const DYN_SHIFT_MODE mode,
+					 void *const data_dst) 
+{
+	if (dyn_array && position < dyn_array->size && !(dyn_array->dead_count && dyn_array->tombstones[position])
+		&& DYN_WRITABLE(dyn_array)) 
+	{
+		uint8_t *const hole = DYN_ARRAY_POSITION(dyn_array, position);
+		if (mode == MODE_ERASE) 
+		{
+			if (dyn_array->destructor) 
 			{
-				// success! Wasn't that easy?
-				dyn_array->array	= new_array;
-				dyn_array->capacity = new_capacity;
-				return true;
+				dyn_array->destructor(hole);
 			}
+		} 
+		else 
+		{
+			memcpy(data_dst, hole, dyn_array->data_size);
+			DYN_STAT(dyn_array, bytes_copied, dyn_array->data_size);
 		}
+
+		// The last slot is always alive, so it can always fill the hole
+		const size_t last = dyn_array->size - 1;
+		if (position != last) 
+		{
+			memcpy(hole, DYN_ARRAY_POSITION(dyn_array, last), dyn_array->data_size);
+			DYN_STAT(dyn_array, bytes_moved, dyn_array->data_size);
+		}
+		dyn_array->size = last;
+
+		// Removing the tail may expose dead slots, keep the last slot alive
+		while (dyn_array->dead_count && dyn_array->tombstones[dyn_array->size - 1]) 
+		{
+			dyn_array->tombstones[--dyn_array->size] = 0;
+			--dyn_array->dead_count;
+		}
+		return true;
 	}
 	return false;
 }
+
+// Marks the slot dead (destructing or extracting it first) instead of shifting everything after it
+// The last slot gets popped for real, along with any dead slots it was hiding,
+// so the last slot is always alive. Compacts once the threshold is reached.
+bool dyn_tombstone_remove(dyn_array_t *const dyn_array, const size_t position, const DYN_SHIFT_MODE mode,
+						  void *const data_dst) 
+{
+	if (position >= dyn_array->size || dyn_array->tombstones[position] || !DYN_WRITABLE(dyn_array)) 
+	{
+		return false;
+	}
+	void *const object = DYN_ARRAY_POSITION(dyn_array, position);
+	if (mode == MODE_ERASE) 
+	{
+		if (dyn_array->destructor) 
+		{
+			dyn_array->destructor(object);
+		}
+	} 
+	else 
+	{
+		memcpy(data_dst, object, dyn_array->data_size);
+		DYN_STAT(dyn_array, bytes_copied, dyn_array->data_size);
+	}
+
+	if (position == dyn_array->size - 1) 
+	{
+		--dyn_array->size;
+		while (dyn_array->size && dyn_array->tombstones[dyn_array->size - 1]) 
+		{
+			dyn_array->tombstones[--dyn_array->size] = 0;
+			--dyn_array->dead_count;
+		}
+		return true;
+	}
+
+	dyn_array->tombstones[position] = 1;
+	++dyn_array->dead_count;
+	if (dyn_array->dead_count * 100 >= dyn_array->compact_percent * dyn_array->size) 
+	{
+		dyn_tombstone_compact(dyn_array, 0);
+	}
+	return true;
+}
+
+// Squeezes out every dead slot, keeping the survivors in order
+// Returns where the given slot position ends up (the number of live slots before it),
+// so callers can translate an index from before the compaction
+size_t dyn_tombstone_compact(dyn_array_t *const dyn_array, const size_t position) 
+{
+	size_t new_position = position;
+	size_t live		= 0;
+	for (size_t idx = 0; idx < dyn_array->size; ++idx) 
+	{
+		if (idx == position) 
+		{
+			new_position = live;
+		}
+		if (dyn_array->tombstones[idx]) 
+		{
+			dyn_array->tombstones[idx] = 0;
+			continue;
+		}
+		if (live != idx) 
+		{
+			memcpy(DYN_ARRAY_POSITION(dyn_array, live), DYN_ARRAY_POSITION(dyn_array, idx), dyn_array->data_size);
+			DYN_STAT(dyn_array, bytes_moved, dyn_array->data_size);
+		}
+		++live;
+	}
+	if (position >= dyn_array->size) 
+	{
+		new_position = live;
+	}
+	dyn_array->size		  = live;
+	dyn_array->dead_count = 0;
+	return new_position;
+}
+
+// Anonymous mappings only get real memory once a page is touched, so capacity is free until used
+void *dyn_map_create(const size_t bytes, const bool hugepages, size_t *const mapped_bytes) 
+{
+	const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	const size_t length = (bytes + page - 1) / page * page;
+	void *array = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (array == MAP_FAILED) 
+	{
+		return NULL;
+	}
+#ifdef MADV_HUGEPAGE
+	if (hugepages) 
+	{
+		// just advice, the kernel is free to ignore it
+		madvise(array, length, MADV_HUGEPAGE);
+	}
+#else
+	(void) hugepages;
+#endif
+	*mapped_bytes = length;
+	return array;
+}
+
+// mremap moves the page table entries, not the data, so growing never copies the payload
+void *dyn_map_resize(void *const array, const size_t old_bytes, const size_t bytes, const bool hugepages,
+					 size_t *const mapped_bytes) 
+{
+	const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	const size_t length = (bytes + page - 1) / page * page;
+	void *new_array = mremap(array, old_bytes, length, MREMAP_MAYMOVE);
+	if (new_array == MAP_FAILED) 
+	{
+		return NULL;
+	}
+#ifdef MADV_HUGEPAGE
+	if (hugepages) 
+	{
+		madvise(new_array, length, MADV_HUGEPAGE);
+	}
+#else
+	(void) hugepages;
+#endif
+	*mapped_bytes = length;
+	return new_array;
+}
+
+void dyn_storage_free(void *const array, const size_t mapped_bytes) 
+{
+	if (mapped_bytes) 
+	{
+		munmap(array, mapped_bytes);
+	} 
+	else 
+	{
+		free(array);
+	}
+}
+
+// Copies the payload into storage of the same kind and lets go of the shared one
+// If everyone else let go in the meantime (or already had), the payload is just ours
+bool dyn_cow_unshare(dyn_array_t *const dyn_array) 
+{
+	dyn_share_t *const share = dyn_array->share;
+	if (atomic_load(&share->owners) > 1) 
+	{
+		size_t mapped_bytes = 0;
+		const size_t bytes  = DYN_SIZE_N_ELEMS(dyn_array, dyn_array->capacity);
+		void *const copy	= dyn_array->mapped_bytes ? dyn_map_create(bytes, dyn_array->hugepages, &mapped_bytes)
+												   : malloc(bytes);
+		if (!copy) 
+		{
+			return false;
+		}
+		memcpy(copy, dyn_array->array, DYN_SIZE_N_ELEMS(dyn_array, dyn_array->size));
+		DYN_STAT(dyn_array, reallocs, 1);
+		DYN_STAT(dyn_array, bytes_copied, DYN_SIZE_N_ELEMS(dyn_array, dyn_array->size));
+		if (atomic_fetch_sub(&share->owners, 1) == 1) 
+		{
+			dyn_storage_free(dyn_array->array, dyn_array->mapped_bytes);
+			free(share);
+		}
+		dyn_array->array		= copy;
+		dyn_array->mapped_bytes = mapped_bytes;
+	} 
+	else 
+	{
+		free(share);
+	}
+	dyn_array->share = NULL;
+	return true;
+}
@@ -0,0 +1,477 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "dyn_array.h"
+#include "pcb_channel.h"
+#include "process_scheduling_core.h"
+
+// The smallest ring, a power of two
+#define CHANNEL_MIN_CAPACITY ((size_t) 64)
+
+// Times a side that can't go on looks again before it sleeps
+#define CHANNEL_SPINS 64u
+
+// PCBs decoded per read by pcb_channel_load_file (12 bytes each in the file)
+#define LOAD_BLOCK_PCB_COUNT 4096u
+
+enum
+{
+	CHANNEL_OPEN,
+	CHANNEL_CLOSED,
+	CHANNEL_ABORTED
+};
+
+struct pcb_channel
+{
+	// The consumer's line
+	_Alignas(64) atomic_size_t head;	// Next slot to read, counts up forever
+	size_t tail_seen;					// The consumer's last look at tail
+
+	// The producer's line
+	_Alignas(64) atomic_size_t tail;	// Next slot to fill, counts up forever
+	size_t head_seen;					// The producer's last look at head
+
+	// Written rarely: only to end the channel, or by a side going to sleep
+	_Alignas(64) atomic_uint state;
+	atomic_uint consumer_sleeping;		// Futex words, 1 while that side sleeps (or is about to)
+	atomic_uint producer_sleeping;
+	size_t mask;						// capacity - 1
+	ProcessControlBlock_t *slots;
+};
+
+///
+/// Sleeps while a futex word is still 1
+/// \param sleeping the word, set back to 0 by whoever wakes us
+///
+static void futex_sleep(atomic_uint *const sleeping)
+{
+	syscall(SYS_futex, (uint32_t *) sleeping, FUTEX_WAIT_PRIVATE, 1, NULL, NULL, 0);
+}
+
+///
+/// Wakes the other side if it is asleep, after this side has stored what it is waiting for
+/// \param sleeping the other side's futex word
+///
+static void wake_side(atomic_uint *const sleeping)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(sleeping, memory_order_relaxed) != 0 && atomic_exchange(sleeping, 0) != 0)
+	{
+		syscall(SYS_futex, (uint32_t *) sleeping, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	}
+}
+
+///
+/// One round of waiting for the other side: a yield for the first few, then a sleep
+/// \param sleeping this side's futex word
+/// \param ready checks (with acquire loads) whether this side can go on or the channel has ended
+/// \param channel the channel, passed to ready
+/// \param spins how many rounds this wait has had
+///
+static void wait_round(atomic_uint *const sleeping, bool (*const ready)(pcb_channel_t *), pcb_channel_t *const channel, const unsigned int spins)
+{
+	if (spins < CHANNEL_SPINS)
+	{
+		sched_yield();
+		return;
+	}
+	// Announced before the last look, so anything the other side does after it sees the announcement and wakes us
+	atomic_store(sleeping, 1);
+	atomic_thread_fence(memory_order_seq_cst);
+	if (ready(channel))
+	{
+		atomic_store(sleeping, 0);
+		return;
+	}
+	futex_sleep(sleeping);
+	atomic_store(sleeping, 0);
+}
+
+static bool consumer_ready(pcb_channel_t *const channel)
+{
+	return atomic_load_explicit(&channel->tail, memory_order_acquire) != atomic_load_explicit(&channel->head, memory_order_relaxed)
+		|| atomic_load_explicit(&channel->state, memory_order_acquire) != CHANNEL_OPEN;
+}
+
+static bool producer_ready(pcb_channel_t *const channel)
+{
+	return atomic_load_explicit(&channel->tail, memory_order_relaxed) - atomic_load_explicit(&channel->head, memory_order_acquire) <= channel->mask
+		|| atomic_load_explicit(&channel->state, memory_order_acquire) != CHANNEL_OPEN;
+}
+
+pcb_channel_t *pcb_channel_create(const size_t capacity)
+{
+	size_t rounded = CHANNEL_MIN_CAPACITY;
+	const size_t wanted = capacity > 0 ? capacity : PCB_CHANNEL_DEFAULT_CAPACITY;
+	while (rounded < wanted)
+	{
+		if (rounded > SIZE_MAX / 2 / sizeof(ProcessControlBlock_t))
+		{
+			return NULL;
+		}
+		rounded *= 2;
+	}
+
+	pcb_channel_t *const channel = aligned_alloc(_Alignof(pcb_channel_t), sizeof(pcb_channel_t));
+	if (channel == NULL)
+	{
+		return NULL;
+	}
+	channel->slots = malloc(rounded * sizeof(ProcessControlBlock_t));
+	if (channel->slots == NULL)
+	{
+		free(channel);
+		return NULL;
+	}
+	atomic_init(&channel->head, 0);
+	atomic_init(&channel->tail, 0);
+	channel->tail_seen = 0;
+	channel->head_seen = 0;
+	atomic_init(&channel->state, CHANNEL_OPEN);
+	atomic_init(&channel->consumer_sleeping, 0);
+	atomic_init(&channel->producer_sleeping, 0);
+	channel->mask = rounded - 1;
+	return channel;
+}
+
+void pcb_channel_destroy(pcb_channel_t *const channel)
+{
+	if (channel != NULL)
+	{
+		free(channel->slots);
+		free(channel);
+	}
+}
+
+size_t pcb_channel_reserve(pcb_channel_t *const channel, ProcessControlBlock_t **const slots, const size_t wanted)
+{
+	if (channel == NULL || slots == NULL || wanted == 0)
+	{
+		return 0;
+	}
+	const size_t tail = atomic_load_explicit(&channel->tail, memory_order_relaxed);
+	const size_t capacity = channel->mask + 1;
+	// The cached head is enough unless the ring looks full
+	for (unsigned int spins = 0; tail - channel->head_seen == capacity; spins++)
+	{
+		if (atomic_load_explicit(&channel->state, memory_order_acquire) != CHANNEL_OPEN)
+		{
+			return 0;
+		}
+		channel->head_seen = atomic_load_explicit(&channel->head, memory_order_acquire);
+		if (tail - channel->head_seen == capacity)
+		{
+			wait_round(&channel->producer_sleeping, producer_ready, channel, spins);
+		}
+	}
+	if (atomic_load_explicit(&channel->state, memory_order_relaxed) != CHANNEL_OPEN)
+	{
+		return 0;
+	}
+
+	size_t count = capacity - (tail - channel->head_seen);
+	const size_t to_wrap = capacity - (tail & channel->mask);
+	count = count < to_wrap ? count : to_wrap;
+	*slots = channel->slots + (tail & channel->mask);
+	return count < wanted ? count : wanted;
+}
+
+void pcb_channel_publish(pcb_channel_t *const channel, const size_t count)
+{
+	if (channel == NULL || count == 0)
+	{
+		return;
+	}
+	atomic_store_explicit(&channel->tail, atomic_load_explicit(&channel->tail, memory_order_relaxed) + count, memory_order_release);
+	wake_side(&channel->consumer_sleeping);
+}
+
+bool pcb_channel_send(pcb_channel_t *const channel, const ProcessControlBlock_t *pcbs, size_t count)
+{
+	if (channel == NULL || (pcbs == NULL && count > 0))
+	{
+		return false;
+	}
+	while (count > 0)
+	{
+		ProcessControlBlock_t *slots = NULL;
+		const size_t reserved = pcb_channel_reserve(channel, &slots, count);
+		if (reserved == 0)
+		{
+			return false;
+		}
+		memcpy(slots, pcbs, reserved * sizeof(ProcessControlBlock_t));
+		pcb_channel_publish(channel, reserved);
+		pcbs += reserved;
+		count -= reserved;
+	}
+	return true;
+}
+
+size_t pcb_channel_peek(pcb_channel_t *const channel, const ProcessControlBlock_t **const pcbs)
+{
+	if (channel == NULL || pcbs == NULL)
+	{
+		return 0;
+	}
+	const size_t head = atomic_load_explicit(&channel->head, memory_order_relaxed);
+	// The cached tail is enough unless the ring looks empty
+	for (unsigned int spins = 0; channel->tail_seen == head; spins++)
+	{
+		// Closed is checked before the tail, so everything published before the close gets seen
+		const unsigned int state = atomic_load_explicit(&channel->state, memory_order_acquire);
+		channel->tail_seen = atomic_load_explicit(&channel->tail, memory_order_acquire);
+		if (channel->tail_seen != head)
+		{
+			break;
+		}
+		if (state != CHANNEL_OPEN)
+		{
+			return 0;
+		}
+		wait_round(&channel->consumer_sleeping, consumer_ready, channel, spins);
+	}
+	if (atomic_load_explicit(&channel->state, memory_order_relaxed) == CHANNEL_ABORTED)
+	{
+		return 0;
+	}
+
+	const size_t count = channel->tail_seen - head;
+	const size_t to_wrap = channel->mask + 1 - (head & channel->mask);
+	*pcbs = channel->slots + (head & channel->mask);
+	return count < to_wrap ? count : to_wrap;
+}
+
+void pcb_channel_release(pcb_channel_t *const channel, const size_t count)
+{
+	if (channel == NULL || count == 0)
+	{
+		return;
+	}
+	atomic_store_explicit(&channel->head, atomic_load_explicit(&channel->head, memory_order_relaxed) + count, memory_order_release);
+	wake_side(&channel->producer_sleeping);
+}
+
+size_t pcb_channel_receive(pcb_channel_t *const channel, ProcessControlBlock_t *const pcbs, const size_t max)
+{
+	if (channel == NULL || pcbs == NULL || max == 0)
+	{
+		return 0;
+	}
+	size_t received = 0;
+	while (received < max)
+	{
+		// Only the first peek waits, after that take what is already there
+		if (received > 0 && atomic_load_explicit(&channel->tail, memory_order_acquire) == atomic_load_explicit(&channel->head, memory_order_relaxed))
+		{
+			break;
+		}
+		const ProcessControlBlock_t *run = NULL;
+		size_t count = pcb_channel_peek(channel, &run);
+		if (count == 0)
+		{
+			break;
+		}
+		count = count < max - received ? count : max - received;
+		memcpy(pcbs + received, run, count * sizeof(ProcessControlBlock_t));
+		pcb_channel_release(channel, count);
+		received += count;
+	}
+	return received;
+}
+
+///
+/// Moves a channel out of the open state and wakes both sides so they see it
+/// \param channel the channel
+/// \param state CHANNEL_CLOSED or CHANNEL_ABORTED
+///
+static void end_channel(pcb_channel_t *const channel, const unsigned int state)
+{
+	unsigned int expected = CHANNEL_OPEN;
+	// An abort wins over a close, nothing reopens a channel
+	if (!atomic_compare_exchange_strong(&channel->state, &expected, state) && state == CHANNEL_ABORTED)
+	{
+		atomic_store(&channel->state, CHANNEL_ABORTED);
+	}
+	wake_side(&channel->consumer_sleeping);
+	wake_side(&channel->producer_sleeping);
+}
+
+void pcb_channel_close(pcb_channel_t *const channel)
+{
+	if (channel != NULL)
+	{
+		end_channel(channel, CHANNEL_CLOSED);
+	}
+}
+
+void pcb_channel_abort(pcb_channel_t *const channel)
+{
+	if (channel != NULL)
+	{
+		end_channel(channel, CHANNEL_ABORTED);
+	}
+}
+
+bool pcb_channel_aborted(const pcb_channel_t *const channel)
+{
+	return channel != NULL && atomic_load(&channel->state) == CHANNEL_ABORTED;
+}
+
+///
+/// Reads count bytes from the current position of a file
+/// \param fd the file
+/// \param buffer where they go
+/// \param count how many
+/// \return bool representing success of the operation (false if the file ends first)
+///
+static bool read_all(const int fd, void *const buffer, size_t count)
+{
+	uint8_t *bytes = (uint8_t *) buffer;
+	while (count > 0)
+	{
+		const ssize_t bytes_read = read(fd, bytes, count);
+		if (bytes_read > 0)
+		{
+			bytes += bytes_read;
+			count -= (size_t) bytes_read;
+		}
+		else if (bytes_read == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool pcb_channel_load_file(const char *const input_file, pcb_channel_t *const channel)
+{
+	if (channel == NULL)
+	{
+		return false;
+	}
+	const int fd = input_file != NULL ? open(input_file, O_RDONLY) : -1;
+	uint32_t count = 0;
+	uint32_t *const fields = malloc(LOAD_BLOCK_PCB_COUNT * 3 * sizeof(uint32_t));
+	bool success = fd != -1 && fields != NULL && read_all(fd, &count, sizeof(uint32_t)) && count > 0;
+
+	// Decode straight into the ring, a block of the file at a time
+	for (uint32_t loaded = 0; success && loaded < count;)
+	{
+		const uint32_t block = count - loaded < LOAD_BLOCK_PCB_COUNT ? count - loaded : LOAD_BLOCK_PCB_COUNT;
+		success = read_all(fd, fields, block * 3 * sizeof(uint32_t));
+		for (uint32_t decoded = 0; success && decoded < block;)
+		{
+			ProcessControlBlock_t *slots = NULL;
+			const size_t reserved = pcb_channel_reserve(channel, &slots, block - decoded);
+			success = reserved > 0;
+			for (size_t i = 0; i < reserved; i++)
+			{
+				const uint32_t *const record = fields + (decoded + i) * 3;
+				slots[i] = (ProcessControlBlock_t) { record[0], record[1], record[2], false };
+			}
+			pcb_channel_publish(channel, reserved);
+			decoded += reserved;
+		}
+		loaded += block;
+	}
+
+	if (fd != -1)
+	{
+		close(fd);
+	}
+	free(fields);
+	if (success)
+	{
+		pcb_channel_close(channel);
+	}
+	else
+	{
+		pcb_channel_abort(channel);
+	}
+	return success;
+}
+
+// The loader thread of pcb_channel_simulate_file
+typedef struct
+{
+	const char *input_file;
+	pcb_channel_t *channel;
+	bool success;
+}
+channel_loader_t;
+
+static void *run_loader(void *arg)
+{
+	channel_loader_t *const loader = (channel_loader_t *) arg;
+	loader->success = pcb_channel_load_file(loader->input_file, loader->channel);
+	return NULL;
+}
+
+///
+/// Appends a run of PCBs to a simulation and makes every decision the new arrivals allow
+/// \param simulation the handle
+/// \param pcbs the PCBs
+/// \param count how many
+/// \return bool representing success of the operation
+///
+static bool simulate_batch(ScheduleSimulation_t *const simulation, const ProcessControlBlock_t *const pcbs, const size_t count)
+{
+	dyn_array_t *const batch = dyn_array_import(pcbs, count, sizeof(ProcessControlBlock_t), NULL);
+	const bool success = batch != NULL && schedule_simulation_append(simulation, batch) && schedule_simulation_settle(simulation);
+	dyn_array_destroy(batch);
+	return success;
+}
+
+bool pcb_channel_simulate_file(const char *const input_file, ScheduleSimulation_t *const simulation)
+{
+	if (input_file == NULL || simulation == NULL)
+	{
+		return false;
+	}
+	channel_loader_t loader = { input_file, pcb_channel_create(0), false };
+	pthread_t thread;
+	if (loader.channel == NULL || pthread_create(&thread, NULL, run_loader, &loader) != 0)
+	{
+		// No second thread, load it all first instead
+		pcb_channel_destroy(loader.channel);
+		dyn_array_t *const pcbs = load_process_control_blocks(input_file);
+		const bool success = pcbs != NULL && schedule_simulation_append(simulation, pcbs) && schedule_simulation_settle(simulation);
+		dyn_array_destroy(pcbs);
+		return success;
+	}
+
+	// Small batches hand slots back to the loader sooner, so it never waits long for room
+	const size_t batch_limit = PCB_CHANNEL_DEFAULT_CAPACITY / 4;
+	bool appended = true;
+	const ProcessControlBlock_t *pcbs = NULL;
+	for (size_t count; appended && (count = pcb_channel_peek(loader.channel, &pcbs)) > 0;)
+	{
+		count = count < batch_limit ? count : batch_limit;
+		appended = simulate_batch(simulation, pcbs, count);
+		pcb_channel_release(loader.channel, count);
+	}
+	if (!appended)
+	{
+		pcb_channel_abort(loader.channel);
+	}
+
+	pthread_join(thread, NULL);
+	pcb_channel_destroy(loader.channel);
+	return appended && loader.success;
+}
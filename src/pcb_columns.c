@@ -0,0 +1,324 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcb_columns.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PCB_COLUMNS_X86
+#endif
+
+// Column storage is padded to this many entries (one AVX2 vector) and aligned to a vector
+#define PCB_COLUMNS_LANES 8u
+#define PCB_COLUMNS_ALIGNMENT 32u
+
+
+// Finds the lowest value among the entries in [begin, end) whose started bit is clear, see pcb_columns_argmin
+typedef size_t (*pcb_argmin_function_t)(const uint32_t *values, const uint64_t *started, size_t begin, size_t end);
+
+// The 8 started bits of the entries from block (a multiple of 8), with entries outside [begin, end) marked started
+static inline uint32_t started_byte(const uint64_t *const started, const size_t block, const size_t begin, const size_t end)
+{
+	uint32_t byte = (uint32_t)(started[block >> 6] >> (block & 63)) & 0xFFu;
+	if (block < begin) { byte |= (1u << (begin - block)) - 1; }
+	if (block + 8 > end) { byte |= (0xFFu << (end - block)) & 0xFFu; }
+	return byte;
+}
+
+static size_t argmin_scalar(const uint32_t *values, const uint64_t *started, size_t begin, size_t end)
+{
+	size_t best = end;
+	uint32_t best_value = 0;
+	for (size_t idx = begin; idx < end; ++idx)
+	{
+		// Skip whole words of started PCBs at once
+		if ((idx & 63) == 0 && started[idx >> 6] == UINT64_MAX)
+		{
+			idx += 63;
+			continue;
+		}
+		if ((started[idx >> 6] >> (idx & 63)) & 1) { continue; }
+		if (best == end || values[idx] < best_value)
+		{
+			best = idx;
+			best_value = values[idx];
+		}
+	}
+	return best;
+}
+
+// Picks the answer out of per lane minimums and their indices
+// Lanes only ever hold values under UINT32_MAX, if none did every candidate is UINT32_MAX (or there are none)
+// and the scalar kernel sorts it out
+static size_t argmin_reduce(const uint32_t *lane_values, const uint32_t *lane_indices, const size_t lanes, const size_t base,
+							const uint32_t *values, const uint64_t *started, const size_t begin, const size_t end)
+{
+	size_t best = end;
+	uint32_t best_value = UINT32_MAX;
+	for (size_t lane = 0; lane < lanes; ++lane)
+	{
+		if (lane_values[lane] == UINT32_MAX) { continue; }
+		const size_t idx = base + lane_indices[lane];
+		if (lane_values[lane] < best_value || (lane_values[lane] == best_value && idx < best))
+		{
+			best = idx;
+			best_value = lane_values[lane];
+		}
+	}
+	return best != end ? best : argmin_scalar(values, started, begin, end);
+}
+
+#ifdef PCB_COLUMNS_X86
+__attribute__((target("avx2")))
+static size_t argmin_avx2(const uint32_t *values, const uint64_t *started, size_t begin, size_t end)
+{
+	// Indices are kept relative to base in 32 bit lanes
+	const size_t base = begin & ~(size_t) 7;
+	const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	const __m256i step = _mm256_set1_epi32(8);
+	__m256i lane_min = _mm256_set1_epi32(-1);
+	__m256i lane_idx = _mm256_setzero_si256();
+	__m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	for (size_t block = base; block < end; block += 8, idx = _mm256_add_epi32(idx, step))
+	{
+		const uint32_t byte = started_byte(started, block, begin, end);
+		if (byte == 0xFFu) { continue; }
+
+		// Started lanes become UINT32_MAX, which never replaces anything
+		const __m256i started_lanes = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int) byte), bits), bits);
+		const __m256i value = _mm256_or_si256(_mm256_load_si256((const __m256i *) (values + block)), started_lanes);
+		const __m256i new_min = _mm256_min_epu32(lane_min, value);
+		// A lane changed only if the new value is strictly lower, so each lane keeps its first minimum
+		const __m256i lower = _mm256_xor_si256(_mm256_cmpeq_epi32(new_min, lane_min), _mm256_set1_epi32(-1));
+		lane_idx = _mm256_blendv_epi8(lane_idx, idx, lower);
+		lane_min = new_min;
+	}
+
+	uint32_t lane_values[8], lane_indices[8];
+	_mm256_storeu_si256((__m256i *) lane_values, lane_min);
+	_mm256_storeu_si256((__m256i *) lane_indices, lane_idx);
+	return argmin_reduce(lane_values, lane_indices, 8, base, values, started, begin, end);
+}
+
+__attribute__((target("sse4.1")))
+static size_t argmin_sse41(const uint32_t *values, const uint64_t *started, size_t begin, size_t end)
+{
+	const size_t base = begin & ~(size_t) 7;
+	const __m128i bits_low = _mm_setr_epi32(1, 2, 4, 8);
+	const __m128i bits_high = _mm_setr_epi32(16, 32, 64, 128);
+	const __m128i step = _mm_set1_epi32(8);
+	const __m128i all = _mm_set1_epi32(-1);
+	__m128i lane_min[2] = { all, all };
+	__m128i lane_idx[2] = { _mm_setzero_si128(), _mm_setzero_si128() };
+	__m128i idx[2] = { _mm_setr_epi32(0, 1, 2, 3), _mm_setr_epi32(4, 5, 6, 7) };
+	for (size_t block = base; block < end; block += 8, idx[0] = _mm_add_epi32(idx[0], step), idx[1] = _mm_add_epi32(idx[1], step))
+	{
+		const uint32_t byte = started_byte(started, block, begin, end);
+		if (byte == 0xFFu) { continue; }
+
+		// Two vectors of 4, same as the AVX2 kernel
+		const __m128i byte_lanes = _mm_set1_epi32((int) byte);
+		const __m128i started_lanes[2] = { _mm_cmpeq_epi32(_mm_and_si128(byte_lanes, bits_low), bits_low),
+										   _mm_cmpeq_epi32(_mm_and_si128(byte_lanes, bits_high), bits_high) };
+		for (int half = 0; half < 2; ++half)
+		{
+			const __m128i value = _mm_or_si128(_mm_load_si128((const __m128i *) (values + block + 4 * half)), started_lanes[half]);
+			const __m128i new_min = _mm_min_epu32(lane_min[half], value);
+			const __m128i lower = _mm_xor_si128(_mm_cmpeq_epi32(new_min, lane_min[half]), all);
+			lane_idx[half] = _mm_blendv_epi8(lane_idx[half], idx[half], lower);
+			lane_min[half] = new_min;
+		}
+	}
+
+	uint32_t lane_values[8], lane_indices[8];
+	_mm_storeu_si128((__m128i *) lane_values, lane_min[0]);
+	_mm_storeu_si128((__m128i *) (lane_values + 4), lane_min[1]);
+	_mm_storeu_si128((__m128i *) lane_indices, lane_idx[0]);
+	_mm_storeu_si128((__m128i *) (lane_indices + 4), lane_idx[1]);
+	return argmin_reduce(lane_values, lane_indices, 8, base, values, started, begin, end);
+}
+#endif
+
+// Looks up a kernel, NULL if this CPU can't run it
+static pcb_argmin_function_t kernel_function(const pcb_kernel_t kernel)
+{
+#ifdef PCB_COLUMNS_X86
+	__builtin_cpu_init();
+	switch (kernel)
+	{
+		case PCB_KERNEL_AUTO:
+			if (__builtin_cpu_supports("avx2")) { return argmin_avx2; }
+			if (__builtin_cpu_supports("sse4.1")) { return argmin_sse41; }
+			return argmin_scalar;
+		case PCB_KERNEL_SCALAR: return argmin_scalar;
+		case PCB_KERNEL_SSE41: return __builtin_cpu_supports("sse4.1") ? argmin_sse41 : NULL;
+		case PCB_KERNEL_AVX2: return __builtin_cpu_supports("avx2") ? argmin_avx2 : NULL;
+	}
+	return NULL;
+#else
+	return kernel == PCB_KERNEL_AUTO || kernel == PCB_KERNEL_SCALAR ? argmin_scalar : NULL;
+#endif
+}
+
+// The kernel in use, picked on first use
+static _Atomic(pcb_argmin_function_t) argmin_kernel = NULL;
+
+bool pcb_columns_use_kernel(const pcb_kernel_t kernel)
+{
+	pcb_argmin_function_t function = kernel_function(kernel);
+	if (!function)
+	{
+		return false;
+	}
+	atomic_store_explicit(&argmin_kernel, function, memory_order_relaxed);
+	return true;
+}
+
+pcb_columns_t *pcb_columns_create(const size_t capacity)
+{
+	// Padded to whole vectors, and at least one so the allocations are never empty
+	const size_t padded = capacity ? (capacity + PCB_COLUMNS_LANES - 1) & ~(size_t)(PCB_COLUMNS_LANES - 1) : PCB_COLUMNS_LANES;
+	if (padded < capacity || padded > SIZE_MAX / sizeof(uint32_t))
+	{
+		return NULL;
+	}
+	pcb_columns_t *columns = calloc(1, sizeof(pcb_columns_t));
+	if (!columns)
+	{
+		return NULL;
+	}
+	columns->capacity = padded;
+	for (int column = 0; column < 3; ++column)
+	{
+		columns->values[column] = aligned_alloc(PCB_COLUMNS_ALIGNMENT, padded * sizeof(uint32_t));
+		if (!columns->values[column])
+		{
+			pcb_columns_destroy(columns);
+			return NULL;
+		}
+		memset(columns->values[column], 0xFF, padded * sizeof(uint32_t));
+	}
+	columns->started = calloc((padded + 63) / 64, sizeof(uint64_t));
+	if (!columns->started)
+	{
+		pcb_columns_destroy(columns);
+		return NULL;
+	}
+	return columns;
+}
+
+pcb_columns_t *pcb_columns_import(const dyn_array_t *const ready_queue)
+{
+	if (!ready_queue || dyn_array_data_size(ready_queue) != sizeof(ProcessControlBlock_t))
+	{
+		return NULL;
+	}
+	const size_t count = dyn_array_size(ready_queue);
+	pcb_columns_t *columns = pcb_columns_create(count);
+	if (!columns)
+	{
+		return NULL;
+	}
+	// One pass straight into the columns, the started bits a word at a time
+	const ProcessControlBlock_t *blocks = dyn_array_export(ready_queue);
+	uint32_t *burst = columns->values[PCB_COLUMN_BURST];
+	uint32_t *priority = columns->values[PCB_COLUMN_PRIORITY];
+	uint32_t *arrival = columns->values[PCB_COLUMN_ARRIVAL];
+	uint64_t started = 0;
+	for (size_t idx = 0; idx < count; ++idx)
+	{
+		burst[idx] = blocks[idx].remaining_burst_time;
+		priority[idx] = blocks[idx].priority;
+		arrival[idx] = blocks[idx].arrival;
+		started |= (uint64_t) blocks[idx].started << (idx & 63);
+		if ((idx & 63) == 63 || idx + 1 == count)
+		{
+			columns->started[idx >> 6] = started;
+			started = 0;
+		}
+	}
+	columns->size = count;
+	return columns;
+}
+
+void pcb_columns_clear_started(pcb_columns_t *const columns)
+{
+	if (columns)
+	{
+		memset(columns->started, 0, (columns->capacity + 63) / 64 * sizeof(uint64_t));
+	}
+}
+
+void pcb_columns_destroy(pcb_columns_t *const columns)
+{
+	if (columns)
+	{
+		for (int column = 0; column < 3; ++column)
+		{
+			free(columns->values[column]);
+		}
+		free(columns->started);
+		free(columns);
+	}
+}
+
+bool pcb_columns_push_back(pcb_columns_t *const columns, const ProcessControlBlock_t *const pcb)
+{
+	if (!columns || !pcb || columns->size == columns->capacity)
+	{
+		return false;
+	}
+	const size_t idx = columns->size++;
+	columns->values[PCB_COLUMN_BURST][idx] = pcb->remaining_burst_time;
+	columns->values[PCB_COLUMN_PRIORITY][idx] = pcb->priority;
+	columns->values[PCB_COLUMN_ARRIVAL][idx] = pcb->arrival;
+	return pcb_columns_set_started(columns, idx, pcb->started);
+}
+
+bool pcb_columns_get(const pcb_columns_t *const columns, const size_t index, ProcessControlBlock_t *const pcb)
+{
+	if (!columns || !pcb || index >= columns->size)
+	{
+		return false;
+	}
+	pcb->remaining_burst_time = columns->values[PCB_COLUMN_BURST][index];
+	pcb->priority = columns->values[PCB_COLUMN_PRIORITY][index];
+	pcb->arrival = columns->values[PCB_COLUMN_ARRIVAL][index];
+	pcb->started = pcb_columns_started(columns, index);
+	return true;
+}
+
+size_t pcb_columns_size(const pcb_columns_t *const columns)
+{
+	return columns ? columns->size : 0;
+}
+
+uint32_t *pcb_columns_column(pcb_columns_t *const columns, const pcb_column_t column)
+{
+	if (!columns || (unsigned) column > PCB_COLUMN_ARRIVAL)
+	{
+		return NULL;
+	}
+	return columns->values[column];
+}
+
+size_t pcb_columns_argmin(const pcb_columns_t *const columns, const pcb_column_t column, const size_t begin, const size_t end)
+{
+	if (!columns || (unsigned) column > PCB_COLUMN_ARRIVAL || begin >= end || end > columns->size)
+	{
+		return end;
+	}
+	pcb_argmin_function_t function = atomic_load_explicit(&argmin_kernel, memory_order_relaxed);
+	if (!function)
+	{
+		function = kernel_function(PCB_KERNEL_AUTO);
+		atomic_store_explicit(&argmin_kernel, function, memory_order_relaxed);
+	}
+	// The vector kernels count in 32 bit lanes
+	if (end - begin > UINT32_MAX - PCB_COLUMNS_LANES)
+	{
+		function = argmin_scalar;
+	}
+	return function(columns->values[column], columns->started, begin, end);
+}
@@ -0,0 +1,594 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "dyn_array.h"
+#include "pcb_sort.h"
+
+// Radix digits on the 32 bit arrival: 11 + 11 + 10 bits (fewer passes beat smaller buckets, even with 12 byte records)
+#define RADIX_BITS 11u
+#define RADIX_BUCKETS (1u << RADIX_BITS)
+#define RADIX_PASSES 3u
+
+// The smallest read buffer a run gets during a merge, which caps how many runs merge at once
+#define MERGE_MIN_BLOCK_BYTES ((size_t) 64 << 10)
+
+// PCBs per batch handed to a pcb_sort_stream consumer
+#define STREAM_BATCH_PCB_COUNT 65536u
+
+// A PCB as it is stored in a PCB file
+typedef struct
+{
+	uint32_t burst;
+	uint32_t priority;
+	uint32_t arrival;
+}
+pcb_record_t;
+
+_Static_assert(sizeof(pcb_record_t) == 3 * sizeof(uint32_t), "PCB records are 12 bytes in a PCB file");
+
+// A sorted run in a temp file
+typedef struct
+{
+	uint64_t offset;	// Its first record's index in the file
+	uint64_t count;
+}
+sort_run_t;
+
+// Where sorted records go
+typedef struct
+{
+	bool (*begin)(void *arg, uint32_t count);	// Called once with the record count, before any records
+	bool (*write)(void *arg, const pcb_record_t *records, size_t count);
+	void *arg;
+}
+record_sink_t;
+
+// A run being merged, with the block of it that has been read
+typedef struct
+{
+	pcb_record_t *buffer;
+	size_t position;	// Next record of buffer
+	size_t size;		// Records in buffer
+	uint64_t next;		// Next record to read from the file
+	uint64_t end;		// One past its last record in the file
+}
+merge_run_t;
+
+///
+/// Reads count bytes from the current position of a file
+/// \param fd the file
+/// \param buffer where they go
+/// \param count how many
+/// \return bool representing success of the operation (false if the file ends first)
+///
+static bool read_all(const int fd, void *const buffer, size_t count)
+{
+	uint8_t *bytes = (uint8_t *) buffer;
+	while (count > 0)
+	{
+		const ssize_t bytes_read = read(fd, bytes, count);
+		if (bytes_read > 0)
+		{
+			bytes += bytes_read;
+			count -= (size_t) bytes_read;
+		}
+		else if (bytes_read == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+///
+/// Reads count bytes starting at an offset, without moving the file position
+/// \param fd the file
+/// \param buffer where they go
+/// \param count how many
+/// \param offset the first byte to read
+/// \return bool representing success of the operation (false if the file ends first)
+///
+static bool read_at(const int fd, void *const buffer, size_t count, off_t offset)
+{
+	uint8_t *bytes = (uint8_t *) buffer;
+	while (count > 0)
+	{
+		const ssize_t bytes_read = pread(fd, bytes, count, offset);
+		if (bytes_read > 0)
+		{
+			bytes += bytes_read;
+			count -= (size_t) bytes_read;
+			offset += bytes_read;
+		}
+		else if (bytes_read == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+///
+/// Writes count bytes at the current position of a file
+/// \param fd the file
+/// \param buffer the bytes
+/// \param count how many
+/// \return bool representing success of the operation
+///
+static bool write_all(const int fd, const void *const buffer, size_t count)
+{
+	const uint8_t *bytes = (const uint8_t *) buffer;
+	while (count > 0)
+	{
+		const ssize_t bytes_written = write(fd, bytes, count);
+		if (bytes_written > 0)
+		{
+			bytes += bytes_written;
+			count -= (size_t) bytes_written;
+		}
+		else if (bytes_written == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+///
+/// Creates a temp file that is already unlinked, so it goes away with its descriptor
+/// \param temp_dir the directory to create it in
+/// \return the file descriptor, -1 on error
+///
+static int create_temp_file(const char *const temp_dir)
+{
+	char path[PATH_MAX];
+	const int length = snprintf(path, sizeof(path), "%s/pcb_sort_XXXXXX", temp_dir);
+	if (length < 0 || (size_t) length >= sizeof(path))
+	{
+		return -1;
+	}
+	const int fd = mkstemp(path);
+	if (fd != -1)
+	{
+		unlink(path);
+	}
+	return fd;
+}
+
+///
+/// Stable LSD radix sort of records on arrival
+/// \param records the records
+/// \param scratch room for count more records
+/// \param count how many records
+/// \return whichever of records and scratch ended up holding the sorted records
+///
+static pcb_record_t *radix_sort_arrival(pcb_record_t *records, pcb_record_t *scratch, const size_t count)
+{
+	// One pass over the keys counts the digits for every pass
+	static _Thread_local size_t counts[RADIX_PASSES][RADIX_BUCKETS];
+	memset(counts, 0, sizeof(counts));
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint32_t arrival = records[i].arrival;
+		for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+		{
+			counts[pass][(arrival >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+		}
+	}
+
+	for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+	{
+		const uint32_t shift = pass * RADIX_BITS;
+		size_t *const buckets = counts[pass];
+
+		// Every key has the same digit, nothing would move (traces that span a small time range skip the top passes)
+		if (count == 0 || buckets[(records[0].arrival >> shift) & (RADIX_BUCKETS - 1)] == count)
+		{
+			continue;
+		}
+
+		// Turn the counts into where each digit starts
+		size_t start = 0;
+		for (uint32_t digit = 0; digit < RADIX_BUCKETS; digit++)
+		{
+			const size_t digit_count = buckets[digit];
+			buckets[digit] = start;
+			start += digit_count;
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			scratch[buckets[(records[i].arrival >> shift) & (RADIX_BUCKETS - 1)]++] = records[i];
+		}
+
+		pcb_record_t *const sorted = scratch;
+		scratch = records;
+		records = sorted;
+	}
+	return records;
+}
+
+///
+/// Reads the next block of a run
+/// \param fd the runs file
+/// \param run the run
+/// \param block records per block
+/// \return bool representing success of the operation
+///
+static bool merge_run_refill(const int fd, merge_run_t *const run, const size_t block)
+{
+	const size_t count = run->end - run->next < block ? (size_t) (run->end - run->next) : block;
+	if (!read_at(fd, run->buffer, count * sizeof(pcb_record_t), (off_t) (run->next * sizeof(pcb_record_t))))
+	{
+		return false;
+	}
+	run->next += count;
+	run->position = 0;
+	run->size = count;
+	return true;
+}
+
+// A run's current key: arrival, then which run it is (so the merge is stable), UINT64_MAX once it is used up
+static inline uint64_t merge_key(const merge_run_t *const run, const size_t index)
+{
+	return run->position < run->size ? (uint64_t) run->buffer[run->position].arrival << 32 | index : UINT64_MAX;
+}
+
+///
+/// Merges sorted runs of a file with a loser tree
+/// \param fd the runs file
+/// \param runs the runs, in file order (ties go to the earlier run)
+/// \param run_count how many, at least 1
+/// \param memory bytes the merge can use for buffers
+/// \param sink where the merged records go
+/// \return bool representing success of the operation
+///
+static bool merge_runs(const int fd, const sort_run_t *const runs, const size_t run_count, const size_t memory, const record_sink_t *const sink)
+{
+	// A block for each run and one for the output
+	const size_t block = memory / ((run_count + 1) * sizeof(pcb_record_t));
+	pcb_record_t *const buffers = malloc((run_count + 1) * block * sizeof(pcb_record_t));
+	merge_run_t *const state = malloc(run_count * sizeof(merge_run_t));
+	uint64_t *const keys = malloc(run_count * sizeof(uint64_t));
+	// Node n plays nodes 2n and 2n + 1, run i is leaf run_count + i, so node 1 is the final
+	size_t *const losers = malloc(run_count * sizeof(size_t));
+	size_t *const winners = malloc(2 * run_count * sizeof(size_t));
+	bool success = buffers != NULL && state != NULL && keys != NULL && losers != NULL && winners != NULL && block > 0;
+
+	for (size_t i = 0; success && i < run_count; i++)
+	{
+		state[i] = (merge_run_t) { buffers + i * block, 0, 0, runs[i].offset, runs[i].offset + runs[i].count };
+		success = merge_run_refill(fd, &state[i], block);
+		keys[i] = merge_key(&state[i], i);
+	}
+
+	if (success)
+	{
+		// Play every match bottom up, each node keeps its loser
+		for (size_t i = 0; i < run_count; i++)
+		{
+			winners[run_count + i] = i;
+		}
+		for (size_t node = run_count - 1; node >= 1; node--)
+		{
+			const size_t left = winners[2 * node];
+			const size_t right = winners[2 * node + 1];
+			winners[node] = keys[left] < keys[right] ? left : right;
+			losers[node] = keys[left] < keys[right] ? right : left;
+		}
+		size_t winner = winners[1];
+
+		pcb_record_t *const output = buffers + run_count * block;
+		size_t output_size = 0;
+		while (success && keys[winner] != UINT64_MAX)
+		{
+			merge_run_t *const run = &state[winner];
+			output[output_size++] = run->buffer[run->position++];
+			if (output_size == block)
+			{
+				success = sink->write(sink->arg, output, output_size);
+				output_size = 0;
+			}
+			if (run->position == run->size && run->next < run->end)
+			{
+				success = success && merge_run_refill(fd, run, block);
+			}
+			keys[winner] = merge_key(run, winner);
+
+			// Replay the winner's path, only its matches can have changed
+			for (size_t node = (run_count + winner) / 2; node >= 1; node /= 2)
+			{
+				if (keys[losers[node]] < keys[winner])
+				{
+					const size_t loser = losers[node];
+					losers[node] = winner;
+					winner = loser;
+				}
+			}
+		}
+		if (success && output_size > 0)
+		{
+			success = sink->write(sink->arg, output, output_size);
+		}
+	}
+
+	free(buffers);
+	free(state);
+	free(keys);
+	free(losers);
+	free(winners);
+	return success;
+}
+
+// Appends records to the end of a temp file, arg points at its descriptor
+static bool write_temp_records(void *arg, const pcb_record_t *records, size_t count)
+{
+	return write_all(*(const int *) arg, records, count * sizeof(pcb_record_t));
+}
+
+///
+/// Merges runs until there are few enough to merge in one go, then merges them into the sink
+/// \param fd the runs file (closed when done)
+/// \param runs the runs, in file order (overwritten by the runs of each pass)
+/// \param run_count how many
+/// \param memory bytes the merge can use for buffers
+/// \param temp_dir where a pass writes its runs
+/// \param sink where the merged records go
+/// \return bool representing success of the operation
+///
+static bool merge_all_runs(int fd, sort_run_t *const runs, size_t run_count, const size_t memory, const char *const temp_dir, const record_sink_t *const sink)
+{
+	const size_t fan_in = memory / MERGE_MIN_BLOCK_BYTES - 1;
+	bool success = true;
+	while (success && run_count > fan_in)
+	{
+		// Each group of fan_in runs becomes one run of the next file, in order, so ties still go to the earlier run
+		int next_fd = create_temp_file(temp_dir);
+		const record_sink_t next_sink = { NULL, write_temp_records, &next_fd };
+		success = next_fd != -1;
+		size_t next_count = 0;
+		uint64_t offset = 0;
+		for (size_t first = 0; success && first < run_count; first += fan_in)
+		{
+			const size_t group = run_count - first < fan_in ? run_count - first : fan_in;
+			uint64_t count = 0;
+			for (size_t i = 0; i < group; i++)
+			{
+				count += runs[first + i].count;
+			}
+			success = merge_runs(fd, runs + first, group, memory, &next_sink);
+			runs[next_count++] = (sort_run_t) { offset, count };
+			offset += count;
+		}
+		close(fd);
+		fd = next_fd;
+		run_count = next_count;
+	}
+	success = success && merge_runs(fd, runs, run_count, memory, sink);
+	if (fd != -1)
+	{
+		close(fd);
+	}
+	return success;
+}
+
+///
+/// Sorts a PCB file by arrival into a sink, see the PCB sort notes
+/// \param input_file the PCB file
+/// \param options resources it may use, NULL for the defaults
+/// \param sink where the sorted records go
+/// \return bool representing success of the operation
+///
+static bool sort_records(const char *const input_file, const pcb_sort_options_t *const options, const record_sink_t *const sink)
+{
+	if (input_file == NULL)
+	{
+		return false;
+	}
+	size_t memory = options != NULL && options->memory_bytes != 0 ? options->memory_bytes : PCB_SORT_DEFAULT_MEMORY;
+	if (memory < PCB_SORT_MIN_MEMORY)
+	{
+		memory = PCB_SORT_MIN_MEMORY;
+	}
+	const char *temp_dir = options != NULL ? options->temp_dir : NULL;
+	if (temp_dir == NULL)
+	{
+		temp_dir = getenv("TMPDIR");
+	}
+	if (temp_dir == NULL || temp_dir[0] == '\0')
+	{
+		temp_dir = "/tmp";
+	}
+
+	const int input = open(input_file, O_RDONLY);
+	if (input == -1)
+	{
+		return false;
+	}
+	uint32_t total = 0;
+	if (!read_all(input, &total, sizeof(total)) || !sink->begin(sink->arg, total))
+	{
+		close(input);
+		return false;
+	}
+
+	// Half the budget holds a chunk, the other half is the radix sort's scratch
+	const size_t chunk_capacity = memory / (2 * sizeof(pcb_record_t));
+	const size_t chunk_size = total < chunk_capacity ? total : chunk_capacity;
+	pcb_record_t *const records = malloc((chunk_size > 0 ? chunk_size : 1) * sizeof(pcb_record_t));
+	pcb_record_t *const scratch = malloc((chunk_size > 0 ? chunk_size : 1) * sizeof(pcb_record_t));
+	bool success = records != NULL && scratch != NULL;
+
+	if (success && total <= chunk_capacity)
+	{
+		// It all fits, no runs
+		success = read_all(input, records, total * sizeof(pcb_record_t));
+		if (success && total > 0)
+		{
+			success = sink->write(sink->arg, radix_sort_arrival(records, scratch, total), total);
+		}
+		free(records);
+		free(scratch);
+		close(input);
+		return success;
+	}
+
+	// Spill every sorted chunk to the runs file, back to back
+	const size_t run_count = (total + chunk_capacity - 1) / chunk_capacity;
+	sort_run_t *const runs = malloc(run_count * sizeof(sort_run_t));
+	const int runs_fd = success ? create_temp_file(temp_dir) : -1;
+	success = success && runs != NULL && runs_fd != -1;
+	for (size_t run = 0; success && run < run_count; run++)
+	{
+		const uint64_t offset = (uint64_t) run * chunk_capacity;
+		const size_t count = total - offset < chunk_capacity ? (size_t) (total - offset) : chunk_capacity;
+		success = read_all(input, records, count * sizeof(pcb_record_t))
+			&& write_all(runs_fd, radix_sort_arrival(records, scratch, count), count * sizeof(pcb_record_t));
+		runs[run] = (sort_run_t) { offset, count };
+	}
+	free(records);
+	free(scratch);
+	close(input);
+
+	// The chunk memory is free again for the merge buffers
+	if (success)
+	{
+		success = merge_all_runs(runs_fd, runs, run_count, memory, temp_dir, sink);
+	}
+	else if (runs_fd != -1)
+	{
+		close(runs_fd);
+	}
+	free(runs);
+	return success;
+}
+
+// Starts an output PCB file with its count, arg points at its descriptor
+static bool begin_output_file(void *arg, uint32_t count)
+{
+	return write_all(*(const int *) arg, &count, sizeof(count));
+}
+
+bool pcb_sort_file(const char *const input_file, const char *const output_file, const pcb_sort_options_t *const options)
+{
+	if (input_file == NULL || output_file == NULL)
+	{
+		return false;
+	}
+	// Opening the output truncates it, which would lose the input if they are the same file
+	struct stat input_stat, output_stat;
+	if (stat(input_file, &input_stat) == 0 && stat(output_file, &output_stat) == 0
+		&& input_stat.st_dev == output_stat.st_dev && input_stat.st_ino == output_stat.st_ino)
+	{
+		return false;
+	}
+	int output = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (output == -1)
+	{
+		return false;
+	}
+	const record_sink_t sink = { begin_output_file, write_temp_records, &output };
+	bool success = sort_records(input_file, options, &sink);
+	if (close(output) == -1)
+	{
+		success = false;
+	}
+	// Never leave half a sorted file behind
+	if (!success)
+	{
+		unlink(output_file);
+	}
+	return success;
+}
+
+// Where pcb_sort_stream's batches go
+typedef struct
+{
+	pcb_sort_consumer_t consumer;
+	void *arg;
+	ProcessControlBlock_t batch[STREAM_BATCH_PCB_COUNT];
+}
+stream_sink_t;
+
+static bool begin_stream(void *arg, uint32_t count)
+{
+	(void) arg;
+	(void) count;
+	return true;
+}
+
+// Hands records to the consumer as PCBs, a batch at a time
+static bool write_stream(void *arg, const pcb_record_t *records, size_t count)
+{
+	stream_sink_t *const stream = (stream_sink_t *) arg;
+	while (count > 0)
+	{
+		const size_t batch = count < STREAM_BATCH_PCB_COUNT ? count : STREAM_BATCH_PCB_COUNT;
+		for (size_t i = 0; i < batch; i++)
+		{
+			stream->batch[i] = (ProcessControlBlock_t) { records[i].burst, records[i].priority, records[i].arrival, false };
+		}
+		if (!stream->consumer(stream->arg, stream->batch, batch))
+		{
+			return false;
+		}
+		records += batch;
+		count -= batch;
+	}
+	return true;
+}
+
+bool pcb_sort_stream(const char *const input_file, const pcb_sort_options_t *const options, const pcb_sort_consumer_t consumer, void *const arg)
+{
+	if (consumer == NULL)
+	{
+		return false;
+	}
+	stream_sink_t *const stream = malloc(sizeof(stream_sink_t));
+	if (stream == NULL)
+	{
+		return false;
+	}
+	stream->consumer = consumer;
+	stream->arg = arg;
+	const record_sink_t sink = { begin_stream, write_stream, stream };
+	const bool success = sort_records(input_file, options, &sink);
+	free(stream);
+	return success;
+}
+
+// Appends a batch to the simulation handle in arg
+static bool append_to_simulation(void *arg, const ProcessControlBlock_t *pcbs, size_t count)
+{
+	dyn_array_t *const batch = dyn_array_import(pcbs, count, sizeof(ProcessControlBlock_t), NULL);
+	const bool appended = batch != NULL && schedule_simulation_append((ScheduleSimulation_t *) arg, batch);
+	dyn_array_destroy(batch);
+	return appended;
+}
+
+bool pcb_sort_simulation(const char *const input_file, const pcb_sort_options_t *const options, ScheduleSimulation_t *const simulation)
+{
+	if (simulation == NULL)
+	{
+		return false;
+	}
+	return pcb_sort_stream(input_file, options, append_to_simulation, simulation);
+}
@@ -3,450 +3,682 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include "dyn_array.h"
+#include "process_scheduling_core.h"
 #include "processing_scheduling.h"
+#include "thread_pool.h"
 
+// Traces with at least this many PCBs are loaded into a large (memory mapped) dyn_array
+#define LARGE_TRACE_PCB_COUNT (1u << 20)
 
-// private function
-void virtual_cpu(ProcessControlBlock_t *process_control_block) 
+// PCB records read from a trace file per read call
+#define LOAD_CHUNK_PCB_COUNT 1024u
+
+
+#ifdef SCHEDULE_STATS
+// Where this thread's schedulers count, NULL when nobody is listening
+static _Thread_local ScheduleStats_t* attached_stats = NULL;
+
+bool schedule_stats_attach(ScheduleStats_t* stats)
 {
-	// decrement the burst time of the pcb
-	--process_control_block->remaining_burst_time;
+	attached_stats = stats;
+	return true;
 }
 
-// Defines a function pointer type for non-preemptive CPU scheduler algorithms that select and extract the next
-// process to run from the ready queue.
-// \param: ready_queue - A dyn_array containing the pool of available processes
-// \param: current_time - The current simulated CPU time used to determine process eligibility
-// \param: object - A pointer to the destination where the extracted process block will be stored
-// \return: True if a process was successfully selected and extracted, false otherwise
-typedef bool (*process_selector_function_t)(dyn_array_t* ready_queue, unsigned long current_time, ProcessControlBlock_t* const process);
+#else
+bool schedule_stats_attach(ScheduleStats_t* stats)
+{
+	(void)stats;
+	return false;
+}
+#endif
 
-// Simulates a non-preemptive CPU scheduler by executing processes from the ready queue to completion using a provided selection algorithm.
-// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing the processes to be scheduled
-// \param: result - A pointer to a ScheduleResult_t structure where the calculated scheduling statistics will be stored
-// \param: selector - A function pointer used to extract the next process from the ready queue based on a specific scheduling algorithm
-// \return: True if the scheduling simulation completed successfully, false otherwise
-static bool nonpreemptive_scheduler(dyn_array_t* ready_queue, ScheduleResult_t* result, process_selector_function_t selector)
+// Who gets told about this thread's finished processes, NULL when nobody is listening
+static _Thread_local schedule_completion_function_t completion_observer = NULL;
+static _Thread_local void* completion_arg = NULL;
+
+void schedule_completion_attach(schedule_completion_function_t observer, void* arg)
 {
-	// Validate input values
-	if (ready_queue == NULL || result == NULL) { return false; }
-	size_t process_count = dyn_array_size(ready_queue);
-	if (process_count == 0) { return false; }
+	completion_observer = observer;
+	completion_arg = arg;
+}
 
-	// Create CPU variables
-	unsigned long current_time = 0;
-	unsigned long total_waiting = 0;
-	unsigned long total_turnaround = 0;
+void schedule_completion_attached(schedule_completion_function_t* observer, void** arg)
+{
+	if (observer != NULL) { *observer = completion_observer; }
+	if (arg != NULL) { *arg = completion_arg; }
+}
 
-	// Loop until the ready queue has been emptied
-	while (!dyn_array_empty(ready_queue))
-	{
-		// Select the next process to run
-		ProcessControlBlock_t target_process;
-		if (!selector(ready_queue, current_time, &target_process)) { return false; }
+// Where this thread's schedulers put per process times, NULL when nobody is listening
+static _Thread_local const ScheduleTimes_t* attached_times = NULL;
 
-		// Skip to the arrival time if needed
-		if (current_time < target_process.arrival) { current_time = target_process.arrival; }
-		else { total_waiting += current_time - target_process.arrival; }
+void schedule_times_attach(const ScheduleTimes_t* times)
+{
+	attached_times = times;
+}
 
-		// If a process was found then run it to completion
-		while (target_process.remaining_burst_time > 0)
+#define SCHEDULE_TRACE_MAGIC "PCBTRACE"
+#define SCHEDULE_TRACE_VERSION 1u
+#define SCHEDULE_FILE_DEFAULT_BLOCK_SIZE (1u << 20)
+
+struct ScheduleWriter
+{
+	int fd;
+	uint8_t* buffer;	// Bytes waiting to be written
+	size_t size;		// Bytes in buffer
+	size_t capacity;	// Bytes buffer holds
+	bool failed;		// A write failed, everything after it is dropped
+};
+
+struct ScheduleReader
+{
+	int fd;
+	uint8_t* buffer;	// Bytes read but not handed out yet
+	size_t position;	// Next byte of buffer to hand out
+	size_t size;		// Bytes in buffer
+	size_t capacity;	// Bytes buffer holds
+};
+
+struct ScheduleTrace
+{
+	ScheduleWriter_t writer;
+};
+
+// Where this thread's schedulers record their events, NULL when nobody is listening
+static _Thread_local ScheduleTrace_t* attached_trace = NULL;
+
+// Writes a specified number of bytes from a buffer to an open file descriptor.
+// \param: fd - the open file descriptor to write to
+// \param: buffer - the bytes to write
+// \param: count - the number of bytes to write
+// \return: True if every byte was written, else false on error
+static bool write_file_bytes(int fd, const void* buffer, size_t count)
+{
+	const uint8_t* buffer_bytes = (const uint8_t*)buffer;
+	while (count > 0)
+	{
+		ssize_t bytes_written = write(fd, buffer_bytes, count);
+		if (bytes_written > 0)
 		{
-			virtual_cpu(&target_process);
-			current_time++;
+			buffer_bytes += bytes_written;
+			count -= bytes_written;
 		}
-		total_turnaround += current_time - target_process.arrival;
+		// If the write is stopped because of an interrupt try again
+		else if (bytes_written == -1 && errno == EINTR) { continue; }
+		else { return false; }
 	}
-
-	// Set the result values
-	result->average_waiting_time = (float)total_waiting / process_count;
-	result->average_turnaround_time = (float)total_turnaround / process_count;
-	result->total_run_time = current_time;
-	
 	return true;
 }
 
-// Extracts the process with the earliest arrival time from the queue.
-// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
-// \param: current_time - The current simulated CPU time used to determine process eligibility
-// \param: object - A pointer to the destination where the extracted process block will be stored
-// \return: True if the extraction was successful, false otherwise
-static bool select_earliest_arrival(dyn_array_t* ready_queue, unsigned long current_time, ProcessControlBlock_t* const process)
+// Opens a file for writing through a buffer, replacing whatever was there.
+// \param: writer - the writer to set up
+// \param: path - the file to write
+// \param: block_size - bytes buffered between writes, 0 for the default
+// \return: True if the file is open and the buffer allocated, else false (and nothing is left open)
+static bool schedule_writer_init(ScheduleWriter_t* writer, const char* path, size_t block_size)
 {
-	// Mark current_time as intentionally unused for the compiler
-	(void)current_time;
-
-	// Validate input values
-	if (ready_queue == NULL || dyn_array_empty(ready_queue) || process == NULL) { return false; }
-	
-	// Find the process with the earliest arrival time
-	size_t prime_candidate_index = 0;
-	for (size_t i = 1; i < dyn_array_size(ready_queue); i++)
+	if (block_size == 0) { block_size = SCHEDULE_FILE_DEFAULT_BLOCK_SIZE; }
+	writer->buffer = malloc(block_size);
+	writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (writer->buffer == NULL || writer->fd == -1)
 	{
-		ProcessControlBlock_t* prime_candidate_process = dyn_array_at(ready_queue, prime_candidate_index);
-		ProcessControlBlock_t* candidate_process = dyn_array_at(ready_queue, i);
-		if (prime_candidate_process->arrival > candidate_process->arrival)
-		{
-			prime_candidate_index = i;
-		}
+		if (writer->fd != -1) { close(writer->fd); }
+		free(writer->buffer);
+		return false;
 	}
-
-	// Store the selected process in the memory location provided
-	dyn_array_extract(ready_queue, prime_candidate_index, process);
-
+	writer->size = 0;
+	writer->capacity = block_size;
+	writer->failed = false;
 	return true;
 }
 
-// Runs First Come First Served algorithm.
-// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
-// \param: result - Result used for stat tracking
-// \return: True if function ran successful, false otherwise
-bool first_come_first_serve(dyn_array_t* ready_queue, ScheduleResult_t* result) 
+// Writes out the buffered bytes of a writer.
+// \param: writer - the writer
+// \return: True if everything so far is in the file, false otherwise
+static bool schedule_writer_flush(ScheduleWriter_t* writer)
 {
-	return nonpreemptive_scheduler(ready_queue, result, select_earliest_arrival);
+	if (!writer->failed && writer->size > 0 && !write_file_bytes(writer->fd, writer->buffer, writer->size)) { writer->failed = true; }
+	writer->size = 0;
+	return !writer->failed;
 }
 
-// Extracts the process with the shortest burst from the queue.
-// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
-// \param: current_time - The current simulated CPU time used to determine process eligibility
-// \param: object - A pointer to the destination where the extracted process block will be stored
-// \return: True if the extraction was successful, false otherwise
-static bool select_shortest_burst(dyn_array_t* ready_queue, unsigned long current_time, ProcessControlBlock_t* target)
+// Flushes a writer and closes its file, the writer itself is left to the caller.
+// \param: writer - the writer
+// \return: True if every byte written made it to the file, false otherwise
+static bool schedule_writer_finish(ScheduleWriter_t* writer)
 {
-	// Checks invalid parameters
-	if (ready_queue == NULL || target == NULL) 
+	bool success = schedule_writer_flush(writer);
+	if (close(writer->fd) == -1) { success = false; }
+	free(writer->buffer);
+	return success;
+}
+
+ScheduleWriter_t* schedule_writer_open(const char* path, size_t block_size)
+{
+	if (path == NULL) { return NULL; }
+	ScheduleWriter_t* writer = malloc(sizeof(ScheduleWriter_t));
+	if (writer == NULL) { return NULL; }
+	if (!schedule_writer_init(writer, path, block_size))
 	{
-		 return false; 
+		free(writer);
+		return NULL;
 	}
-	// Gets number of processes
-	size_t num_processes = dyn_array_size(ready_queue); 
-	if(num_processes == 0)
+	return writer;
+}
+
+bool schedule_writer_write(ScheduleWriter_t* writer, const void* data, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	while (size > 0)
 	{
-		return false;
+		size_t count = writer->capacity - writer->size;
+		if (count > size) { count = size; }
+		memcpy(writer->buffer + writer->size, bytes, count);
+		writer->size += count;
+		bytes += count;
+		size -= count;
+		if (writer->size == writer->capacity) { schedule_writer_flush(writer); }
 	}
+	return !writer->failed;
+}
 
-	int shortest_burst_index = -1;
-	uint32_t shortest_burst = UINT32_MAX;
+bool schedule_writer_close(ScheduleWriter_t* writer)
+{
+	if (writer == NULL) { return false; }
+	bool success = schedule_writer_finish(writer);
+	free(writer);
+	return success;
+}
 
-	// Iterate through each process looking for shortest burst
-	for(size_t i = 0; i < num_processes; i++ )
+ScheduleReader_t* schedule_reader_open(const char* path, size_t block_size)
+{
+	if (path == NULL) { return NULL; }
+	if (block_size == 0) { block_size = SCHEDULE_FILE_DEFAULT_BLOCK_SIZE; }
+	ScheduleReader_t* reader = malloc(sizeof(ScheduleReader_t));
+	if (reader == NULL) { return NULL; }
+	reader->buffer = malloc(block_size);
+	reader->fd = open(path, O_RDONLY);
+	if (reader->buffer == NULL || reader->fd == -1)
 	{
-		ProcessControlBlock_t *pcb = (ProcessControlBlock_t *)dyn_array_at(ready_queue, i);
-		if(!pcb)
-		{			
-			return false;
-		}
-		// Has process arrived and the shortest burst found
-		if(pcb->arrival <= current_time && pcb->remaining_burst_time < shortest_burst)
-		{
-			shortest_burst_index = i;
-			shortest_burst = pcb->remaining_burst_time;
-		}
+		if (reader->fd != -1) { close(reader->fd); }
+		free(reader->buffer);
+		free(reader);
+		return NULL;
 	}
-	// Process has yet to arrive
-	if(shortest_burst_index == -1)
-	{
-		uint32_t next_arrival = UINT32_MAX;		
-			for(size_t i = 0; i < num_processes; i++ )
-			{
-
-			ProcessControlBlock_t *pcb = (ProcessControlBlock_t *)dyn_array_at(ready_queue, i);	
+	reader->position = 0;
+	reader->size = 0;
+	reader->capacity = block_size;
+	return reader;
+}
 
-			if(pcb->arrival > current_time && pcb->arrival < next_arrival)
-			{
-				next_arrival = pcb->arrival;
-				shortest_burst_index = i;
-			}
-		}
-	}
-	if(shortest_burst_index != -1)
+bool schedule_reader_read(ScheduleReader_t* reader, void* data, size_t size)
+{
+	uint8_t* bytes = (uint8_t*)data;
+	while (size > 0)
 	{
-		return dyn_array_extract(ready_queue, shortest_burst_index, target);
+		if (reader->position == reader->size)
+		{
+			ssize_t bytes_read = read(reader->fd, reader->buffer, reader->capacity);
+			// If the read is stopped because of an interrupt try again
+			if (bytes_read == -1 && errno == EINTR) { continue; }
+			// The end of the file (or an error) before size bytes
+			if (bytes_read <= 0) { return false; }
+			reader->position = 0;
+			reader->size = (size_t)bytes_read;
+		}
+		size_t count = reader->size - reader->position;
+		if (count > size) { count = size; }
+		memcpy(bytes, reader->buffer + reader->position, count);
+		reader->position += count;
+		bytes += count;
+		size -= count;
 	}
-	return false;
+	return true;
 }
-// Runs Shortest Job First algorithm
-// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
-// \param: result - Result used for stat tracking
-// \return: True if function ran successful, false otherwise
-bool shortest_job_first(dyn_array_t *ready_queue, ScheduleResult_t *result) 
+
+void schedule_reader_close(ScheduleReader_t* reader)
 {
-	return nonpreemptive_scheduler(ready_queue, result, select_shortest_burst);
+	if (reader == NULL) { return; }
+	close(reader->fd);
+	free(reader->buffer);
+	free(reader);
 }
 
-// Extracts the highest priority process that is in the ready queue, or the earliest future process if the CPU is idle.
-// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
-// \param: current_time - The current simulated CPU time used to determine process eligibility
-// \param: object - A pointer to the destination where the extracted process block will be stored
-// \return: True if the extraction was successful, false otherwise
-static bool select_highest_priority(dyn_array_t* ready_queue, unsigned long current_time, ProcessControlBlock_t* const process)
+void schedule_trace_record(ScheduleTrace_t* trace, uint64_t time, size_t pid, ScheduleTraceEventType_t event)
 {
-	// Validate input values
-	if (ready_queue == NULL || dyn_array_empty(ready_queue) || process == NULL) { return false; }
-	
-	// Find the process with the highest priority
-	size_t prime_candidate_index = 0;
-	for (size_t i = 1; i < dyn_array_size(ready_queue); i++)
+	ScheduleTraceEvent_t record = { time, (uint32_t)pid, (uint32_t)event };
+	schedule_writer_write(&trace->writer, &record, sizeof(record));
+}
+
+ScheduleTrace_t* schedule_trace_open(const char* path, size_t block_size)
+{
+	if (path == NULL) { return NULL; }
+	if (block_size == 0) { block_size = SCHEDULE_FILE_DEFAULT_BLOCK_SIZE; }
+	// Whole events per write
+	block_size -= block_size % sizeof(ScheduleTraceEvent_t);
+	if (block_size == 0) { block_size = sizeof(ScheduleTraceEvent_t); }
+
+	ScheduleTrace_t* trace = malloc(sizeof(ScheduleTrace_t));
+	if (trace == NULL) { return NULL; }
+	if (!schedule_writer_init(&trace->writer, path, block_size))
 	{
-		// Acquire two processes to compare
-		ProcessControlBlock_t* prime_candidate_process = dyn_array_at(ready_queue, prime_candidate_index);
-		ProcessControlBlock_t* candidate_process = dyn_array_at(ready_queue, i);
-		bool prime_candidate_arrived = prime_candidate_process->arrival <= current_time;
-		bool candidate_arrived = candidate_process->arrival <= current_time;
-		
-		// If both process have arrived determine which one has higher priority 
-		if (prime_candidate_arrived && candidate_arrived)
-		{
-			if (prime_candidate_process->priority > candidate_process->priority || 
-                (prime_candidate_process->priority == candidate_process->priority && 
-                prime_candidate_process->arrival > candidate_process->arrival))
-            {
-                prime_candidate_index = i;
-            }
-		}
-		// If neither have arrived determine which one has the earlier arrival time
-		else if (!prime_candidate_arrived && !candidate_arrived && prime_candidate_process->arrival > candidate_process->arrival)
-		{
-			prime_candidate_index = i;
-		}
-		// If only one arrived then it gets priority
-		else if (candidate_arrived)
-		{
-			prime_candidate_index = i;
-		}
+		free(trace);
+		return NULL;
 	}
 
-	// Store the selected process in the memory location provided
-	dyn_array_extract(ready_queue, prime_candidate_index, process);
+	uint32_t header[4];
+	memcpy(header, SCHEDULE_TRACE_MAGIC, 8);
+	header[2] = SCHEDULE_TRACE_VERSION;
+	header[3] = sizeof(ScheduleTraceEvent_t);
+	if (!write_file_bytes(trace->writer.fd, header, sizeof(header))) { trace->writer.failed = true; }
+	return trace;
+}
 
-	return true;
+bool schedule_trace_close(ScheduleTrace_t* trace)
+{
+	if (trace == NULL) { return false; }
+	bool success = schedule_writer_finish(&trace->writer);
+	free(trace);
+	return success;
 }
 
-// Runs the non-preemptive Priority algorithm over the incoming ready_queue.
-// \param: ready_queue - a dyn_array of type ProcessControlBlock_t that contain be up to N elements
-// \param: result - used for shortest job first stat tracking \ref ScheduleResult_t
-// \return: True if function ran successful else false for an error
-bool priority(dyn_array_t* ready_queue, ScheduleResult_t* result) 
+void schedule_trace_attach(ScheduleTrace_t* trace)
 {
-	return nonpreemptive_scheduler(ready_queue, result, select_highest_priority);
+	attached_trace = trace;
 }
 
-// Runs round robin algorithm
-// \param: ready_queue - A dyn_array_t containing items of type ProcessControlBlock_t
-// \param: result - Struct used for stat tracking
-// \param: quantum - The quantum, or time slice, allocated to a pcb in each round
-// \return: True if the function ran successfully, false otherwise
-bool round_robin(dyn_array_t *ready_queue, ScheduleResult_t* result, size_t quantum) 
+void schedule_hooks_current(ScheduleHooks_t* hooks)
 {
-	if (!ready_queue || !result || quantum == 0) {
-		return false;
-	}
+#ifdef SCHEDULE_STATS
+	hooks->stats = attached_stats;
+#else
+	hooks->stats = NULL;
+#endif
+	hooks->completion_observer = completion_observer;
+	hooks->completion_arg = completion_arg;
+	hooks->times = attached_times;
+	hooks->trace = attached_trace;
+}
 
-	dyn_array_t *rr_queue = dyn_array_create(0, sizeof(ProcessControlBlock_t), NULL);
-	if (!rr_queue) {
-		return false;
-	}
+/*
+	Latency histogram notes!
 
-	unsigned long current_time = 0;
-	unsigned long total_waiting = 0;
-	unsigned long total_turnaround = 0;
-	size_t num_processes = dyn_array_size(ready_queue);
-	if (num_processes == 0) {
-		dyn_array_destroy(rr_queue);
-		return false;
-	}
+	Times under 128 get a counter each. Past that every power of two is split into 64 equal counters, so a
+	  counter covers at most 1/64 of the values in it. 3776 counters cover every 64 bit value.
 
-	// Represents pcb at i
-	ProcessControlBlock_t *pcb = malloc(sizeof(ProcessControlBlock_t));
-	if (!pcb) {
-		dyn_array_destroy(rr_queue);
-		return false;
-	}
+	A percentile is the highest value its counter covers (capped at the largest time seen), so it is never
+	  under the exact percentile and at most 1/64 over it. Percentiles use the nearest rank definition:
+	  p is the smallest time that at least p of the processes are at or under.
+*/
+#define LATENCY_SUB_BUCKETS 128u
+#define LATENCY_HALF_BUCKETS 64u
+#define LATENCY_BUCKETS (LATENCY_SUB_BUCKETS + (64u - 7u) * LATENCY_HALF_BUCKETS)
 
-	// Represents the pcb that we execute from rr_queue
-	ProcessControlBlock_t *round = malloc(sizeof(ProcessControlBlock_t));
-	if (!round) {
-		dyn_array_destroy(rr_queue);
-		free(pcb);
-		return false;
-	}
+// Where one kind of per process time (waiting or turnaround) is collected
+typedef struct
+{
+	size_t count;
+	uint64_t max;
+	uint64_t* exact;	// Every time, NULL when using the histogram
+	uint64_t* buckets;	// LATENCY_BUCKETS counters, NULL when keeping exact times
+}
+LatencyRecorder_t;
 
-	// Tracks how many processes are still in ready_queue
-	size_t i = 0;
-	// Tracks if we executed a pcb from rr_queue
-	bool flag = false;
-	// Continue until rr_queue is empty and every pcb has arrived
-	while (!dyn_array_empty(rr_queue) || i < num_processes) {
-		// Execute the front pcb in rr_queue
-		flag = false;
-		if (!dyn_array_empty(rr_queue)) {
-			flag = true;
-			dyn_array_extract_front(rr_queue, round);
-			size_t rr_size = dyn_array_size(rr_queue);
-			// Execute this pcb for the time quantum, or until it terminates
-			for (size_t j = 0; j < quantum; j++) {
-				virtual_cpu(round);
-				current_time++;
-				// For every unit of time this pcb is executed, every other pcb
-				// in rr_queue waits that amount of time
-				total_waiting += rr_size;
-				// For every unit of time thsi pcb is executed, this pcb takes
-				// that amount of time to execute (Hence the +1) and every other pcb in rr_queue
-				// waits that amount of time
-				total_turnaround += rr_size + 1;
-				if (round->remaining_burst_time <= 0) {
-					break;
-				}
-			}
-		} // If no pcb can be executed, fast-forward time
-		else if (i < num_processes && ((ProcessControlBlock_t *)dyn_array_at(ready_queue, 0))->arrival > current_time) {
-			current_time = ((ProcessControlBlock_t *)dyn_array_at(ready_queue, 0))->arrival;
-		}
+// What schedule_extended attaches as the completion observer
+typedef struct
+{
+	LatencyRecorder_t waiting;
+	LatencyRecorder_t turnaround;
+	schedule_completion_function_t previous_observer;	// Whatever was attached before, still called
+	void* previous_arg;
+}
+LatencyObserver_t;
 
-		// Add all pcb's that are waiting to the back of rr_queue
-		while (i < num_processes && ((ProcessControlBlock_t *)dyn_array_at(ready_queue, 0))->arrival <= current_time) {
-			dyn_array_extract_front(ready_queue, pcb);
-			dyn_array_push_back(rr_queue, pcb);
-			// This pcb had to wait until after 'round' finished executing
-			total_waiting += current_time - pcb->arrival;
-			total_turnaround += current_time - pcb->arrival;
-			i++;
-		}
-		
-		// If the pcb we executed has not terminated, put it at the back of the queue
-		// Important that this happens after all pcb's that became available are loaded onto the queue
-		if (flag && round->remaining_burst_time > 0) {
-			dyn_array_push_back(rr_queue, round);
-		}
-	}
+static size_t latency_bucket(const uint64_t value)
+{
+	if (value < LATENCY_SUB_BUCKETS) { return value; }
+	unsigned shift = 63 - __builtin_clzll(value) - 6;
+	return LATENCY_SUB_BUCKETS + (shift - 1) * LATENCY_HALF_BUCKETS + ((value >> shift) - LATENCY_HALF_BUCKETS);
+}
 
-	dyn_array_destroy(rr_queue);
-	free(pcb);
-	free(round);
+// The highest value a bucket covers
+static uint64_t latency_bucket_highest(const size_t bucket)
+{
+	if (bucket < LATENCY_SUB_BUCKETS) { return bucket; }
+	unsigned shift = (bucket - LATENCY_SUB_BUCKETS) / LATENCY_HALF_BUCKETS + 1;
+	uint64_t sub_bucket = (bucket - LATENCY_SUB_BUCKETS) % LATENCY_HALF_BUCKETS + LATENCY_HALF_BUCKETS;
+	return ((sub_bucket + 1) << shift) - 1;
+}
 
-	result->average_waiting_time = (float)total_waiting / num_processes;
-	result->average_turnaround_time = (float)total_turnaround / num_processes;
-	result->total_run_time = current_time;
+// Sets up a recorder for up to capacity times.
+// \param: recorder - the recorder
+// \param: exact - true to keep every time, false for the histogram
+// \param: capacity - how many times will be recorded
+// \return: True if it was set up, false on allocation failure
+static bool latency_recorder_init(LatencyRecorder_t* recorder, const bool exact, const size_t capacity)
+{
+	memset(recorder, 0, sizeof(*recorder));
+	if (exact) { recorder->exact = malloc(sizeof(uint64_t) * (capacity ? capacity : 1)); }
+	else { recorder->buckets = calloc(LATENCY_BUCKETS, sizeof(uint64_t)); }
+	return recorder->exact != NULL || recorder->buckets != NULL;
+}
 
-	return true;
+static void latency_recorder_add(LatencyRecorder_t* recorder, const uint64_t value)
+{
+	if (recorder->exact != NULL) { recorder->exact[recorder->count] = value; }
+	else { recorder->buckets[latency_bucket(value)]++; }
+	recorder->count++;
+	if (value > recorder->max) { recorder->max = value; }
 }
 
-// Selects and extracts the process from the ready queue with the shortest remaining time.
-// \param: ready_queue - a pointer to the dynamic array containing the pool of processes
-// \param: current_time - the current simulation time used to evaluate if a process has arrived
-// \param: process - a pointer to the destination control block where the selected process data will be stored
-// \return: True if a process was successfully selected and extracted, else false on error or empty queue
-static bool select_shortest_remaining_time(dyn_array_t* ready_queue, unsigned long current_time, ProcessControlBlock_t* const process)
+static int compare_latency(const void* a, const void* b)
 {
-	// Validate input values
-	if (ready_queue == NULL || dyn_array_empty(ready_queue) || process == NULL) { return false; }
+	uint64_t value_a = *(const uint64_t*)a;
+	uint64_t value_b = *(const uint64_t*)b;
+	return (value_a > value_b) - (value_a < value_b);
+}
 
-	// Find the process with the shortest burst time remaining 
-	size_t prime_candidate_index = 0;
-	for (size_t i = 1; i < dyn_array_size(ready_queue); i++)
+// Works out the percentiles of everything recorded. Sorts the exact times.
+// \param: recorder - the recorder
+// \param: latency - where the percentiles go
+static void latency_recorder_finish(LatencyRecorder_t* recorder, ScheduleLatency_t* latency)
+{
+	static const unsigned per_mille[] = { 500, 900, 990, 999 };
+	unsigned long* percentiles[] = { &latency->p50, &latency->p90, &latency->p99, &latency->p999 };
+	memset(latency, 0, sizeof(*latency));
+	if (recorder->count == 0) { return; }
+	if (recorder->exact != NULL) { qsort(recorder->exact, recorder->count, sizeof(uint64_t), compare_latency); }
+
+	size_t bucket = 0;
+	uint64_t seen = 0;
+	for (size_t i = 0; i < sizeof(per_mille) / sizeof(per_mille[0]); i++)
 	{
-		// Acquire two processes to compare
-		ProcessControlBlock_t* prime_candidate_process = dyn_array_at(ready_queue, prime_candidate_index);
-		ProcessControlBlock_t* candidate_process = dyn_array_at(ready_queue, i);
-		bool prime_candidate_arrived = prime_candidate_process->arrival <= current_time;
-		bool candidate_arrived = candidate_process->arrival <= current_time;
-
-		// If both process have arrived determine which one has the shorter burst time remaining
-		if (prime_candidate_arrived && candidate_arrived)
-		{
-			if (prime_candidate_process->remaining_burst_time > candidate_process->remaining_burst_time || 
-                (prime_candidate_process->remaining_burst_time == candidate_process->remaining_burst_time && 
-                prime_candidate_process->arrival > candidate_process->arrival))
-            {
-                prime_candidate_index = i;
-            }
-		}
-		// If neither have arrived determine which one has the earlier arrival time
-		else if (!prime_candidate_arrived && !candidate_arrived)
-		{
-			if (prime_candidate_process->arrival > candidate_process->arrival)
-            {
-                prime_candidate_index = i;
-            }
-            else if (prime_candidate_process->arrival == candidate_process->arrival && 
-                     prime_candidate_process->remaining_burst_time > candidate_process->remaining_burst_time)
-            {
-                prime_candidate_index = i;
-            }
-		}
-		// If only one arrived then it gets priority
-		else if (candidate_arrived)
+		// Nearest rank, 1 based
+		uint64_t rank = ((uint64_t)recorder->count * per_mille[i] + 999) / 1000;
+		if (recorder->exact != NULL)
 		{
-			prime_candidate_index = i;
+			*percentiles[i] = recorder->exact[rank - 1];
+			continue;
 		}
+		// Ranks only go up, so carry on from the last bucket
+		while (seen + recorder->buckets[bucket] < rank) { seen += recorder->buckets[bucket++]; }
+		uint64_t highest = latency_bucket_highest(bucket);
+		*percentiles[i] = highest < recorder->max ? highest : recorder->max;
 	}
+	latency->max = recorder->max;
+}
 
-	// Store the selected process in the memory location provided
-	dyn_array_extract(ready_queue, prime_candidate_index, process);
+static void latency_recorder_destroy(LatencyRecorder_t* recorder)
+{
+	free(recorder->exact);
+	free(recorder->buckets);
+}
 
-	return true;
+// Completion observer for schedule_extended
+static void latency_observer(void* arg, const ProcessControlBlock_t* process, unsigned long waiting_time, unsigned long turnaround_time)
+{
+	LatencyObserver_t* observer = (LatencyObserver_t*)arg;
+	latency_recorder_add(&observer->waiting, waiting_time);
+	latency_recorder_add(&observer->turnaround, turnaround_time);
+	if (observer->previous_observer != NULL) { observer->previous_observer(observer->previous_arg, process, waiting_time, turnaround_time); }
 }
 
-// Runs the preemptive Shortest Remaining Time First Process Scheduling algorithm over the incoming ready_queue
-// \param: ready_queue - a dyn_array of type ProcessControlBlock_t that contain be up to N elements
-// \param: result - used for shortest job first stat tracking \ref ScheduleResult_t
-// \return: True if function ran successful else false for an error
-// There is no guarantee that the passed dyn_array_t will be the result of your implementation of load_process_control_blocks
-bool shortest_remaining_time_first(dyn_array_t* ready_queue, ScheduleResult_t* result) 
+// Runs a scheduler with a latency observer attached, see schedule_extended.
+// \param: ready_queue - a dyn_array of type ProcessControlBlock_t
+// \param: scheduler - the scheduler to run, NULL for round robin
+// \param: quantum - the round robin quantum
+// \param: mode - how to work out the percentiles
+// \param: result - where the results go
+// \return: True if the scheduler ran successfully, false otherwise
+static bool run_extended(dyn_array_t* ready_queue, bool (*scheduler)(dyn_array_t*, ScheduleResult_t*), const size_t quantum,
+	const ScheduleLatencyMode_t mode, ScheduleResultExtended_t* result)
 {
 	// Validate input values
 	if (ready_queue == NULL || result == NULL) { return false; }
 	size_t process_count = dyn_array_size(ready_queue);
-	if (process_count == 0) { return false; }
+	bool exact = mode == SCHEDULE_LATENCY_EXACT || (mode == SCHEDULE_LATENCY_AUTO && process_count <= SCHEDULE_EXACT_LATENCY_LIMIT);
 
-	// Create CPU variables
-	unsigned long current_time = 0;
-	unsigned long total_waiting = 0;
-	unsigned long total_turnaround = 0;
+	LatencyObserver_t observer;
+	if (!latency_recorder_init(&observer.waiting, exact, process_count)) { return false; }
+	if (!latency_recorder_init(&observer.turnaround, exact, process_count)) { latency_recorder_destroy(&observer.waiting); return false; }
+	schedule_completion_attached(&observer.previous_observer, &observer.previous_arg);
+
+	schedule_completion_attach(latency_observer, &observer);
+	bool success = scheduler != NULL ? scheduler(ready_queue, &result->result) : round_robin(ready_queue, &result->result, quantum);
+	schedule_completion_attach(observer.previous_observer, observer.previous_arg);
 
-	// Loop until the ready queue has been emptied
-	while (!dyn_array_empty(ready_queue))
+	if (success)
 	{
-		// Acquire the process with the shortest burst time remaining
-		ProcessControlBlock_t target_process;
-		if (!select_shortest_remaining_time(ready_queue, current_time, &target_process)) { return false; }
+		latency_recorder_finish(&observer.waiting, &result->waiting);
+		latency_recorder_finish(&observer.turnaround, &result->turnaround);
+		result->exact = exact;
+	}
+	latency_recorder_destroy(&observer.waiting);
+	latency_recorder_destroy(&observer.turnaround);
+	return success;
+}
+
+bool schedule_extended(dyn_array_t* ready_queue, bool (*scheduler)(dyn_array_t*, ScheduleResult_t*), ScheduleLatencyMode_t mode,
+	ScheduleResultExtended_t* result)
+{
+	if (scheduler == NULL) { return false; }
+	return run_extended(ready_queue, scheduler, 0, mode, result);
+}
+
+bool round_robin_extended(dyn_array_t* ready_queue, size_t quantum, ScheduleLatencyMode_t mode, ScheduleResultExtended_t* result)
+{
+	return run_extended(ready_queue, NULL, quantum, mode, result);
+}
 
-		// If the process has not been run on the CPU before then skip to the arrival time if needed and mark it as started
-		if (!target_process.started)
+// Parallel runs group busy periods into segments of at least this many processes
+#define PARALLEL_MIN_SEGMENT_PCB_COUNT 4096u
+
+// and aim for this many segments per pool thread, so uneven segments balance out
+#define PARALLEL_SEGMENTS_PER_THREAD 4u
+
+// A run of whole busy periods, simulated on its own by a parallel run
+typedef struct
+{
+	size_t begin;						// Its processes are [begin, end) of ParallelSchedule_t::pcbs
+	size_t end;
+	unsigned long total_waiting;
+	unsigned long total_turnaround;
+	unsigned long run_time;
+	bool success;
+}
+ScheduleSegment_t;
+
+// What the segments of a parallel run share
+typedef struct
+{
+	const ProcessControlBlock_t* pcbs;	// Grouped by segment, in ready queue order within each one
+	bool (*scheduler)(dyn_array_t*, ScheduleResult_t*);
+	size_t quantum;
+	ScheduleSegment_t* segments;
+}
+ParallelSchedule_t;
+
+// Completion observer for a segment, adds up its times
+static void segment_observer(void* arg, const ProcessControlBlock_t* process, unsigned long waiting_time, unsigned long turnaround_time)
+{
+	(void)process;
+	ScheduleSegment_t* segment = (ScheduleSegment_t*)arg;
+	segment->total_waiting += waiting_time;
+	segment->total_turnaround += turnaround_time;
+}
+
+// Simulates one segment, with only its own observer attached on this thread while it runs.
+// \param: arg - the ParallelSchedule_t
+// \param: index - the segment
+static void run_segment(void* arg, size_t index)
+{
+	ParallelSchedule_t* schedule = (ParallelSchedule_t*)arg;
+	ScheduleSegment_t* segment = &schedule->segments[index];
+
+	// The pool runs segments on the calling thread too, and whatever it has attached isn't meant for them
+	ScheduleHooks_t hooks;
+	schedule_hooks_current(&hooks);
+	schedule_stats_attach(NULL);
+	schedule_times_attach(NULL);
+	schedule_trace_attach(NULL);
+	schedule_completion_attach(segment_observer, segment);
+
+	dyn_array_t* queue = dyn_array_import(schedule->pcbs + segment->begin, segment->end - segment->begin, sizeof(ProcessControlBlock_t), NULL);
+	ScheduleResult_t result;
+	segment->success = queue != NULL &&
+		(schedule->scheduler != NULL ? schedule->scheduler(queue, &result) : round_robin(queue, &result, schedule->quantum));
+	if (segment->success) { segment->run_time = result.total_run_time; }
+	dyn_array_destroy(queue);
+
+	schedule_stats_attach(hooks.stats);
+	schedule_times_attach(hooks.times);
+	schedule_trace_attach(hooks.trace);
+	schedule_completion_attach(hooks.completion_observer, hooks.completion_arg);
+}
+
+// Orders packed (arrival, burst) keys
+static int compare_admission_key(const void* a, const void* b)
+{
+	uint64_t key_a = *(const uint64_t*)a;
+	uint64_t key_b = *(const uint64_t*)b;
+	return (key_a > key_b) - (key_a < key_b);
+}
+
+// Runs a scheduler over the busy periods of the ready queue in parallel, see schedule_parallel.
+// \param: ready_queue - a dyn_array of type ProcessControlBlock_t
+// \param: scheduler - the scheduler to run, NULL for round robin
+// \param: quantum - the round robin quantum
+// \param: result - where the results go
+// \return: True if every segment ran successfully, false otherwise
+static bool run_parallel(dyn_array_t* ready_queue, bool (*scheduler)(dyn_array_t*, ScheduleResult_t*), const size_t quantum,
+	ScheduleResult_t* result)
+{
+	// Validate input values
+	if (ready_queue == NULL || result == NULL || (scheduler == NULL && quantum == 0)) { return false; }
+	if (dyn_array_data_size(ready_queue) != sizeof(ProcessControlBlock_t)) { return false; }
+	const size_t process_count = dyn_array_size(ready_queue);
+	if (process_count == 0) { return false; }
+	const ProcessControlBlock_t* pcbs = dyn_array_export(ready_queue);
+
+	// Round robin admits in queue order, the others by arrival. Most traces are already in arrival order,
+	// only sort (packed arrival and burst, which is all the busy periods depend on) when they are not
+	bool sorted = true;
+	for (size_t i = 1; scheduler != NULL && i < process_count && sorted; i++) { sorted = pcbs[i - 1].arrival <= pcbs[i].arrival; }
+	dyn_array_t* keys = NULL;
+	if (!sorted)
+	{
+		keys = dyn_array_create(process_count, sizeof(uint64_t), NULL);
+		for (size_t i = 0; keys != NULL && i < process_count; i++)
 		{
-			if (current_time < target_process.arrival) { current_time = target_process.arrival; }
-			else { total_waiting += current_time - target_process.arrival; }
-			target_process.started = true;
+			uint64_t key = (uint64_t)pcbs[i].arrival << 32 | pcbs[i].remaining_burst_time;
+			dyn_array_push_back(keys, &key);
 		}
-		
-		// Run the process on the CPU
-		virtual_cpu(&target_process);
+		if (keys == NULL || !dyn_array_parallel_sort(keys, compare_admission_key)) { dyn_array_destroy(keys); return false; }
+	}
+	const uint64_t* sorted_keys = keys != NULL ? dyn_array_export(keys) : NULL;
+
+	// One pass in admission order finds the busy periods. A segment ends at the first idle gap past its target size
+	size_t target = process_count / (thread_pool_thread_count() * PARALLEL_SEGMENTS_PER_THREAD);
+	if (target < PARALLEL_MIN_SEGMENT_PCB_COUNT) { target = PARALLEL_MIN_SEGMENT_PCB_COUNT; }
+	size_t* firsts = malloc(sizeof(size_t) * (process_count / target + 1));
+	size_t segment_count = 0;
+	unsigned long busy_until = 0;
+	uint32_t admitted = 0;
+	for (size_t i = 0; firsts != NULL && i < process_count; i++)
+	{
+		// In round robin a process that hasn't arrived holds up the ones behind it
+		uint32_t arrival = sorted_keys != NULL ? (uint32_t)(sorted_keys[i] >> 32) : pcbs[i].arrival;
+		uint32_t burst = sorted_keys != NULL ? (uint32_t)sorted_keys[i] : pcbs[i].remaining_burst_time;
+		if (arrival < admitted) { arrival = admitted; }
+		admitted = arrival;
+		if (i == 0 || (arrival > busy_until && i - firsts[segment_count - 1] >= target)) { firsts[segment_count++] = i; }
+		busy_until = (arrival > busy_until ? arrival : busy_until) + burst;
+	}
 
-		// For all preempted processes in the ready queue increment the total wait time by one
-		for (size_t i = 0; i < dyn_array_size(ready_queue); i++)
+	ParallelSchedule_t schedule = { pcbs, scheduler, quantum, calloc(segment_count, sizeof(ScheduleSegment_t)) };
+	ProcessControlBlock_t* grouped = NULL;
+	bool success = firsts != NULL && schedule.segments != NULL;
+	if (success && sorted_keys == NULL)
+	{
+		// Segments are already contiguous in the ready queue
+		for (size_t segment = 0; segment < segment_count; segment++)
 		{
-			ProcessControlBlock_t* process = dyn_array_at(ready_queue, i);
-			if (process->started) { total_waiting++; }
+			schedule.segments[segment].begin = firsts[segment];
+			schedule.segments[segment].end = segment + 1 < segment_count ? firsts[segment + 1] : process_count;
 		}
+	}
+	else if (success)
+	{
+		// A process belongs to the last segment that starts at or before its arrival (segments start at strictly
+		// increasing arrivals). Count each segment's processes, then copy them out in queue order
+		uint32_t* starts = malloc(sizeof(uint32_t) * segment_count);
+		grouped = malloc(sizeof(ProcessControlBlock_t) * process_count);
+		success = starts != NULL && grouped != NULL;
+		for (size_t segment = 0; success && segment < segment_count; segment++) { starts[segment] = (uint32_t)(sorted_keys[firsts[segment]] >> 32); }
+		for (int pass = 0; success && pass < 2; pass++)
+		{
+			for (size_t i = 0; i < process_count; i++)
+			{
+				size_t low = 0, high = segment_count - 1;
+				while (low < high)
+				{
+					size_t middle = (low + high + 1) / 2;
+					if (starts[middle] <= pcbs[i].arrival) { low = middle; }
+					else { high = middle - 1; }
+				}
+				if (pass == 0) { schedule.segments[low].end++; }
+				else { grouped[schedule.segments[low].end++] = pcbs[i]; }
+			}
+			// After counting, each segment starts where the one before it ends (and end counts up again from there)
+			for (size_t segment = 0, begin = 0; pass == 0 && segment < segment_count; segment++)
+			{
+				size_t count = schedule.segments[segment].end;
+				schedule.segments[segment].begin = schedule.segments[segment].end = begin;
+				begin += count;
+			}
+		}
+		free(starts);
+		schedule.pcbs = grouped;
+	}
+	dyn_array_destroy(keys);
+	free(firsts);
 
-		// Increment the CPU clock
-		current_time++;
+	success = success && thread_pool_parallel_for(segment_count, run_segment, &schedule);
 
-		// Push the process back to the ready queue if it has not fnished
-		if (target_process.remaining_burst_time > 0) { dyn_array_push_back(ready_queue, &target_process); }
-		else { total_turnaround += current_time - target_process.arrival; }
+	// Add the segments back up, the last one to finish is the end of the run
+	unsigned long total_waiting = 0;
+	unsigned long total_turnaround = 0;
+	unsigned long run_time = 0;
+	for (size_t segment = 0; success && segment < segment_count; segment++)
+	{
+		success = schedule.segments[segment].success;
+		total_waiting += schedule.segments[segment].total_waiting;
+		total_turnaround += schedule.segments[segment].total_turnaround;
+		if (schedule.segments[segment].run_time > run_time) { run_time = schedule.segments[segment].run_time; }
 	}
+	free(schedule.segments);
+	free(grouped);
+	if (!success) { return false; }
 
-	// Set the result values
 	result->average_waiting_time = (float)total_waiting / process_count;
 	result->average_turnaround_time = (float)total_turnaround / process_count;
-	result->total_run_time = current_time;
-
+	result->total_run_time = run_time;
 	return true;
 }
 
+bool schedule_parallel(dyn_array_t* ready_queue, bool (*scheduler)(dyn_array_t*, ScheduleResult_t*), ScheduleResult_t* result)
+{
+	if (scheduler == NULL) { return false; }
+	return run_parallel(ready_queue, scheduler, 0, result);
+}
+
+bool round_robin_parallel(dyn_array_t* ready_queue, size_t quantum, ScheduleResult_t* result)
+{
+	return run_parallel(ready_queue, NULL, quantum, result);
+}
+
 // Reads a specified number of bytes from an open file descriptor into a destination buffer.
 // \param: fd - the open file descriptor to read from
 // \param: buffer - a pointer to the destination buffer where the data will be stored
@@ -497,30 +729,34 @@ dyn_array_t* load_process_control_blocks(const char* input_file)
 	if (read_file_bytes(fd, &control_block_count, sizeof(uint32_t)) && control_block_count > 0) // Read first 4 bytes for control block count
 	{
 		// Allocate a storage array for the control blocks and read them into it
-		control_blocks = dyn_array_create(control_block_count, sizeof(ProcessControlBlock_t), NULL);
+		// Huge traces go in a mapped array so they never get copied around in memory
+		if (control_block_count >= LARGE_TRACE_PCB_COUNT)
+		{
+			control_blocks = dyn_array_create_mapped(control_block_count, sizeof(ProcessControlBlock_t), NULL, DYN_MAP_HUGEPAGES);
+		}
+		else
+		{
+			control_blocks = dyn_array_create(control_block_count, sizeof(ProcessControlBlock_t), NULL);
+		}
 		if (control_blocks != NULL)
 		{
-			for (uint32_t i = 0; i < control_block_count; i++)
+			// Read the records a chunk at a time rather than a field at a time, small files take one read
+			uint32_t fields[LOAD_CHUNK_PCB_COUNT * 3];
+			for (uint32_t loaded = 0; loaded < control_block_count;)
 			{
-				// Allocate a control block struct to store the incoming data
-				ProcessControlBlock_t* block = malloc(sizeof(ProcessControlBlock_t));
-				if (block != NULL &&
-					read_file_bytes(fd, &(block->remaining_burst_time), sizeof(uint32_t)) &&
-					read_file_bytes(fd, &(block->priority), sizeof(uint32_t)) &&
-					read_file_bytes(fd, &(block->arrival), sizeof(uint32_t))
-					)
-				{
-					block->started = false;
-					dyn_array_push_back(control_blocks, block);
-					free(block);
-				}
-				else
+				uint32_t chunk = control_block_count - loaded < LOAD_CHUNK_PCB_COUNT ? control_block_count - loaded : LOAD_CHUNK_PCB_COUNT;
+				if (!read_file_bytes(fd, fields, chunk * 3 * sizeof(uint32_t)))
 				{
 					dyn_array_destroy(control_blocks);
-					free(block);
 					control_blocks = NULL;
 					break;
 				}
+				for (uint32_t i = 0; i < chunk; i++)
+				{
+					ProcessControlBlock_t block = { fields[i * 3], fields[i * 3 + 1], fields[i * 3 + 2], false };
+					dyn_array_push_back(control_blocks, &block);
+				}
+				loaded += chunk;
 			}
 		}
 	}
@@ -531,3 +767,43 @@ dyn_array_t* load_process_control_blocks(const char* input_file)
 	// Return the control blocks
 	return control_blocks;
 }
+
+// Reads back a trace written by a schedule_trace_open trace
+// \param: input_file - the trace file
+// \return: A dyn_array of ScheduleTraceEvent_t if function ran successful else NULL for an error
+dyn_array_t* load_schedule_trace(const char* input_file)
+{
+	if (input_file == NULL) { return NULL; }
+	int fd = open(input_file, O_RDONLY);
+	if (fd == -1) { return NULL; }
+
+	// The file has to be a header and a whole number of events
+	uint32_t header[4];
+	struct stat file_stat;
+	dyn_array_t* events = NULL;
+	if (fstat(fd, &file_stat) == 0 && (size_t)file_stat.st_size >= sizeof(header)
+		&& ((size_t)file_stat.st_size - sizeof(header)) % sizeof(ScheduleTraceEvent_t) == 0
+		&& read_file_bytes(fd, header, sizeof(header)) && memcmp(header, SCHEDULE_TRACE_MAGIC, 8) == 0
+		&& header[2] == SCHEDULE_TRACE_VERSION && header[3] == sizeof(ScheduleTraceEvent_t))
+	{
+		size_t event_count = ((size_t)file_stat.st_size - sizeof(header)) / sizeof(ScheduleTraceEvent_t);
+		events = dyn_array_create(event_count, sizeof(ScheduleTraceEvent_t), NULL);
+
+		// Read the events a chunk at a time
+		ScheduleTraceEvent_t chunk[LOAD_CHUNK_PCB_COUNT];
+		for (size_t loaded = 0; events != NULL && loaded < event_count;)
+		{
+			size_t count = event_count - loaded < LOAD_CHUNK_PCB_COUNT ? event_count - loaded : LOAD_CHUNK_PCB_COUNT;
+			if (!read_file_bytes(fd, chunk, count * sizeof(ScheduleTraceEvent_t)))
+			{
+				dyn_array_destroy(events);
+				events = NULL;
+				break;
+			}
+			for (size_t i = 0; i < count; i++) { dyn_array_push_back(events, &chunk[i]); }
+			loaded += count;
+		}
+	}
+	close(fd);
+	return events;
+}
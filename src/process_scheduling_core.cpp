@@ -0,0 +1,1164 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "dyn_array.hpp"
+#include "process_scheduling_core.h"
+#include "processing_scheduling.h"
+
+/*
+	Template scheduler notes!
+
+	A scheduler is a loop over a heap of arrived processes, and the only thing that changes between
+	  policies is the order of that heap. Here the order is a template parameter (a struct with a static
+	  before(a, b)), so each policy compiles to its own loop with the comparison inlined into the heap.
+	  The C version went through a function pointer and dyn_array_at for every comparison.
+
+	To add a policy, write an order and an extern "C" function that runs run_nonpreemptive with it.
+	  Orders must be total (break every tie with the queue position), so results never depend on how
+	  the heap happens to be laid out.
+
+	Allocation failures throw std::bad_alloc inside, the extern "C" functions turn them into false.
+*/
+
+// Adds amount to one of the attached counters, compiled out unless counting is
+#ifdef SCHEDULE_STATS
+#define SCHEDULE_STAT(stats, counter, amount) do { if ((stats) != nullptr) { (stats)->counter += (amount); } } while (0)
+#else
+#define SCHEDULE_STAT(stats, counter, amount) ((void)(stats))
+#endif
+
+namespace
+{
+	// A process waiting to be scheduled, along with what the schedulers need to know about it
+	struct QueuedProcess
+	{
+		ProcessControlBlock_t pcb;	// remaining_burst_time counts down as it runs
+		size_t order;				// Position in the incoming ready queue, breaks every tie the same way
+		uint32_t burst;				// The burst time it arrived with
+	};
+
+	// Which policy a checkpoint holds, see the checkpoint notes in processing_scheduling.h
+	enum CheckpointPolicy : uint32_t
+	{
+		CHECKPOINT_FCFS,
+		CHECKPOINT_SJF,
+		CHECKPOINT_PRIORITY,
+		CHECKPOINT_ROUND_ROBIN,
+		CHECKPOINT_SRTF
+	};
+
+	// Writes checkpoint fields in native byte order. A failed write sticks, check ok() once at the end
+	class CheckpointWriter
+	{
+	public:
+		explicit CheckpointWriter(ScheduleWriter_t *const file) noexcept : file_(file), ok_(true) {}
+
+		bool ok() const noexcept { return ok_; }
+
+		void bytes(const void *const data, const std::size_t size) noexcept { ok_ = schedule_writer_write(file_, data, size) && ok_; }
+		void u32(const uint32_t value) noexcept { bytes(&value, sizeof(value)); }
+		void u64(const uint64_t value) noexcept { bytes(&value, sizeof(value)); }
+
+		void process(const QueuedProcess &queued) noexcept
+		{
+			u32(queued.pcb.remaining_burst_time);
+			u32(queued.pcb.priority);
+			u32(queued.pcb.arrival);
+			u32(queued.burst);
+			u32(queued.pcb.started);
+			u64(queued.order);
+		}
+
+	private:
+		ScheduleWriter_t *const file_;
+		bool ok_;
+	};
+
+	// Reads what CheckpointWriter wrote. Anything read after a failure is 0, check ok() once at the end
+	class CheckpointReader
+	{
+	public:
+		explicit CheckpointReader(ScheduleReader_t *const file) noexcept : file_(file), ok_(true) {}
+
+		bool ok() const noexcept { return ok_; }
+		void fail() noexcept { ok_ = false; }
+
+		// True if the whole file has been read
+		bool at_end() noexcept
+		{
+			uint8_t extra;
+			return !schedule_reader_read(file_, &extra, sizeof(extra));
+		}
+
+		void bytes(void *const data, const std::size_t size) noexcept
+		{
+			if (ok_ && !schedule_reader_read(file_, data, size)) { ok_ = false; }
+			if (!ok_) { std::memset(data, 0, size); }
+		}
+
+		uint32_t u32() noexcept
+		{
+			uint32_t value;
+			bytes(&value, sizeof(value));
+			return value;
+		}
+
+		uint64_t u64() noexcept
+		{
+			uint64_t value;
+			bytes(&value, sizeof(value));
+			return value;
+		}
+
+		QueuedProcess process() noexcept
+		{
+			QueuedProcess queued = QueuedProcess();
+			queued.pcb.remaining_burst_time = u32();
+			queued.pcb.priority = u32();
+			queued.pcb.arrival = u32();
+			queued.burst = u32();
+			queued.pcb.started = u32() != 0;
+			queued.order = u64();
+			return queued;
+		}
+
+	private:
+		ScheduleReader_t *const file_;
+		bool ok_;
+	};
+
+	// Earliest arrival, then position in the incoming ready queue
+	struct EarliestArrival
+	{
+		static constexpr CheckpointPolicy policy = CHECKPOINT_FCFS;
+
+		static bool before(const QueuedProcess &a, const QueuedProcess &b) noexcept
+		{
+			if (a.pcb.arrival != b.pcb.arrival) { return a.pcb.arrival < b.pcb.arrival; }
+			return a.order < b.order;
+		}
+	};
+
+	// Shortest burst, then position in the incoming ready queue
+	struct ShortestBurst
+	{
+		static constexpr CheckpointPolicy policy = CHECKPOINT_SJF;
+
+		static bool before(const QueuedProcess &a, const QueuedProcess &b) noexcept
+		{
+			if (a.pcb.remaining_burst_time != b.pcb.remaining_burst_time) { return a.pcb.remaining_burst_time < b.pcb.remaining_burst_time; }
+			return a.order < b.order;
+		}
+	};
+
+	// Highest priority (lowest value), then earliest arrival
+	struct HighestPriority
+	{
+		static constexpr CheckpointPolicy policy = CHECKPOINT_PRIORITY;
+
+		static bool before(const QueuedProcess &a, const QueuedProcess &b) noexcept
+		{
+			if (a.pcb.priority != b.pcb.priority) { return a.pcb.priority < b.pcb.priority; }
+			return EarliestArrival::before(a, b);
+		}
+	};
+
+	// Shortest remaining time, then earliest arrival
+	struct ShortestRemainingTime
+	{
+		static bool before(const QueuedProcess &a, const QueuedProcess &b) noexcept
+		{
+			if (a.pcb.remaining_burst_time != b.pcb.remaining_burst_time) { return a.pcb.remaining_burst_time < b.pcb.remaining_burst_time; }
+			return EarliestArrival::before(a, b);
+		}
+	};
+
+	// Processes that have not been admitted yet, in the order they get admitted
+	// Admitted ones are dropped from the front once they are most of the array, so a simulation that keeps
+	// getting more appended only holds on to what it still needs
+	class PendingQueue
+	{
+	public:
+		explicit PendingQueue(hw2::dyn_array<QueuedProcess> &&processes) noexcept : processes_(std::move(processes)), next_(0) {}
+		PendingQueue(PendingQueue &&other) noexcept = default;
+		// A copy only takes what is still pending
+		PendingQueue(const PendingQueue &other) : processes_(other.processes_.data() + other.next_, other.processes_.size() - other.next_), next_(0) {}
+
+		bool empty() const noexcept { return next_ == processes_.size(); }
+		const QueuedProcess &front() const noexcept { return processes_[next_]; }
+		QueuedProcess pop() noexcept { return processes_[next_++]; }
+
+		void push(const QueuedProcess &process)
+		{
+			if (next_ >= PENDING_COMPACT_MIN && next_ * 2 >= processes_.size())
+			{
+				hw2::dyn_array<QueuedProcess> rest(processes_.data() + next_, processes_.size() - next_);
+				processes_.swap(rest);
+				next_ = 0;
+			}
+			processes_.push_back(process);
+		}
+
+		// Count, then what is still pending in order
+		void save(CheckpointWriter &out) const noexcept
+		{
+			out.u64(processes_.size() - next_);
+			for (std::size_t i = next_; i < processes_.size(); i++) { out.process(processes_[i]); }
+		}
+
+		void load(CheckpointReader &in)
+		{
+			for (uint64_t count = in.u64(); count > 0 && in.ok(); count--) { push(in.process()); }
+		}
+
+	private:
+		static constexpr std::size_t PENDING_COMPACT_MIN = 1024;
+
+		hw2::dyn_array<QueuedProcess> processes_;
+		std::size_t next_;
+	};
+
+	// Processes waiting for a round robin slice. A ring, so taking from the front and adding to the back are both O(1)
+	class ProcessRing
+	{
+	public:
+		ProcessRing() : head_(0), count_(0) { grow(); }
+
+		bool empty() const noexcept { return count_ == 0; }
+		std::size_t size() const noexcept { return count_; }
+
+		void push_back(const QueuedProcess &process)
+		{
+			if (count_ == slots_.size()) { grow(); }
+			std::size_t tail = head_ + count_;
+			if (tail >= slots_.size()) { tail -= slots_.size(); }
+			slots_[tail] = process;
+			count_++;
+		}
+
+		QueuedProcess pop_front() noexcept
+		{
+			const QueuedProcess process = slots_[head_];
+			if (++head_ == slots_.size()) { head_ = 0; }
+			count_--;
+			return process;
+		}
+
+		// Count, then front to back
+		void save(CheckpointWriter &out) const noexcept
+		{
+			out.u64(count_);
+			for (std::size_t i = 0; i < count_; i++) { out.process(slots_[(head_ + i) % slots_.size()]); }
+		}
+
+		void load(CheckpointReader &in)
+		{
+			for (uint64_t count = in.u64(); count > 0 && in.ok(); count--) { push_back(in.process()); }
+		}
+
+	private:
+		// Unrolls the ring, front first, into twice the room
+		void grow()
+		{
+			hw2::dyn_array<QueuedProcess> slots(slots_.size() ? slots_.size() * 2 : 64);
+			for (std::size_t i = 0; i < count_; i++) { slots.push_back(slots_[(head_ + i) % slots_.size()]); }
+			while (slots.size() < slots.capacity()) { slots.push_back(QueuedProcess()); }
+			slots_.swap(slots);
+			head_ = 0;
+		}
+
+		hw2::dyn_array<QueuedProcess> slots_;
+		std::size_t head_;
+		std::size_t count_;
+	};
+
+	// A binary min-heap of processes under Order
+	template <typename Order>
+	class ProcessHeap
+	{
+	public:
+		explicit ProcessHeap(ScheduleStats_t *const counters) noexcept : stats_(counters) {}
+
+		bool empty() const noexcept { return heap_.empty(); }
+
+		void push(const QueuedProcess &process)
+		{
+			heap_.push_back(process);
+			SCHEDULE_STAT(stats_, bytes_copied, sizeof(QueuedProcess));
+
+			// Move parents down into the hole until the new process fits
+			std::size_t hole = heap_.size() - 1;
+			while (hole > 0)
+			{
+				const std::size_t parent = (hole - 1) / 2;
+				if (!before(process, heap_[parent])) { break; }
+				heap_[hole] = heap_[parent];
+				SCHEDULE_STAT(stats_, bytes_moved, sizeof(QueuedProcess));
+				hole = parent;
+			}
+			heap_[hole] = process;
+		}
+
+		QueuedProcess pop() noexcept
+		{
+			const QueuedProcess lowest = heap_.front();
+			const QueuedProcess last = heap_.back();
+			heap_.pop_back();
+			SCHEDULE_STAT(stats_, bytes_copied, sizeof(QueuedProcess));
+
+			// Move the lower child up into the hole until the last process fits
+			const std::size_t size = heap_.size();
+			std::size_t hole = 0;
+			if (size > 0)
+			{
+				for (std::size_t child = 1; child < size; child = 2 * hole + 1)
+				{
+					if (child + 1 < size && before(heap_[child + 1], heap_[child])) { child++; }
+					if (!before(heap_[child], last)) { break; }
+					heap_[hole] = heap_[child];
+					SCHEDULE_STAT(stats_, bytes_moved, sizeof(QueuedProcess));
+					hole = child;
+				}
+				heap_[hole] = last;
+			}
+			return lowest;
+		}
+
+		// Count, then the heap array as it is (pushing it back in that order rebuilds the same array)
+		void save(CheckpointWriter &out) const noexcept
+		{
+			out.u64(heap_.size());
+			for (const QueuedProcess &process : heap_) { out.process(process); }
+		}
+
+		void load(CheckpointReader &in)
+		{
+			for (uint64_t count = in.u64(); count > 0 && in.ok(); count--) { push(in.process()); }
+		}
+
+	private:
+		bool before(const QueuedProcess &a, const QueuedProcess &b) const noexcept
+		{
+			SCHEDULE_STAT(stats_, comparisons, 1);
+			return Order::before(a, b);
+		}
+
+		hw2::dyn_array<QueuedProcess> heap_;
+		ScheduleStats_t *const stats_;
+	};
+
+	// The attached hooks, read once per run
+	class Hooks
+	{
+	public:
+		Hooks() noexcept { schedule_hooks_current(&hooks_); }
+		explicit Hooks(const ScheduleHooks_t &hooks) noexcept : hooks_(hooks) {}
+
+		ScheduleStats_t *stats() const noexcept { return hooks_.stats; }
+
+		void trace(const unsigned long time, const std::size_t pid, const ScheduleTraceEventType_t event) const noexcept
+		{
+			if (hooks_.trace != nullptr) { schedule_trace_record(hooks_.trace, time, pid, event); }
+		}
+
+		void started(const QueuedProcess &process, const unsigned long time) const noexcept
+		{
+			if (hooks_.times == nullptr) { return; }
+			if (hooks_.times->start != nullptr) { hooks_.times->start[process.order] = time; }
+			if (hooks_.times->response != nullptr) { hooks_.times->response[process.order] = time - process.pcb.arrival; }
+		}
+
+		// process has to have its whole burst back in remaining_burst_time
+		void completed(const QueuedProcess &process, const unsigned long time, const unsigned long waiting, const unsigned long turnaround) const
+		{
+			if (hooks_.times != nullptr)
+			{
+				if (hooks_.times->completion != nullptr) { hooks_.times->completion[process.order] = time; }
+				if (hooks_.times->waiting != nullptr) { hooks_.times->waiting[process.order] = waiting; }
+			}
+			trace(time, process.order, SCHEDULE_TRACE_COMPLETE);
+			if (hooks_.completion_observer != nullptr) { hooks_.completion_observer(hooks_.completion_arg, &process.pcb, waiting, turnaround); }
+		}
+
+	private:
+		ScheduleHooks_t hooks_;
+	};
+
+	// Copies the incoming ready queue into queued processes, sorted by arrival unless by_arrival is false.
+	// The ready queue is left untouched
+	PendingQueue create_pending_queue(const dyn_array_t *const ready_queue, ScheduleStats_t *const stats, const bool by_arrival)
+	{
+		const std::size_t process_count = dyn_array_size(ready_queue);
+		const ProcessControlBlock_t *const blocks = static_cast<const ProcessControlBlock_t *>(dyn_array_export(ready_queue));
+		hw2::dyn_array<QueuedProcess> pending(process_count);
+
+		// Most traces are already in arrival order, only pay for the sort when they are not
+		bool sorted = true;
+		for (std::size_t i = 0; i < process_count; i++)
+		{
+			pending.push_back(QueuedProcess { blocks[i], i, blocks[i].remaining_burst_time });
+			if (i > 0 && blocks[i - 1].arrival > blocks[i].arrival) { sorted = false; }
+		}
+		if (by_arrival && !sorted)
+		{
+			std::sort(pending.begin(), pending.end(), [stats](const QueuedProcess &a, const QueuedProcess &b) {
+				SCHEDULE_STAT(stats, comparisons, 1);
+				return EarliestArrival::before(a, b);
+			});
+		}
+		return PendingQueue(std::move(pending));
+	}
+
+	// Pass to advance to run until every process has finished
+	constexpr unsigned long END_OF_TIME = std::numeric_limits<unsigned long>::max();
+
+	// Pass to advance to make as many decisions as it takes
+	constexpr std::size_t UNLIMITED_DECISIONS = std::numeric_limits<std::size_t>::max();
+
+	// Where a run is up to, everything that has finished is in the totals
+	struct Progress
+	{
+		unsigned long current_time;
+		unsigned long total_waiting;
+		unsigned long total_turnaround;
+		std::size_t completed;
+		bool cpu_busy;		// Something has been running up to current_time
+	};
+
+	// Fills in a result from the totals of a run that has finished
+	void set_result(const Progress &progress, ScheduleResult_t *const result) noexcept
+	{
+		result->average_waiting_time = (float)progress.total_waiting / progress.completed;
+		result->average_turnaround_time = (float)progress.total_turnaround / progress.completed;
+		result->total_run_time = progress.current_time;
+	}
+
+	void save_progress(CheckpointWriter &out, const Progress &progress) noexcept
+	{
+		out.u64(progress.current_time);
+		out.u64(progress.total_waiting);
+		out.u64(progress.total_turnaround);
+		out.u64(progress.completed);
+		out.u64(progress.cpu_busy);
+	}
+
+	Progress load_progress(CheckpointReader &in) noexcept
+	{
+		Progress progress;
+		progress.current_time = in.u64();
+		progress.total_waiting = in.u64();
+		progress.total_turnaround = in.u64();
+		progress.completed = in.u64();
+		progress.cpu_busy = in.u64() != 0;
+		return progress;
+	}
+
+	/*
+		A run is a policy's whole simulation state: the clock, the totals, the processes still pending and the
+		  ready structure. advance(limit, budget) carries on from wherever it stopped and makes every decision
+		  that falls before limit, so the same loop runs a whole ready queue in one go (limit END_OF_TIME) or a
+		  simulation handle a piece at a time as processes get appended. It returns how many decisions it
+		  made, and stops early after budget of them, so a long run can be checkpointed every so often.
+
+		save writes all of that state to a checkpoint, load reads it back into a run made with the same
+		  policy (and nothing appended). Between decisions is the only place a run ever stops, so any
+		  stopping point makes a valid checkpoint.
+
+		Nothing that gets appended can arrive before the last arrival so far, so a decision made strictly
+		  before that time is final. A run never picks a process (or, in round robin, puts one back in line)
+		  at or past limit, because something appended later could still change it.
+	*/
+
+	// Simulates a non-preemptive CPU scheduler by executing processes from the ready queue to completion.
+	// Arrived processes wait in a heap ordered by Order. If nothing has arrived when the CPU goes idle,
+	// the next process to arrive (earliest arrival, then queue position) runs as soon as it does.
+	template <typename Order>
+	class NonpreemptiveRun
+	{
+	public:
+		static constexpr bool by_arrival = true;
+		static constexpr CheckpointPolicy policy = Order::policy;
+
+		NonpreemptiveRun(PendingQueue &&pending, const Hooks &hooks) : hooks_(hooks), pending_(std::move(pending)), arrived_(hooks.stats()), progress_() {}
+
+		void append(const QueuedProcess &process) { pending_.push(process); }
+
+		std::size_t advance(const unsigned long limit, const std::size_t budget)
+		{
+			ScheduleStats_t *const stats = hooks_.stats();
+			Progress progress = progress_;
+			std::size_t decisions = 0;
+			while (true)
+			{
+				// Queue up everything that has arrived by now
+				while (!pending_.empty() && pending_.front().pcb.arrival <= progress.current_time)
+				{
+					arrived_.push(pending_.pop());
+				}
+				if (arrived_.empty() && (pending_.empty() || pending_.front().pcb.arrival >= limit)) { break; }
+				if (!arrived_.empty() && progress.current_time >= limit) { break; }
+				if (decisions == budget) { break; }
+
+				// Select the next process to run, the next arrival if the CPU would sit idle
+				const QueuedProcess target_process = arrived_.empty() ? pending_.pop() : arrived_.pop();
+				SCHEDULE_STAT(stats, selections, 1);
+				decisions++;
+
+				// Skip to the arrival time if needed
+				unsigned long waiting = 0;
+				if (progress.current_time < target_process.pcb.arrival)
+				{
+					progress.current_time = target_process.pcb.arrival;
+					SCHEDULE_STAT(stats, idle_jumps, 1);
+					SCHEDULE_STAT(stats, ticks, 1);
+				}
+				else
+				{
+					waiting = progress.current_time - target_process.pcb.arrival;
+					if (progress.cpu_busy) { SCHEDULE_STAT(stats, context_switches, 1); }
+				}
+
+				// Run it to completion
+				hooks_.trace(progress.current_time, target_process.order, SCHEDULE_TRACE_DISPATCH);
+				hooks_.started(target_process, progress.current_time);
+				progress.current_time += target_process.pcb.remaining_burst_time;
+				const unsigned long turnaround = progress.current_time - target_process.pcb.arrival;
+				progress.total_waiting += waiting;
+				progress.total_turnaround += turnaround;
+				progress.completed++;
+				hooks_.completed(target_process, progress.current_time, waiting, turnaround);
+				progress.cpu_busy = true;
+				SCHEDULE_STAT(stats, ticks, 1);
+			}
+			progress_ = progress;
+			return decisions;
+		}
+
+		void finish(ScheduleResult_t *const result) const noexcept { set_result(progress_, result); }
+
+		void save(CheckpointWriter &out) const noexcept
+		{
+			save_progress(out, progress_);
+			pending_.save(out);
+			arrived_.save(out);
+		}
+
+		void load(CheckpointReader &in)
+		{
+			progress_ = load_progress(in);
+			pending_.load(in);
+			arrived_.load(in);
+		}
+
+	private:
+		Hooks hooks_;
+		PendingQueue pending_;
+		ProcessHeap<Order> arrived_;
+		Progress progress_;
+	};
+
+	// Simulates preemptive Shortest Remaining Time First. The running process can only be preempted when
+	// something new arrives, so instead of ticking the clock it runs until it finishes or the next arrival,
+	// whichever comes first.
+	class ShortestRemainingTimeRun
+	{
+	public:
+		static constexpr bool by_arrival = true;
+		static constexpr CheckpointPolicy policy = CHECKPOINT_SRTF;
+
+		ShortestRemainingTimeRun(PendingQueue &&pending, const Hooks &hooks)
+			: hooks_(hooks), pending_(std::move(pending)), arrived_(hooks.stats()), progress_(), running_order_(0), holding_(false) {}
+
+		void append(const QueuedProcess &process) { pending_.push(process); }
+
+		std::size_t advance(const unsigned long limit, const std::size_t budget)
+		{
+			ScheduleStats_t *const stats = hooks_.stats();
+			Progress progress = progress_;
+			std::size_t decisions = 0;
+			while (true)
+			{
+				// Queue up everything that has arrived by now
+				while (!pending_.empty() && pending_.front().pcb.arrival <= progress.current_time)
+				{
+					arrived_.push(pending_.pop());
+				}
+
+				// Skip ahead to the next arrival if nothing is ready
+				if (arrived_.empty())
+				{
+					if (pending_.empty()) { break; }
+					progress.current_time = pending_.front().pcb.arrival;
+					progress.cpu_busy = false;
+					SCHEDULE_STAT(stats, idle_jumps, 1);
+					SCHEDULE_STAT(stats, ticks, 1);
+					continue;
+				}
+				if (progress.current_time >= limit || decisions == budget) { break; }
+
+				// Acquire the process with the shortest burst time remaining
+				QueuedProcess target_process = arrived_.pop();
+				SCHEDULE_STAT(stats, selections, 1);
+				decisions++;
+
+				// Picking anyone but the process that just had the CPU is a switch
+				if (progress.cpu_busy && target_process.order != running_order_) { SCHEDULE_STAT(stats, context_switches, 1); }
+				if (holding_ && target_process.order != running_order_) { hooks_.trace(progress.current_time, running_order_, SCHEDULE_TRACE_PREEMPT); }
+				if (!holding_ || target_process.order != running_order_) { hooks_.trace(progress.current_time, target_process.order, SCHEDULE_TRACE_DISPATCH); }
+				// Every run goes until the next arrival at least, so a process with its whole burst left has not run yet
+				if (target_process.pcb.remaining_burst_time == target_process.burst) { hooks_.started(target_process, progress.current_time); }
+				running_order_ = target_process.order;
+				progress.cpu_busy = true;
+
+				// Run the process on the CPU until it finishes or something new arrives
+				// (before limit something always is pending, so a run never goes past an arrival still to be appended)
+				unsigned long run_time = target_process.pcb.remaining_burst_time;
+				if (!pending_.empty())
+				{
+					const unsigned long next_arrival = pending_.front().pcb.arrival;
+					if (next_arrival - progress.current_time < run_time) { run_time = next_arrival - progress.current_time; }
+				}
+				target_process.pcb.remaining_burst_time -= run_time;
+				progress.current_time += run_time;
+				SCHEDULE_STAT(stats, ticks, 1);
+				holding_ = target_process.pcb.remaining_burst_time > 0;
+
+				// Push the process back to the ready queue if it has not finished
+				// A finished process spent every moment it wasn't on the CPU waiting
+				if (holding_)
+				{
+					arrived_.push(target_process);
+				}
+				else
+				{
+					const unsigned long turnaround = progress.current_time - target_process.pcb.arrival;
+					const unsigned long waiting = turnaround - target_process.burst;
+					progress.total_turnaround += turnaround;
+					progress.total_waiting += waiting;
+					progress.completed++;
+					target_process.pcb.remaining_burst_time = target_process.burst;
+					hooks_.completed(target_process, progress.current_time, waiting, turnaround);
+				}
+			}
+			progress_ = progress;
+			return decisions;
+		}
+
+		void finish(ScheduleResult_t *const result) const noexcept { set_result(progress_, result); }
+
+		void save(CheckpointWriter &out) const noexcept
+		{
+			save_progress(out, progress_);
+			out.u64(running_order_);
+			out.u64(holding_);
+			pending_.save(out);
+			arrived_.save(out);
+		}
+
+		void load(CheckpointReader &in)
+		{
+			progress_ = load_progress(in);
+			running_order_ = in.u64();
+			holding_ = in.u64() != 0;
+			pending_.load(in);
+			arrived_.load(in);
+		}
+
+	private:
+		Hooks hooks_;
+		PendingQueue pending_;
+		ProcessHeap<ShortestRemainingTime> arrived_;
+		Progress progress_;
+		std::size_t running_order_;
+		// If the process that last ran still has work left, it holds the CPU until something else is picked
+		bool holding_;
+	};
+
+	// Simulates round robin. Processes join the queue in the order they appear in the ready queue, once they
+	// have arrived (a process that hasn't arrived yet holds up the ones behind it). A slice runs
+	// min(quantum, remaining) time units in one go, then everything that arrived by the end of it joins the
+	// queue ahead of the process that ran, if it has work left. A process with a zero burst finishes as
+	// soon as it gets the CPU.
+	class RoundRobinRun
+	{
+	public:
+		static constexpr bool by_arrival = false;
+		static constexpr CheckpointPolicy policy = CHECKPOINT_ROUND_ROBIN;
+
+		RoundRobinRun(PendingQueue &&pending, const Hooks &hooks, const std::size_t quantum)
+			: hooks_(hooks), pending_(std::move(pending)), quantum_(quantum), progress_(), round_(), sliced_(false), holding_(false) {}
+
+		void append(const QueuedProcess &process) { pending_.push(process); }
+
+		std::size_t advance(const unsigned long limit, const std::size_t budget)
+		{
+			ScheduleStats_t *const stats = hooks_.stats();
+			Progress progress = progress_;
+			std::size_t decisions = 0;
+			while (true)
+			{
+				// Once a slice is over, everything that arrived by the end of it gets in line, then the process that
+				// ran (if it has work left). That can't happen at or past limit, something could still arrive before it
+				if (sliced_ && progress.current_time >= limit) { break; }
+				admit(progress.current_time);
+				if (sliced_)
+				{
+					holding_ = round_.pcb.remaining_burst_time > 0;
+					if (holding_) { ready_.push_back(round_); }
+					sliced_ = false;
+				}
+
+				// Nothing is ready, fast-forward to the next arrival
+				if (ready_.empty())
+				{
+					if (pending_.empty()) { break; }
+					progress.current_time = pending_.front().pcb.arrival;
+					progress.cpu_busy = false;
+					holding_ = false;
+					SCHEDULE_STAT(stats, idle_jumps, 1);
+					SCHEDULE_STAT(stats, ticks, 1);
+					continue;
+				}
+				if (progress.current_time >= limit || decisions == budget) { break; }
+				decisions++;
+
+				// The process that just ran only keeps the CPU if it was the only one waiting
+				const bool keeps_cpu = holding_ && ready_.size() == 1;
+				if (progress.cpu_busy && !keeps_cpu) { SCHEDULE_STAT(stats, context_switches, 1); }
+				SCHEDULE_STAT(stats, selections, 1);
+				progress.cpu_busy = true;
+				if (holding_ && !keeps_cpu) { hooks_.trace(progress.current_time, round_.order, SCHEDULE_TRACE_PREEMPT); }
+				round_ = ready_.pop_front();
+				if (!keeps_cpu) { hooks_.trace(progress.current_time, round_.order, SCHEDULE_TRACE_DISPATCH); }
+				// Slices are never empty, so a process with its whole burst left has not run yet
+				if (round_.pcb.remaining_burst_time == round_.burst) { hooks_.started(round_, progress.current_time); }
+
+				// Execute it for the quantum, or until it terminates
+				const unsigned long run_time = round_.pcb.remaining_burst_time < quantum_ ? round_.pcb.remaining_burst_time : quantum_;
+				round_.pcb.remaining_burst_time -= run_time;
+				progress.current_time += run_time;
+				SCHEDULE_STAT(stats, ticks, 1);
+				sliced_ = true;
+
+				// A finished process spent every moment it wasn't on the CPU waiting
+				if (round_.pcb.remaining_burst_time == 0)
+				{
+					const unsigned long turnaround = progress.current_time - round_.pcb.arrival;
+					const unsigned long waiting = turnaround - round_.burst;
+					progress.total_turnaround += turnaround;
+					progress.total_waiting += waiting;
+					progress.completed++;
+					round_.pcb.remaining_burst_time = round_.burst;
+					hooks_.completed(round_, progress.current_time, waiting, turnaround);
+					round_.pcb.remaining_burst_time = 0;
+				}
+			}
+			progress_ = progress;
+			return decisions;
+		}
+
+		void finish(ScheduleResult_t *const result) const noexcept { set_result(progress_, result); }
+
+		void save(CheckpointWriter &out) const noexcept
+		{
+			out.u64(quantum_);
+			save_progress(out, progress_);
+			out.process(round_);
+			out.u64(sliced_);
+			out.u64(holding_);
+			pending_.save(out);
+			ready_.save(out);
+		}
+
+		void load(CheckpointReader &in)
+		{
+			quantum_ = in.u64();
+			if (quantum_ == 0) { in.fail(); }
+			progress_ = load_progress(in);
+			round_ = in.process();
+			sliced_ = in.u64() != 0;
+			holding_ = in.u64() != 0;
+			pending_.load(in);
+			ready_.load(in);
+		}
+
+	private:
+		// Puts everything that has arrived by time in line, in ready queue order
+		void admit(const unsigned long time)
+		{
+			while (!pending_.empty() && pending_.front().pcb.arrival <= time) { ready_.push_back(pending_.pop()); }
+		}
+
+		Hooks hooks_;
+		PendingQueue pending_;
+		ProcessRing ready_;
+		std::size_t quantum_;
+		Progress progress_;
+		QueuedProcess round_;	// The process that had the last slice
+		bool sliced_;			// round_ has had its slice but is not back in line yet
+		bool holding_;			// round_ went back in line with work left and still has the CPU
+	};
+
+	// Runs a whole ready queue through a fresh Run, with the hooks attached on this thread
+	template <typename Run, typename... Args>
+	bool run_ready_queue(const dyn_array_t *const ready_queue, ScheduleResult_t *const result, const Args... args)
+	{
+		// Validate input values
+		if (ready_queue == nullptr || result == nullptr) { return false; }
+		const std::size_t process_count = dyn_array_size(ready_queue);
+		if (process_count == 0) { return false; }
+
+		const Hooks hooks;
+		Run run(create_pending_queue(ready_queue, hooks.stats(), Run::by_arrival), hooks, args...);
+		hooks.trace(0, process_count, SCHEDULE_TRACE_BEGIN);
+		run.advance(END_OF_TIME, UNLIMITED_DECISIONS);
+		run.finish(result);
+		return true;
+	}
+
+	// Runs a scheduler, an allocation failure anywhere in it is a failed run
+	template <typename Scheduler>
+	bool run_guarded(const Scheduler scheduler) noexcept
+	{
+		try
+		{
+			return scheduler();
+		}
+		catch (const std::bad_alloc &)
+		{
+			return false;
+		}
+	}
+
+	// What a simulation handle holds, whatever its policy
+	class Simulation
+	{
+	public:
+		virtual ~Simulation() {}
+		virtual Simulation *clone() const = 0;
+		virtual CheckpointPolicy policy() const = 0;
+		virtual void append(const QueuedProcess &process) = 0;
+		virtual std::size_t advance(unsigned long limit, std::size_t budget) = 0;
+		virtual void finish(ScheduleResult_t *result) const = 0;
+		virtual void save(CheckpointWriter &out) const = 0;
+		virtual void load(CheckpointReader &in) = 0;
+	};
+
+	template <typename Run>
+	class RunSimulation final : public Simulation
+	{
+	public:
+		explicit RunSimulation(Run &&run) : run_(std::move(run)) {}
+		RunSimulation(const RunSimulation &other) : run_(other.run_) {}
+
+		Simulation *clone() const override { return new RunSimulation(*this); }
+		CheckpointPolicy policy() const override { return Run::policy; }
+		void append(const QueuedProcess &process) override { run_.append(process); }
+		std::size_t advance(const unsigned long limit, const std::size_t budget) override { return run_.advance(limit, budget); }
+		void finish(ScheduleResult_t *const result) const override { run_.finish(result); }
+		void save(CheckpointWriter &out) const override { run_.save(out); }
+		void load(CheckpointReader &in) override { run_.load(in); }
+
+	private:
+		Run run_;
+	};
+
+	// A simulation with nothing appended and nothing attached
+	template <typename Run, typename... Args>
+	std::unique_ptr<Simulation> empty_simulation(const Args... args)
+	{
+		const ScheduleHooks_t detached = {};
+		return std::unique_ptr<Simulation>(new RunSimulation<Run>(Run(PendingQueue(hw2::dyn_array<QueuedProcess>()), Hooks(detached), args...)));
+	}
+
+	constexpr char CHECKPOINT_MAGIC[8] = { 'P', 'C', 'B', 'S', 'I', 'M', 'C', 'K' };
+	constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+	// Decisions schedule_simulation_finish makes between looking at whether a checkpoint is due
+	constexpr std::size_t CHECKPOINT_CHECK_DECISIONS = 1 << 16;
+}
+
+struct ScheduleSimulation
+{
+	std::unique_ptr<Simulation> simulation;
+	std::size_t appended;	// Processes appended so far, the next one's queue position
+	uint32_t frontier;		// The latest arrival appended, nothing appended later can arrive before it
+	bool closed;			// Finishing has started, nothing more can be appended
+};
+
+// A handle with nothing appended and nothing attached, NULL if it couldn't be made
+template <typename Run, typename... Args>
+static ScheduleSimulation_t *create_simulation(const Args... args) noexcept
+{
+	try
+	{
+		return new ScheduleSimulation { empty_simulation<Run>(args...), 0, 0, false };
+	}
+	catch (const std::bad_alloc &)
+	{
+		return nullptr;
+	}
+}
+
+// Writes a handle to path.tmp, then renames it over path
+static bool write_checkpoint(const ScheduleSimulation &simulation, const char *const path)
+{
+	const std::string temporary = std::string(path) + ".tmp";
+	ScheduleWriter_t *const file = schedule_writer_open(temporary.c_str(), 0);
+	if (file == nullptr) { return false; }
+
+	CheckpointWriter out(file);
+	out.bytes(CHECKPOINT_MAGIC, 8);
+	out.u32(CHECKPOINT_VERSION);
+	out.u32(simulation.simulation->policy());
+	out.u64(simulation.appended);
+	out.u32(simulation.frontier);
+	out.u32(simulation.closed);
+	simulation.simulation->save(out);
+
+	const bool written = schedule_writer_close(file) && out.ok();
+	if (!written || std::rename(temporary.c_str(), path) != 0)
+	{
+		std::remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Reads a handle back out of a checkpoint, NULL if the file isn't a whole checkpoint
+static ScheduleSimulation_t *read_checkpoint(ScheduleReader_t *const file)
+{
+	CheckpointReader in(file);
+	char magic[8];
+	in.bytes(magic, sizeof(magic));
+	const uint32_t version = in.u32();
+	if (!in.ok() || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 || version != CHECKPOINT_VERSION) { return nullptr; }
+
+	std::unique_ptr<Simulation> simulation;
+	switch (in.u32())
+	{
+		case CHECKPOINT_FCFS: simulation = empty_simulation<NonpreemptiveRun<EarliestArrival>>(); break;
+		case CHECKPOINT_SJF: simulation = empty_simulation<NonpreemptiveRun<ShortestBurst>>(); break;
+		case CHECKPOINT_PRIORITY: simulation = empty_simulation<NonpreemptiveRun<HighestPriority>>(); break;
+		case CHECKPOINT_SRTF: simulation = empty_simulation<ShortestRemainingTimeRun>(); break;
+		// The quantum is part of the run's own state
+		case CHECKPOINT_ROUND_ROBIN: simulation = empty_simulation<RoundRobinRun>(std::size_t(1)); break;
+		default: return nullptr;
+	}
+	const std::size_t appended = in.u64();
+	const uint32_t frontier = in.u32();
+	const bool closed = in.u32() != 0;
+	simulation->load(in);
+	if (!in.ok() || !in.at_end()) { return nullptr; }
+	return new ScheduleSimulation { std::move(simulation), appended, frontier, closed };
+}
+
+bool first_come_first_serve(dyn_array_t *ready_queue, ScheduleResult_t *result)
+{
+	return run_guarded([=] { return run_ready_queue<NonpreemptiveRun<EarliestArrival>>(ready_queue, result); });
+}
+
+bool shortest_job_first(dyn_array_t *ready_queue, ScheduleResult_t *result)
+{
+	return run_guarded([=] { return run_ready_queue<NonpreemptiveRun<ShortestBurst>>(ready_queue, result); });
+}
+
+bool priority(dyn_array_t *ready_queue, ScheduleResult_t *result)
+{
+	return run_guarded([=] { return run_ready_queue<NonpreemptiveRun<HighestPriority>>(ready_queue, result); });
+}
+
+bool shortest_remaining_time_first(dyn_array_t *ready_queue, ScheduleResult_t *result)
+{
+	return run_guarded([=] { return run_ready_queue<ShortestRemainingTimeRun>(ready_queue, result); });
+}
+
+bool round_robin(dyn_array_t *ready_queue, ScheduleResult_t *result, size_t quantum)
+{
+	if (quantum == 0) { return false; }
+	return run_guarded([=] { return run_ready_queue<RoundRobinRun>(ready_queue, result, quantum); });
+}
+
+ScheduleSimulation_t *schedule_simulation_create(bool (*scheduler)(dyn_array_t *, ScheduleResult_t *))
+{
+	if (scheduler == first_come_first_serve) { return create_simulation<NonpreemptiveRun<EarliestArrival>>(); }
+	if (scheduler == shortest_job_first) { return create_simulation<NonpreemptiveRun<ShortestBurst>>(); }
+	if (scheduler == priority) { return create_simulation<NonpreemptiveRun<HighestPriority>>(); }
+	if (scheduler == shortest_remaining_time_first) { return create_simulation<ShortestRemainingTimeRun>(); }
+	return nullptr;
+}
+
+ScheduleSimulation_t *round_robin_simulation_create(size_t quantum)
+{
+	if (quantum == 0) { return nullptr; }
+	return create_simulation<RoundRobinRun>(quantum);
+}
+
+ScheduleSimulation_t *schedule_simulation_clone(const ScheduleSimulation_t *simulation)
+{
+	if (simulation == nullptr) { return nullptr; }
+	try
+	{
+		std::unique_ptr<Simulation> copy(simulation->simulation->clone());
+		return new ScheduleSimulation { std::move(copy), simulation->appended, simulation->frontier, simulation->closed };
+	}
+	catch (const std::bad_alloc &)
+	{
+		return nullptr;
+	}
+}
+
+void schedule_simulation_destroy(ScheduleSimulation_t *simulation)
+{
+	delete simulation;
+}
+
+bool schedule_simulation_append(ScheduleSimulation_t *simulation, const dyn_array_t *pcbs)
+{
+	if (simulation == nullptr || simulation->closed || pcbs == nullptr || dyn_array_data_size(pcbs) != sizeof(ProcessControlBlock_t)) { return false; }
+	const std::size_t count = dyn_array_size(pcbs);
+	const ProcessControlBlock_t *const blocks = static_cast<const ProcessControlBlock_t *>(dyn_array_export(pcbs));
+
+	// Check the whole batch first, so one that is out of order changes nothing
+	uint32_t frontier = simulation->frontier;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		if (blocks[i].arrival < frontier) { return false; }
+		frontier = blocks[i].arrival;
+	}
+	try
+	{
+		for (std::size_t i = 0; i < count; i++)
+		{
+			simulation->simulation->append(QueuedProcess { blocks[i], simulation->appended, blocks[i].remaining_burst_time });
+			simulation->appended++;
+			simulation->frontier = blocks[i].arrival;
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+		return false;
+	}
+	return true;
+}
+
+bool schedule_simulation_advance(ScheduleSimulation_t *simulation, ScheduleResult_t *result)
+{
+	if (simulation == nullptr || result == nullptr || simulation->appended == 0) { return false; }
+	try
+	{
+		// A closed handle can't get any more arrivals, so it just runs to the end
+		if (simulation->closed)
+		{
+			simulation->simulation->advance(END_OF_TIME, UNLIMITED_DECISIONS);
+			simulation->simulation->finish(result);
+			return true;
+		}
+		simulation->simulation->advance(simulation->frontier, UNLIMITED_DECISIONS);
+		// Finishing means running everything that is still waiting, which more arrivals could change, so that happens on a copy
+		std::unique_ptr<Simulation> rest(simulation->simulation->clone());
+		rest->advance(END_OF_TIME, UNLIMITED_DECISIONS);
+		rest->finish(result);
+	}
+	catch (const std::bad_alloc &)
+	{
+		return false;
+	}
+	return true;
+}
+
+bool schedule_simulation_settle(ScheduleSimulation_t *simulation)
+{
+	if (simulation == nullptr) { return false; }
+	if (simulation->appended == 0) { return true; }
+	try
+	{
+		simulation->simulation->advance(simulation->closed ? END_OF_TIME : simulation->frontier, UNLIMITED_DECISIONS);
+	}
+	catch (const std::bad_alloc &)
+	{
+		return false;
+	}
+	return true;
+}
+
+size_t schedule_simulation_size(const ScheduleSimulation_t *simulation)
+{
+	return simulation != nullptr ? simulation->appended : 0;
+}
+
+bool schedule_simulation_checkpoint(const ScheduleSimulation_t *simulation, const char *path)
+{
+	if (simulation == nullptr || path == nullptr) { return false; }
+	try
+	{
+		return write_checkpoint(*simulation, path);
+	}
+	catch (const std::bad_alloc &)
+	{
+		return false;
+	}
+}
+
+ScheduleSimulation_t *schedule_simulation_restore(const char *path)
+{
+	ScheduleReader_t *const file = schedule_reader_open(path, 0);
+	if (file == nullptr) { return nullptr; }
+	ScheduleSimulation_t *simulation = nullptr;
+	try
+	{
+		simulation = read_checkpoint(file);
+	}
+	catch (const std::bad_alloc &)
+	{
+		simulation = nullptr;
+	}
+	schedule_reader_close(file);
+	return simulation;
+}
+
+bool schedule_simulation_finish(ScheduleSimulation_t *simulation, const ScheduleCheckpoints_t *checkpoints, ScheduleResult_t *result)
+{
+	if (simulation == nullptr || result == nullptr || simulation->appended == 0) { return false; }
+	if (checkpoints != nullptr && checkpoints->path == nullptr) { return false; }
+	simulation->closed = true;
+	try
+	{
+		if (checkpoints == nullptr)
+		{
+			simulation->simulation->advance(END_OF_TIME, UNLIMITED_DECISIONS);
+		}
+		else
+		{
+			// Run a batch of decisions at a time, checkpointing between batches when asked to or when one is due
+			typedef std::chrono::steady_clock Clock;
+			const Clock::duration interval = std::chrono::seconds(checkpoints->interval_seconds);
+			Clock::time_point last_checkpoint = Clock::now();
+			while (simulation->simulation->advance(END_OF_TIME, CHECKPOINT_CHECK_DECISIONS) == CHECKPOINT_CHECK_DECISIONS)
+			{
+				const bool requested = checkpoints->request != nullptr && *checkpoints->request != 0;
+				const bool due = checkpoints->interval_seconds > 0 && Clock::now() - last_checkpoint >= interval;
+				if (!requested && !due) { continue; }
+				// Cleared first, so a request that comes in during the write gets another checkpoint
+				if (requested) { *checkpoints->request = 0; }
+				if (!write_checkpoint(*simulation, checkpoints->path)) { return false; }
+				last_checkpoint = Clock::now();
+			}
+		}
+		simulation->simulation->finish(result);
+	}
+	catch (const std::bad_alloc &)
+	{
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,497 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "dyn_array.h"
+#include "process_scheduling_reference.h"
+
+// The original per-tick schedulers, see the notes in process_scheduling_reference.h
+// Apart from working on a copy and finishing zero bursts, this is the code as it was
+
+// Copies the incoming ready queue so the original scheduling code can extract from it as it always did.
+// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
+// \return: A new dyn_array holding the same processes, NULL if ready_queue is NULL, empty or the copy failed
+static dyn_array_t* copy_ready_queue(const dyn_array_t* ready_queue)
+{
+	if (ready_queue == NULL || dyn_array_size(ready_queue) == 0) { return NULL; }
+	return dyn_array_import(dyn_array_export(ready_queue), dyn_array_size(ready_queue), sizeof(ProcessControlBlock_t), NULL);
+}
+
+// Runs a process on the virtual CPU for one time unit
+static void virtual_cpu(ProcessControlBlock_t *process_control_block) 
+{
+	// decrement the burst time of the pcb
+	--process_control_block->remaining_burst_time;
+}
+
+// Defines a function pointer type for non-preemptive CPU scheduler algorithms that select and extract the next
+// process to run from the ready queue.
+// \param: ready_queue - A dyn_array containing the pool of available processes
+// \param: current_time - The current simulated CPU time used to determine process eligibility
+// \param: object - A pointer to the destination where the extracted process block will be stored
+// \return: True if a process was successfully selected and extracted, false otherwise
+typedef bool (*process_selector_function_t)(dyn_array_t* ready_queue, unsigned long current_time, ProcessControlBlock_t* const process);
+
+// Simulates a non-preemptive CPU scheduler by executing processes from the ready queue to completion using a provided selection algorithm.
+// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing the processes to be scheduled
+// \param: result - A pointer to a ScheduleResult_t structure where the calculated scheduling statistics will be stored
+// \param: selector - A function pointer used to extract the next process from the ready queue based on a specific scheduling algorithm
+// \return: True if the scheduling simulation completed successfully, false otherwise
+static bool nonpreemptive_scheduler(dyn_array_t* ready_queue, ScheduleResult_t* result, process_selector_function_t selector)
+{
+	// Validate input values
+	if (ready_queue == NULL || result == NULL) { return false; }
+	size_t process_count = dyn_array_size(ready_queue);
+	if (process_count == 0) { return false; }
+
+	// Create CPU variables
+	unsigned long current_time = 0;
+	unsigned long total_waiting = 0;
+	unsigned long total_turnaround = 0;
+
+	// Loop until the ready queue has been emptied
+	while (!dyn_array_empty(ready_queue))
+	{
+		// Select the next process to run
+		ProcessControlBlock_t target_process;
+		if (!selector(ready_queue, current_time, &target_process)) { return false; }
+
+		// Skip to the arrival time if needed
+		if (current_time < target_process.arrival) { current_time = target_process.arrival; }
+		else { total_waiting += current_time - target_process.arrival; }
+
+		// If a process was found then run it to completion
+		while (target_process.remaining_burst_time > 0)
+		{
+			virtual_cpu(&target_process);
+			current_time++;
+		}
+		total_turnaround += current_time - target_process.arrival;
+	}
+
+	// Set the result values
+	result->average_waiting_time = (float)total_waiting / process_count;
+	result->average_turnaround_time = (float)total_turnaround / process_count;
+	result->total_run_time = current_time;
+	
+	return true;
+}
+
+// Extracts the process with the earliest arrival time from the queue.
+// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
+// \param: current_time - The current simulated CPU time used to determine process eligibility
+// \param: object - A pointer to the destination where the extracted process block will be stored
+// \return: True if the extraction was successful, false otherwise
+static bool select_earliest_arrival(dyn_array_t* ready_queue, unsigned long current_time, ProcessControlBlock_t* const process)
+{
+	// Mark current_time as intentionally unused for the compiler
+	(void)current_time;
+
+	// Validate input values
+	if (ready_queue == NULL || dyn_array_empty(ready_queue) || process == NULL) { return false; }
+	
+	// Find the process with the earliest arrival time
+	size_t prime_candidate_index = 0;
+	for (size_t i = 1; i < dyn_array_size(ready_queue); i++)
+	{
+		ProcessControlBlock_t* prime_candidate_process = dyn_array_at(ready_queue, prime_candidate_index);
+		ProcessControlBlock_t* candidate_process = dyn_array_at(ready_queue, i);
+		if (prime_candidate_process->arrival > candidate_process->arrival)
+		{
+			prime_candidate_index = i;
+		}
+	}
+
+	// Store the selected process in the memory location provided
+	dyn_array_extract(ready_queue, prime_candidate_index, process);
+
+	return true;
+}
+
+// Runs First Come First Served algorithm.
+// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
+// \param: result - Result used for stat tracking
+// \return: True if function ran successful, false otherwise
+bool reference_first_come_first_serve(const dyn_array_t* ready_queue, ScheduleResult_t* result)
+{
+	dyn_array_t* queue = copy_ready_queue(ready_queue);
+	bool success = nonpreemptive_scheduler(queue, result, select_earliest_arrival);
+	dyn_array_destroy(queue);
+	return success;
+}
+
+// Extracts the process with the shortest burst from the queue.
+// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
+// \param: current_time - The current simulated CPU time used to determine process eligibility
+// \param: object - A pointer to the destination where the extracted process block will be stored
+// \return: True if the extraction was successful, false otherwise
+static bool select_shortest_burst(dyn_array_t* ready_queue, unsigned long current_time, ProcessControlBlock_t* target)
+{
+	// Checks invalid parameters
+	if (ready_queue == NULL || target == NULL) 
+	{
+		 return false; 
+	}
+	// Gets number of processes
+	size_t num_processes = dyn_array_size(ready_queue); 
+	if(num_processes == 0)
+	{
+		return false;
+	}
+
+	int shortest_burst_index = -1;
+	uint32_t shortest_burst = UINT32_MAX;
+
+	// Iterate through each process looking for shortest burst
+	for(size_t i = 0; i < num_processes; i++ )
+	{
+		ProcessControlBlock_t *pcb = (ProcessControlBlock_t *)dyn_array_at(ready_queue, i);
+		if(!pcb)
+		{			
+			return false;
+		}
+		// Has process arrived and the shortest burst found
+		if(pcb->arrival <= current_time && pcb->remaining_burst_time < shortest_burst)
+		{
+			shortest_burst_index = i;
+			shortest_burst = pcb->remaining_burst_time;
+		}
+	}
+	// Process has yet to arrive
+	if(shortest_burst_index == -1)
+	{
+		uint32_t next_arrival = UINT32_MAX;		
+			for(size_t i = 0; i < num_processes; i++ )
+			{
+
+			ProcessControlBlock_t *pcb = (ProcessControlBlock_t *)dyn_array_at(ready_queue, i);	
+
+			if(pcb->arrival > current_time && pcb->arrival < next_arrival)
+			{
+				next_arrival = pcb->arrival;
+				shortest_burst_index = i;
+			}
+		}
+	}
+	if(shortest_burst_index != -1)
+	{
+		return dyn_array_extract(ready_queue, shortest_burst_index, target);
+	}
+	return false;
+}
+// Runs Shortest Job First algorithm
+// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
+// \param: result - Result used for stat tracking
+// \return: True if function ran successful, false otherwise
+bool reference_shortest_job_first(const dyn_array_t* ready_queue, ScheduleResult_t* result)
+{
+	dyn_array_t* queue = copy_ready_queue(ready_queue);
+	bool success = nonpreemptive_scheduler(queue, result, select_shortest_burst);
+	dyn_array_destroy(queue);
+	return success;
+}
+
+// Extracts the highest priority process that is in the ready queue, or the earliest future process if the CPU is idle.
+// \param: ready_queue - A dyn_array of type ProcessControlBlock_t containing up to N elements
+// \param: current_time - The current simulated CPU time used to determine process eligibility
+// \param: object - A pointer to the destination where the extracted process block will be stored
+// \return: True if the extraction was successful, false otherwise
+static bool select_highest_priority(dyn_array_t* ready_queue, unsigned long current_time, ProcessControlBlock_t* const process)
+{
+	// Validate input values
+	if (ready_queue == NULL || dyn_array_empty(ready_queue) || process == NULL) { return false; }
+	
+	// Find the process with the highest priority
+	size_t prime_candidate_index = 0;
+	for (size_t i = 1; i < dyn_array_size(ready_queue); i++)
+	{
+		// Acquire two processes to compare
+		ProcessControlBlock_t* prime_candidate_process = dyn_array_at(ready_queue, prime_candidate_index);
+		ProcessControlBlock_t* candidate_process = dyn_array_at(ready_queue, i);
+		bool prime_candidate_arrived = prime_candidate_process->arrival <= current_time;
+		bool candidate_arrived = candidate_process->arrival <= current_time;
+		
+		// If both process have arrived determine which one has higher priority 
+		if (prime_candidate_arrived && candidate_arrived)
+		{
+			if (prime_candidate_process->priority > candidate_process->priority || 
+                (prime_candidate_process->priority == candidate_process->priority && 
+                prime_candidate_process->arrival > candidate_process->arrival))
+            {
+                prime_candidate_index = i;
+            }
+		}
+		// If neither have arrived determine which one has the earlier arrival time
+		else if (!prime_candidate_arrived && !candidate_arrived && prime_candidate_process->arrival > candidate_process->arrival)
+		{
+			prime_candidate_index = i;
+		}
+		// If only one arrived then it gets priority
+		else if (candidate_arrived)
+		{
+			prime_candidate_index = i;
+		}
+	}
+
+	// Store the selected process in the memory location provided
+	dyn_array_extract(ready_queue, prime_candidate_index, process);
+
+	return true;
+}
+
+// Runs the non-preemptive Priority algorithm over the incoming ready_queue.
+// \param: ready_queue - a dyn_array of type ProcessControlBlock_t that contain be up to N elements
+// \param: result - used for shortest job first stat tracking \ref ScheduleResult_t
+// \return: True if function ran successful else false for an error
+bool reference_priority(const dyn_array_t* ready_queue, ScheduleResult_t* result)
+{
+	dyn_array_t* queue = copy_ready_queue(ready_queue);
+	bool success = nonpreemptive_scheduler(queue, result, select_highest_priority);
+	dyn_array_destroy(queue);
+	return success;
+}
+
+// Runs round robin algorithm
+// \param: ready_queue - A dyn_array_t containing items of type ProcessControlBlock_t
+// \param: result - Struct used for stat tracking
+// \param: quantum - The quantum, or time slice, allocated to a pcb in each round
+// \return: True if the function ran successfully, false otherwise
+static bool round_robin_in_place(dyn_array_t* ready_queue, ScheduleResult_t* result, size_t quantum)
+{
+	if (!ready_queue || !result || quantum == 0) {
+		return false;
+	}
+
+	dyn_array_t *rr_queue = dyn_array_create(0, sizeof(ProcessControlBlock_t), NULL);
+	if (!rr_queue) {
+		return false;
+	}
+
+	unsigned long current_time = 0;
+	unsigned long total_waiting = 0;
+	unsigned long total_turnaround = 0;
+	size_t num_processes = dyn_array_size(ready_queue);
+	if (num_processes == 0) {
+		dyn_array_destroy(rr_queue);
+		return false;
+	}
+
+	// Represents pcb at i
+	ProcessControlBlock_t *pcb = malloc(sizeof(ProcessControlBlock_t));
+	if (!pcb) {
+		dyn_array_destroy(rr_queue);
+		return false;
+	}
+
+	// Represents the pcb that we execute from rr_queue
+	ProcessControlBlock_t *round = malloc(sizeof(ProcessControlBlock_t));
+	if (!round) {
+		dyn_array_destroy(rr_queue);
+		free(pcb);
+		return false;
+	}
+
+	// Tracks how many processes are still in ready_queue
+	size_t i = 0;
+	// Tracks if we executed a pcb from rr_queue
+	bool flag = false;
+	// Continue until rr_queue is empty and every pcb has arrived
+	while (!dyn_array_empty(rr_queue) || i < num_processes) {
+		// Execute the front pcb in rr_queue
+		flag = false;
+		if (!dyn_array_empty(rr_queue)) {
+			flag = true;
+			dyn_array_extract_front(rr_queue, round);
+			size_t rr_size = dyn_array_size(rr_queue);
+			// Execute this pcb for the time quantum, or until it terminates (a zero burst terminates straight away)
+			for (size_t j = 0; j < quantum && round->remaining_burst_time > 0; j++) {
+				virtual_cpu(round);
+				current_time++;
+				// For every unit of time this pcb is executed, every other pcb
+				// in rr_queue waits that amount of time
+				total_waiting += rr_size;
+				// For every unit of time thsi pcb is executed, this pcb takes
+				// that amount of time to execute (Hence the +1) and every other pcb in rr_queue
+				// waits that amount of time
+				total_turnaround += rr_size + 1;
+				if (round->remaining_burst_time <= 0) {
+					break;
+				}
+			}
+		} // If no pcb can be executed, fast-forward time
+		else if (i < num_processes && ((ProcessControlBlock_t *)dyn_array_at(ready_queue, 0))->arrival > current_time) {
+			current_time = ((ProcessControlBlock_t *)dyn_array_at(ready_queue, 0))->arrival;
+		}
+
+		// Add all pcb's that are waiting to the back of rr_queue
+		while (i < num_processes && ((ProcessControlBlock_t *)dyn_array_at(ready_queue, 0))->arrival <= current_time) {
+			dyn_array_extract_front(ready_queue, pcb);
+			dyn_array_push_back(rr_queue, pcb);
+			// This pcb had to wait until after 'round' finished executing
+			total_waiting += current_time - pcb->arrival;
+			total_turnaround += current_time - pcb->arrival;
+			i++;
+		}
+		
+		// If the pcb we executed has not terminated, put it at the back of the queue
+		// Important that this happens after all pcb's that became available are loaded onto the queue
+		if (flag && round->remaining_burst_time > 0) {
+			dyn_array_push_back(rr_queue, round);
+		}
+	}
+
+	dyn_array_destroy(rr_queue);
+	free(pcb);
+	free(round);
+
+	result->average_waiting_time = (float)total_waiting / num_processes;
+	result->average_turnaround_time = (float)total_turnaround / num_processes;
+	result->total_run_time = current_time;
+
+	return true;
+}
+
+// Runs round robin on a copy of the incoming ready_queue.
+// \param: ready_queue - A dyn_array_t containing items of type ProcessControlBlock_t
+// \param: result - Struct used for stat tracking
+// \param: quantum - The quantum, or time slice, allocated to a pcb in each round
+// \return: True if the function ran successfully, false otherwise
+bool reference_round_robin(const dyn_array_t* ready_queue, ScheduleResult_t* result, size_t quantum)
+{
+	dyn_array_t* queue = copy_ready_queue(ready_queue);
+	bool success = round_robin_in_place(queue, result, quantum);
+	dyn_array_destroy(queue);
+	return success;
+}
+
+// Selects and extracts the process from the ready queue with the shortest remaining time.
+// \param: ready_queue - a pointer to the dynamic array containing the pool of processes
+// \param: current_time - the current simulation time used to evaluate if a process has arrived
+// \param: process - a pointer to the destination control block where the selected process data will be stored
+// \return: True if a process was successfully selected and extracted, else false on error or empty queue
+static bool select_shortest_remaining_time(dyn_array_t* ready_queue, unsigned long current_time, ProcessControlBlock_t* const process)
+{
+	// Validate input values
+	if (ready_queue == NULL || dyn_array_empty(ready_queue) || process == NULL) { return false; }
+
+	// Find the process with the shortest burst time remaining 
+	size_t prime_candidate_index = 0;
+	for (size_t i = 1; i < dyn_array_size(ready_queue); i++)
+	{
+		// Acquire two processes to compare
+		ProcessControlBlock_t* prime_candidate_process = dyn_array_at(ready_queue, prime_candidate_index);
+		ProcessControlBlock_t* candidate_process = dyn_array_at(ready_queue, i);
+		bool prime_candidate_arrived = prime_candidate_process->arrival <= current_time;
+		bool candidate_arrived = candidate_process->arrival <= current_time;
+
+		// If both process have arrived determine which one has the shorter burst time remaining
+		if (prime_candidate_arrived && candidate_arrived)
+		{
+			if (prime_candidate_process->remaining_burst_time > candidate_process->remaining_burst_time || 
+                (prime_candidate_process->remaining_burst_time == candidate_process->remaining_burst_time && 
+                prime_candidate_process->arrival > candidate_process->arrival))
+            {
+                prime_candidate_index = i;
+            }
+		}
+		// If neither have arrived determine which one has the earlier arrival time
+		else if (!prime_candidate_arrived && !candidate_arrived)
+		{
+			if (prime_candidate_process->arrival > candidate_process->arrival)
+            {
+                prime_candidate_index = i;
+            }
+            else if (prime_candidate_process->arrival == candidate_process->arrival && 
+                     prime_candidate_process->remaining_burst_time > candidate_process->remaining_burst_time)
+            {
+                prime_candidate_index = i;
+            }
+		}
+		// If only one arrived then it gets priority
+		else if (candidate_arrived)
+		{
+			prime_candidate_index = i;
+		}
+	}
+
+	// Store the selected process in the memory location provided
+	dyn_array_extract(ready_queue, prime_candidate_index, process);
+
+	return true;
+}
+
+// Runs the preemptive Shortest Remaining Time First Process Scheduling algorithm over the incoming ready_queue
+// \param: ready_queue - a dyn_array of type ProcessControlBlock_t that contain be up to N elements
+// \param: result - used for shortest job first stat tracking \ref ScheduleResult_t
+// \return: True if function ran successful else false for an error
+// There is no guarantee that the passed dyn_array_t will be the result of your implementation of load_process_control_blocks
+static bool shortest_remaining_time_first_in_place(dyn_array_t* ready_queue, ScheduleResult_t* result)
+{
+	// Validate input values
+	if (ready_queue == NULL || result == NULL) { return false; }
+	size_t process_count = dyn_array_size(ready_queue);
+	if (process_count == 0) { return false; }
+
+	// Create CPU variables
+	unsigned long current_time = 0;
+	unsigned long total_waiting = 0;
+	unsigned long total_turnaround = 0;
+
+	// Loop until the ready queue has been emptied
+	while (!dyn_array_empty(ready_queue))
+	{
+		// Acquire the process with the shortest burst time remaining
+		ProcessControlBlock_t target_process;
+		if (!select_shortest_remaining_time(ready_queue, current_time, &target_process)) { return false; }
+
+		// If the process has not been run on the CPU before then skip to the arrival time if needed and mark it as started
+		if (!target_process.started)
+		{
+			if (current_time < target_process.arrival) { current_time = target_process.arrival; }
+			else { total_waiting += current_time - target_process.arrival; }
+			target_process.started = true;
+		}
+
+		// A zero burst finishes without using the CPU
+		if (target_process.remaining_burst_time == 0)
+		{
+			total_turnaround += current_time - target_process.arrival;
+			continue;
+		}
+		
+		// Run the process on the CPU
+		virtual_cpu(&target_process);
+
+		// For all preempted processes in the ready queue increment the total wait time by one
+		for (size_t i = 0; i < dyn_array_size(ready_queue); i++)
+		{
+			ProcessControlBlock_t* process = dyn_array_at(ready_queue, i);
+			if (process->started) { total_waiting++; }
+		}
+
+		// Increment the CPU clock
+		current_time++;
+
+		// Push the process back to the ready queue if it has not fnished
+		if (target_process.remaining_burst_time > 0) { dyn_array_push_back(ready_queue, &target_process); }
+		else { total_turnaround += current_time - target_process.arrival; }
+	}
+
+	// Set the result values
+	result->average_waiting_time = (float)total_waiting / process_count;
+	result->average_turnaround_time = (float)total_turnaround / process_count;
+	result->total_run_time = current_time;
+
+	return true;
+}
+
+// Runs Shortest Remaining Time First on a copy of the incoming ready_queue.
+// \param: ready_queue - a dyn_array of type ProcessControlBlock_t that contain be up to N elements
+// \param: result - used for shortest job first stat tracking \ref ScheduleResult_t
+// \return: True if function ran successful else false for an error
+bool reference_shortest_remaining_time_first(const dyn_array_t* ready_queue, ScheduleResult_t* result)
+{
+	dyn_array_t* queue = copy_ready_queue(ready_queue);
+	bool success = shortest_remaining_time_first_in_place(queue, result);
+	dyn_array_destroy(queue);
+	return success;
+}
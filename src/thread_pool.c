@@ -0,0 +1,575 @@
+#define _GNU_SOURCE
+
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+// Slots in each worker's deque (a power of two), a task spawned into a full one runs on the spot
+#define DEQUE_CAPACITY 4096u
+
+// Chunks per thread when a parallel operation picks its own grain
+#define AUTO_CHUNKS_PER_THREAD 8u
+
+// Chunks when a parallel operation picks its own grain in deterministic mode, whatever the thread count
+#define DETERMINISTIC_CHUNKS 256u
+
+// Times a thread with nothing to do looks again before it sleeps
+#define IDLE_SPINS 64u
+
+struct pool_range;
+
+// A unit of work: a task group task, or a range of chunks of a parallel operation
+typedef struct pool_task
+{
+	void (*func)(void *);					// A task group task
+	void *arg;
+	const struct pool_range *range;			// Or chunks [first, last) of a parallel operation
+	size_t first;
+	size_t last;
+	thread_pool_task_group_t *group;		// Told when the task is done
+	struct pool_task *next;					// Next in the injection queue
+} pool_task_t;
+
+struct thread_pool_task_group
+{
+	atomic_uint pending;	// Tasks spawned and not finished yet, 32 bits so it can be waited on with a futex
+};
+
+// A parallel operation split into chunks of grain indices: chunk c covers [c * grain, min((c + 1) * grain, count))
+typedef struct pool_range
+{
+	size_t count;
+	size_t grain;
+	void (*index_func)(void *, size_t);						// One of these three
+	void (*range_func)(void *, size_t, size_t);
+	void (*map_func)(void *, size_t, size_t, void *);
+	uint8_t *partials;										// map_func's partial for chunk c is at c * partial_size
+	size_t partial_size;
+	void *arg;
+} pool_range_t;
+
+// A Chase-Lev deque: the owner pushes and pops at the bottom, anybody can steal from the top
+typedef struct
+{
+	_Alignas(64) atomic_llong top;
+	_Alignas(64) atomic_llong bottom;
+	_Alignas(64) _Atomic(pool_task_t *) slots[DEQUE_CAPACITY];
+} task_deque_t;
+
+// Guards starting and stopping the workers
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_idle = PTHREAD_COND_INITIALIZER;
+static size_t active_operations = 0;	// Parallel operations and task groups in flight
+static bool resizing = false;			// thread_pool_set_thread_count is waiting for them to finish
+static bool started = false;
+
+static pthread_t *workers = NULL;
+static task_deque_t *deques = NULL;		// One per worker
+static size_t worker_count = 0;
+static size_t requested_thread_count = 0;	// 0 means one per online CPU
+static atomic_bool deterministic = false;
+
+// Tasks spawned by threads that aren't workers
+static pthread_mutex_t inject_lock = PTHREAD_MUTEX_INITIALIZER;
+static pool_task_t *inject_head = NULL;
+static pool_task_t *inject_tail = NULL;
+static atomic_size_t inject_count = 0;
+
+// Where idle workers sleep
+static pthread_mutex_t sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sleep_cond = PTHREAD_COND_INITIALIZER;
+static atomic_size_t sleepers = 0;
+static bool shutting_down = false;
+
+// The deque this thread owns, -1 if it isn't a worker
+static _Thread_local long current_worker = -1;
+// Operations this thread is inside of, a nested one can't wait for a resize (it would wait for itself)
+static _Thread_local size_t operation_depth = 0;
+// Where this thread starts looking when it steals
+static _Thread_local uint32_t steal_seed = 0;
+
+static void futex_wait(atomic_uint *const address, const unsigned int expected)
+{
+	syscall(SYS_futex, (uint32_t *) address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static void futex_wake_all(atomic_uint *const address)
+{
+	syscall(SYS_futex, (uint32_t *) address, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+}
+
+// Adds a task at the bottom, false if the deque is full. Owner only
+static bool deque_push(task_deque_t *const deque, pool_task_t *const task)
+{
+	const long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	const long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	if (bottom - top >= (long long) DEQUE_CAPACITY) { return false; }
+	atomic_store_explicit(&deque->slots[bottom & (DEQUE_CAPACITY - 1)], task, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+	return true;
+}
+
+// Takes the newest task from the bottom, NULL if there is none. Owner only
+static pool_task_t* deque_pop(task_deque_t *const deque)
+{
+	const long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	long long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+	if (top > bottom)
+	{
+		atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+		return NULL;
+	}
+	pool_task_t *task = atomic_load_explicit(&deque->slots[bottom & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+	if (top == bottom)
+	{
+		// The last task, a thief could be after it too
+		if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) { task = NULL; }
+		atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+	}
+	return task;
+}
+
+// Takes the oldest task from the top, NULL if there is none (or another thief got it first)
+static pool_task_t* deque_steal(task_deque_t *const deque)
+{
+	long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	const long long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+	if (top >= bottom) { return NULL; }
+	pool_task_t *const task = atomic_load_explicit(&deque->slots[top & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) { return NULL; }
+	return task;
+}
+
+static void inject_push(pool_task_t *const task)
+{
+	task->next = NULL;
+	pthread_mutex_lock(&inject_lock);
+	if (inject_tail != NULL) { inject_tail->next = task; }
+	else { inject_head = task; }
+	inject_tail = task;
+	atomic_fetch_add(&inject_count, 1);
+	pthread_mutex_unlock(&inject_lock);
+}
+
+static pool_task_t* inject_pop(void)
+{
+	if (atomic_load_explicit(&inject_count, memory_order_relaxed) == 0) { return NULL; }
+	pthread_mutex_lock(&inject_lock);
+	pool_task_t *const task = inject_head;
+	if (task != NULL)
+	{
+		inject_head = task->next;
+		if (inject_head == NULL) { inject_tail = NULL; }
+		atomic_fetch_sub(&inject_count, 1);
+	}
+	pthread_mutex_unlock(&inject_lock);
+	return task;
+}
+
+// True if any task is waiting anywhere
+static bool work_visible(void)
+{
+	if (atomic_load(&inject_count) > 0) { return true; }
+	for (size_t i = 0; i < worker_count; i++)
+	{
+		if (atomic_load(&deques[i].top) < atomic_load(&deques[i].bottom)) { return true; }
+	}
+	return false;
+}
+
+// Wakes a sleeping worker, if there is one, after a task has been made visible
+static void wake_worker(void)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load(&sleepers) > 0)
+	{
+		pthread_mutex_lock(&sleep_lock);
+		pthread_cond_signal(&sleep_cond);
+		pthread_mutex_unlock(&sleep_lock);
+	}
+}
+
+// Own deque first (newest work, still in cache), then the injection queue, then steal the oldest work of a random worker
+static pool_task_t* find_task(void)
+{
+	pool_task_t *task = NULL;
+	if (current_worker >= 0 && (task = deque_pop(&deques[current_worker])) != NULL) { return task; }
+	if ((task = inject_pop()) != NULL) { return task; }
+	if (worker_count == 0) { return NULL; }
+
+	steal_seed = steal_seed * 1664525u + 1013904223u;
+	const size_t start = (steal_seed >> 8) % worker_count;
+	for (size_t i = 0; i < worker_count; i++)
+	{
+		const size_t victim = (start + i) % worker_count;
+		if ((long) victim == current_worker) { continue; }
+		if ((task = deque_steal(&deques[victim])) != NULL) { return task; }
+	}
+	return NULL;
+}
+
+static void run_task(pool_task_t *const task);
+
+// Hands a task to the pool: the worker's own deque, or the injection queue from any other thread
+static void spawn_task(pool_task_t *const task)
+{
+	atomic_fetch_add_explicit(&task->group->pending, 1, memory_order_relaxed);
+	if (current_worker >= 0)
+	{
+		// A full deque means plenty of work is queued already, so just do this one now
+		if (!deque_push(&deques[current_worker], task))
+		{
+			run_task(task);
+			return;
+		}
+	}
+	else
+	{
+		inject_push(task);
+	}
+	wake_worker();
+}
+
+// Runs chunk c of a parallel operation
+static void run_chunk(const pool_range_t *const range, const size_t chunk)
+{
+	const size_t begin = chunk * range->grain;
+	const size_t end = range->count - begin < range->grain ? range->count : begin + range->grain;
+	if (range->index_func != NULL)
+	{
+		for (size_t i = begin; i < end; i++) { range->index_func(range->arg, i); }
+	}
+	else if (range->range_func != NULL)
+	{
+		range->range_func(range->arg, begin, end);
+	}
+	else
+	{
+		range->map_func(range->arg, begin, end, range->partials + chunk * range->partial_size);
+	}
+}
+
+// Runs chunks [first, last): the top half goes back to the pool (for a thief) until one chunk is left
+static void run_chunks(const pool_range_t *const range, size_t first, size_t last, thread_pool_task_group_t *const group)
+{
+	while (last - first > 1)
+	{
+		const size_t middle = first + (last - first) / 2;
+		pool_task_t *const half = malloc(sizeof(pool_task_t));
+		if (half == NULL)
+		{
+			// Out of memory, this thread does that half too
+			for (size_t chunk = middle; chunk < last; chunk++) { run_chunk(range, chunk); }
+		}
+		else
+		{
+			*half = (pool_task_t) { NULL, NULL, range, middle, last, group, NULL };
+			spawn_task(half);
+		}
+		last = middle;
+	}
+	run_chunk(range, first);
+}
+
+static void run_task(pool_task_t *const task)
+{
+	if (task->range != NULL) { run_chunks(task->range, task->first, task->last, task->group); }
+	else { task->func(task->arg); }
+
+	thread_pool_task_group_t *const group = task->group;
+	free(task);
+	if (atomic_fetch_sub_explicit(&group->pending, 1, memory_order_acq_rel) == 1) { futex_wake_all(&group->pending); }
+}
+
+// Runs tasks (anybody's) until every task of group has finished, sleeping once there are none to run
+static void group_wait(thread_pool_task_group_t *const group)
+{
+	unsigned int spins = 0;
+	for (;;)
+	{
+		const unsigned int pending = atomic_load_explicit(&group->pending, memory_order_acquire);
+		if (pending == 0) { return; }
+		pool_task_t *const task = find_task();
+		if (task != NULL)
+		{
+			run_task(task);
+			spins = 0;
+		}
+		else if (++spins < IDLE_SPINS)
+		{
+			sched_yield();
+		}
+		else
+		{
+			// Every task of the group is running on another thread (a waiter always finds its own spawns), so just wait
+			futex_wait(&group->pending, pending);
+			spins = 0;
+		}
+	}
+}
+
+// Worker main loop, the argument is the worker's index
+static void* thread_pool_worker(void *index)
+{
+	current_worker = (long) (uintptr_t) index;
+	steal_seed = (uint32_t) current_worker * 2654435761u;
+	unsigned int spins = 0;
+	for (;;)
+	{
+		pool_task_t *const task = find_task();
+		if (task != NULL)
+		{
+			run_task(task);
+			spins = 0;
+			continue;
+		}
+		if (++spins < IDLE_SPINS)
+		{
+			sched_yield();
+			continue;
+		}
+
+		// Counted as a sleeper before the last look, so a task spawned after it is either seen or wakes us
+		pthread_mutex_lock(&sleep_lock);
+		atomic_fetch_add(&sleepers, 1);
+		atomic_thread_fence(memory_order_seq_cst);
+		while (!shutting_down && !work_visible())
+		{
+			pthread_cond_wait(&sleep_cond, &sleep_lock);
+		}
+		atomic_fetch_sub(&sleepers, 1);
+		const bool leave = shutting_down;
+		pthread_mutex_unlock(&sleep_lock);
+		if (leave) { break; }
+		spins = 0;
+	}
+	return NULL;
+}
+
+size_t thread_pool_thread_count(void)
+{
+	size_t thread_count = requested_thread_count;
+	if (thread_count == 0)
+	{
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		thread_count = online > 0 ? (size_t) online : 1;
+	}
+	return thread_count;
+}
+
+// Starts the workers. Must hold pool_lock with nothing in flight.
+// If some threads can't be created we just run with fewer.
+static void thread_pool_start(void)
+{
+	started = true;
+	const size_t wanted = thread_pool_thread_count() - 1;
+	if (wanted == 0) { return; }
+	workers = malloc(sizeof(pthread_t) * wanted);
+	deques = aligned_alloc(_Alignof(task_deque_t), sizeof(task_deque_t) * wanted);
+	if (workers == NULL || deques == NULL)
+	{
+		free(workers);
+		free(deques);
+		workers = NULL;
+		deques = NULL;
+		return;
+	}
+	memset(deques, 0, sizeof(task_deque_t) * wanted);
+
+	// worker_count only counts deques whose thread is running, stealing never looks past it
+	for (worker_count = 0; worker_count < wanted; worker_count++)
+	{
+		if (pthread_create(&workers[worker_count], NULL, thread_pool_worker, (void *) (uintptr_t) worker_count) != 0) { break; }
+	}
+}
+
+// Stops and joins all workers. Must hold pool_lock with nothing in flight.
+static void thread_pool_stop(void)
+{
+	pthread_mutex_lock(&sleep_lock);
+	shutting_down = true;
+	pthread_cond_broadcast(&sleep_cond);
+	pthread_mutex_unlock(&sleep_lock);
+
+	for (size_t i = 0; i < worker_count; i++)
+	{
+		pthread_join(workers[i], NULL);
+	}
+	free(workers);
+	free(deques);
+	workers = NULL;
+	deques = NULL;
+	worker_count = 0;
+	shutting_down = false;
+	started = false;
+}
+
+// Marks a parallel operation (or task group) as in flight, starting the workers if they aren't running
+static void operation_begin(void)
+{
+	pthread_mutex_lock(&pool_lock);
+	while (resizing && operation_depth == 0 && current_worker < 0)
+	{
+		pthread_cond_wait(&pool_idle, &pool_lock);
+	}
+	if (!started) { thread_pool_start(); }
+	active_operations++;
+	pthread_mutex_unlock(&pool_lock);
+	operation_depth++;
+}
+
+static void operation_end(void)
+{
+	operation_depth--;
+	pthread_mutex_lock(&pool_lock);
+	if (--active_operations == 0) { pthread_cond_broadcast(&pool_idle); }
+	pthread_mutex_unlock(&pool_lock);
+}
+
+void thread_pool_set_thread_count(const size_t thread_count)
+{
+	pthread_mutex_lock(&pool_lock);
+	// One resize at a time, then wait for everything in flight
+	while (resizing)
+	{
+		pthread_cond_wait(&pool_idle, &pool_lock);
+	}
+	resizing = true;
+	while (active_operations > 0)
+	{
+		pthread_cond_wait(&pool_idle, &pool_lock);
+	}
+	if (started) { thread_pool_stop(); }
+	requested_thread_count = thread_count;
+	resizing = false;
+	pthread_cond_broadcast(&pool_idle);
+	pthread_mutex_unlock(&pool_lock);
+}
+
+void thread_pool_set_deterministic(const bool enabled)
+{
+	atomic_store(&deterministic, enabled);
+}
+
+bool thread_pool_deterministic(void)
+{
+	return atomic_load(&deterministic);
+}
+
+// The grain for a parallel operation that didn't ask for one
+static size_t auto_grain(const size_t count)
+{
+	const size_t chunks = atomic_load(&deterministic) ? DETERMINISTIC_CHUNKS : thread_pool_thread_count() * AUTO_CHUNKS_PER_THREAD;
+	const size_t grain = (count + chunks - 1) / chunks;
+	return grain > 0 ? grain : 1;
+}
+
+// Runs every chunk of a parallel operation, the calling thread splits off the first tasks and helps until they are done
+static void run_range(pool_range_t *const range)
+{
+	const size_t chunk_count = (range->count + range->grain - 1) / range->grain;
+	if (chunk_count < 2)
+	{
+		if (chunk_count == 1) { run_chunk(range, 0); }
+		return;
+	}
+	operation_begin();
+	thread_pool_task_group_t group = { 0 };
+	run_chunks(range, 0, chunk_count, &group);
+	group_wait(&group);
+	operation_end();
+}
+
+bool thread_pool_parallel_for(const size_t count, void (*const func)(void *, size_t), void *arg)
+{
+	// Validate input values
+	if (func == NULL) { return false; }
+
+	pool_range_t range = { count, 1, func, NULL, NULL, NULL, 0, arg };
+	run_range(&range);
+	return true;
+}
+
+bool thread_pool_parallel_for_chunked(const size_t count, const size_t grain, void (*const func)(void *, size_t, size_t), void *arg)
+{
+	// Validate input values
+	if (func == NULL) { return false; }
+
+	pool_range_t range = { count, grain > 0 ? grain : auto_grain(count), NULL, func, NULL, NULL, 0, arg };
+	run_range(&range);
+	return true;
+}
+
+bool thread_pool_parallel_reduce(const size_t count, const size_t grain, const size_t partial_size,
+								 void (*const map)(void *, size_t, size_t, void *), void (*const combine)(void *, const void *), void *arg)
+{
+	// Validate input values
+	if (map == NULL || combine == NULL || partial_size == 0) { return false; }
+
+	pool_range_t range = { count, grain > 0 ? grain : auto_grain(count), NULL, NULL, map, NULL, partial_size, arg };
+	const size_t chunk_count = (count + range.grain - 1) / range.grain;
+	if (chunk_count == 0) { return true; }
+	range.partials = calloc(chunk_count, partial_size);
+	if (range.partials == NULL) { return false; }
+
+	run_range(&range);
+
+	// Combine in chunk order, so it comes out the same whichever thread ran what
+	for (size_t chunk = 0; chunk < chunk_count; chunk++)
+	{
+		combine(arg, range.partials + chunk * partial_size);
+	}
+	free(range.partials);
+	return true;
+}
+
+thread_pool_task_group_t* thread_pool_task_group_create(void)
+{
+	thread_pool_task_group_t *const group = malloc(sizeof(thread_pool_task_group_t));
+	if (group == NULL) { return NULL; }
+	atomic_init(&group->pending, 0);
+	operation_begin();
+	return group;
+}
+
+bool thread_pool_task_group_run(thread_pool_task_group_t *const group, void (*const func)(void *), void *arg)
+{
+	// Validate input values
+	if (group == NULL || func == NULL) { return false; }
+
+	pool_task_t *const task = malloc(sizeof(pool_task_t));
+	if (task == NULL)
+	{
+		// No room to queue it, it still runs
+		func(arg);
+		return true;
+	}
+	*task = (pool_task_t) { func, arg, NULL, 0, 0, group, NULL };
+	spawn_task(task);
+	return true;
+}
+
+void thread_pool_task_group_wait(thread_pool_task_group_t *const group)
+{
+	if (group != NULL) { group_wait(group); }
+}
+
+void thread_pool_task_group_destroy(thread_pool_task_group_t *const group)
+{
+	if (group == NULL) { return; }
+	group_wait(group);
+	operation_end();
+	free(group);
+}
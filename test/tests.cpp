@@ -1,8 +1,30 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include "gtest/gtest.h"
 #include "../include/processing_scheduling.h"
+#include "../include/process_scheduling_reference.h"
+#include "../include/pcb_channel.h"
+#include "../include/pcb_columns.h"
+#include "../include/pcb_sort.h"
+#include "../include/dyn_array.hpp"
+#include "../include/thread_pool.h"
 
 // Using a C library requires extern "C" to prevent function mangling
 extern "C"
@@ -861,6 +883,2542 @@ TEST(load_process_control_blocks, ValidRead) {
 	dyn_array_destroy(data);
 }
 
+/*
+*  DYN_ARRAY UNORDERED AND TOMBSTONE REMOVAL UNIT TEST CASES
+**/
+TEST(dyn_array_extract_swap, MovesLastIntoHole) {
+	int data[] = { 1, 2, 3, 4, 5 };
+	dyn_array_t* array = dyn_array_import(data, 5, sizeof(int), NULL);
+	int out = 0;
+
+	EXPECT_TRUE(dyn_array_extract_swap(array, 1, &out));
+	EXPECT_EQ(2, out);
+	EXPECT_EQ((size_t)4, dyn_array_size(array));
+	EXPECT_EQ(5, *(int*)dyn_array_at(array, 1));
+	EXPECT_EQ(4, *(int*)dyn_array_back(array));
+
+	EXPECT_TRUE(dyn_array_extract_swap(array, 3, &out));
+	EXPECT_EQ(4, out);
+	EXPECT_EQ((size_t)3, dyn_array_size(array));
+
+	EXPECT_FALSE(dyn_array_extract_swap(array, 3, &out));
+	EXPECT_FALSE(dyn_array_extract_swap(array, 0, NULL));
+	EXPECT_FALSE(dyn_array_erase_swap(NULL, 0));
+
+	dyn_array_destroy(array);
+}
+
+TEST(dyn_array_tombstones, ExtractKeepsIndicesAndOrder) {
+	int data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	dyn_array_t* array = dyn_array_import(data, 8, sizeof(int), NULL);
+	ASSERT_TRUE(dyn_array_enable_tombstones(array, 100));
+	int out = 0;
+
+	EXPECT_TRUE(dyn_array_extract(array, 2, &out));
+	EXPECT_EQ(3, out);
+	EXPECT_EQ((size_t)8, dyn_array_size(array));
+	EXPECT_EQ(NULL, dyn_array_at(array, 2));
+	EXPECT_EQ(4, *(int*)dyn_array_at(array, 3));
+	EXPECT_FALSE(dyn_array_extract(array, 2, &out));
+
+	EXPECT_TRUE(dyn_array_erase(array, 0));
+	EXPECT_EQ(2, *(int*)dyn_array_front(array));
+
+	// Removing the back also drops the dead slots it was hiding
+	EXPECT_TRUE(dyn_array_extract(array, 6, &out));
+	EXPECT_TRUE(dyn_array_extract(array, 7, &out));
+	EXPECT_EQ((size_t)6, dyn_array_size(array));
+	EXPECT_EQ(6, *(int*)dyn_array_back(array));
+
+	// Appending keeps the tombstones, anything else compacts
+	int pushed = 9;
+	EXPECT_TRUE(dyn_array_push_back(array, &pushed));
+	EXPECT_EQ(NULL, dyn_array_at(array, 0));
+	EXPECT_TRUE(dyn_array_extract_front(array, &out));
+	EXPECT_EQ(2, out);
+
+	int expected[] = { 4, 5, 6, 9 };
+	ASSERT_EQ((size_t)4, dyn_array_size(array));
+	for (size_t i = 0; i < 4; i++) { EXPECT_EQ(expected[i], *(int*)dyn_array_at(array, i)); }
+
+	dyn_array_destroy(array);
+}
+
+static int destroyed_ints = 0;
+static void count_destroyed(void* const object) { (void)object; destroyed_ints++; }
+
+TEST(dyn_array_tombstones, PopAndExtractBackSkipDeadSlots) {
+	int data[] = { 1, 2, 3, 4, 5, 6 };
+	dyn_array_t* array = dyn_array_import(data, 6, sizeof(int), count_destroyed);
+	ASSERT_TRUE(dyn_array_enable_tombstones(array, 100));
+	destroyed_ints = 0;
+	int out = 0;
+
+	// 1 2 x 4 x 6: taking the 6 exposes a dead slot, which goes with it
+	EXPECT_TRUE(dyn_array_erase(array, 2));
+	EXPECT_TRUE(dyn_array_erase(array, 4));
+	EXPECT_TRUE(dyn_array_extract_back(array, &out));
+	EXPECT_EQ(6, out);
+	ASSERT_EQ((size_t)4, dyn_array_size(array));
+	EXPECT_EQ(4, *(int*)dyn_array_back(array));
+
+	// Popping the 4 does the same, leaving 1 2
+	EXPECT_TRUE(dyn_array_pop_back(array));
+	ASSERT_EQ((size_t)2, dyn_array_size(array));
+	EXPECT_EQ(2, *(int*)dyn_array_back(array));
+	EXPECT_EQ(1, *(int*)dyn_array_front(array));
+
+	// With only dead slots in front of the back, the array empties
+	EXPECT_TRUE(dyn_array_erase(array, 0));
+	EXPECT_TRUE(dyn_array_extract_back(array, &out));
+	EXPECT_EQ(2, out);
+	EXPECT_TRUE(dyn_array_empty(array));
+	EXPECT_EQ(NULL, dyn_array_front(array));
+	EXPECT_EQ(NULL, dyn_array_back(array));
+	EXPECT_FALSE(dyn_array_pop_back(array));
+	EXPECT_FALSE(dyn_array_extract_back(array, &out));
+
+	// Every element was destroyed or extracted exactly once
+	EXPECT_EQ(4, destroyed_ints);
+	dyn_array_destroy(array);
+	EXPECT_EQ(4, destroyed_ints);
+}
+
+static void sum_ints(void* const object, void* arg) { *(int*)arg += *(int*)object; }
+
+TEST(dyn_array_tombstones, ThresholdCompactsAndForEachSkipsDead) {
+	int data[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	dyn_array_t* array = dyn_array_import(data, 10, sizeof(int), NULL);
+	ASSERT_TRUE(dyn_array_enable_tombstones(array, 30));
+	EXPECT_FALSE(dyn_array_enable_tombstones(array, 0));
+	EXPECT_FALSE(dyn_array_enable_tombstones(array, 101));
+
+	EXPECT_TRUE(dyn_array_erase(array, 0));
+	EXPECT_TRUE(dyn_array_erase(array, 4));
+	EXPECT_EQ((size_t)10, dyn_array_size(array));
+
+	int sum = 0;
+	EXPECT_TRUE(dyn_array_for_each(array, sum_ints, &sum));
+	EXPECT_EQ(49, sum);
+
+	// Third dead slot hits 30%
+	EXPECT_TRUE(dyn_array_erase(array, 8));
+	EXPECT_EQ((size_t)7, dyn_array_size(array));
+	int expected[] = { 2, 3, 4, 6, 7, 8, 10 };
+	for (size_t i = 0; i < 7; i++) { EXPECT_EQ(expected[i], *(int*)dyn_array_at(array, i)); }
+
+	dyn_array_disable_tombstones(array);
+	EXPECT_TRUE(dyn_array_erase(array, 0));
+	EXPECT_EQ(3, *(int*)dyn_array_front(array));
+
+	dyn_array_destroy(array);
+}
+
+TEST(dyn_array_tombstones, GrowthKeepsMarks) {
+	dyn_array_t* array = dyn_array_create(0, sizeof(int), NULL);
+	ASSERT_TRUE(dyn_array_enable_tombstones(array, 100));
+	for (int i = 0; i < 16; i++) { dyn_array_push_back(array, &i); }
+	EXPECT_TRUE(dyn_array_erase(array, 3));
+	for (int i = 16; i < 100; i++) { dyn_array_push_back(array, &i); }
+
+	EXPECT_EQ(NULL, dyn_array_at(array, 3));
+	for (size_t i = 4; i < 100; i++) { EXPECT_EQ((int)i, *(int*)dyn_array_at(array, i)); }
+
+	dyn_array_compact(array);
+	EXPECT_EQ((size_t)99, dyn_array_size(array));
+	EXPECT_EQ(4, *(int*)dyn_array_at(array, 3));
+
+	dyn_array_destroy(array);
+}
+
+/*
+*  TYPED DYN_ARRAY UNIT TEST CASES
+**/
+TEST(typed_dyn_array, PushGrowAndIterate) {
+	static_assert(hw2::dyn_array<ProcessControlBlock_t>::data_size == sizeof(ProcessControlBlock_t), "compile time size");
+	hw2::dyn_array<uint32_t> array;
+	EXPECT_TRUE(array.empty());
+	for (uint32_t i = 0; i < 100; i++) { array.push_back(i); }
+
+	EXPECT_EQ((size_t)100, array.size());
+	EXPECT_EQ((size_t)128, array.capacity());
+	uint32_t sum = 0;
+	for (uint32_t value : array) { sum += value; }
+	EXPECT_EQ((uint32_t)4950, sum);
+	EXPECT_EQ((uint32_t)99, array.back());
+	EXPECT_THROW(array.at(100), std::out_of_range);
+
+	array.erase_swap(0);
+	EXPECT_EQ((uint32_t)99, array.front());
+	EXPECT_EQ((size_t)99, array.size());
+}
+
+TEST(typed_dyn_array, GrowthMovesObjects) {
+	hw2::dyn_array<std::unique_ptr<std::string>> array;
+	for (int i = 0; i < 40; i++) { array.emplace_back(new std::string(std::to_string(i))); }
+	EXPECT_EQ("0", *array[0]);
+	EXPECT_EQ("39", *array[39]);
+
+	hw2::dyn_array<std::unique_ptr<std::string>> moved(std::move(array));
+	EXPECT_TRUE(array.empty());
+	EXPECT_EQ((size_t)40, moved.size());
+	moved.erase_swap(5);
+	EXPECT_EQ("39", *moved[5]);
+}
+
+// Counts live objects and throws on the copy it is told to
+struct CopyCounter
+{
+	static int live;
+	static int copies_left;
+	CopyCounter() { live++; }
+	CopyCounter(const CopyCounter&)
+	{
+		if (copies_left-- == 0) { throw std::runtime_error("copy failed"); }
+		live++;
+	}
+	~CopyCounter() { live--; }
+};
+int CopyCounter::live = 0;
+int CopyCounter::copies_left = -1;
+
+TEST(typed_dyn_array, FailedCopyDestroysWhatWasBuilt) {
+	{
+		std::vector<CopyCounter> source(10);
+		hw2::dyn_array<CopyCounter> array(source.data(), source.size());
+		EXPECT_EQ(20, CopyCounter::live);
+
+		CopyCounter::copies_left = 4;
+		EXPECT_THROW(hw2::dyn_array<CopyCounter> partial(source.data(), source.size()), std::runtime_error);
+		EXPECT_EQ(20, CopyCounter::live);
+		CopyCounter::copies_left = 6;
+		EXPECT_THROW(hw2::dyn_array<CopyCounter> copy(array), std::runtime_error);
+		EXPECT_EQ(20, CopyCounter::live);
+		CopyCounter::copies_left = -1;
+	}
+	EXPECT_EQ(0, CopyCounter::live);
+}
+
+TEST(typed_dyn_array, RoundTripsThroughC) {
+	ProcessControlBlock_t data[] = {
+		{ .remaining_burst_time = 5, .priority = 2, .arrival = 0, .started = false },
+		{ .remaining_burst_time = 3, .priority = 1, .arrival = 1, .started = false }
+	};
+	hw2::dyn_array<ProcessControlBlock_t> typed(data, 2);
+	dyn_array_t* c_array = typed.to_c();
+	ASSERT_NE((dyn_array_t*)NULL, c_array);
+	EXPECT_EQ((size_t)2, dyn_array_size(c_array));
+
+	hw2::dyn_array<ProcessControlBlock_t> copy = hw2::dyn_array<ProcessControlBlock_t>::from_c(c_array);
+	EXPECT_EQ((size_t)2, copy.size());
+	EXPECT_EQ((uint32_t)3, copy[1].remaining_burst_time);
+	EXPECT_THROW(hw2::dyn_array<uint32_t>::from_c(c_array), std::invalid_argument);
+	dyn_array_destroy(c_array);
+
+	dyn_array_t* empty = hw2::dyn_array<ProcessControlBlock_t>().to_c();
+	EXPECT_NE((dyn_array_t*)NULL, empty);
+	EXPECT_TRUE(dyn_array_empty(empty));
+	dyn_array_destroy(empty);
+}
+
+TEST(typed_dyn_array, FeedsScheduler) {
+	hw2::dyn_array<ProcessControlBlock_t> workload;
+	for (uint32_t i = 0; i < 3; i++) { workload.push_back(ProcessControlBlock_t{ 5, 0, i, false }); }
+
+	dyn_array_t* ready_queue = workload.to_c();
+	ScheduleResult_t result;
+	EXPECT_TRUE(first_come_first_serve(ready_queue, &result));
+	EXPECT_NEAR(result.average_waiting_time, 4.0f, 0.01);
+	EXPECT_EQ(result.total_run_time, 15UL);
+	dyn_array_destroy(ready_queue);
+}
+
+/*
+*  DYN_ARRAY PARALLEL UNIT TEST CASES
+**/
+static int compare_by_arrival(const void* a, const void* b)
+{
+	const ProcessControlBlock_t* x = (const ProcessControlBlock_t*)a;
+	const ProcessControlBlock_t* y = (const ProcessControlBlock_t*)b;
+	if (x->arrival != y->arrival) { return x->arrival < y->arrival ? -1 : 1; }
+	if (x->remaining_burst_time != y->remaining_burst_time) { return x->remaining_burst_time < y->remaining_burst_time ? -1 : 1; }
+	return 0;
+}
+
+static dyn_array_t* random_pcbs(size_t count, uint32_t seed)
+{
+	dyn_array_t* array = dyn_array_create(count, sizeof(ProcessControlBlock_t), NULL);
+	for (size_t i = 0; i < count; i++)
+	{
+		seed = seed * 1103515245u + 12345u;
+		ProcessControlBlock_t pcb = { (uint32_t)i, seed % 8, (seed >> 8) % 50000, false };
+		dyn_array_push_back(array, &pcb);
+	}
+	return array;
+}
+
+static void double_burst(void* const object, void*) { ((ProcessControlBlock_t*)object)->remaining_burst_time *= 2; }
+static void sum_burst(void* const object, void* state) { *(uint64_t*)state += ((ProcessControlBlock_t*)object)->remaining_burst_time; }
+static void add_u64(void* total, const void* state) { *(uint64_t*)total += *(const uint64_t*)state; }
+
+TEST(dyn_array_parallel, ForEachMatchesSerial) {
+	thread_pool_set_thread_count(4);
+	dyn_array_t* array = random_pcbs(100000, 7);
+
+	EXPECT_TRUE(dyn_array_parallel_for_each(array, double_burst, NULL, 0, NULL));
+	uint64_t parallel_sum = 0;
+	EXPECT_TRUE(dyn_array_parallel_for_each(array, sum_burst, &parallel_sum, sizeof(uint64_t), add_u64));
+	uint64_t serial_sum = 0;
+	EXPECT_TRUE(dyn_array_for_each(array, sum_burst, &serial_sum));
+
+	EXPECT_EQ(serial_sum, parallel_sum);
+	EXPECT_EQ((uint64_t)100000 * 99999, parallel_sum);
+	EXPECT_FALSE(dyn_array_parallel_for_each(array, sum_burst, &parallel_sum, sizeof(uint64_t), NULL));
+
+	dyn_array_destroy(array);
+	thread_pool_set_thread_count(0);
+}
+
+TEST(dyn_array_parallel, SortMatchesSerial) {
+	for (size_t threads = 1; threads <= 5; threads++)
+	{
+		thread_pool_set_thread_count(threads);
+		dyn_array_t* serial = random_pcbs(100003, 11);
+		dyn_array_t* parallel = random_pcbs(100003, 11);
+
+		EXPECT_TRUE(dyn_array_sort(serial, compare_by_arrival));
+		EXPECT_TRUE(dyn_array_parallel_sort(parallel, compare_by_arrival));
+		EXPECT_EQ(0, memcmp(dyn_array_export(serial), dyn_array_export(parallel), 100003 * sizeof(ProcessControlBlock_t)));
+
+		dyn_array_destroy(serial);
+		dyn_array_destroy(parallel);
+	}
+	thread_pool_set_thread_count(0);
+}
+
+/*
+*  THREAD POOL UNIT TEST CASES
+**/
+struct IndexCounts
+{
+	std::vector<std::atomic<uint32_t>> hits;
+	std::atomic<uint32_t> bad_chunks;
+	size_t grain;
+	explicit IndexCounts(size_t count) : hits(count), bad_chunks(0), grain(0) {}
+};
+
+static void count_indices(void* arg, size_t begin, size_t end)
+{
+	IndexCounts* counts = (IndexCounts*)arg;
+	if (begin >= end || (counts->grain && (begin % counts->grain || (end - begin != counts->grain && end != counts->hits.size())))) { counts->bad_chunks++; }
+	for (size_t i = begin; i < end; i++) { counts->hits[i]++; }
+}
+
+static void count_index(void* arg, size_t index) { count_indices(arg, index, index + 1); }
+
+TEST(thread_pool, ChunkedCoversEveryIndexOnce) {
+	thread_pool_set_thread_count(4);
+	const size_t grains[] = { 0, 1, 7, 4096, 200000 };
+	for (size_t grain : grains)
+	{
+		IndexCounts counts(100003);
+		counts.grain = grain;
+		EXPECT_TRUE(thread_pool_parallel_for_chunked(counts.hits.size(), grain, count_indices, &counts));
+		EXPECT_EQ(0U, counts.bad_chunks.load());
+		for (size_t i = 0; i < counts.hits.size(); i++) { ASSERT_EQ(1U, counts.hits[i].load()) << "grain " << grain << " index " << i; }
+	}
+
+	IndexCounts counts(1000);
+	EXPECT_TRUE(thread_pool_parallel_for(counts.hits.size(), count_index, &counts));
+	for (size_t i = 0; i < counts.hits.size(); i++) { ASSERT_EQ(1U, counts.hits[i].load()); }
+	EXPECT_TRUE(thread_pool_parallel_for_chunked(0, 0, count_indices, &counts));
+	EXPECT_FALSE(thread_pool_parallel_for_chunked(10, 0, NULL, &counts));
+	thread_pool_set_thread_count(0);
+}
+
+struct TreeTask
+{
+	thread_pool_task_group_t* group;
+	std::atomic<uint64_t>* leaves;
+	unsigned depth;
+};
+
+// Every task adds two children to the group until depth runs out
+static void grow_tree(void* arg)
+{
+	TreeTask* task = (TreeTask*)arg;
+	if (task->depth == 0)
+	{
+		(*task->leaves)++;
+		delete task;
+		return;
+	}
+	for (int child = 0; child < 2; child++)
+	{
+		thread_pool_task_group_run(task->group, grow_tree, new TreeTask{ task->group, task->leaves, task->depth - 1 });
+	}
+	delete task;
+}
+
+static void nested_loop(void* arg, size_t)
+{
+	IndexCounts* counts = (IndexCounts*)arg;
+	thread_pool_parallel_for_chunked(counts->hits.size(), 3, count_indices, counts);
+}
+
+TEST(thread_pool, TaskGroupsAndNestedLoops) {
+	thread_pool_set_thread_count(4);
+	thread_pool_task_group_t* group = thread_pool_task_group_create();
+	ASSERT_NE((thread_pool_task_group_t*)NULL, group);
+	std::atomic<uint64_t> leaves(0);
+	EXPECT_TRUE(thread_pool_task_group_run(group, grow_tree, new TreeTask{ group, &leaves, 12 }));
+	thread_pool_task_group_wait(group);
+	EXPECT_EQ(4096U, leaves.load());
+
+	// A group can be reused after a wait
+	EXPECT_TRUE(thread_pool_task_group_run(group, grow_tree, new TreeTask{ group, &leaves, 3 }));
+	thread_pool_task_group_destroy(group);
+	EXPECT_EQ(4104U, leaves.load());
+	EXPECT_FALSE(thread_pool_task_group_run(NULL, grow_tree, NULL));
+
+	// Loops inside loops all run to completion
+	IndexCounts counts(1000);
+	EXPECT_TRUE(thread_pool_parallel_for(16, nested_loop, &counts));
+	for (size_t i = 0; i < counts.hits.size(); i++) { ASSERT_EQ(16U, counts.hits[i].load()); }
+	thread_pool_set_thread_count(0);
+}
+
+static void* loop_from_thread(void* arg)
+{
+	IndexCounts* counts = (IndexCounts*)arg;
+	for (int round = 0; round < 20; round++) { thread_pool_parallel_for_chunked(counts->hits.size(), 0, count_indices, counts); }
+	return NULL;
+}
+
+TEST(thread_pool, ConcurrentCallersAndResize) {
+	thread_pool_set_thread_count(3);
+	IndexCounts counts(50000);
+	pthread_t callers[3];
+	for (pthread_t& caller : callers) { ASSERT_EQ(0, pthread_create(&caller, NULL, loop_from_thread, &counts)); }
+	// Resizing waits for whatever is running and the callers carry on afterwards
+	thread_pool_set_thread_count(2);
+	for (pthread_t& caller : callers) { pthread_join(caller, NULL); }
+	for (size_t i = 0; i < counts.hits.size(); i++) { ASSERT_EQ(60U, counts.hits[i].load()); }
+	thread_pool_set_thread_count(0);
+}
+
+struct FloatSum
+{
+	std::vector<float> values;
+	float sum;
+};
+
+static void sum_floats(void* arg, size_t begin, size_t end, void* partial)
+{
+	const FloatSum* job = (const FloatSum*)arg;
+	for (size_t i = begin; i < end; i++) { *(float*)partial += job->values[i]; }
+}
+
+static void add_float(void* arg, const void* partial) { ((FloatSum*)arg)->sum += *(const float*)partial; }
+
+TEST(thread_pool, DeterministicReduce) {
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> values_between(-1000.0f, 1000.0f);
+	FloatSum job;
+	for (size_t i = 0; i < 123457; i++) { job.values.push_back(values_between(random)); }
+
+	thread_pool_set_deterministic(true);
+	EXPECT_TRUE(thread_pool_deterministic());
+	std::vector<float> sums;
+	for (size_t threads = 1; threads <= 5; threads++)
+	{
+		thread_pool_set_thread_count(threads);
+		for (int repeat = 0; repeat < 3; repeat++)
+		{
+			job.sum = 0.0f;
+			EXPECT_TRUE(thread_pool_parallel_reduce(job.values.size(), 0, sizeof(float), sum_floats, add_float, &job));
+			sums.push_back(job.sum);
+		}
+	}
+	thread_pool_set_deterministic(false);
+	for (float sum : sums) { EXPECT_EQ(0, memcmp(&sums[0], &sum, sizeof(float))); }
+
+	EXPECT_FALSE(thread_pool_parallel_reduce(10, 0, 0, sum_floats, add_float, &job));
+	EXPECT_FALSE(thread_pool_parallel_reduce(10, 0, sizeof(float), sum_floats, NULL, &job));
+	thread_pool_set_thread_count(0);
+}
+
+/*
+*  DYN_ARRAY LARGE ARRAY MODE UNIT TEST CASES
+**/
+TEST(dyn_array_create_mapped, RoundsCapacityToPages) {
+	dyn_array_t* array = dyn_array_create_mapped(10, sizeof(ProcessControlBlock_t), NULL, 0);
+	ASSERT_NE((dyn_array_t*)NULL, array);
+	EXPECT_TRUE(dyn_array_empty(array));
+	EXPECT_EQ((size_t)sysconf(_SC_PAGESIZE) / sizeof(ProcessControlBlock_t), dyn_array_capacity(array));
+	EXPECT_EQ(NULL, dyn_array_create_mapped(10, 0, NULL, 0));
+	dyn_array_destroy(array);
+}
+
+TEST(dyn_array_create_mapped, GrowsWithoutLosingData) {
+	dyn_array_t* array = dyn_array_create_mapped(0, sizeof(uint64_t), NULL, DYN_MAP_HUGEPAGES);
+	ASSERT_NE((dyn_array_t*)NULL, array);
+	for (uint64_t i = 0; i < 1000000; i++) { ASSERT_TRUE(dyn_array_push_back(array, &i)); }
+	EXPECT_GE(dyn_array_capacity(array), (size_t)1000000);
+
+	uint64_t front = 42;
+	EXPECT_TRUE(dyn_array_push_front(array, &front));
+	EXPECT_EQ((uint64_t)42, *(uint64_t*)dyn_array_front(array));
+	for (uint64_t i = 0; i < 1000000; i += 999) { EXPECT_EQ(i, *(uint64_t*)dyn_array_at(array, i + 1)); }
+
+	dyn_array_destroy(array);
+}
+
+TEST(dyn_array_create_mapped, TombstonesCoverRoundedCapacity) {
+	// The mapping rounds up to pages, so reserving 300 gives more than 300 slots and the tombstones have to cover all of them
+	dyn_array_t* array = dyn_array_create_mapped(256, 16, NULL, 0);
+	ASSERT_NE((dyn_array_t*)NULL, array);
+	ASSERT_TRUE(dyn_array_enable_tombstones(array, 100));
+	ASSERT_TRUE(dyn_array_reserve(array, 300));
+	const size_t capacity = dyn_array_capacity(array);
+	EXPECT_GT(capacity, (size_t)300);
+
+	uint8_t object[16] = { 0 };
+	for (size_t i = 0; i < capacity; i++)
+	{
+		object[0] = (uint8_t)i;
+		ASSERT_TRUE(dyn_array_push_back(array, object));
+	}
+	EXPECT_EQ(capacity, dyn_array_capacity(array));
+	for (size_t i = capacity - 1; i >= 400; i -= 25) { ASSERT_TRUE(dyn_array_erase(array, i)); }
+	EXPECT_EQ((uint8_t)399, *(uint8_t*)dyn_array_at(array, 399));
+
+	// Shrinking keeps them covering what is left
+	ASSERT_TRUE(dyn_array_shrink_to_fit(array));
+	ASSERT_TRUE(dyn_array_erase(array, dyn_array_size(array) - 1));
+	EXPECT_EQ((uint8_t)0, *(uint8_t*)dyn_array_at(array, 0));
+	dyn_array_destroy(array);
+}
+
+/*
+*  DYN_ARRAY CLONE UNIT TEST CASES
+**/
+TEST(dyn_array_clone, SharesUntilWritten) {
+	int data[] = { 1, 2, 3, 4 };
+	dyn_array_t* source = dyn_array_import(data, 4, sizeof(int), NULL);
+	dyn_array_t* clone = dyn_array_clone(source);
+	ASSERT_NE((dyn_array_t*)NULL, clone);
+	EXPECT_EQ(dyn_array_export(source), dyn_array_export(clone));
+	EXPECT_EQ((size_t)4, dyn_array_size(clone));
+
+	int pushed = 5;
+	EXPECT_TRUE(dyn_array_push_back(clone, &pushed));
+	EXPECT_NE(dyn_array_export(source), dyn_array_export(clone));
+	EXPECT_EQ((size_t)4, dyn_array_size(source));
+	EXPECT_EQ((size_t)5, dyn_array_size(clone));
+
+	int out = 0;
+	EXPECT_TRUE(dyn_array_extract_front(source, &out));
+	EXPECT_EQ(1, out);
+	EXPECT_EQ(1, *(int*)dyn_array_front(clone));
+
+	dyn_array_destroy(source);
+	dyn_array_destroy(clone);
+}
+
+TEST(dyn_array_clone, ManyClonesAndDestroyOrder) {
+	dyn_array_t* source = dyn_array_create_mapped(0, sizeof(int), NULL, 0);
+	for (int i = 0; i < 5000; i++) { dyn_array_push_back(source, &i); }
+
+	dyn_array_t* clones[4];
+	for (int i = 0; i < 4; i++) { clones[i] = dyn_array_clone(i ? clones[i - 1] : source); }
+	dyn_array_destroy(source);
+
+	// Schedulers only read their input, so they can run straight off a clone
+	ScheduleResult_t result;
+	dyn_array_t* workload = dyn_array_create(0, sizeof(ProcessControlBlock_t), NULL);
+	ProcessControlBlock_t pcb = { 3, 0, 0, false };
+	dyn_array_push_back(workload, &pcb);
+	dyn_array_t* workload_clone = dyn_array_clone(workload);
+	EXPECT_TRUE(round_robin(workload_clone, &result, 1));
+	EXPECT_EQ((size_t)1, dyn_array_size(workload));
+	dyn_array_destroy(workload_clone);
+	dyn_array_destroy(workload);
+
+	EXPECT_TRUE(dyn_array_erase(clones[1], 0));
+	EXPECT_TRUE(dyn_array_detach(clones[2]));
+	*(int*)dyn_array_at(clones[2], 0) = -1;
+	EXPECT_EQ(0, *(int*)dyn_array_front(clones[0]));
+	EXPECT_EQ(1, *(int*)dyn_array_front(clones[1]));
+	EXPECT_EQ(-1, *(int*)dyn_array_front(clones[2]));
+	EXPECT_EQ(0, *(int*)dyn_array_front(clones[3]));
+	EXPECT_EQ((size_t)5000, dyn_array_size(clones[3]));
+
+	for (int i = 0; i < 4; i++) { dyn_array_destroy(clones[i]); }
+}
+
+static void noop_destructor(void*) {}
+
+TEST(dyn_array_clone, RejectsDestructorsAndNull) {
+	EXPECT_EQ(NULL, dyn_array_clone(NULL));
+	dyn_array_t* array = dyn_array_create(0, sizeof(int), noop_destructor);
+	EXPECT_EQ(NULL, dyn_array_clone(array));
+	dyn_array_destroy(array);
+}
+
+/*
+*  DYN_ARRAY HEAP UNIT TEST CASES
+**/
+static int compare_int(const void* a, const void* b)
+{
+	return (*(const int*)a > *(const int*)b) - (*(const int*)a < *(const int*)b);
+}
+
+TEST(dyn_array_heap, PopsInOrder) {
+	dyn_array_t* heap = random_pcbs(2000, 3);
+	dyn_array_t* pushed = dyn_array_create(0, sizeof(ProcessControlBlock_t), NULL);
+	ASSERT_TRUE(dyn_array_make_heap(heap, compare_by_arrival));
+	for (size_t i = 0; i < 2000; i++) { ASSERT_TRUE(dyn_array_heap_push(pushed, dyn_array_at(heap, i), compare_by_arrival)); }
+
+	ProcessControlBlock_t previous = { 0, 0, 0, false };
+	for (size_t i = 0; i < 2000; i++)
+	{
+		ProcessControlBlock_t top = *(ProcessControlBlock_t*)dyn_array_heap_top(heap);
+		ProcessControlBlock_t popped, other;
+		ASSERT_TRUE(dyn_array_heap_pop(heap, &popped, compare_by_arrival));
+		ASSERT_TRUE(dyn_array_heap_pop(pushed, &other, compare_by_arrival));
+		EXPECT_EQ(0, compare_by_arrival(&top, &popped));
+		EXPECT_EQ(0, compare_by_arrival(&other, &popped));
+		if (i) { EXPECT_LE(compare_by_arrival(&previous, &popped), 0); }
+		previous = popped;
+	}
+	EXPECT_TRUE(dyn_array_empty(heap));
+	EXPECT_EQ(NULL, dyn_array_heap_top(heap));
+	EXPECT_FALSE(dyn_array_heap_pop(heap, &previous, compare_by_arrival));
+	dyn_array_destroy(heap);
+	dyn_array_destroy(pushed);
+}
+
+TEST(dyn_array_heap, RejectsBadInputAndTombstones) {
+	int value = 1;
+	dyn_array_t* heap = dyn_array_create(0, sizeof(int), NULL);
+	EXPECT_FALSE(dyn_array_make_heap(NULL, compare_int));
+	EXPECT_FALSE(dyn_array_make_heap(heap, NULL));
+	EXPECT_FALSE(dyn_array_heap_push(heap, NULL, compare_int));
+	EXPECT_FALSE(dyn_array_heap_pop(heap, &value, compare_int));
+	ASSERT_TRUE(dyn_array_enable_tombstones(heap, 50));
+	EXPECT_FALSE(dyn_array_heap_push(heap, &value, compare_int));
+	dyn_array_disable_tombstones(heap);
+	EXPECT_TRUE(dyn_array_heap_push(heap, &value, compare_int));
+	dyn_array_destroy(heap);
+}
+
+TEST(dyn_array_heap, SchedulersKeepTheirInput) {
+	ProcessControlBlock_t data[4] = { { 5, 2, 3, false }, { 2, 1, 0, false }, { 4, 0, 1, false }, { 1, 3, 1, false } };
+	dyn_array_t* ready_queue = dyn_array_import(data, 4, sizeof(ProcessControlBlock_t), NULL);
+	ScheduleResult_t result;
+	EXPECT_TRUE(first_come_first_serve(ready_queue, &result));
+	EXPECT_TRUE(shortest_job_first(ready_queue, &result));
+	EXPECT_TRUE(priority(ready_queue, &result));
+	EXPECT_TRUE(shortest_remaining_time_first(ready_queue, &result));
+	ASSERT_EQ((size_t)4, dyn_array_size(ready_queue));
+	EXPECT_EQ(0, memcmp(data, dyn_array_export(ready_queue), sizeof(data)));
+	dyn_array_destroy(ready_queue);
+}
+
+TEST(dyn_indexed_heap, UpdateAndRemoveByHandle) {
+	dyn_indexed_heap_t* heap = dyn_indexed_heap_create(0, sizeof(int), compare_int);
+	ASSERT_NE((dyn_indexed_heap_t*)NULL, heap);
+	size_t handles[100];
+	for (int i = 0; i < 100; i++)
+	{
+		int value = 1000 + i;
+		ASSERT_TRUE(dyn_indexed_heap_push(heap, &value, &handles[i]));
+	}
+
+	// Decrease one key to the front, increase another past everything, drop a third
+	int value = 1;
+	size_t handle = 0;
+	EXPECT_TRUE(dyn_indexed_heap_update(heap, handles[50], &value));
+	EXPECT_EQ(1, *(const int*)dyn_indexed_heap_top(heap, &handle));
+	EXPECT_EQ(handles[50], handle);
+	value = 5000;
+	EXPECT_TRUE(dyn_indexed_heap_update(heap, handles[0], &value));
+	EXPECT_TRUE(dyn_indexed_heap_remove(heap, handles[70], &value));
+	EXPECT_EQ(1070, value);
+	EXPECT_EQ(NULL, dyn_indexed_heap_get(heap, handles[70]));
+	EXPECT_FALSE(dyn_indexed_heap_remove(heap, handles[70], NULL));
+	EXPECT_EQ((size_t)99, dyn_indexed_heap_size(heap));
+
+	// Released handles get handed out again
+	value = 1050;
+	EXPECT_TRUE(dyn_indexed_heap_push(heap, &value, &handle));
+	EXPECT_EQ(handles[70], handle);
+
+	int previous = 0;
+	for (size_t i = 0; i < 100; i++)
+	{
+		ASSERT_TRUE(dyn_indexed_heap_pop(heap, &value, &handle));
+		EXPECT_LE(previous, value);
+		previous = value;
+	}
+	EXPECT_EQ(5000, previous);
+	EXPECT_EQ(handles[0], handle);
+	EXPECT_EQ((size_t)0, dyn_indexed_heap_size(heap));
+	EXPECT_EQ(NULL, dyn_indexed_heap_top(heap, NULL));
+	dyn_indexed_heap_destroy(heap);
+}
+
+/*
+*  DYN_ARRAY GROWTH POLICY AND STATS UNIT TEST CASES
+**/
+static size_t grow_by_ten(const size_t capacity, const size_t needed, void* arg)
+{
+	++*(int*)arg;
+	size_t new_capacity = capacity + 10;
+	return new_capacity < needed ? needed : new_capacity;
+}
+
+TEST(dyn_array_growth, PolicyControlsCapacity) {
+	dyn_array_t* array = dyn_array_create(0, sizeof(int), NULL);
+	EXPECT_EQ((size_t)DYN_DEFAULT_MIN_CAPACITY, dyn_array_capacity(array));
+
+	dyn_growth_policy_t policy = { 1.5, 16, NULL, NULL };
+	ASSERT_TRUE(dyn_array_set_growth_policy(array, &policy));
+	for (int i = 0; i < 17; i++) { dyn_array_push_back(array, &i); }
+	EXPECT_EQ((size_t)24, dyn_array_capacity(array));
+
+	int calls = 0;
+	policy = { 0.0, 0, grow_by_ten, &calls };
+	ASSERT_TRUE(dyn_array_set_growth_policy(array, &policy));
+	for (int i = 17; i < 40; i++) { dyn_array_push_back(array, &i); }
+	EXPECT_EQ((size_t)44, dyn_array_capacity(array));
+	EXPECT_EQ(2, calls);
+
+	policy = { 1.0, 16, NULL, NULL };
+	EXPECT_FALSE(dyn_array_set_growth_policy(array, &policy));
+	EXPECT_TRUE(dyn_array_set_growth_policy(array, NULL));
+	for (int i = 40; i < 45; i++) { dyn_array_push_back(array, &i); }
+	EXPECT_EQ((size_t)88, dyn_array_capacity(array));
+	for (int i = 0; i < 45; i++) { EXPECT_EQ(i, *(int*)dyn_array_at(array, i)); }
+	dyn_array_destroy(array);
+}
+
+TEST(dyn_array_growth, ReserveAndShrinkToFit) {
+	dyn_array_t* array = dyn_array_create(0, sizeof(int), NULL);
+	ASSERT_TRUE(dyn_array_reserve(array, 1000));
+	EXPECT_EQ((size_t)1000, dyn_array_capacity(array));
+	EXPECT_TRUE(dyn_array_reserve(array, 10));
+	EXPECT_EQ((size_t)1000, dyn_array_capacity(array));
+
+	for (int i = 0; i < 100; i++) { dyn_array_push_back(array, &i); }
+	ASSERT_TRUE(dyn_array_enable_tombstones(array, 100));
+	EXPECT_TRUE(dyn_array_erase(array, 10));
+	ASSERT_TRUE(dyn_array_shrink_to_fit(array));
+	EXPECT_EQ((size_t)99, dyn_array_capacity(array));
+	EXPECT_EQ(11, *(int*)dyn_array_at(array, 10));
+
+	// Growing from a shrunken array goes back to the policy
+	int value = 100;
+	EXPECT_TRUE(dyn_array_push_back(array, &value));
+	EXPECT_EQ((size_t)198, dyn_array_capacity(array));
+	dyn_array_disable_tombstones(array);
+
+	dyn_array_clear(array);
+	ASSERT_TRUE(dyn_array_shrink_to_fit(array));
+	EXPECT_EQ((size_t)1, dyn_array_capacity(array));
+	for (int i = 0; i < 20; i++) { EXPECT_TRUE(dyn_array_push_back(array, &i)); }
+	EXPECT_EQ((size_t)32, dyn_array_capacity(array));
+	dyn_array_destroy(array);
+}
+
+TEST(dyn_array_growth, StatsCountTraffic) {
+	dyn_array_t* array = dyn_array_create(0, sizeof(int), NULL);
+	dyn_array_stats_t stats;
+	EXPECT_FALSE(dyn_array_get_stats(array, &stats));
+	ASSERT_TRUE(dyn_array_enable_stats(array));
+
+	for (int i = 0; i < 32; i++) { dyn_array_push_back(array, &i); }
+	int value = -1;
+	dyn_array_push_front(array, &value);
+	dyn_array_extract(array, 0, &value);
+	ASSERT_TRUE(dyn_array_get_stats(array, &stats));
+	EXPECT_EQ((size_t)2, stats.reallocs);
+	EXPECT_EQ((size_t)64, stats.peak_capacity);
+	EXPECT_EQ(34 * sizeof(int), stats.bytes_copied);
+	EXPECT_EQ(64 * sizeof(int), stats.bytes_moved);
+
+	dyn_array_shrink_to_fit(array);
+	ASSERT_TRUE(dyn_array_get_stats(array, &stats));
+	EXPECT_EQ((size_t)3, stats.reallocs);
+	EXPECT_EQ((size_t)64, stats.peak_capacity);
+
+	// A shared payload gets copied on the first write
+	dyn_array_t* clone = dyn_array_clone(array);
+	EXPECT_TRUE(dyn_array_pop_back(array));
+	ASSERT_TRUE(dyn_array_get_stats(array, &stats));
+	EXPECT_EQ((size_t)4, stats.reallocs);
+	EXPECT_EQ(66 * sizeof(int), stats.bytes_copied);
+	EXPECT_FALSE(dyn_array_get_stats(clone, &stats));
+
+	dyn_array_disable_stats(array);
+	EXPECT_FALSE(dyn_array_get_stats(array, &stats));
+	dyn_array_destroy(clone);
+	dyn_array_destroy(array);
+}
+
+/*
+*  SCHEDULE STATS UNIT TEST CASES
+**/
+TEST(schedule_stats, CountsIdleJumpsAndSwitches) {
+	ScheduleStats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	if (!schedule_stats_attach(&stats)) { GTEST_SKIP(); }
+
+	// P0 runs 0-4, the CPU idles until 10, then P1 and P2 run back to back
+	ProcessControlBlock_t data[3] = { { 4, 0, 0, false }, { 2, 0, 10, false }, { 3, 0, 10, false } };
+	dyn_array_t* ready_queue = dyn_array_import(data, 3, sizeof(ProcessControlBlock_t), NULL);
+	ScheduleResult_t result;
+	EXPECT_TRUE(first_come_first_serve(ready_queue, &result));
+	schedule_stats_attach(NULL);
+	EXPECT_EQ(3UL, stats.selections);
+	EXPECT_EQ(1UL, stats.idle_jumps);
+	EXPECT_EQ(1UL, stats.context_switches);
+	EXPECT_EQ(4UL, stats.ticks);
+
+	// Detached runs count nothing
+	ScheduleStats_t before = stats;
+	EXPECT_TRUE(shortest_job_first(ready_queue, &result));
+	EXPECT_EQ(0, memcmp(&before, &stats, sizeof(stats)));
+	dyn_array_destroy(ready_queue);
+}
+
+TEST(schedule_stats, CountsPreemptionsAndSlices) {
+	ScheduleStats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	if (!schedule_stats_attach(&stats)) { GTEST_SKIP(); }
+
+	// P1 shows up at 2 and preempts P0, which gets the CPU back at 3
+	ProcessControlBlock_t data[2] = { { 5, 0, 0, false }, { 1, 0, 2, false } };
+	dyn_array_t* ready_queue = dyn_array_import(data, 2, sizeof(ProcessControlBlock_t), NULL);
+	ScheduleResult_t result;
+	EXPECT_TRUE(shortest_remaining_time_first(ready_queue, &result));
+	EXPECT_EQ(3UL, stats.selections);
+	EXPECT_EQ(2UL, stats.context_switches);
+	EXPECT_EQ(0UL, stats.idle_jumps);
+	EXPECT_GT(stats.comparisons, 0UL);
+	dyn_array_destroy(ready_queue);
+
+	// A lone process keeps the CPU between slices
+	memset(&stats, 0, sizeof(stats));
+	ready_queue = dyn_array_import(data, 1, sizeof(ProcessControlBlock_t), NULL);
+	EXPECT_TRUE(round_robin(ready_queue, &result, 2));
+	schedule_stats_attach(NULL);
+	EXPECT_EQ(3UL, stats.selections);
+	EXPECT_EQ(0UL, stats.context_switches);
+	EXPECT_EQ(3UL, stats.ticks);
+	dyn_array_destroy(ready_queue);
+}
+
+/*
+*  SCHEDULER SCALING UNIT TEST CASES
+**/
+// Every scheduler should be O(n log n) or better. These run each one at 10k, 100k and 1M PCBs,
+// fit the growth of the run times on a log-log scale and fail if it's heading for quadratic.
+// Each size also has a time budget (seconds, generous enough for an unoptimized build).
+// Slow hosts can set HW2_SCALING_BUDGET_SCALE to stretch the budgets (0 turns them off).
+static const size_t scaling_sizes[] = { 10000, 100000, 1000000 };
+static const double scaling_budgets[] = { 1.0, 5.0, 30.0 };
+
+// n log n fits at ~1.1 over these sizes, n^2 at 2
+#define SCALING_MAX_EXPONENT 1.5
+
+// Balanced trace (arrivals keep pace with the CPU), so any prefix is a smaller trace of the same kind
+static const dyn_array_t* scaling_workload()
+{
+	static dyn_array_t* workload = NULL;
+	if (workload == NULL)
+	{
+		workload = dyn_array_create(1000000, sizeof(ProcessControlBlock_t), NULL);
+		uint32_t seed = 17;
+		for (uint32_t i = 0; i < 1000000; i++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			ProcessControlBlock_t pcb = { 1 + (seed >> 8) % 100, (seed >> 4) % 16, i * 50 + (seed >> 16) % 100, false };
+			dyn_array_push_back(workload, &pcb);
+		}
+	}
+	return workload;
+}
+
+static bool round_robin_quantum_4(dyn_array_t* ready_queue, ScheduleResult_t* result)
+{
+	return round_robin(ready_queue, result, 4);
+}
+
+static void expect_scales(bool (*scheduler)(dyn_array_t*, ScheduleResult_t*))
+{
+	const char* scale_setting = getenv("HW2_SCALING_BUDGET_SCALE");
+	const double budget_scale = scale_setting ? atof(scale_setting) : 1.0;
+
+	double log_sizes[3], log_times[3];
+	for (size_t i = 0; i < 3; i++)
+	{
+		dyn_array_t* ready_queue = dyn_array_import(dyn_array_export(scaling_workload()), scaling_sizes[i], sizeof(ProcessControlBlock_t), NULL);
+		ASSERT_NE((dyn_array_t*)NULL, ready_queue);
+
+		// Best of a few runs for the small sizes, where a hiccup would skew the fit
+		double best = INFINITY;
+		for (int run = 0; run < (i < 2 ? 3 : 1); run++)
+		{
+			ScheduleResult_t result;
+			auto start = std::chrono::steady_clock::now();
+			ASSERT_TRUE(scheduler(ready_queue, &result));
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			best = std::min(best, seconds);
+		}
+		dyn_array_destroy(ready_queue);
+
+		if (budget_scale > 0) { EXPECT_LT(best, scaling_budgets[i] * budget_scale) << scaling_sizes[i] << " PCBs"; }
+		log_sizes[i] = std::log((double)scaling_sizes[i]);
+		log_times[i] = std::log(std::max(best, 1e-6));
+	}
+
+	// Least squares slope of log(time) against log(size) is the growth exponent
+	double mean_size = (log_sizes[0] + log_sizes[1] + log_sizes[2]) / 3;
+	double mean_time = (log_times[0] + log_times[1] + log_times[2]) / 3;
+	double covariance = 0, variance = 0;
+	for (size_t i = 0; i < 3; i++)
+	{
+		covariance += (log_sizes[i] - mean_size) * (log_times[i] - mean_time);
+		variance += (log_sizes[i] - mean_size) * (log_sizes[i] - mean_size);
+	}
+	EXPECT_LT(covariance / variance, SCALING_MAX_EXPONENT);
+}
+
+TEST(scheduler_scaling, FirstComeFirstServe) { expect_scales(first_come_first_serve); }
+TEST(scheduler_scaling, ShortestJobFirst) { expect_scales(shortest_job_first); }
+TEST(scheduler_scaling, Priority) { expect_scales(priority); }
+TEST(scheduler_scaling, ShortestRemainingTimeFirst) { expect_scales(shortest_remaining_time_first); }
+TEST(scheduler_scaling, RoundRobin) { expect_scales(round_robin_quantum_4); }
+
+/*
+*  REFERENCE ORACLE DIFFERENTIAL UNIT TEST CASES
+**/
+// Runs thousands of generated workloads through each fast scheduler and its reference (the original
+// per-tick code) and requires identical results. A failing workload is shrunk to the smallest one that
+// still fails before it is reported, so the message is something you can step through by hand.
+#define DIFFERENTIAL_CASES 3000
+
+// A generated workload, the quantum only matters to round robin
+struct DifferentialCase
+{
+	std::vector<ProcessControlBlock_t> pcbs;
+	size_t quantum;
+};
+
+// A fast scheduler and its reference, with the quantum threaded through so every policy looks the same
+struct DifferentialPolicy
+{
+	bool (*fast)(dyn_array_t*, ScheduleResult_t*, size_t);
+	bool (*reference)(const dyn_array_t*, ScheduleResult_t*, size_t);
+};
+
+static std::string describe_case(const DifferentialCase& test_case)
+{
+	std::ostringstream description;
+	description << "quantum " << test_case.quantum << ", {burst, priority, arrival}:";
+	for (const ProcessControlBlock_t& pcb : test_case.pcbs)
+	{
+		description << " {" << pcb.remaining_burst_time << ", " << pcb.priority << ", " << pcb.arrival << "}";
+	}
+	return description.str();
+}
+
+static std::string describe_result(const bool success, const ScheduleResult_t& result)
+{
+	if (!success) { return "failed"; }
+	std::ostringstream description;
+	description << "waiting " << result.average_waiting_time << ", turnaround " << result.average_turnaround_time
+		<< ", run time " << result.total_run_time;
+	return description.str();
+}
+
+// Runs both engines on the workload
+// \return how they differ (results, or the fast one changing its input), empty if they agree
+static std::string differential_mismatch(const DifferentialPolicy& policy, const DifferentialCase& test_case)
+{
+	dyn_array_t* ready_queue = dyn_array_import(test_case.pcbs.data(), test_case.pcbs.size(), sizeof(ProcessControlBlock_t), NULL);
+	if (ready_queue == NULL) { return "could not build the ready queue"; }
+
+	ScheduleResult_t fast = { 0, 0, 0 };
+	ScheduleResult_t reference = { 0, 0, 0 };
+	const bool fast_success = policy.fast(ready_queue, &fast, test_case.quantum);
+	const bool reference_success = policy.reference(ready_queue, &reference, test_case.quantum);
+
+	bool untouched = dyn_array_size(ready_queue) == test_case.pcbs.size();
+	for (size_t i = 0; untouched && i < test_case.pcbs.size(); i++)
+	{
+		const ProcessControlBlock_t* pcb = (const ProcessControlBlock_t*)dyn_array_at(ready_queue, i);
+		untouched = pcb->remaining_burst_time == test_case.pcbs[i].remaining_burst_time && pcb->priority == test_case.pcbs[i].priority
+			&& pcb->arrival == test_case.pcbs[i].arrival && pcb->started == test_case.pcbs[i].started;
+	}
+	dyn_array_destroy(ready_queue);
+
+	if (!untouched) { return "the ready queue was changed"; }
+	if (fast_success == reference_success && (!fast_success || (fast.average_waiting_time == reference.average_waiting_time
+		&& fast.average_turnaround_time == reference.average_turnaround_time && fast.total_run_time == reference.total_run_time)))
+	{
+		return "";
+	}
+	return "fast: " + describe_result(fast_success, fast) + ", reference: " + describe_result(reference_success, reference);
+}
+
+// Makes a small workload that is likely to hit an edge case: lots of equal arrivals, bursts and priorities,
+// idle gaps, zero bursts and input that isn't in arrival order
+static DifferentialCase generate_case(std::mt19937& random)
+{
+	DifferentialCase test_case;
+	const size_t count = 1 + random() % 12;
+	// Arrivals bunched together (ties), spread out (idle gaps) or in two waves with a long gap between them
+	const uint32_t shape = random() % 3;
+	for (size_t i = 0; i < count; i++)
+	{
+		ProcessControlBlock_t pcb;
+		pcb.remaining_burst_time = random() % 8 == 0 ? 0 : 1 + random() % 12;
+		pcb.priority = random() % 4;
+		pcb.arrival = shape == 0 ? random() % 4 : shape == 1 ? random() % 60 : (random() % 2) * 100 + random() % 6;
+		pcb.started = false;
+		test_case.pcbs.push_back(pcb);
+	}
+	if (random() % 2)
+	{
+		std::stable_sort(test_case.pcbs.begin(), test_case.pcbs.end(),
+			[](const ProcessControlBlock_t& a, const ProcessControlBlock_t& b) { return a.arrival < b.arrival; });
+	}
+	test_case.quantum = 1 + random() % 5;
+	return test_case;
+}
+
+// Shrinks a failing workload until no single removal or reduction keeps it failing
+static DifferentialCase shrink_case(const DifferentialPolicy& policy, DifferentialCase failing)
+{
+	for (bool shrunk = true; shrunk;)
+	{
+		shrunk = false;
+		// Every candidate is strictly smaller than the failing case, so this always stops
+		std::vector<DifferentialCase> candidates;
+		for (size_t i = 0; failing.pcbs.size() > 1 && i < failing.pcbs.size(); i++)
+		{
+			DifferentialCase candidate = failing;
+			candidate.pcbs.erase(candidate.pcbs.begin() + i);
+			candidates.push_back(candidate);
+		}
+		for (size_t i = 0; i < failing.pcbs.size(); i++)
+		{
+			uint32_t ProcessControlBlock_t::* fields[] = { &ProcessControlBlock_t::remaining_burst_time, &ProcessControlBlock_t::arrival, &ProcessControlBlock_t::priority };
+			for (uint32_t ProcessControlBlock_t::* field : fields)
+			{
+				const uint32_t value = failing.pcbs[i].*field;
+				for (uint32_t smaller : { 0u, value / 2, value - 1 })
+				{
+					if (value == 0 || smaller >= value) { continue; }
+					DifferentialCase candidate = failing;
+					candidate.pcbs[i].*field = smaller;
+					candidates.push_back(candidate);
+				}
+			}
+		}
+		if (failing.quantum > 1)
+		{
+			DifferentialCase candidate = failing;
+			candidate.quantum = 1;
+			candidates.push_back(candidate);
+		}
+
+		for (const DifferentialCase& candidate : candidates)
+		{
+			if (!differential_mismatch(policy, candidate).empty())
+			{
+				failing = candidate;
+				shrunk = true;
+				break;
+			}
+		}
+	}
+	return failing;
+}
+
+static void expect_matches_reference(const DifferentialPolicy& policy, const uint32_t seed)
+{
+	std::mt19937 random(seed);
+	for (int i = 0; i < DIFFERENTIAL_CASES; i++)
+	{
+		const DifferentialCase test_case = generate_case(random);
+		if (!differential_mismatch(policy, test_case).empty())
+		{
+			const DifferentialCase smallest = shrink_case(policy, test_case);
+			ADD_FAILURE() << "case " << i << " (seed " << seed << ") shrunk to " << describe_case(smallest)
+				<< "\n  " << differential_mismatch(policy, smallest);
+			return;
+		}
+	}
+}
+
+static const DifferentialPolicy differential_fcfs = {
+	[](dyn_array_t* q, ScheduleResult_t* r, size_t) { return first_come_first_serve(q, r); },
+	[](const dyn_array_t* q, ScheduleResult_t* r, size_t) { return reference_first_come_first_serve(q, r); } };
+static const DifferentialPolicy differential_sjf = {
+	[](dyn_array_t* q, ScheduleResult_t* r, size_t) { return shortest_job_first(q, r); },
+	[](const dyn_array_t* q, ScheduleResult_t* r, size_t) { return reference_shortest_job_first(q, r); } };
+static const DifferentialPolicy differential_priority = {
+	[](dyn_array_t* q, ScheduleResult_t* r, size_t) { return priority(q, r); },
+	[](const dyn_array_t* q, ScheduleResult_t* r, size_t) { return reference_priority(q, r); } };
+static const DifferentialPolicy differential_srtf = {
+	[](dyn_array_t* q, ScheduleResult_t* r, size_t) { return shortest_remaining_time_first(q, r); },
+	[](const dyn_array_t* q, ScheduleResult_t* r, size_t) { return reference_shortest_remaining_time_first(q, r); } };
+static const DifferentialPolicy differential_round_robin = { round_robin, reference_round_robin };
+
+TEST(reference_oracle, FirstComeFirstServe) { expect_matches_reference(differential_fcfs, 1); }
+TEST(reference_oracle, ShortestJobFirst) { expect_matches_reference(differential_sjf, 2); }
+TEST(reference_oracle, Priority) { expect_matches_reference(differential_priority, 3); }
+TEST(reference_oracle, ShortestRemainingTimeFirst) { expect_matches_reference(differential_srtf, 4); }
+TEST(reference_oracle, RoundRobin) { expect_matches_reference(differential_round_robin, 5); }
+
+TEST(reference_oracle, ShrinksToSmallestFailure) {
+	// An engine that gets run time wrong once any burst is over 5 should shrink to a single burst of 6 at time 0
+	const DifferentialPolicy broken = {
+		[](dyn_array_t* q, ScheduleResult_t* r, size_t) {
+			bool success = first_come_first_serve(q, r);
+			for (size_t i = 0; i < dyn_array_size(q); i++)
+			{
+				if (((ProcessControlBlock_t*)dyn_array_at(q, i))->remaining_burst_time > 5) { r->total_run_time++; }
+			}
+			return success;
+		},
+		differential_fcfs.reference };
+	DifferentialCase failing = { { { 3, 2, 0, false }, { 9, 1, 4, false }, { 0, 3, 7, false }, { 8, 0, 2, false } }, 4 };
+	ASSERT_FALSE(differential_mismatch(broken, failing).empty());
+
+	DifferentialCase smallest = shrink_case(broken, failing);
+	ASSERT_EQ(1U, smallest.pcbs.size());
+	EXPECT_EQ(6U, smallest.pcbs[0].remaining_burst_time);
+	EXPECT_EQ(0U, smallest.pcbs[0].arrival);
+	EXPECT_EQ(0U, smallest.pcbs[0].priority);
+	EXPECT_EQ(1U, smallest.quantum);
+}
+
+/*
+*  SCHEDULE LATENCY UNIT TEST CASES
+**/
+struct CompletionTotals
+{
+	size_t count;
+	unsigned long waiting;
+	unsigned long turnaround;
+	unsigned long burst;
+};
+
+static void count_completion(void* arg, const ProcessControlBlock_t* process, unsigned long waiting_time, unsigned long turnaround_time)
+{
+	CompletionTotals* totals = (CompletionTotals*)arg;
+	totals->count++;
+	totals->waiting += waiting_time;
+	totals->turnaround += turnaround_time;
+	totals->burst += process->remaining_burst_time;
+}
+
+static dyn_array_t* latency_workload(const size_t count, const uint32_t seed)
+{
+	dyn_array_t* ready_queue = dyn_array_create(count, sizeof(ProcessControlBlock_t), NULL);
+	std::mt19937 random(seed);
+	for (size_t i = 0; i < count; i++)
+	{
+		ProcessControlBlock_t pcb = { (uint32_t)(random() % 8 == 0 ? 0 : 1 + random() % 200), (uint32_t)(random() % 8), (uint32_t)(i * 60 + random() % 50), false };
+		dyn_array_push_back(ready_queue, &pcb);
+	}
+	return ready_queue;
+}
+
+TEST(schedule_latency, ObserverSeesEveryProcess) {
+	dyn_array_t* ready_queue = latency_workload(500, 7);
+	unsigned long bursts = 0;
+	for (size_t i = 0; i < dyn_array_size(ready_queue); i++) { bursts += ((ProcessControlBlock_t*)dyn_array_at(ready_queue, i))->remaining_burst_time; }
+
+	// Every scheduler reports each process once, with its whole burst, and the times add up to the averages
+	for (int policy = 0; policy < 5; policy++)
+	{
+		CompletionTotals totals = { 0, 0, 0, 0 };
+		ScheduleResult_t result;
+		schedule_completion_attach(count_completion, &totals);
+		bool success = policy == 0 ? first_come_first_serve(ready_queue, &result) : policy == 1 ? shortest_job_first(ready_queue, &result)
+			: policy == 2 ? priority(ready_queue, &result) : policy == 3 ? round_robin(ready_queue, &result, 7)
+			: shortest_remaining_time_first(ready_queue, &result);
+		schedule_completion_attach(NULL, NULL);
+		ASSERT_TRUE(success) << policy;
+		EXPECT_EQ(dyn_array_size(ready_queue), totals.count) << policy;
+		EXPECT_EQ(bursts, totals.burst) << policy;
+		EXPECT_EQ((float)totals.waiting / totals.count, result.average_waiting_time) << policy;
+		EXPECT_EQ((float)totals.turnaround / totals.count, result.average_turnaround_time) << policy;
+	}
+	dyn_array_destroy(ready_queue);
+}
+
+TEST(schedule_latency, ExactPercentiles) {
+	// FCFS with everything at 0: waiting 0, 1, 3, 6 and turnaround 1, 3, 6, 10
+	ProcessControlBlock_t pcbs[] = { { 1, 0, 0, false }, { 2, 0, 0, false }, { 3, 0, 0, false }, { 4, 0, 0, false } };
+	dyn_array_t* ready_queue = dyn_array_import(pcbs, 4, sizeof(ProcessControlBlock_t), NULL);
+
+	// Observers already attached keep getting called
+	CompletionTotals totals = { 0, 0, 0, 0 };
+	schedule_completion_attach(count_completion, &totals);
+	ScheduleResultExtended_t result;
+	ASSERT_TRUE(schedule_extended(ready_queue, first_come_first_serve, SCHEDULE_LATENCY_AUTO, &result));
+	schedule_completion_attach(NULL, NULL);
+	EXPECT_EQ(4U, totals.count);
+
+	EXPECT_TRUE(result.exact);
+	EXPECT_EQ(2.5f, result.result.average_waiting_time);
+	EXPECT_EQ(1UL, result.waiting.p50);
+	EXPECT_EQ(6UL, result.waiting.p90);
+	EXPECT_EQ(6UL, result.waiting.p999);
+	EXPECT_EQ(6UL, result.waiting.max);
+	EXPECT_EQ(3UL, result.turnaround.p50);
+	EXPECT_EQ(10UL, result.turnaround.p99);
+	EXPECT_EQ(10UL, result.turnaround.max);
+
+	ASSERT_TRUE(round_robin_extended(ready_queue, 1, SCHEDULE_LATENCY_EXACT, &result));
+	EXPECT_EQ(10UL, result.turnaround.max);
+	EXPECT_FALSE(round_robin_extended(ready_queue, 0, SCHEDULE_LATENCY_EXACT, &result));
+	EXPECT_FALSE(schedule_extended(ready_queue, NULL, SCHEDULE_LATENCY_EXACT, &result));
+	dyn_array_destroy(ready_queue);
+}
+
+TEST(schedule_latency, HistogramStaysWithinBound) {
+	dyn_array_t* ready_queue = latency_workload(SCHEDULE_EXACT_LATENCY_LIMIT + 1000, 11);
+	ScheduleResultExtended_t exact, histogram;
+	ASSERT_TRUE(schedule_extended(ready_queue, shortest_job_first, SCHEDULE_LATENCY_EXACT, &exact));
+	ASSERT_TRUE(schedule_extended(ready_queue, shortest_job_first, SCHEDULE_LATENCY_AUTO, &histogram));
+	EXPECT_TRUE(exact.exact);
+	EXPECT_FALSE(histogram.exact);
+
+	// Never under the exact value, and no more than 1/64 over it
+	const ScheduleLatency_t* pairs[][2] = { { &exact.waiting, &histogram.waiting }, { &exact.turnaround, &histogram.turnaround } };
+	for (auto& pair : pairs)
+	{
+		unsigned long exact_values[] = { pair[0]->p50, pair[0]->p90, pair[0]->p99, pair[0]->p999 };
+		unsigned long histogram_values[] = { pair[1]->p50, pair[1]->p90, pair[1]->p99, pair[1]->p999 };
+		for (int i = 0; i < 4; i++)
+		{
+			EXPECT_GE(histogram_values[i], exact_values[i]);
+			EXPECT_LE(histogram_values[i], exact_values[i] + exact_values[i] / 64);
+		}
+		EXPECT_EQ(pair[0]->max, pair[1]->max);
+		EXPECT_LT(pair[0]->p50, pair[0]->max);
+	}
+	EXPECT_EQ(exact.result.average_waiting_time, histogram.result.average_waiting_time);
+	dyn_array_destroy(ready_queue);
+}
+
+/*
+*  SCHEDULE TIMES AND TRACE UNIT TEST CASES
+**/
+static bool run_policy(const int policy, dyn_array_t* ready_queue, ScheduleResult_t* result)
+{
+	return policy == 0 ? first_come_first_serve(ready_queue, result) : policy == 1 ? shortest_job_first(ready_queue, result)
+		: policy == 2 ? priority(ready_queue, result) : policy == 3 ? round_robin(ready_queue, result, 7)
+		: shortest_remaining_time_first(ready_queue, result);
+}
+
+TEST(schedule_times, PreemptedProcess) {
+	// SRTF: 0 runs for 1, 1 arrives shorter and runs 1-3, then 0 finishes 3-12
+	ProcessControlBlock_t pcbs[] = { { 10, 0, 0, false }, { 2, 0, 1, false } };
+	dyn_array_t* ready_queue = dyn_array_import(pcbs, 2, sizeof(ProcessControlBlock_t), NULL);
+	unsigned long start[2], completion[2], waiting[2], response[2];
+	ScheduleTimes_t times = { start, completion, waiting, response };
+	ScheduleResult_t result;
+	schedule_times_attach(&times);
+	ASSERT_TRUE(shortest_remaining_time_first(ready_queue, &result));
+	schedule_times_attach(NULL);
+	EXPECT_EQ(0UL, start[0]);
+	EXPECT_EQ(1UL, start[1]);
+	EXPECT_EQ(12UL, completion[0]);
+	EXPECT_EQ(3UL, completion[1]);
+	EXPECT_EQ(2UL, waiting[0]);
+	EXPECT_EQ(0UL, waiting[1]);
+	EXPECT_EQ(0UL, response[0]);
+	EXPECT_EQ(0UL, response[1]);
+
+	// Only the arrays given get written
+	unsigned long only_completion[2] = { 0, 0 };
+	ScheduleTimes_t partial = { NULL, only_completion, NULL, NULL };
+	schedule_times_attach(&partial);
+	ASSERT_TRUE(first_come_first_serve(ready_queue, &result));
+	schedule_times_attach(NULL);
+	EXPECT_EQ(10UL, only_completion[0]);
+	EXPECT_EQ(12UL, only_completion[1]);
+	dyn_array_destroy(ready_queue);
+}
+
+TEST(schedule_times, AddUpToTheAverages) {
+	dyn_array_t* ready_queue = latency_workload(400, 13);
+	const size_t count = dyn_array_size(ready_queue);
+	std::vector<unsigned long> start(count), completion(count), waiting(count), response(count);
+	ScheduleTimes_t times = { start.data(), completion.data(), waiting.data(), response.data() };
+	for (int policy = 0; policy < 5; policy++)
+	{
+		ScheduleResult_t result;
+		schedule_times_attach(&times);
+		ASSERT_TRUE(run_policy(policy, ready_queue, &result)) << policy;
+		schedule_times_attach(NULL);
+
+		unsigned long total_waiting = 0, last_completion = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			const ProcessControlBlock_t* pcb = (const ProcessControlBlock_t*)dyn_array_at(ready_queue, i);
+			EXPECT_EQ(pcb->arrival + waiting[i] + pcb->remaining_burst_time, completion[i]) << policy << " " << i;
+			EXPECT_EQ(pcb->arrival + response[i], start[i]) << policy << " " << i;
+			EXPECT_LE(response[i], waiting[i]) << policy << " " << i;
+			total_waiting += waiting[i];
+			last_completion = std::max(last_completion, completion[i]);
+		}
+		EXPECT_EQ((float)total_waiting / count, result.average_waiting_time) << policy;
+		EXPECT_EQ(result.total_run_time, last_completion) << policy;
+		// Without preemption a process waits exactly until it starts
+		if (policy < 3) { EXPECT_EQ(response, waiting) << policy; }
+	}
+	dyn_array_destroy(ready_queue);
+}
+
+TEST(schedule_trace, ReplaysEveryRun) {
+	dyn_array_t* ready_queue = latency_workload(300, 17);
+	const size_t count = dyn_array_size(ready_queue);
+	std::vector<unsigned long> start(count), completion(count);
+	std::vector<std::vector<unsigned long>> starts(5), completions(5);
+	ScheduleTimes_t times = { start.data(), completion.data(), NULL, NULL };
+
+	// A tiny block, so the trace gets written out many times along the way
+	const char* path = "schedule_trace_test.bin";
+	ScheduleTrace_t* trace = schedule_trace_open(path, 100);
+	ASSERT_NE(nullptr, trace);
+	for (int policy = 0; policy < 5; policy++)
+	{
+		ScheduleResult_t result;
+		schedule_trace_attach(trace);
+		schedule_times_attach(&times);
+		ASSERT_TRUE(run_policy(policy, ready_queue, &result)) << policy;
+		schedule_times_attach(NULL);
+		schedule_trace_attach(NULL);
+		starts[policy] = start;
+		completions[policy] = completion;
+	}
+	ASSERT_TRUE(schedule_trace_close(trace));
+
+	dyn_array_t* events = load_schedule_trace(path);
+	ASSERT_NE(nullptr, events);
+	remove(path);
+
+	// Replay the CPU: one process at a time, time never goes backwards, every process gets exactly its burst
+	int policy = -1;
+	size_t completed = 0;
+	bool running = false;
+	uint32_t running_pid = 0;
+	uint64_t last_time = 0, running_since = 0;
+	std::vector<uint64_t> ran(count);
+	std::vector<bool> dispatched(count);
+	for (size_t i = 0; i < dyn_array_size(events); i++)
+	{
+		const ScheduleTraceEvent_t* event = (const ScheduleTraceEvent_t*)dyn_array_at(events, i);
+		if (event->event == SCHEDULE_TRACE_BEGIN)
+		{
+			if (policy >= 0) { EXPECT_EQ(count, completed) << policy; }
+			policy++;
+			ASSERT_LT(policy, 5);
+			EXPECT_EQ(count, event->pid);
+			completed = 0;
+			running = false;
+			last_time = 0;
+			std::fill(ran.begin(), ran.end(), 0);
+			std::fill(dispatched.begin(), dispatched.end(), false);
+			continue;
+		}
+		ASSERT_GE(policy, 0);
+		ASSERT_LT(event->pid, count);
+		EXPECT_GE(event->time, last_time) << policy << " event " << i;
+		last_time = event->time;
+		const ProcessControlBlock_t* pcb = (const ProcessControlBlock_t*)dyn_array_at(ready_queue, event->pid);
+		if (event->event == SCHEDULE_TRACE_DISPATCH)
+		{
+			ASSERT_FALSE(running) << policy << " event " << i;
+			EXPECT_GE(event->time, pcb->arrival);
+			if (!dispatched[event->pid]) { EXPECT_EQ(starts[policy][event->pid], event->time) << policy << " " << event->pid; }
+			dispatched[event->pid] = true;
+			running = true;
+			running_pid = event->pid;
+			running_since = event->time;
+			continue;
+		}
+		ASSERT_TRUE(running) << policy << " event " << i;
+		ASSERT_EQ(running_pid, event->pid) << policy << " event " << i;
+		ran[event->pid] += event->time - running_since;
+		running = false;
+		if (event->event == SCHEDULE_TRACE_PREEMPT) { EXPECT_LT(ran[event->pid], pcb->remaining_burst_time); }
+		else
+		{
+			ASSERT_EQ((uint32_t)SCHEDULE_TRACE_COMPLETE, event->event);
+			EXPECT_EQ(pcb->remaining_burst_time, ran[event->pid]) << policy << " " << event->pid;
+			EXPECT_EQ(completions[policy][event->pid], event->time) << policy << " " << event->pid;
+			completed++;
+		}
+	}
+	EXPECT_EQ(4, policy);
+	EXPECT_EQ(count, completed);
+	dyn_array_destroy(events);
+	dyn_array_destroy(ready_queue);
+}
+
+TEST(schedule_trace, RejectsBadFiles) {
+	EXPECT_EQ(nullptr, schedule_trace_open(NULL, 0));
+	EXPECT_EQ(nullptr, schedule_trace_open("no/such/directory/trace.bin", 0));
+	EXPECT_FALSE(schedule_trace_close(NULL));
+	EXPECT_EQ(nullptr, load_schedule_trace(NULL));
+	EXPECT_EQ(nullptr, load_schedule_trace("no_such_trace.bin"));
+	// A PCB file is not a trace
+	EXPECT_EQ(nullptr, load_schedule_trace("../pcb.bin"));
+
+	// An empty trace has just the header
+	ScheduleTrace_t* trace = schedule_trace_open("schedule_trace_empty.bin", 0);
+	ASSERT_NE(nullptr, trace);
+	ASSERT_TRUE(schedule_trace_close(trace));
+	dyn_array_t* events = load_schedule_trace("schedule_trace_empty.bin");
+	ASSERT_NE(nullptr, events);
+	EXPECT_EQ(0U, dyn_array_size(events));
+	dyn_array_destroy(events);
+	remove("schedule_trace_empty.bin");
+}
+
+/*
+*  PCB COLUMNS UNIT TEST CASES
+**/
+
+TEST(pcb_columns, ImportGetAndStarted) {
+	EXPECT_EQ(nullptr, pcb_columns_import(NULL));
+	EXPECT_EQ(0U, pcb_columns_size(NULL));
+	EXPECT_EQ(nullptr, pcb_columns_column(NULL, PCB_COLUMN_BURST));
+	EXPECT_FALSE(pcb_columns_set_started(NULL, 0, true));
+	EXPECT_FALSE(pcb_columns_started(NULL, 0));
+	pcb_columns_destroy(NULL);
+	dyn_array_t* not_pcbs = dyn_array_create(0, sizeof(int), NULL);
+	EXPECT_EQ(nullptr, pcb_columns_import(not_pcbs));
+	dyn_array_destroy(not_pcbs);
+
+	dyn_array_t* ready_queue = load_process_control_blocks("../pcb.bin");
+	ASSERT_NE(nullptr, ready_queue);
+	ProcessControlBlock_t* blocks = (ProcessControlBlock_t*)dyn_array_export(ready_queue);
+	blocks[1].started = true;
+	pcb_columns_t* columns = pcb_columns_import(ready_queue);
+	ASSERT_NE(nullptr, columns);
+	ASSERT_EQ(dyn_array_size(ready_queue), pcb_columns_size(columns));
+	for (size_t i = 0; i < pcb_columns_size(columns); i++)
+	{
+		ProcessControlBlock_t pcb;
+		ASSERT_TRUE(pcb_columns_get(columns, i, &pcb));
+		EXPECT_EQ(blocks[i].remaining_burst_time, pcb.remaining_burst_time);
+		EXPECT_EQ(blocks[i].priority, pcb.priority);
+		EXPECT_EQ(blocks[i].arrival, pcb.arrival);
+		EXPECT_EQ(blocks[i].started, pcb.started);
+		EXPECT_EQ(blocks[i].arrival, pcb_columns_column(columns, PCB_COLUMN_ARRIVAL)[i]);
+	}
+	ProcessControlBlock_t pcb;
+	EXPECT_FALSE(pcb_columns_get(columns, pcb_columns_size(columns), &pcb));
+	EXPECT_EQ(nullptr, pcb_columns_column(columns, (pcb_column_t)3));
+
+	// Capacity is padded to a whole vector, then it's full
+	while (columns->size < columns->capacity)
+	{
+		ASSERT_TRUE(pcb_columns_push_back(columns, &blocks[0]));
+	}
+	EXPECT_EQ(0U, columns->capacity % 8);
+	EXPECT_FALSE(pcb_columns_push_back(columns, &blocks[0]));
+
+	EXPECT_TRUE(pcb_columns_started(columns, 1));
+	EXPECT_TRUE(pcb_columns_set_started(columns, 0, true));
+	EXPECT_TRUE(pcb_columns_set_started(columns, 1, false));
+	EXPECT_TRUE(pcb_columns_started(columns, 0));
+	EXPECT_FALSE(pcb_columns_started(columns, 1));
+	EXPECT_FALSE(pcb_columns_set_started(columns, columns->size, true));
+	pcb_columns_clear_started(columns);
+	for (size_t i = 0; i < pcb_columns_size(columns); i++)
+	{
+		EXPECT_FALSE(pcb_columns_started(columns, i));
+	}
+	pcb_columns_destroy(columns);
+	dyn_array_destroy(ready_queue);
+}
+
+TEST(pcb_columns, ArgminRanges) {
+	pcb_columns_t* columns = pcb_columns_create(20);
+	ASSERT_NE(nullptr, columns);
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		ProcessControlBlock_t pcb = { 100 - i % 10, i, i, false };
+		ASSERT_TRUE(pcb_columns_push_back(columns, &pcb));
+	}
+	// Ties (bursts 91 at 9 and 19) go to the lowest index
+	EXPECT_EQ(9U, pcb_columns_argmin(columns, PCB_COLUMN_BURST, 0, 20));
+	EXPECT_EQ(19U, pcb_columns_argmin(columns, PCB_COLUMN_BURST, 10, 20));
+	EXPECT_EQ(8U, pcb_columns_argmin(columns, PCB_COLUMN_BURST, 3, 9));
+	EXPECT_EQ(5U, pcb_columns_argmin(columns, PCB_COLUMN_PRIORITY, 5, 20));
+	pcb_columns_set_started(columns, 9, true);
+	EXPECT_EQ(19U, pcb_columns_argmin(columns, PCB_COLUMN_BURST, 0, 20));
+	// Nothing left, an empty range, or a bad range all give end
+	for (size_t i = 0; i < 20; i++)
+	{
+		pcb_columns_set_started(columns, i, true);
+	}
+	EXPECT_EQ(20U, pcb_columns_argmin(columns, PCB_COLUMN_BURST, 0, 20));
+	EXPECT_EQ(4U, pcb_columns_argmin(columns, PCB_COLUMN_BURST, 4, 4));
+	EXPECT_EQ(21U, pcb_columns_argmin(columns, PCB_COLUMN_BURST, 0, 21));
+	EXPECT_EQ(5U, pcb_columns_argmin(NULL, PCB_COLUMN_BURST, 0, 5));
+	pcb_columns_destroy(columns);
+}
+
+TEST(pcb_columns, KernelsAgreeWithBruteForce) {
+	std::mt19937 random(44);
+	const size_t count = 1000;
+	pcb_columns_t* columns = pcb_columns_create(count);
+	ASSERT_NE(nullptr, columns);
+	for (size_t i = 0; i < count; i++)
+	{
+		// Few distinct values so there are plenty of ties, and some UINT32_MAX (the padding value)
+		ProcessControlBlock_t pcb = { (uint32_t)(random() % 16), (uint32_t)(random() % 3 ? random() : UINT32_MAX), 0, false };
+		ASSERT_TRUE(pcb_columns_push_back(columns, &pcb));
+	}
+	const uint32_t* bursts = pcb_columns_column(columns, PCB_COLUMN_BURST);
+	const uint32_t* priorities = pcb_columns_column(columns, PCB_COLUMN_PRIORITY);
+
+	EXPECT_TRUE(pcb_columns_use_kernel(PCB_KERNEL_SCALAR));
+	for (int round = 0; round < 400; round++)
+	{
+		// From nothing started to almost everything started
+		const unsigned started_percent = round % 100;
+		for (size_t i = 0; i < count; i++)
+		{
+			pcb_columns_set_started(columns, i, random() % 100 < started_percent);
+		}
+		const size_t begin = random() % count;
+		const size_t end = begin + random() % (count - begin + 1);
+		for (const uint32_t* values : { bursts, priorities })
+		{
+			size_t expected = end;
+			for (size_t i = begin; i < end; i++)
+			{
+				if (!pcb_columns_started(columns, i) && (expected == end || values[i] < values[expected])) { expected = i; }
+			}
+			const pcb_column_t column = values == bursts ? PCB_COLUMN_BURST : PCB_COLUMN_PRIORITY;
+			int tried = 0;
+			for (pcb_kernel_t kernel : { PCB_KERNEL_SCALAR, PCB_KERNEL_SSE41, PCB_KERNEL_AVX2 })
+			{
+				if (!pcb_columns_use_kernel(kernel)) { continue; }
+				tried++;
+				ASSERT_EQ(expected, pcb_columns_argmin(columns, column, begin, end))
+					<< "kernel " << kernel << " [" << begin << ", " << end << ") " << started_percent << "% started";
+			}
+			EXPECT_GE(tried, 1);
+		}
+	}
+	EXPECT_TRUE(pcb_columns_use_kernel(PCB_KERNEL_AUTO));
+	pcb_columns_destroy(columns);
+}
+
+/*
+*  PARALLEL SCHEDULE UNIT TEST CASES
+**/
+
+// Bursts of activity with idle gaps between them, segments need thousands of processes so this is big
+static std::vector<ProcessControlBlock_t> busy_period_workload(std::mt19937& random, const size_t count, const bool in_order)
+{
+	std::vector<ProcessControlBlock_t> pcbs;
+	uint32_t arrival = 0;
+	while (pcbs.size() < count)
+	{
+		// A busy period of up to 300 processes, then the CPU catches up (or just about catches up) and goes idle
+		const size_t group = 1 + random() % 300;
+		uint64_t work = 0;
+		for (size_t i = 0; i < group && pcbs.size() < count; i++)
+		{
+			ProcessControlBlock_t pcb = { (uint32_t)(random() % 8 ? random() % 50 : random() % 500), (uint32_t)(random() % 8),
+				arrival + (uint32_t)(random() % 100), false };
+			work += pcb.remaining_burst_time;
+			pcbs.push_back(pcb);
+		}
+		arrival += 100 + (uint32_t)work + (uint32_t)(random() % 3 ? random() % 200 : 0);
+	}
+	if (!in_order)
+	{
+		// Local shuffling, so round robin has processes holding up the ones behind them
+		for (size_t i = 0; i + 1 < pcbs.size(); i++)
+		{
+			if (random() % 4 == 0) { std::swap(pcbs[i], pcbs[i + 1 + random() % std::min<size_t>(pcbs.size() - i - 1, 500)]); }
+		}
+	}
+	return pcbs;
+}
+
+static bool run_policy_parallel(const int policy, dyn_array_t* ready_queue, ScheduleResult_t* result)
+{
+	bool (*const schedulers[])(dyn_array_t*, ScheduleResult_t*) = { first_come_first_serve, shortest_job_first, priority, NULL,
+		shortest_remaining_time_first };
+	return policy == 3 ? round_robin_parallel(ready_queue, 7, result) : schedule_parallel(ready_queue, schedulers[policy], result);
+}
+
+TEST(schedule_parallel, MatchesSingleRun) {
+	std::mt19937 random(45);
+	thread_pool_set_thread_count(4);
+	for (const bool in_order : { true, false })
+	{
+		std::vector<ProcessControlBlock_t> pcbs = busy_period_workload(random, 60000, in_order);
+		dyn_array_t* ready_queue = dyn_array_import(pcbs.data(), pcbs.size(), sizeof(ProcessControlBlock_t), NULL);
+		ASSERT_NE(nullptr, ready_queue);
+		for (int policy = 0; policy < 5; policy++)
+		{
+			ScheduleResult_t expected, actual;
+			ASSERT_TRUE(run_policy(policy, ready_queue, &expected));
+			ASSERT_TRUE(run_policy_parallel(policy, ready_queue, &actual)) << policy;
+			// Both come from the same integer totals, so they match exactly
+			EXPECT_EQ(expected.average_waiting_time, actual.average_waiting_time) << policy << " " << in_order;
+			EXPECT_EQ(expected.average_turnaround_time, actual.average_turnaround_time) << policy << " " << in_order;
+			EXPECT_EQ(expected.total_run_time, actual.total_run_time) << policy << " " << in_order;
+		}
+		// The ready queue is left as it was
+		EXPECT_EQ(0, memcmp(pcbs.data(), dyn_array_export(ready_queue), pcbs.size() * sizeof(ProcessControlBlock_t)));
+		dyn_array_destroy(ready_queue);
+	}
+
+	// A small trace is a single segment
+	dyn_array_t* ready_queue = load_process_control_blocks("../pcb.bin");
+	ASSERT_NE(nullptr, ready_queue);
+	for (int policy = 0; policy < 5; policy++)
+	{
+		ScheduleResult_t expected, actual;
+		ASSERT_TRUE(run_policy(policy, ready_queue, &expected));
+		ASSERT_TRUE(run_policy_parallel(policy, ready_queue, &actual));
+		EXPECT_EQ(expected.average_waiting_time, actual.average_waiting_time) << policy;
+		EXPECT_EQ(expected.average_turnaround_time, actual.average_turnaround_time) << policy;
+		EXPECT_EQ(expected.total_run_time, actual.total_run_time) << policy;
+	}
+	dyn_array_destroy(ready_queue);
+	thread_pool_set_thread_count(0);
+}
+
+TEST(schedule_parallel, LeavesHooksAlone) {
+	ScheduleResult_t result;
+	EXPECT_FALSE(schedule_parallel(NULL, shortest_job_first, &result));
+	EXPECT_FALSE(round_robin_parallel(NULL, 4, &result));
+	dyn_array_t* ready_queue = dyn_array_create(0, sizeof(ProcessControlBlock_t), NULL);
+	EXPECT_FALSE(schedule_parallel(ready_queue, shortest_job_first, &result));
+	dyn_array_destroy(ready_queue);
+
+	ready_queue = load_process_control_blocks("../pcb.bin");
+	ASSERT_NE(nullptr, ready_queue);
+	EXPECT_FALSE(schedule_parallel(ready_queue, NULL, &result));
+	EXPECT_FALSE(schedule_parallel(ready_queue, shortest_job_first, NULL));
+	EXPECT_FALSE(round_robin_parallel(ready_queue, 0, &result));
+
+	// What the caller attached sees nothing, and is still attached afterwards
+	CompletionTotals completions = {};
+	ScheduleStats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	schedule_stats_attach(&stats);
+	schedule_completion_attach(count_completion, &completions);
+	EXPECT_TRUE(schedule_parallel(ready_queue, priority, &result));
+	EXPECT_TRUE(round_robin_parallel(ready_queue, 4, &result));
+	EXPECT_EQ(0U, completions.count);
+	EXPECT_EQ(0U, stats.selections);
+	schedule_completion_function_t observer;
+	void* arg;
+	schedule_completion_attached(&observer, &arg);
+	EXPECT_EQ((schedule_completion_function_t)count_completion, observer);
+	EXPECT_EQ(&completions, arg);
+	EXPECT_TRUE(priority(ready_queue, &result));
+	EXPECT_EQ(dyn_array_size(ready_queue), completions.count);
+	schedule_completion_attach(NULL, NULL);
+	schedule_stats_attach(NULL);
+	dyn_array_destroy(ready_queue);
+}
+
+/*
+*  SIMULATION HANDLE UNIT TEST CASES
+**/
+
+static ScheduleSimulation_t* create_policy_simulation(const int policy)
+{
+	bool (*const schedulers[])(dyn_array_t*, ScheduleResult_t*) = { first_come_first_serve, shortest_job_first, priority, NULL,
+		shortest_remaining_time_first };
+	return policy == 3 ? round_robin_simulation_create(7) : schedule_simulation_create(schedulers[policy]);
+}
+
+// Arrival ordered, with busy stretches, idle gaps, ties on arrival and zero bursts
+static std::vector<ProcessControlBlock_t> arrival_ordered_workload(std::mt19937& random, const size_t count)
+{
+	std::vector<ProcessControlBlock_t> pcbs;
+	uint32_t arrival = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint32_t step = random() % 4 == 0 ? 0 : random() % 10 == 0 ? 200 + random() % 300 : random() % 12;
+		arrival += step;
+		pcbs.push_back({ (uint32_t)(random() % 20 == 0 ? 0 : 1 + random() % 30), (uint32_t)(random() % 5), arrival, false });
+	}
+	return pcbs;
+}
+
+static void expect_same_result(const ScheduleResult_t& expected, const ScheduleResult_t& actual, const int policy, const size_t count)
+{
+	EXPECT_EQ(expected.average_waiting_time, actual.average_waiting_time) << policy << " after " << count;
+	EXPECT_EQ(expected.average_turnaround_time, actual.average_turnaround_time) << policy << " after " << count;
+	EXPECT_EQ(expected.total_run_time, actual.total_run_time) << policy << " after " << count;
+}
+
+TEST(schedule_simulation, MatchesRerunAfterEveryAppend) {
+	std::mt19937 random(46);
+	const std::vector<ProcessControlBlock_t> pcbs = arrival_ordered_workload(random, 3000);
+	for (int policy = 0; policy < 5; policy++)
+	{
+		ScheduleSimulation_t* simulation = create_policy_simulation(policy);
+		ASSERT_NE(nullptr, simulation);
+		size_t appended = 0;
+		while (appended < pcbs.size())
+		{
+			// Batches from a single process up to a few hundred
+			const size_t batch = std::min<size_t>(pcbs.size() - appended, random() % 3 == 0 ? 1 : 1 + random() % 200);
+			dyn_array_t* more = dyn_array_import(pcbs.data() + appended, batch, sizeof(ProcessControlBlock_t), NULL);
+			ASSERT_TRUE(schedule_simulation_append(simulation, more));
+			dyn_array_destroy(more);
+			appended += batch;
+			ASSERT_EQ(appended, schedule_simulation_size(simulation));
+
+			ScheduleResult_t expected, actual;
+			dyn_array_t* history = dyn_array_import(pcbs.data(), appended, sizeof(ProcessControlBlock_t), NULL);
+			ASSERT_TRUE(run_policy(policy, history, &expected));
+			dyn_array_destroy(history);
+			ASSERT_TRUE(schedule_simulation_advance(simulation, &actual));
+			expect_same_result(expected, actual, policy, appended);
+			if (HasFailure()) { break; }
+		}
+		schedule_simulation_destroy(simulation);
+	}
+}
+
+TEST(schedule_simulation, ClonesCarryOnSeparately) {
+	std::mt19937 random(4646);
+	const std::vector<ProcessControlBlock_t> prefix = arrival_ordered_workload(random, 500);
+	for (int policy = 0; policy < 5; policy++)
+	{
+		ScheduleSimulation_t* simulation = create_policy_simulation(policy);
+		dyn_array_t* shared = dyn_array_import(prefix.data(), prefix.size(), sizeof(ProcessControlBlock_t), NULL);
+		ASSERT_TRUE(schedule_simulation_append(simulation, shared));
+		dyn_array_destroy(shared);
+		ScheduleResult_t before;
+		ASSERT_TRUE(schedule_simulation_advance(simulation, &before));
+
+		// Two different continuations from the same warm prefix
+		for (int fork = 0; fork < 2; fork++)
+		{
+			ScheduleSimulation_t* copy = schedule_simulation_clone(simulation);
+			ASSERT_NE(nullptr, copy);
+			std::vector<ProcessControlBlock_t> whole = prefix;
+			for (size_t i = 0; i < 200; i++)
+			{
+				whole.push_back({ (uint32_t)(1 + random() % (fork ? 5 : 50)), (uint32_t)(random() % 5), prefix.back().arrival + (uint32_t)(i * (fork + 1)), false });
+			}
+			dyn_array_t* more = dyn_array_import(whole.data() + prefix.size(), 200, sizeof(ProcessControlBlock_t), NULL);
+			ASSERT_TRUE(schedule_simulation_append(copy, more));
+			dyn_array_destroy(more);
+
+			ScheduleResult_t expected, actual;
+			dyn_array_t* everything = dyn_array_import(whole.data(), whole.size(), sizeof(ProcessControlBlock_t), NULL);
+			ASSERT_TRUE(run_policy(policy, everything, &expected));
+			dyn_array_destroy(everything);
+			ASSERT_TRUE(schedule_simulation_advance(copy, &actual));
+			expect_same_result(expected, actual, policy, whole.size());
+			schedule_simulation_destroy(copy);
+		}
+
+		// The original never saw either
+		ScheduleResult_t after;
+		ASSERT_TRUE(schedule_simulation_advance(simulation, &after));
+		expect_same_result(before, after, policy, prefix.size());
+		EXPECT_EQ(prefix.size(), schedule_simulation_size(simulation));
+		schedule_simulation_destroy(simulation);
+	}
+}
+
+// A scheduler the handles don't know
+static bool unknown_scheduler(dyn_array_t*, ScheduleResult_t*)
+{
+	return false;
+}
+
+TEST(schedule_simulation, RejectsBadInput) {
+	EXPECT_EQ(nullptr, schedule_simulation_create(NULL));
+	EXPECT_EQ(nullptr, schedule_simulation_create(unknown_scheduler));
+	EXPECT_EQ(nullptr, round_robin_simulation_create(0));
+	EXPECT_EQ(nullptr, schedule_simulation_clone(NULL));
+	EXPECT_EQ(0U, schedule_simulation_size(NULL));
+	schedule_simulation_destroy(NULL);
+
+	ScheduleSimulation_t* simulation = schedule_simulation_create(shortest_remaining_time_first);
+	ASSERT_NE(nullptr, simulation);
+	ScheduleResult_t result;
+	EXPECT_FALSE(schedule_simulation_advance(simulation, &result));
+	EXPECT_FALSE(schedule_simulation_append(simulation, NULL));
+	dyn_array_t* not_pcbs = dyn_array_create(0, sizeof(int), NULL);
+	EXPECT_FALSE(schedule_simulation_append(simulation, not_pcbs));
+	dyn_array_destroy(not_pcbs);
+
+	ProcessControlBlock_t pcbs[] = { { 5, 0, 10, false }, { 3, 0, 12, false }, { 4, 0, 11, false } };
+	dyn_array_t* in_order = dyn_array_import(pcbs, 2, sizeof(ProcessControlBlock_t), NULL);
+	ASSERT_TRUE(schedule_simulation_append(simulation, in_order));
+	dyn_array_destroy(in_order);
+	EXPECT_FALSE(schedule_simulation_advance(simulation, NULL));
+
+	// Arriving before the last one appended is out of order, and nothing from that batch goes in
+	ProcessControlBlock_t late[] = { pcbs[1], pcbs[2] };
+	dyn_array_t* out_of_order = dyn_array_import(late, 2, sizeof(ProcessControlBlock_t), NULL);
+	EXPECT_FALSE(schedule_simulation_append(simulation, out_of_order));
+	dyn_array_destroy(out_of_order);
+	EXPECT_EQ(2U, schedule_simulation_size(simulation));
+
+	// Nothing attached sees a handle's runs
+	ScheduleStats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	schedule_stats_attach(&stats);
+	ASSERT_TRUE(schedule_simulation_advance(simulation, &result));
+	schedule_stats_attach(NULL);
+	EXPECT_EQ(0U, stats.selections);
+	// 0 runs 10-12, 1 runs 12-15, then 0 finishes 15-18
+	EXPECT_EQ(18U, result.total_run_time);
+	EXPECT_FLOAT_EQ(5.5f, result.average_turnaround_time);
+	EXPECT_FLOAT_EQ(1.5f, result.average_waiting_time);
+	schedule_simulation_destroy(simulation);
+}
+
+/*
+*  SIMULATION CHECKPOINT UNIT TEST CASES
+**/
+
+static bool append_pcbs(ScheduleSimulation_t* simulation, const ProcessControlBlock_t* pcbs, const size_t count)
+{
+	dyn_array_t* more = dyn_array_import(pcbs, count, sizeof(ProcessControlBlock_t), NULL);
+	const bool appended = schedule_simulation_append(simulation, more);
+	dyn_array_destroy(more);
+	return appended;
+}
+
+TEST(schedule_checkpoint, RestoresMidGrowth) {
+	const char* path = "schedule_checkpoint_test.bin";
+	std::mt19937 random(47);
+	const std::vector<ProcessControlBlock_t> pcbs = arrival_ordered_workload(random, 4000);
+	for (int policy = 0; policy < 5; policy++)
+	{
+		ScheduleSimulation_t* simulation = create_policy_simulation(policy);
+		ASSERT_TRUE(append_pcbs(simulation, pcbs.data(), 1500));
+		ScheduleResult_t before;
+		ASSERT_TRUE(schedule_simulation_advance(simulation, &before));
+		ASSERT_TRUE(schedule_simulation_checkpoint(simulation, path));
+		schedule_simulation_destroy(simulation);
+
+		// Restored twice, each carries on with a different continuation of the same prefix
+		for (size_t end = 2500; end <= pcbs.size(); end += 1500)
+		{
+			ScheduleSimulation_t* restored = schedule_simulation_restore(path);
+			ASSERT_NE(nullptr, restored);
+			EXPECT_EQ(1500U, schedule_simulation_size(restored));
+			ScheduleResult_t actual;
+			ASSERT_TRUE(schedule_simulation_advance(restored, &actual));
+			expect_same_result(before, actual, policy, 1500);
+
+			ASSERT_TRUE(append_pcbs(restored, pcbs.data() + 1500, end - 1500));
+			ScheduleResult_t expected;
+			dyn_array_t* everything = dyn_array_import(pcbs.data(), end, sizeof(ProcessControlBlock_t), NULL);
+			ASSERT_TRUE(run_policy(policy, everything, &expected));
+			dyn_array_destroy(everything);
+			ASSERT_TRUE(schedule_simulation_advance(restored, &actual));
+			expect_same_result(expected, actual, policy, end);
+			schedule_simulation_destroy(restored);
+		}
+	}
+	remove(path);
+}
+
+static volatile sig_atomic_t checkpoint_requested = 0;
+
+static void request_checkpoint(int)
+{
+	checkpoint_requested = 1;
+}
+
+TEST(schedule_checkpoint, FinishResumesFromCheckpoint) {
+	const char* path = "schedule_checkpoint_finish.bin";
+	std::mt19937 random(4747);
+	// Enough decisions for finish to check for a checkpoint several times
+	const std::vector<ProcessControlBlock_t> pcbs = arrival_ordered_workload(random, 200000);
+	dyn_array_t* everything = dyn_array_import(pcbs.data(), pcbs.size(), sizeof(ProcessControlBlock_t), NULL);
+	void (*const previous)(int) = signal(SIGUSR1, request_checkpoint);
+	for (int policy = 0; policy < 5; policy++)
+	{
+		ScheduleResult_t expected;
+		ASSERT_TRUE(run_policy(policy, everything, &expected));
+
+		ScheduleSimulation_t* simulation = create_policy_simulation(policy);
+		ASSERT_TRUE(append_pcbs(simulation, pcbs.data(), pcbs.size()));
+		const ScheduleCheckpoints_t checkpoints = { path, 0, &checkpoint_requested };
+		raise(SIGUSR1);
+		ScheduleResult_t actual;
+		ASSERT_TRUE(schedule_simulation_finish(simulation, &checkpoints, &actual));
+		expect_same_result(expected, actual, policy, pcbs.size());
+		EXPECT_EQ(0, checkpoint_requested);
+		// Finishing closes the handle
+		EXPECT_FALSE(append_pcbs(simulation, &pcbs.back(), 1));
+		schedule_simulation_destroy(simulation);
+
+		// The checkpoint was taken partway through, as if the run had been interrupted there
+		ScheduleSimulation_t* restored = schedule_simulation_restore(path);
+		ASSERT_NE(nullptr, restored);
+		EXPECT_FALSE(append_pcbs(restored, &pcbs.back(), 1));
+		ASSERT_TRUE(schedule_simulation_finish(restored, NULL, &actual));
+		expect_same_result(expected, actual, policy, pcbs.size());
+		schedule_simulation_destroy(restored);
+	}
+	signal(SIGUSR1, previous);
+	dyn_array_destroy(everything);
+	remove(path);
+}
+
+TEST(schedule_checkpoint, RejectsBadFiles) {
+	const char* path = "schedule_checkpoint_bad.bin";
+	EXPECT_EQ(nullptr, schedule_simulation_restore(NULL));
+	EXPECT_EQ(nullptr, schedule_simulation_restore("no_such_checkpoint.bin"));
+	EXPECT_EQ(nullptr, schedule_simulation_restore("../pcb.bin"));
+	EXPECT_FALSE(schedule_simulation_checkpoint(NULL, path));
+
+	ScheduleSimulation_t* simulation = round_robin_simulation_create(4);
+	ProcessControlBlock_t pcbs[] = { { 5, 0, 0, false }, { 3, 0, 1, false }, { 4, 0, 2, false } };
+	ASSERT_TRUE(append_pcbs(simulation, pcbs, 3));
+	EXPECT_FALSE(schedule_simulation_checkpoint(simulation, NULL));
+	EXPECT_FALSE(schedule_simulation_checkpoint(simulation, "no/such/directory/checkpoint.bin"));
+	ScheduleResult_t result;
+	const ScheduleCheckpoints_t nowhere = { NULL, 1, NULL };
+	EXPECT_FALSE(schedule_simulation_finish(simulation, &nowhere, &result));
+	EXPECT_FALSE(schedule_simulation_finish(simulation, NULL, NULL));
+
+	// A checkpoint missing its last byte, or with one too many, is not a checkpoint
+	ASSERT_TRUE(schedule_simulation_checkpoint(simulation, path));
+	struct stat file_stats;
+	ASSERT_EQ(0, stat(path, &file_stats));
+	ASSERT_EQ(0, truncate(path, file_stats.st_size - 1));
+	EXPECT_EQ(nullptr, schedule_simulation_restore(path));
+	ASSERT_EQ(0, truncate(path, file_stats.st_size + 1));
+	EXPECT_EQ(nullptr, schedule_simulation_restore(path));
+	ASSERT_EQ(0, truncate(path, file_stats.st_size));
+	ScheduleSimulation_t* restored = schedule_simulation_restore(path);
+	ASSERT_NE(nullptr, restored);
+	// 0 runs 0-4, 1 runs 4-7, 2 runs 7-11, 0 finishes 11-12
+	ASSERT_TRUE(schedule_simulation_finish(restored, NULL, &result));
+	EXPECT_EQ(12U, result.total_run_time);
+	schedule_simulation_destroy(restored);
+	schedule_simulation_destroy(simulation);
+	remove(path);
+}
+
+/*
+*  PCB SORT UNIT TEST CASES
+**/
+
+// Writes PCBs to a file in the format load_process_control_blocks reads
+static bool write_pcb_file(const char* path, const std::vector<ProcessControlBlock_t>& pcbs)
+{
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) { return false; }
+	const uint32_t count = (uint32_t)pcbs.size();
+	bool written = fwrite(&count, sizeof(count), 1, file) == 1;
+	for (const ProcessControlBlock_t& pcb : pcbs)
+	{
+		const uint32_t fields[3] = { pcb.remaining_burst_time, pcb.priority, pcb.arrival };
+		written = written && fwrite(fields, sizeof(fields), 1, file) == 1;
+	}
+	return fclose(file) == 0 && written;
+}
+
+// Random PCBs with arrivals up to max_arrival, bursts number them so ties can be told apart
+static std::vector<ProcessControlBlock_t> unsorted_workload(std::mt19937& random, const size_t count, const uint32_t max_arrival)
+{
+	std::vector<ProcessControlBlock_t> pcbs;
+	for (size_t i = 0; i < count; i++)
+	{
+		pcbs.push_back({ (uint32_t)i, (uint32_t)(random() % 5), (uint32_t)(random() % ((uint64_t)max_arrival + 1)), false });
+	}
+	return pcbs;
+}
+
+static std::vector<ProcessControlBlock_t> stable_sorted(std::vector<ProcessControlBlock_t> pcbs)
+{
+	std::stable_sort(pcbs.begin(), pcbs.end(), [](const ProcessControlBlock_t& a, const ProcessControlBlock_t& b) { return a.arrival < b.arrival; });
+	return pcbs;
+}
+
+TEST(pcb_sort, MatchesStableSort) {
+	const char* input = "pcb_sort_input.bin";
+	const char* output = "pcb_sort_output.bin";
+	std::mt19937 random(48);
+	// Fits in memory, one run per chunk with a single merge, then several merge passes; narrow and full range arrivals
+	const struct { size_t count; uint32_t max_arrival; size_t memory; } cases[] = {
+		{ 1000, 100, 0 }, { 30000, 5000, PCB_SORT_MIN_MEMORY * 2 }, { 200000, 1000, PCB_SORT_MIN_MEMORY },
+		{ 200000, UINT32_MAX, PCB_SORT_MIN_MEMORY }, { 1, 0, PCB_SORT_MIN_MEMORY } };
+	for (const auto& test : cases)
+	{
+		const std::vector<ProcessControlBlock_t> pcbs = unsorted_workload(random, test.count, test.max_arrival);
+		ASSERT_TRUE(write_pcb_file(input, pcbs));
+		const pcb_sort_options_t options = { test.memory, "." };
+		ASSERT_TRUE(pcb_sort_file(input, output, &options)) << test.count;
+
+		const std::vector<ProcessControlBlock_t> expected = stable_sorted(pcbs);
+		dyn_array_t* sorted = load_process_control_blocks(output);
+		ASSERT_NE(nullptr, sorted);
+		ASSERT_EQ(expected.size(), dyn_array_size(sorted));
+		const ProcessControlBlock_t* actual = (const ProcessControlBlock_t*)dyn_array_export(sorted);
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			ASSERT_EQ(expected[i].arrival, actual[i].arrival) << test.count << " at " << i;
+			ASSERT_EQ(expected[i].remaining_burst_time, actual[i].remaining_burst_time) << test.count << " at " << i;
+			ASSERT_EQ(expected[i].priority, actual[i].priority) << test.count << " at " << i;
+		}
+		dyn_array_destroy(sorted);
+	}
+	remove(input);
+	remove(output);
+}
+
+TEST(pcb_sort, StreamsIntoSimulation) {
+	const char* input = "pcb_sort_stream.bin";
+	std::mt19937 random(4848);
+	std::vector<ProcessControlBlock_t> pcbs = unsorted_workload(random, 100000, 2000000);
+	for (ProcessControlBlock_t& pcb : pcbs) { pcb.remaining_burst_time = 1 + random() % 30; }
+	ASSERT_TRUE(write_pcb_file(input, pcbs));
+	dyn_array_t* ready_queue = dyn_array_import(pcbs.data(), pcbs.size(), sizeof(ProcessControlBlock_t), NULL);
+
+	// FCFS and SRTF only break ties on arrival by file position, which the stable sort keeps
+	bool (*const schedulers[])(dyn_array_t*, ScheduleResult_t*) = { first_come_first_serve, shortest_remaining_time_first };
+	for (auto scheduler : schedulers)
+	{
+		ScheduleResult_t expected, actual;
+		ASSERT_TRUE(scheduler(ready_queue, &expected));
+		ScheduleSimulation_t* simulation = schedule_simulation_create(scheduler);
+		const pcb_sort_options_t options = { PCB_SORT_MIN_MEMORY, "." };
+		ASSERT_TRUE(pcb_sort_simulation(input, &options, simulation));
+		EXPECT_EQ(pcbs.size(), schedule_simulation_size(simulation));
+		ASSERT_TRUE(schedule_simulation_finish(simulation, NULL, &actual));
+		EXPECT_EQ(expected.average_waiting_time, actual.average_waiting_time);
+		EXPECT_EQ(expected.average_turnaround_time, actual.average_turnaround_time);
+		EXPECT_EQ(expected.total_run_time, actual.total_run_time);
+		schedule_simulation_destroy(simulation);
+	}
+	dyn_array_destroy(ready_queue);
+	remove(input);
+}
+
+// Takes the first batch and then stops the sort
+static bool stop_after_first_batch(void* arg, const ProcessControlBlock_t*, size_t count)
+{
+	*(size_t*)arg += count;
+	return false;
+}
+
+TEST(pcb_sort, RejectsBadInput) {
+	const char* input = "pcb_sort_bad.bin";
+	const char* output = "pcb_sort_bad_output.bin";
+	EXPECT_FALSE(pcb_sort_file(NULL, output, NULL));
+	EXPECT_FALSE(pcb_sort_file("../pcb.bin", NULL, NULL));
+	EXPECT_FALSE(pcb_sort_file("no_such_pcbs.bin", output, NULL));
+	EXPECT_NE(0, access(output, F_OK));
+	EXPECT_FALSE(pcb_sort_stream("../pcb.bin", NULL, NULL, NULL));
+	EXPECT_FALSE(pcb_sort_simulation("../pcb.bin", NULL, NULL));
+
+	// Sorting a file onto itself would truncate it first
+	std::mt19937 random(484848);
+	const std::vector<ProcessControlBlock_t> pcbs = unsorted_workload(random, 100, 10);
+	ASSERT_TRUE(write_pcb_file(input, pcbs));
+	EXPECT_FALSE(pcb_sort_file(input, input, NULL));
+	dyn_array_t* untouched = load_process_control_blocks(input);
+	ASSERT_NE(nullptr, untouched);
+	EXPECT_EQ(pcbs.size(), dyn_array_size(untouched));
+	dyn_array_destroy(untouched);
+
+	// The consumer can stop it
+	size_t consumed = 0;
+	EXPECT_FALSE(pcb_sort_stream(input, NULL, stop_after_first_batch, &consumed));
+	EXPECT_EQ(pcbs.size(), consumed);
+
+	// A file with fewer PCBs than its count says fails, and leaves no output behind
+	ASSERT_EQ(0, truncate(input, 4 + 12 * 50));
+	EXPECT_FALSE(pcb_sort_file(input, output, NULL));
+	EXPECT_NE(0, access(output, F_OK));
+	const pcb_sort_options_t nowhere = { PCB_SORT_MIN_MEMORY, "no/such/directory" };
+	ASSERT_TRUE(write_pcb_file(input, unsorted_workload(random, 100000, 10)));
+	EXPECT_FALSE(pcb_sort_file(input, output, &nowhere));
+	remove(input);
+}
+
+/*
+*  PCB CHANNEL UNIT TEST CASES
+**/
+struct ChannelProducer
+{
+	pcb_channel_t* channel;
+	uint32_t count;
+	bool in_place;		// reserve/publish instead of send
+	bool sent;
+};
+
+// Sends PCBs numbered 0 to count - 1 in uneven batches, then closes the channel
+static void* produce_pcbs(void* arg)
+{
+	ChannelProducer* producer = (ChannelProducer*)arg;
+	std::mt19937 random(50);
+	std::vector<ProcessControlBlock_t> batch;
+	producer->sent = true;
+	for (uint32_t next = 0; producer->sent && next < producer->count;)
+	{
+		const uint32_t wanted = std::min<uint32_t>(producer->count - next, 1 + random() % 300);
+		if (producer->in_place)
+		{
+			ProcessControlBlock_t* slots = NULL;
+			const size_t reserved = pcb_channel_reserve(producer->channel, &slots, wanted);
+			producer->sent = reserved > 0 && reserved <= wanted;
+			for (size_t i = 0; producer->sent && i < reserved; i++) { slots[i] = ProcessControlBlock_t{ next + (uint32_t)i, 0, next + (uint32_t)i, false }; }
+			pcb_channel_publish(producer->channel, reserved);
+			next += (uint32_t)reserved;
+		}
+		else
+		{
+			batch.clear();
+			for (uint32_t i = 0; i < wanted; i++) { batch.push_back(ProcessControlBlock_t{ next + i, 0, next + i, false }); }
+			producer->sent = pcb_channel_send(producer->channel, batch.data(), batch.size());
+			next += wanted;
+		}
+	}
+	pcb_channel_close(producer->channel);
+	return NULL;
+}
+
+TEST(pcb_channel, HandsOverInOrder) {
+	for (int in_place = 0; in_place < 2; in_place++)
+	{
+		// A small ring, so both sides keep running into each other
+		pcb_channel_t* channel = pcb_channel_create(100);
+		ASSERT_NE(nullptr, channel);
+		ChannelProducer producer = { channel, 500000, in_place == 1, false };
+		pthread_t thread;
+		ASSERT_EQ(0, pthread_create(&thread, NULL, produce_pcbs, &producer));
+
+		// Alternate between reading in place and copying out
+		uint32_t expected = 0;
+		bool in_order = true;
+		std::vector<ProcessControlBlock_t> copied(97);
+		for (bool peek = true;; peek = !peek)
+		{
+			size_t count = 0;
+			if (peek)
+			{
+				const ProcessControlBlock_t* pcbs = NULL;
+				count = pcb_channel_peek(channel, &pcbs);
+				for (size_t i = 0; i < count; i++) { in_order = in_order && pcbs[i].arrival == expected + i; }
+				pcb_channel_release(channel, count);
+			}
+			else
+			{
+				count = pcb_channel_receive(channel, copied.data(), copied.size());
+				for (size_t i = 0; i < count; i++) { in_order = in_order && copied[i].arrival == expected + i && copied[i].remaining_burst_time == expected + i; }
+			}
+			if (count == 0) { break; }
+			expected += (uint32_t)count;
+		}
+		pthread_join(thread, NULL);
+
+		EXPECT_TRUE(producer.sent);
+		EXPECT_TRUE(in_order);
+		EXPECT_EQ(producer.count, expected);
+		EXPECT_FALSE(pcb_channel_aborted(channel));
+		EXPECT_FALSE(pcb_channel_send(channel, copied.data(), 1));
+		pcb_channel_destroy(channel);
+	}
+}
+
+TEST(pcb_channel, AbortStopsBothSides) {
+	// A producer stuck on a full ring gets woken by the consumer giving up
+	pcb_channel_t* channel = pcb_channel_create(64);
+	ChannelProducer producer = { channel, 100000, false, true };
+	pthread_t thread;
+	ASSERT_EQ(0, pthread_create(&thread, NULL, produce_pcbs, &producer));
+	const ProcessControlBlock_t* pcbs = NULL;
+	ASSERT_GT(pcb_channel_peek(channel, &pcbs), 0U);
+	pcb_channel_abort(channel);
+	pthread_join(thread, NULL);
+	EXPECT_FALSE(producer.sent);
+	EXPECT_TRUE(pcb_channel_aborted(channel));
+	EXPECT_EQ(0U, pcb_channel_peek(channel, &pcbs));
+	pcb_channel_destroy(channel);
+
+	EXPECT_EQ(nullptr, pcb_channel_create(SIZE_MAX));
+	EXPECT_EQ(0U, pcb_channel_peek(NULL, &pcbs));
+	EXPECT_FALSE(pcb_channel_send(NULL, NULL, 0));
+	pcb_channel_destroy(NULL);
+}
+
+TEST(pcb_channel, SimulatesFile) {
+	const char* input = "pcb_channel_input.bin";
+	std::mt19937 random(5050);
+	std::vector<ProcessControlBlock_t> pcbs = stable_sorted(unsorted_workload(random, 300000, 3000000));
+	for (ProcessControlBlock_t& pcb : pcbs) { pcb.remaining_burst_time = 1 + random() % 30; }
+	ASSERT_TRUE(write_pcb_file(input, pcbs));
+	dyn_array_t* ready_queue = dyn_array_import(pcbs.data(), pcbs.size(), sizeof(ProcessControlBlock_t), NULL);
+
+	bool (*const schedulers[])(dyn_array_t*, ScheduleResult_t*) = { first_come_first_serve, shortest_job_first, priority, shortest_remaining_time_first };
+	for (auto scheduler : schedulers)
+	{
+		ScheduleResult_t expected, actual;
+		ASSERT_TRUE(scheduler(ready_queue, &expected));
+		ScheduleSimulation_t* simulation = schedule_simulation_create(scheduler);
+		ASSERT_TRUE(pcb_channel_simulate_file(input, simulation));
+		EXPECT_EQ(pcbs.size(), schedule_simulation_size(simulation));
+		ASSERT_TRUE(schedule_simulation_advance(simulation, &actual));
+		EXPECT_EQ(expected.average_waiting_time, actual.average_waiting_time);
+		EXPECT_EQ(expected.average_turnaround_time, actual.average_turnaround_time);
+		EXPECT_EQ(expected.total_run_time, actual.total_run_time);
+		schedule_simulation_destroy(simulation);
+	}
+	dyn_array_destroy(ready_queue);
+
+	// Out of order, missing and truncated files all fail
+	ScheduleSimulation_t* simulation = round_robin_simulation_create(QUANTUM);
+	EXPECT_FALSE(pcb_channel_simulate_file("no_such_pcbs.bin", simulation));
+	EXPECT_FALSE(pcb_channel_simulate_file(input, NULL));
+	std::swap(pcbs.front(), pcbs.back());
+	ASSERT_TRUE(write_pcb_file(input, pcbs));
+	EXPECT_FALSE(pcb_channel_simulate_file(input, simulation));
+	ASSERT_TRUE(write_pcb_file(input, stable_sorted(pcbs)));
+	ASSERT_EQ(0, truncate(input, 4 + 12 * 1000));
+	ScheduleSimulation_t* truncated = round_robin_simulation_create(QUANTUM);
+	EXPECT_FALSE(pcb_channel_simulate_file(input, truncated));
+	schedule_simulation_destroy(truncated);
+	schedule_simulation_destroy(simulation);
+	remove(input);
+}
+
+/*
+*  ANALYSIS BATCH UNIT TEST CASES
+**/
+
+// Runs a command, returning its exit status (-1 if it didn't exit) and its standard output
+static int run_command(const std::string& command, std::string& output)
+{
+	output.clear();
+	FILE* pipe = popen(command.c_str(), "r");
+	if (pipe == NULL) { return -1; }
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), pipe)) > 0) { output.append(buffer, read); }
+	const int status = pclose(pipe);
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// One summary row (empty file column) of the batch CSV report
+struct BatchSummaryRow
+{
+	int complete;
+	size_t pcbs;
+	double average_waiting_time;
+	double average_turnaround_time;
+	unsigned long total_run_time;
+};
+
+static bool batch_summary_row(const std::string& csv, const std::string& algorithm, BatchSummaryRow& row)
+{
+	std::istringstream lines(csv);
+	std::string line;
+	const std::string prefix = "," + algorithm + ",";
+	while (std::getline(lines, line))
+	{
+		if (line.compare(0, prefix.size(), prefix) != 0) { continue; }
+		return sscanf(line.c_str() + prefix.size(), "%d,%zu,%lf,%lf,%lu", &row.complete, &row.pcbs, &row.average_waiting_time,
+			&row.average_turnaround_time, &row.total_run_time) == 5;
+	}
+	return false;
+}
+
+TEST(analysis_batch, SummaryIsWeightedByPcbCount) {
+	const std::string directory = "analysis_batch_weighted";
+	mkdir(directory.c_str(), 0755);
+	// Very different sizes and waits, so a plain mean of the two files would be far off
+	std::vector<std::vector<ProcessControlBlock_t>> traces(2);
+	for (uint32_t i = 0; i < 3; i++) { traces[0].push_back({ 20 - i, i % 3, 0, false }); }
+	for (uint32_t i = 0; i < 40; i++) { traces[1].push_back({ 1 + i % 7, i % 4, i / 2, false }); }
+	std::vector<std::string> paths;
+	for (size_t t = 0; t < traces.size(); t++)
+	{
+		paths.push_back(directory + "/trace" + std::to_string(t) + ".bin");
+		ASSERT_TRUE(write_pcb_file(paths.back().c_str(), traces[t]));
+	}
+
+	std::string output;
+	ASSERT_EQ(0, run_command(std::string(ANALYSIS_PATH) + " --batch " + directory + " FCFS,SJF,RR " + std::to_string(QUANTUM) + " --format csv", output)) << output;
+
+	const struct { const char* name; bool (*scheduler)(dyn_array_t*, ScheduleResult_t*); } algorithms[] = {
+		{ "FCFS", first_come_first_serve }, { "SJF", shortest_job_first }, { "RR", NULL } };
+	for (const auto& algorithm : algorithms)
+	{
+		double waiting = 0, turnaround = 0;
+		unsigned long run_time = 0;
+		size_t pcbs = 0;
+		for (const std::string& path : paths)
+		{
+			dyn_array_t* ready_queue = load_process_control_blocks(path.c_str());
+			ASSERT_NE(nullptr, ready_queue);
+			ScheduleResult_t result;
+			ASSERT_TRUE(algorithm.scheduler ? algorithm.scheduler(ready_queue, &result) : round_robin(ready_queue, &result, QUANTUM));
+			const size_t count = dyn_array_size(ready_queue);
+			waiting += (double)result.average_waiting_time * count;
+			turnaround += (double)result.average_turnaround_time * count;
+			run_time += result.total_run_time;
+			pcbs += count;
+			dyn_array_destroy(ready_queue);
+		}
+
+		BatchSummaryRow row;
+		ASSERT_TRUE(batch_summary_row(output, algorithm.name, row)) << output;
+		EXPECT_EQ(1, row.complete) << algorithm.name;
+		EXPECT_EQ(pcbs, row.pcbs) << algorithm.name;
+		EXPECT_NEAR(waiting / pcbs, row.average_waiting_time, 1e-5) << algorithm.name;
+		EXPECT_NEAR(turnaround / pcbs, row.average_turnaround_time, 1e-5) << algorithm.name;
+		EXPECT_EQ(run_time, row.total_run_time) << algorithm.name;
+	}
+
+	for (const std::string& path : paths) { remove(path.c_str()); }
+	rmdir(directory.c_str());
+}
+
+TEST(analysis_batch, FailedFileFailsTheBatch) {
+	const std::string directory = "analysis_batch_failed";
+	mkdir(directory.c_str(), 0755);
+	const std::string good = directory + "/good.bin";
+	const std::string bad = directory + "/bad.bin";
+	const std::vector<ProcessControlBlock_t> pcbs = { { 5, 0, 0, false }, { 3, 1, 1, false }, { 8, 2, 2, false } };
+	ASSERT_TRUE(write_pcb_file(good.c_str(), pcbs));
+	ASSERT_TRUE(write_pcb_file(bad.c_str(), pcbs));
+	ASSERT_EQ(0, truncate(bad.c_str(), 4 + 12 * 2));
+
+	// The good file is still reported and summarized, but the summary is marked incomplete
+	std::string output;
+	EXPECT_NE(0, run_command(std::string(ANALYSIS_PATH) + " --batch " + directory + " FCFS --format csv", output));
+	BatchSummaryRow row;
+	ASSERT_TRUE(batch_summary_row(output, "FCFS", row)) << output;
+	EXPECT_EQ(0, row.complete);
+	EXPECT_EQ(pcbs.size(), row.pcbs);
+
+	// As is a batch with nothing in it
+	EXPECT_NE(0, run_command(std::string(ANALYSIS_PATH) + " --batch '" + directory + "/nomatch*' ALL 4 2>/dev/null", output));
+	remove(good.c_str());
+	remove(bad.c_str());
+	EXPECT_NE(0, run_command(std::string(ANALYSIS_PATH) + " --batch " + directory + " ALL 4 2>/dev/null", output));
+	rmdir(directory.c_str());
+}
+
+TEST(analysis_batch, TraceRecordsEachAlgorithmOnce) {
+	const char* input = "../test/valid.bin";
+	const char* analysis_trace = "analysis_trace.bin";
+	const char* direct_trace = "analysis_trace_direct.bin";
+
+	// ALL without a quantum, run straight through the library: one traced run per algorithm, in the same order
+	ScheduleTrace_t* trace = schedule_trace_open(direct_trace, 0);
+	ASSERT_NE(nullptr, trace);
+	schedule_trace_attach(trace);
+	bool (*const schedulers[])(dyn_array_t*, ScheduleResult_t*) = { first_come_first_serve, shortest_job_first, priority, shortest_remaining_time_first };
+	for (auto scheduler : schedulers)
+	{
+		dyn_array_t* ready_queue = load_process_control_blocks(input);
+		ASSERT_NE(nullptr, ready_queue);
+		ScheduleResult_t result;
+		EXPECT_TRUE(scheduler(ready_queue, &result));
+		dyn_array_destroy(ready_queue);
+	}
+	schedule_trace_attach(NULL);
+	ASSERT_TRUE(schedule_trace_close(trace));
+
+	// Every format but markdown also works out the latency tails, which must not show up in the trace
+	for (const char* format : { "text", "markdown" })
+	{
+		std::string output;
+		ASSERT_EQ(0, run_command(std::string(ANALYSIS_PATH) + " " + input + " ALL --trace " + analysis_trace + " --format " + format, output)) << output;
+		dyn_array_t* expected = load_schedule_trace(direct_trace);
+		dyn_array_t* actual = load_schedule_trace(analysis_trace);
+		ASSERT_NE(nullptr, expected);
+		ASSERT_NE(nullptr, actual);
+		size_t begins = 0;
+		ASSERT_EQ(dyn_array_size(expected), dyn_array_size(actual)) << format;
+		for (size_t i = 0; i < dyn_array_size(actual); i++)
+		{
+			const ScheduleTraceEvent_t* want = (const ScheduleTraceEvent_t*)dyn_array_at(expected, i);
+			const ScheduleTraceEvent_t* got = (const ScheduleTraceEvent_t*)dyn_array_at(actual, i);
+			EXPECT_EQ(want->time, got->time) << format << " at " << i;
+			EXPECT_EQ(want->pid, got->pid) << format << " at " << i;
+			EXPECT_EQ(want->event, got->event) << format << " at " << i;
+			begins += got->event == SCHEDULE_TRACE_BEGIN;
+		}
+		EXPECT_EQ((size_t)4, begins) << format;
+		dyn_array_destroy(expected);
+		dyn_array_destroy(actual);
+	}
+	remove(analysis_trace);
+	remove(direct_trace);
+}
+
+/*
+*  ANALYSIS SERVER UNIT TEST CASES
+**/
+
+// Connects to analysis --serve, replies that take over 5 seconds count as missing
+static int server_connect(const char* socket_path)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1) { return -1; }
+	const struct timeval timeout = { 5, 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) { close(fd); return -1; }
+	return fd;
+}
+
+// Sends request lines and returns the reply line to the last one (empty if there was none)
+static std::string server_request(const int fd, const std::string& requests)
+{
+	if (send(fd, requests.data(), requests.size(), MSG_NOSIGNAL) != (ssize_t)requests.size()) { return ""; }
+	const size_t expected = std::count(requests.begin(), requests.end(), '\n');
+	std::string replies;
+	char c;
+	while ((size_t)std::count(replies.begin(), replies.end(), '\n') < expected && recv(fd, &c, 1, 0) == 1) { replies += c; }
+	if (replies.empty() || replies.back() != '\n') { return ""; }
+	replies.pop_back();
+	return replies.substr(replies.find_last_of('\n') + 1);
+}
+
+// The reply the server gives for a scheduler run on a file
+static std::string server_expected(const char* path, bool (*scheduler)(dyn_array_t*, ScheduleResult_t*), const size_t quantum)
+{
+	dyn_array_t* ready_queue = load_process_control_blocks(path);
+	if (ready_queue == NULL) { return ""; }
+	ScheduleResult_t result;
+	const bool success = scheduler ? scheduler(ready_queue, &result) : round_robin(ready_queue, &result, quantum);
+	dyn_array_destroy(ready_queue);
+	if (!success) { return ""; }
+	char reply[128];
+	snprintf(reply, sizeof(reply), "OK %.9g %.9g %lu", result.average_waiting_time, result.average_turnaround_time, result.total_run_time);
+	return reply;
+}
+
+// Kills the server if a test stops before shutting it down
+struct ServerProcess
+{
+	pid_t pid;
+	~ServerProcess() { if (pid > 0) { kill(pid, SIGKILL); waitpid(pid, NULL, 0); } }
+};
+
+TEST(analysis_server, AnswersAroundIdleClientsAndKeepsItsCacheRight) {
+	const char* socket_path = "analysis_server.sock";
+	const char* a = "analysis_server_a.bin";
+	const char* b = "analysis_server_b.bin";
+	const char* c = "analysis_server_c.bin";
+	std::vector<ProcessControlBlock_t> pcbs = { { 9, 0, 0, false }, { 4, 1, 1, false }, { 7, 2, 2, false }, { 2, 3, 9, false } };
+	ASSERT_TRUE(write_pcb_file(a, pcbs));
+	ASSERT_TRUE(write_pcb_file(b, pcbs));
+	ASSERT_TRUE(write_pcb_file(c, pcbs));
+
+	// Two threads (the poller and one worker) and room for two files
+	ServerProcess server = { fork() };
+	ASSERT_NE(-1, server.pid);
+	if (server.pid == 0)
+	{
+		execl(ANALYSIS_PATH, "analysis", "--serve", socket_path, "--threads", "2", "--cache-size", "2", (char*)NULL);
+		_exit(127);
+	}
+	// More idle clients than threads, one of them halfway through a request, don't hold up the ones after them
+	int idle[3] = { -1, -1, -1 };
+	for (int attempt = 0; attempt < 500 && idle[0] == -1; attempt++)
+	{
+		idle[0] = server_connect(socket_path);
+		if (idle[0] == -1) { usleep(10000); }
+	}
+	ASSERT_NE(-1, idle[0]);
+	ASSERT_EQ(7, send(idle[0], "FCFS 0 ", 7, MSG_NOSIGNAL));
+	for (int i = 1; i < 3; i++) { idle[i] = server_connect(socket_path); ASSERT_NE(-1, idle[i]); }
+	const int client = server_connect(socket_path);
+	ASSERT_NE(-1, client);
+	ASSERT_EQ("OK 0 0 0", server_request(client, "STATS\n"));
+
+	// A miss, then a hit, with several requests in one send
+	EXPECT_EQ(server_expected(a, shortest_job_first, 0), server_request(client, "FCFS 0 " + std::string(a) + "\nSJF 0 " + a + "\n"));
+	EXPECT_EQ(server_expected(a, first_come_first_serve, 0), server_request(client, "FCFS 0 " + std::string(a) + "\n"));
+	EXPECT_EQ("OK 2 1 1", server_request(client, "STATS\n"));
+	EXPECT_EQ(server_expected(a, first_come_first_serve, 0), server_request(idle[0], std::string(a) + "\n"));
+
+	// Round robin results are kept per quantum
+	const std::string rr1 = server_expected(a, NULL, 1), rr3 = server_expected(a, NULL, 3);
+	ASSERT_NE(rr1, rr3);
+	EXPECT_EQ(rr1, server_request(client, "RR 1 " + std::string(a) + "\n"));
+	EXPECT_EQ(rr3, server_request(client, "RR 3 " + std::string(a) + "\n"));
+	EXPECT_EQ(rr1, server_request(client, "RR 1 " + std::string(a) + "\n"));
+	EXPECT_EQ("ERR RR needs a quantum", server_request(client, "RR 0 " + std::string(a) + "\n"));
+
+	// A file rewritten with another size, or replaced by another file (new inode), is loaded again
+	EXPECT_EQ("OK 6 1 1", server_request(client, "STATS\n"));
+	pcbs.push_back({ 30, 0, 10, false });
+	ASSERT_TRUE(write_pcb_file(a, pcbs));
+	EXPECT_EQ(server_expected(a, first_come_first_serve, 0), server_request(client, "FCFS 0 " + std::string(a) + "\n"));
+	EXPECT_EQ("OK 6 2 1", server_request(client, "STATS\n"));
+	pcbs.back().remaining_burst_time = 1;
+	const std::string replacement = std::string(a) + ".new";
+	ASSERT_TRUE(write_pcb_file(replacement.c_str(), pcbs));
+	ASSERT_EQ(0, rename(replacement.c_str(), a));
+	EXPECT_EQ(server_expected(a, first_come_first_serve, 0), server_request(client, "FCFS 0 " + std::string(a) + "\n"));
+	EXPECT_EQ("OK 6 3 1", server_request(client, "STATS\n"));
+
+	// The least recently used file goes first: a, b, a again, then c pushes out b
+	EXPECT_EQ(server_expected(b, first_come_first_serve, 0), server_request(client, "FCFS 0 " + std::string(b) + "\n"));
+	EXPECT_EQ(server_expected(a, first_come_first_serve, 0), server_request(client, "FCFS 0 " + std::string(a) + "\n"));
+	EXPECT_EQ(server_expected(c, first_come_first_serve, 0), server_request(client, "FCFS 0 " + std::string(c) + "\n"));
+	EXPECT_EQ("OK 7 5 2", server_request(client, "STATS\n"));
+	EXPECT_EQ(server_expected(a, first_come_first_serve, 0), server_request(client, "FCFS 0 " + std::string(a) + "\n"));
+	EXPECT_EQ("OK 8 5 2", server_request(client, "STATS\n"));
+	EXPECT_EQ(server_expected(b, first_come_first_serve, 0), server_request(client, "FCFS 0 " + std::string(b) + "\n"));
+	EXPECT_EQ("OK 8 6 2", server_request(client, "STATS\n"));
+
+	EXPECT_EQ("ERR could not load no_such_pcbs.bin", server_request(client, "FCFS 0 no_such_pcbs.bin\n"));
+	EXPECT_EQ("OK", server_request(client, "SHUTDOWN\n"));
+	int status = 0;
+	ASSERT_EQ(server.pid, waitpid(server.pid, &status, 0));
+	server.pid = -1;
+	EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	EXPECT_NE(0, access(socket_path, F_OK));
+
+	for (int fd : idle) { close(fd); }
+	close(client);
+	remove(a);
+	remove(b);
+	remove(c);
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest(&argc, argv);